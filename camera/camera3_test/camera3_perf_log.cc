@@ -95,6 +95,16 @@ bool Camera3PerfLog::UpdateFrameEvent(int cam_id,
   return true;
 }
 
+void Camera3PerfLog::UpdateCaptureToBlobLatency(int cam_id,
+                                                int num_threads,
+                                                base::TimeDelta latency) {
+  VLOGF(1) << "Updating capture-to-blob latency of camera " << cam_id
+           << " with " << num_threads
+           << " threads: " << latency.InMicroseconds() << " us";
+  capture_to_blob_latencies_[cam_id][num_threads].push_back(
+      latency.InMicroseconds());
+}
+
 std::vector<std::pair<std::string, int64_t>> Camera3PerfLog::CollectPerfLogs(
     int cam_id) const {
   std::vector<std::pair<std::string, int64_t>> perf_logs;
@@ -196,6 +206,18 @@ std::vector<std::pair<std::string, int64_t>> Camera3PerfLog::CollectPerfLogs(
     }
   }
 
+  // Capture-to-blob latencies for each number of SW encode threads.
+  if (base::ContainsKey(capture_to_blob_latencies_, cam_id)) {
+    for (const auto& it : capture_to_blob_latencies_.at(cam_id)) {
+      const std::vector<int64_t>& logs = it.second;
+      if (logs.empty())
+        continue;
+      perf_logs.emplace_back(
+          base::StringPrintf("capture_to_blob_latency_%d_threads", it.first),
+          std::accumulate(logs.begin(), logs.end(), 0) / logs.size());
+    }
+  }
+
   return perf_logs;
 }
 
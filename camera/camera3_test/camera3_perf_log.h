@@ -43,6 +43,12 @@ class Camera3PerfLog final {
                         FrameEvent event,
                         base::TimeTicks time);
 
+  // Update the latency from submitting a still capture request to receiving
+  // its JPEG blob, with |num_threads| SW encode threads configured in the HAL
+  void UpdateCaptureToBlobLatency(int cam_id,
+                                  int num_threads,
+                                  base::TimeDelta latency);
+
  private:
   Camera3PerfLog() {}
 
@@ -65,6 +71,9 @@ class Camera3PerfLog final {
   std::map<int, std::map<uint32_t, std::map<FrameEvent, base::TimeTicks>>>
       frame_events_;
 
+  // Record capture-to-blob latencies with camera id and number of threads
+  std::map<int, std::map<int, std::vector<int64_t>>> capture_to_blob_latencies_;
+
   DISALLOW_COPY_AND_ASSIGN(Camera3PerfLog);
 };
 
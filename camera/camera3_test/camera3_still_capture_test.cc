@@ -6,6 +6,13 @@
 
 #include <algorithm>
 
+#include <base/sys_info.h>
+#include <base/timer/elapsed_timer.h>
+
+#include "camera3_test/camera3_perf_log.h"
+#include "cros-camera/constants.h"
+#include "cros-camera/utils/camera_config.h"
+
 namespace camera3_test {
 
 void Camera3StillCaptureFixture::SetUp() {
@@ -264,6 +271,65 @@ TEST_P(Camera3JpegResolutionTest, JpegResolutionTest) {
       << "JPEG size result and request should match";
 }
 
+// Test parameters:
+// - Camera ID
+class Camera3CaptureToBlobLatencyTest
+    : public Camera3StillCaptureFixture,
+      public ::testing::WithParamInterface<int32_t> {
+ public:
+  Camera3CaptureToBlobLatencyTest()
+      : Camera3StillCaptureFixture(std::vector<int>(1, GetParam())),
+        cam_id_(GetParam()) {}
+
+ protected:
+  int cam_id_;
+};
+
+TEST_P(Camera3CaptureToBlobLatencyTest, CaptureToBlobLatencyTest) {
+  const int kNumIterations = 5;
+
+  // Tag the latencies with the number of SW encode threads the HAL reads from
+  // the same config, so that runs with different settings can be compared.
+  std::unique_ptr<cros::CameraConfig> camera_config =
+      cros::CameraConfig::Create(cros::constants::kCrosCameraConfigPathString);
+  int jpeg_sw_encode_threads =
+      camera_config->GetInteger(cros::constants::kCrosJpegSwEncodeThreads,
+                                base::SysInfo::NumberOfProcessors());
+
+  ResolutionInfo jpeg_resolution =
+      cam_service_.GetStaticInfo(cam_id_)
+          ->GetSortedOutputResolutions(HAL_PIXEL_FORMAT_BLOB)
+          .back();
+  ResolutionInfo preview_resolution =
+      cam_service_.GetStaticInfo(cam_id_)
+          ->GetSortedOutputResolutions(HAL_PIXEL_FORMAT_IMPLEMENTATION_DEFINED)
+          .back();
+  ResolutionInfo recording_resolution(0, 0);
+  ASSERT_EQ(
+      0, cam_service_.StartPreview(cam_id_, preview_resolution, jpeg_resolution,
+                                   recording_resolution));
+
+  const camera_metadata_t* metadata =
+      cam_service_.ConstructDefaultRequestSettings(
+          cam_id_, CAMERA3_TEMPLATE_STILL_CAPTURE);
+  for (int i = 0; i < kNumIterations; i++) {
+    base::ElapsedTimer timer;
+    cam_service_.TakeStillCapture(cam_id_, metadata);
+    struct timespec timeout;
+    clock_gettime(CLOCK_REALTIME, &timeout);
+    timeout.tv_sec += 1;  // 1 second per capture
+    ASSERT_EQ(0, WaitStillCaptureResult(cam_id_, timeout))
+        << "Waiting for still capture result timeout";
+    Camera3PerfLog::GetInstance()->UpdateCaptureToBlobLatency(
+        cam_id_, jpeg_sw_encode_threads, timer.Elapsed());
+  }
+  cam_service_.StopPreview(cam_id_);
+
+  ASSERT_EQ(kNumIterations,
+            still_capture_results_[cam_id_].buffer_handles.size())
+      << "Incorrect number of still captures received";
+}
+
 INSTANTIATE_TEST_CASE_P(
     Camera3StillCaptureTest,
     Camera3SimpleStillCaptureTest,
@@ -292,4 +358,9 @@ INSTANTIATE_TEST_CASE_P(
     Camera3JpegResolutionTest,
     ::testing::ValuesIn(IterateCameraIdPreviewJpegResolution()));
 
+INSTANTIATE_TEST_CASE_P(
+    Camera3StillCaptureTest,
+    Camera3CaptureToBlobLatencyTest,
+    ::testing::ValuesIn(Camera3Module().GetTestCameraIds()));
+
 }  // namespace camera3_test
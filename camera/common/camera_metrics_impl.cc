@@ -60,8 +60,31 @@ constexpr base::TimeDelta kMaxCameraSessionDuration =
     base::TimeDelta::FromDays(1);
 constexpr int kBucketCameraSessionDuration = 100;
 
+constexpr char kCameraRequestStageLatency[] =
+    "ChromeOS.Camera.RequestStage.Latency.%s";
+
 }  // namespace
 
+const char* RequestStageToString(RequestStage stage) {
+  switch (stage) {
+    case RequestStage::kWaitBufferSync:
+      return "WaitBufferSync";
+    case RequestStage::kDequeueFrame:
+      return "DequeueFrame";
+    case RequestStage::kDecode:
+      return "Decode";
+    case RequestStage::kConvert:
+      return "Convert";
+    case RequestStage::kEncode:
+      return "Encode";
+    case RequestStage::kWriteStreamBuffers:
+      return "WriteStreamBuffers";
+    case RequestStage::kTotal:
+      return "Total";
+  }
+  return "Unknown";
+}
+
 // static
 std::unique_ptr<CameraMetrics> CameraMetrics::New() {
   return std::make_unique<CameraMetricsImpl>();
@@ -169,4 +192,13 @@ void CameraMetricsImpl::SendSessionDuration(base::TimeDelta duration) {
                           kBucketCameraSessionDuration);
 }
 
+void CameraMetricsImpl::SendRequestStageLatency(RequestStage stage,
+                                                base::TimeDelta latency) {
+  std::string action_name = base::StringPrintf(kCameraRequestStageLatency,
+                                                RequestStageToString(stage));
+  metrics_lib_->SendToUMA(action_name, latency.InMicroseconds(),
+                          kMinLatency.InMicroseconds(),
+                          kMaxLatency.InMicroseconds(), kBucketLatency);
+}
+
 }  // namespace cros
@@ -40,6 +40,8 @@ class CameraMetricsImpl : public CameraMetrics {
   void SendError(int error_code) override;
   void SendCameraFacing(int facing) override;
   void SendSessionDuration(base::TimeDelta duration) override;
+  void SendRequestStageLatency(RequestStage stage,
+                               base::TimeDelta latency) override;
 
  private:
   std::unique_ptr<MetricsLibraryInterface> metrics_lib_;
@@ -6,16 +6,19 @@
 
 #include "common/jpeg_compressor_impl.h"
 
+#include <algorithm>
 #include <memory>
 #include <utility>
 
 #include <errno.h>
 #include <libyuv.h>
+#include <string.h>
 #include <linux/videodev2.h>
 #include <time.h>
 
 #include <base/memory/ptr_util.h>
 #include <base/memory/shared_memory.h>
+#include <base/strings/stringprintf.h>
 #include <base/timer/elapsed_timer.h>
 #include "cros-camera/camera_buffer_manager.h"
 #include "cros-camera/common.h"
@@ -30,6 +33,111 @@ struct destination_mgr {
   JpegCompressorImpl* compressor;
 };
 
+namespace {
+
+// The maximum number of threads used by tiled SW encode.
+const int kMaxSwEncodeThreads = 8;
+
+// Images smaller than this are always encoded on the calling thread, since the
+// cost of dispatching strips outweighs the speedup for them.
+const int kMinTiledEncodePixels = 1920 * 1080;
+
+// Height of a MCU row for YUV420 subsampling.
+const int kMcuHeight = 16;
+
+// JPEG markers used when stitching strips.
+const uint8_t kMarkerPrefix = 0xFF;
+const uint8_t kMarkerSoi = 0xD8;
+const uint8_t kMarkerEoi = 0xD9;
+const uint8_t kMarkerRst0 = 0xD0;
+const uint8_t kMarkerSof0 = 0xC0;
+const uint8_t kMarkerDri = 0xDD;
+const uint8_t kMarkerSos = 0xDA;
+
+// The destination manager that writes a strip into a growing vector.
+struct strip_destination_mgr {
+ public:
+  struct jpeg_destination_mgr mgr;
+  std::vector<uint8_t>* output;
+};
+
+void InitStripDestination(j_compress_ptr cinfo) {
+  strip_destination_mgr* dest =
+      reinterpret_cast<strip_destination_mgr*>(cinfo->dest);
+  dest->mgr.next_output_byte = dest->output->data();
+  dest->mgr.free_in_buffer = dest->output->size();
+}
+
+boolean EmptyStripOutputBuffer(j_compress_ptr cinfo) {
+  strip_destination_mgr* dest =
+      reinterpret_cast<strip_destination_mgr*>(cinfo->dest);
+  // The whole buffer has been filled when this is called. Double its size.
+  size_t used_size = dest->output->size();
+  dest->output->resize(used_size * 2);
+  dest->mgr.next_output_byte = dest->output->data() + used_size;
+  dest->mgr.free_in_buffer = used_size;
+  return true;
+}
+
+void TerminateStripDestination(j_compress_ptr cinfo) {
+  strip_destination_mgr* dest =
+      reinterpret_cast<strip_destination_mgr*>(cinfo->dest);
+  dest->output->resize(dest->output->size() - dest->mgr.free_in_buffer);
+}
+
+// Walks the markers of the JPEG image |data|. Stores the offset of the SOF0
+// marker in |sof_offset| and the offset of the entropy-coded data of the scan
+// in |scan_offset|. Returns false if |data| is not a baseline JPEG with a
+// restart interval and an EOI marker right after the scan.
+bool ParseStrip(const std::vector<uint8_t>& data,
+                size_t* sof_offset,
+                size_t* scan_offset) {
+  size_t size = data.size();
+  if (size < 4 || data[0] != kMarkerPrefix || data[1] != kMarkerSoi ||
+      data[size - 2] != kMarkerPrefix || data[size - 1] != kMarkerEoi) {
+    return false;
+  }
+  bool has_sof = false;
+  bool has_dri = false;
+  size_t pos = 2;
+  while (pos + 4 <= size) {
+    if (data[pos] != kMarkerPrefix) {
+      return false;
+    }
+    uint8_t marker = data[pos + 1];
+    size_t length = (data[pos + 2] << 8) | data[pos + 3];
+    if (marker == kMarkerSof0) {
+      has_sof = true;
+      *sof_offset = pos;
+    } else if (marker == kMarkerDri) {
+      has_dri = true;
+    } else if (marker == kMarkerSos) {
+      *scan_offset = pos + 2 + length;
+      return has_sof && has_dri && *scan_offset <= size - 2;
+    }
+    pos += 2 + length;
+  }
+  return false;
+}
+
+}  // namespace
+
+struct JpegCompressorImpl::StripTask {
+  const uint8_t* y_plane;
+  const uint8_t* u_plane;
+  const uint8_t* v_plane;
+  int width;
+  int height;
+  int quality;
+  const void* app1_buffer;
+  unsigned int app1_size;
+  // Whether the JFIF header is kept in front of |app1_buffer|.
+  bool keep_jfif_header;
+  // The encoded JPEG image of this strip.
+  std::vector<uint8_t> output;
+  bool result;
+};
+
 // static
 std::unique_ptr<JpegCompressor> JpegCompressor::GetInstance() {
   return std::make_unique<JpegCompressorImpl>();
@@ -39,6 +147,7 @@ JpegCompressorImpl::JpegCompressorImpl()
     : camera_metrics_(CameraMetrics::New()),
       hw_encoder_(nullptr),
       hw_encoder_started_(false),
+      sw_encode_threads_(1),
       out_buffer_ptr_(nullptr),
       out_buffer_size_(0),
       out_data_size_(0),
@@ -46,6 +155,11 @@ JpegCompressorImpl::JpegCompressorImpl()
 
 JpegCompressorImpl::~JpegCompressorImpl() {}
 
+void JpegCompressorImpl::SetSwEncodeThreads(int num_threads) {
+  sw_encode_threads_ = std::max(1, std::min(num_threads, kMaxSwEncodeThreads));
+  VLOGF(1) << "SW encode threads: " << sw_encode_threads_;
+}
+
 bool JpegCompressorImpl::CompressImage(const void* image,
                                        int width,
                                        int height,
@@ -390,6 +504,24 @@ bool JpegCompressorImpl::EncodeLegacy(const void* inYuv,
                                       void* out_buffer,
                                       uint32_t* out_data_size) {
   base::ElapsedTimer timer;
+  if (ShouldEncodeTiled(width, height)) {
+    // The single-threaded legacy encode below keeps the JFIF header along
+    // with the APP1 segment, so the strips do the same.
+    if (EncodeTiled(static_cast<const uint8_t*>(inYuv), width, height,
+                    jpeg_quality, app1_buffer, app1_size,
+                    /*keep_jfif_header=*/true, out_buffer_size, out_buffer,
+                    out_data_size)) {
+      camera_metrics_->SendJpegProcessLatency(JpegProcessType::kEncode,
+                                              JpegProcessMethod::kSoftware,
+                                              timer.Elapsed());
+      camera_metrics_->SendJpegResolution(JpegProcessType::kEncode,
+                                          JpegProcessMethod::kSoftware, width,
+                                          height);
+      return true;
+    }
+    LOGF(WARNING) << "Tiled SW encode failed. Fall back to single thread";
+  }
+
   out_buffer_ptr_ = static_cast<JOCTET*>(out_buffer);
   out_buffer_size_ = out_buffer_size;
 
@@ -572,6 +704,21 @@ bool JpegCompressorImpl::EncodeSw(const android_ycbcr& input_ycbcr,
     return false;
   }
 
+  if (ShouldEncodeTiled(width, height)) {
+    if (EncodeTiled(i420_y_plane, width, height, jpeg_quality, app1_buffer,
+                    app1_size, /*keep_jfif_header=*/false, output_buffer_size,
+                    output_ptr, out_data_size)) {
+      camera_metrics_->SendJpegProcessLatency(JpegProcessType::kEncode,
+                                              JpegProcessMethod::kSoftware,
+                                              timer.Elapsed());
+      camera_metrics_->SendJpegResolution(JpegProcessType::kEncode,
+                                          JpegProcessMethod::kSoftware, width,
+                                          height);
+      return true;
+    }
+    LOGF(WARNING) << "Tiled SW encode failed. Fall back to single thread";
+  }
+
   out_buffer_ptr_ = static_cast<JOCTET*>(output_ptr);
   out_buffer_size_ = output_buffer_size;
 
@@ -615,6 +762,212 @@ bool JpegCompressorImpl::EncodeSw(const android_ycbcr& input_ycbcr,
   return is_encode_success_;
 }
 
+bool JpegCompressorImpl::ShouldEncodeTiled(int width, int height) const {
+  return sw_encode_threads_ > 1 && width * height >= kMinTiledEncodePixels;
+}
+
+bool JpegCompressorImpl::EncodeTiled(const uint8_t* yuv,
+                                     int width,
+                                     int height,
+                                     int jpeg_quality,
+                                     const void* app1_buffer,
+                                     unsigned int app1_size,
+                                     bool keep_jfif_header,
+                                     uint32_t out_buffer_size,
+                                     void* out_buffer,
+                                     uint32_t* out_data_size) {
+  // The calling thread encodes the first strip.
+  while (encode_threads_.size() < static_cast<size_t>(sw_encode_threads_ - 1)) {
+    auto thread = std::make_unique<base::Thread>(
+        base::StringPrintf("JpegEncodeWorker%zu", encode_threads_.size()));
+    if (!thread->Start()) {
+      LOGF(ERROR) << "Failed to start JPEG encode worker thread";
+      return false;
+    }
+    encode_threads_.push_back(std::move(thread));
+  }
+
+  // Every strip but the last one covers whole MCU rows, so that restart
+  // intervals line up after the strips are concatenated.
+  int mcu_rows = (height + kMcuHeight - 1) / kMcuHeight;
+  int num_strips = std::min(sw_encode_threads_, mcu_rows);
+  int strip_height = (mcu_rows + num_strips - 1) / num_strips * kMcuHeight;
+  num_strips = (height + strip_height - 1) / strip_height;
+
+  const uint8_t* y_plane = yuv;
+  const uint8_t* u_plane = y_plane + width * height;
+  const uint8_t* v_plane = u_plane + width * height / 4;
+  std::vector<StripTask> tasks(num_strips);
+  for (int i = 0; i < num_strips; ++i) {
+    int top = i * strip_height;
+    StripTask& task = tasks[i];
+    task.y_plane = y_plane + top * width;
+    task.u_plane = u_plane + top / 2 * (width / 2);
+    task.v_plane = v_plane + top / 2 * (width / 2);
+    task.width = width;
+    task.height = std::min(strip_height, height - top);
+    task.quality = jpeg_quality;
+    // Only the header of the first strip is kept in the final image.
+    task.app1_buffer = i == 0 ? app1_buffer : nullptr;
+    task.app1_size = i == 0 ? app1_size : 0;
+    task.keep_jfif_header = keep_jfif_header;
+    task.output.resize(width * task.height / 2 + task.app1_size);
+    task.result = false;
+  }
+
+  std::vector<std::unique_ptr<base::WaitableEvent>> done_events;
+  for (int i = 1; i < num_strips; ++i) {
+    done_events.push_back(std::make_unique<base::WaitableEvent>(
+        base::WaitableEvent::ResetPolicy::MANUAL,
+        base::WaitableEvent::InitialState::NOT_SIGNALED));
+    encode_threads_[i - 1]->task_runner()->PostTask(
+        FROM_HERE,
+        base::Bind(&JpegCompressorImpl::EncodeStrip,
+                   base::Unretained(&tasks[i]),
+                   base::Unretained(done_events.back().get())));
+  }
+  EncodeStrip(&tasks[0], nullptr);
+  for (const auto& event : done_events) {
+    event->Wait();
+  }
+
+  for (const auto& task : tasks) {
+    if (!task.result) {
+      LOGF(ERROR) << "Failed to encode JPEG strip";
+      return false;
+    }
+  }
+  return StitchStrips(tasks, height, out_buffer_size, out_buffer,
+                      out_data_size);
+}
+
+// static
+void JpegCompressorImpl::EncodeStrip(StripTask* task,
+                                     base::WaitableEvent* done) {
+  jpeg_compress_struct cinfo;
+  jpeg_error_mgr jerr;
+
+  cinfo.err = jpeg_std_error(&jerr);
+  // Override output_message() to print error log with ALOGE().
+  cinfo.err->output_message = &OutputErrorMessage;
+  jpeg_create_compress(&cinfo);
+
+  strip_destination_mgr dest;
+  dest.output = &task->output;
+  dest.mgr.init_destination = &InitStripDestination;
+  dest.mgr.empty_output_buffer = &EmptyStripOutputBuffer;
+  dest.mgr.term_destination = &TerminateStripDestination;
+  cinfo.dest = &dest.mgr;
+
+  SetJpegCompressStruct(task->width, task->height, task->quality, &cinfo);
+  // Emit a restart marker after every MCU row, so the entropy-coded data of
+  // the strips can be concatenated without re-encoding.
+  cinfo.restart_in_rows = 1;
+
+  if (task->app1_buffer != nullptr && task->app1_size > 0 &&
+      !task->keep_jfif_header) {
+    cinfo.write_Adobe_marker = false;
+    cinfo.write_JFIF_header = false;
+  }
+
+  jpeg_start_compress(&cinfo, TRUE);
+
+  if (task->app1_buffer != nullptr && task->app1_size > 0) {
+    jpeg_write_marker(&cinfo, JPEG_APP0 + 1,
+                      static_cast<const JOCTET*>(task->app1_buffer),
+                      task->app1_size);
+  }
+
+  int uv_stride = task->width / 2;
+  task->result = CompressPlanes(&cinfo, task->y_plane, task->u_plane,
+                                task->v_plane, task->width, uv_stride);
+  jpeg_finish_compress(&cinfo);
+  jpeg_destroy_compress(&cinfo);
+
+  if (done != nullptr) {
+    done->Signal();
+  }
+}
+
+// static
+bool JpegCompressorImpl::StitchStrips(const std::vector<StripTask>& tasks,
+                                      int height,
+                                      uint32_t out_buffer_size,
+                                      void* out_buffer,
+                                      uint32_t* out_data_size) {
+  uint8_t* out = static_cast<uint8_t*>(out_buffer);
+  size_t out_size = 0;
+  // Restart markers cycle through RST0 to RST7 across the whole image.
+  int next_rst = 0;
+  for (size_t i = 0; i < tasks.size(); ++i) {
+    const std::vector<uint8_t>& data = tasks[i].output;
+    size_t sof_offset = 0;
+    size_t scan_offset = 0;
+    if (!ParseStrip(data, &sof_offset, &scan_offset)) {
+      LOGF(ERROR) << "Malformed JPEG strip " << i;
+      return false;
+    }
+
+    if (i == 0) {
+      // Keep the headers of the first strip and patch the image height in
+      // SOF0.
+      if (scan_offset > out_buffer_size) {
+        LOGF(ERROR) << "Output buffer is too small";
+        return false;
+      }
+      memcpy(out, data.data(), scan_offset);
+      out[sof_offset + 5] = static_cast<uint8_t>(height >> 8);
+      out[sof_offset + 6] = static_cast<uint8_t>(height & 0xff);
+      out_size = scan_offset;
+    } else {
+      // The previous strip ends at a MCU row boundary without a restart
+      // marker.
+      if (out_size + 2 > out_buffer_size) {
+        LOGF(ERROR) << "Output buffer is too small";
+        return false;
+      }
+      out[out_size++] = kMarkerPrefix;
+      out[out_size++] = kMarkerRst0 + next_rst;
+      next_rst = (next_rst + 1) % 8;
+    }
+
+    // Copy the entropy-coded data and renumber its restart markers. Any other
+    // 0xFF byte in the scan is stuffed with 0x00.
+    const uint8_t* p = data.data() + scan_offset;
+    const uint8_t* end = data.data() + data.size() - 2;
+    while (p < end) {
+      const uint8_t* prefix =
+          static_cast<const uint8_t*>(memchr(p, kMarkerPrefix, end - p));
+      if (prefix != nullptr && prefix + 1 >= end) {
+        LOGF(ERROR) << "Truncated marker in JPEG strip " << i;
+        return false;
+      }
+      const uint8_t* next = prefix != nullptr ? prefix + 2 : end;
+      size_t length = next - p;
+      if (out_size + length > out_buffer_size) {
+        LOGF(ERROR) << "Output buffer is too small";
+        return false;
+      }
+      memcpy(out + out_size, p, length);
+      if (prefix != nullptr && (prefix[1] & 0xF8) == kMarkerRst0) {
+        out[out_size + length - 1] = kMarkerRst0 + next_rst;
+        next_rst = (next_rst + 1) % 8;
+      }
+      out_size += length;
+      p = next;
+    }
+  }
+
+  if (out_size + 2 > out_buffer_size) {
+    LOGF(ERROR) << "Output buffer is too small";
+    return false;
+  }
+  out[out_size++] = kMarkerPrefix;
+  out[out_size++] = kMarkerEoi;
+  *out_data_size = out_size;
+  return true;
+}
+
 void JpegCompressorImpl::SetJpegDestination(jpeg_compress_struct* cinfo) {
   destination_mgr* dest =
       static_cast<struct destination_mgr*>((*cinfo->mem->alloc_small)(
@@ -653,16 +1006,25 @@ void JpegCompressorImpl::SetJpegCompressStruct(int width,
 
 bool JpegCompressorImpl::Compress(jpeg_compress_struct* cinfo,
                                   const uint8_t* yuv) {
+  size_t y_plane_size = cinfo->image_width * cinfo->image_height;
+  size_t uv_plane_size = y_plane_size / 4;
+  return CompressPlanes(cinfo, yuv, yuv + y_plane_size,
+                        yuv + y_plane_size + uv_plane_size, cinfo->image_width,
+                        cinfo->image_width / 2);
+}
+
+// static
+bool JpegCompressorImpl::CompressPlanes(jpeg_compress_struct* cinfo,
+                                        const uint8_t* y_plane,
+                                        const uint8_t* u_plane,
+                                        const uint8_t* v_plane,
+                                        int y_stride,
+                                        int uv_stride) {
   JSAMPROW y[kCompressBatchSize];
   JSAMPROW cb[kCompressBatchSize / 2];
   JSAMPROW cr[kCompressBatchSize / 2];
   JSAMPARRAY planes[3]{y, cb, cr};
 
-  size_t y_plane_size = cinfo->image_width * cinfo->image_height;
-  size_t uv_plane_size = y_plane_size / 4;
-  uint8_t* y_plane = const_cast<uint8_t*>(yuv);
-  uint8_t* u_plane = const_cast<uint8_t*>(yuv + y_plane_size);
-  uint8_t* v_plane = const_cast<uint8_t*>(yuv + y_plane_size + uv_plane_size);
   std::unique_ptr<uint8_t[]> empty(new uint8_t[cinfo->image_width]);
   memset(empty.get(), 0, cinfo->image_width);
 
@@ -670,7 +1032,7 @@ bool JpegCompressorImpl::Compress(jpeg_compress_struct* cinfo,
     for (int i = 0; i < kCompressBatchSize; ++i) {
       size_t scanline = cinfo->next_scanline + i;
       if (scanline < cinfo->image_height) {
-        y[i] = y_plane + scanline * cinfo->image_width;
+        y[i] = const_cast<uint8_t*>(y_plane + scanline * y_stride);
       } else {
         y[i] = empty.get();
       }
@@ -679,9 +1041,9 @@ bool JpegCompressorImpl::Compress(jpeg_compress_struct* cinfo,
     for (int i = 0; i < kCompressBatchSize / 2; ++i) {
       size_t scanline = cinfo->next_scanline / 2 + i;
       if (scanline < cinfo->image_height / 2) {
-        int offset = scanline * (cinfo->image_width / 2);
-        cb[i] = u_plane + offset;
-        cr[i] = v_plane + offset;
+        int offset = scanline * uv_stride;
+        cb[i] = const_cast<uint8_t*>(u_plane + offset);
+        cr[i] = const_cast<uint8_t*>(v_plane + offset);
       } else {
         cb[i] = cr[i] = empty.get();
       }
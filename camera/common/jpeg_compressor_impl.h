@@ -17,6 +17,9 @@
 #include <string>
 #include <vector>
 
+#include <base/synchronization/waitable_event.h>
+#include <base/threading/thread.h>
+
 extern "C" {
 #include <jerror.h>
 #include <jpeglib.h>
@@ -34,6 +37,8 @@ class JpegCompressorImpl : public JpegCompressor {
   JpegCompressorImpl();
   ~JpegCompressorImpl() override;
 
+  void SetSwEncodeThreads(int num_threads) override;
+
   // To be deprecated.
   bool CompressImage(
       const void* image,
@@ -129,13 +134,56 @@ class JpegCompressorImpl : public JpegCompressor {
                 unsigned int app1_size,
                 uint32_t* out_data_size);
 
+  // Returns true if an image of |width|x|height| should be encoded with
+  // EncodeTiled().
+  bool ShouldEncodeTiled(int width, int height) const;
+
+  // Encodes the I420 image |yuv| by splitting it into horizontal strips that
+  // are encoded in parallel on |encode_threads_| and the calling thread. The
+  // strips are stitched into |out_buffer|. |keep_jfif_header| tells whether
+  // the JFIF header is written along with |app1_buffer|, which must match the
+  // single-threaded encode of the caller. Returns false if errors occur.
+  bool EncodeTiled(const uint8_t* yuv,
+                   int width,
+                   int height,
+                   int jpeg_quality,
+                   const void* app1_buffer,
+                   unsigned int app1_size,
+                   bool keep_jfif_header,
+                   uint32_t out_buffer_size,
+                   void* out_buffer,
+                   uint32_t* out_data_size);
+
+  // One horizontal strip of the image encoded by EncodeTiled().
+  struct StripTask;
+
+  // Encodes |task| into its own JPEG bitstream and signals |done| if it's not
+  // nullptr.
+  static void EncodeStrip(StripTask* task, base::WaitableEvent* done);
+
+  // Concatenates the bitstreams of |tasks| into a single JPEG image of
+  // |height| rows in |out_buffer|. Returns false if errors occur.
+  static bool StitchStrips(const std::vector<StripTask>& tasks,
+                           int height,
+                           uint32_t out_buffer_size,
+                           void* out_buffer,
+                           uint32_t* out_data_size);
+
   void SetJpegDestination(jpeg_compress_struct* cinfo);
-  void SetJpegCompressStruct(int width,
-                             int height,
-                             int quality,
-                             jpeg_compress_struct* cinfo);
+  static void SetJpegCompressStruct(int width,
+                                    int height,
+                                    int quality,
+                                    jpeg_compress_struct* cinfo);
   // Returns false if errors occur.
   bool Compress(jpeg_compress_struct* cinfo, const uint8_t* yuv);
+  // Compresses the I420 planes with the given strides. Returns false if errors
+  // occur.
+  static bool CompressPlanes(jpeg_compress_struct* cinfo,
+                             const uint8_t* y_plane,
+                             const uint8_t* u_plane,
+                             const uint8_t* v_plane,
+                             int y_stride,
+                             int uv_stride);
 
   // Metrics that used to record things like encoding latency.
   std::unique_ptr<CameraMetrics> camera_metrics_;
@@ -143,6 +191,12 @@ class JpegCompressorImpl : public JpegCompressor {
   std::unique_ptr<cros::JpegEncodeAccelerator> hw_encoder_;
   bool hw_encoder_started_;
 
+  // Number of threads used by EncodeTiled(), including the calling thread.
+  int sw_encode_threads_;
+
+  // Worker threads of EncodeTiled(). Started lazily.
+  std::vector<std::unique_ptr<base::Thread>> encode_threads_;
+
   // Process 16 lines of Y and 16 lines of U/V each time.
   // We must pass at least 16 scanlines according to libjpeg documentation.
   static const int kCompressBatchSize = 16;
@@ -0,0 +1,198 @@
+/*
+ * Copyright 2019 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "cros-camera/jpeg_compressor.h"
+
+#include <linux/videodev2.h>
+#include <stdio.h>
+
+#include <memory>
+#include <vector>
+
+#include <base/at_exit.h>
+#include <gtest/gtest.h>
+#include <jpeglib.h>
+
+namespace cros {
+
+namespace {
+
+// Large enough to be split into strips when more than one SW encode thread is
+// used. The height is not a multiple of the MCU height, so the last strip is
+// shorter than the others.
+constexpr int kWidth = 1920;
+constexpr int kHeight = 1080;
+constexpr int kQuality = 90;
+constexpr int kEncodeThreads = 4;
+
+struct DecodedImage {
+  int width = 0;
+  int height = 0;
+  bool has_jfif = false;
+  std::vector<uint8_t> app1;
+  // Interleaved YCbCr samples after upsampling.
+  std::vector<uint8_t> pixels;
+};
+
+// Fills an I420 image with gradients and noise, so the entropy-coded data
+// contains 0xFF bytes that have to be stuffed.
+std::vector<uint8_t> CreateI420Image(int width, int height) {
+  std::vector<uint8_t> image(width * height * 3 / 2);
+  uint32_t seed = 1;
+  for (size_t i = 0; i < image.size(); ++i) {
+    seed = seed * 1103515245 + 12345;
+    image[i] = static_cast<uint8_t>((i % width) / 8 + (seed >> 24) / 4);
+  }
+  return image;
+}
+
+std::vector<uint8_t> I420ToNV12(const std::vector<uint8_t>& i420,
+                                int width,
+                                int height) {
+  std::vector<uint8_t> nv12(i420.begin(), i420.begin() + width * height);
+  const uint8_t* u = i420.data() + width * height;
+  const uint8_t* v = u + width * height / 4;
+  for (int i = 0; i < width * height / 4; ++i) {
+    nv12.push_back(u[i]);
+    nv12.push_back(v[i]);
+  }
+  return nv12;
+}
+
+bool Decode(const std::vector<uint8_t>& jpeg, DecodedImage* image) {
+  jpeg_decompress_struct dinfo;
+  jpeg_error_mgr jerr;
+  dinfo.err = jpeg_std_error(&jerr);
+  jpeg_create_decompress(&dinfo);
+  jpeg_mem_src(&dinfo, const_cast<uint8_t*>(jpeg.data()), jpeg.size());
+  jpeg_save_markers(&dinfo, JPEG_APP0 + 1, 0xFFFF);
+  if (jpeg_read_header(&dinfo, TRUE) != JPEG_HEADER_OK) {
+    jpeg_destroy_decompress(&dinfo);
+    return false;
+  }
+  image->has_jfif = dinfo.saw_JFIF_marker;
+  for (jpeg_saved_marker_ptr marker = dinfo.marker_list; marker != nullptr;
+       marker = marker->next) {
+    if (marker->marker == JPEG_APP0 + 1) {
+      image->app1.assign(marker->data, marker->data + marker->data_length);
+    }
+  }
+
+  dinfo.out_color_space = JCS_YCbCr;
+  jpeg_start_decompress(&dinfo);
+  image->width = dinfo.output_width;
+  image->height = dinfo.output_height;
+  size_t row_size = dinfo.output_width * dinfo.output_components;
+  image->pixels.resize(row_size * dinfo.output_height);
+  while (dinfo.output_scanline < dinfo.output_height) {
+    JSAMPROW row = image->pixels.data() + dinfo.output_scanline * row_size;
+    jpeg_read_scanlines(&dinfo, &row, 1);
+  }
+  jpeg_finish_decompress(&dinfo);
+  jpeg_destroy_decompress(&dinfo);
+  return true;
+}
+
+}  // namespace
+
+class JpegCompressorImplTest : public ::testing::Test {
+ protected:
+  JpegCompressorImplTest()
+      : image_(CreateI420Image(kWidth, kHeight)),
+        app1_{'E', 'x', 'i', 'f', 0, 0, 'M', 'M', 0, 42} {}
+
+  void SetUp() override {
+    reference_compressor_ = JpegCompressor::GetInstance();
+    tiled_compressor_ = JpegCompressor::GetInstance();
+    ASSERT_NE(reference_compressor_, nullptr);
+    ASSERT_NE(tiled_compressor_, nullptr);
+    tiled_compressor_->SetSwEncodeThreads(kEncodeThreads);
+  }
+
+  // Encodes |image_| through the legacy I420 path and decodes the result.
+  void CompressImage(JpegCompressor* compressor,
+                     const std::vector<uint8_t>& app1,
+                     DecodedImage* decoded) {
+    std::vector<uint8_t> jpeg(image_.size());
+    uint32_t jpeg_size = 0;
+    ASSERT_TRUE(compressor->CompressImage(
+        image_.data(), kWidth, kHeight, kQuality,
+        app1.empty() ? nullptr : app1.data(), app1.size(), jpeg.size(),
+        jpeg.data(), &jpeg_size, JpegCompressor::Mode::kSwOnly));
+    jpeg.resize(jpeg_size);
+    ASSERT_TRUE(Decode(jpeg, decoded));
+  }
+
+  // Encodes |image_| through the NV12 path and decodes the result.
+  void CompressImageFromMemory(JpegCompressor* compressor,
+                               const std::vector<uint8_t>& app1,
+                               DecodedImage* decoded) {
+    std::vector<uint8_t> nv12 = I420ToNV12(image_, kWidth, kHeight);
+    std::vector<uint8_t> jpeg(image_.size());
+    uint32_t jpeg_size = 0;
+    ASSERT_TRUE(compressor->CompressImageFromMemory(
+        nv12.data(), V4L2_PIX_FMT_NV12, jpeg.data(), jpeg.size(), kWidth,
+        kHeight, kQuality, app1.empty() ? nullptr : app1.data(), app1.size(),
+        &jpeg_size));
+    jpeg.resize(jpeg_size);
+    ASSERT_TRUE(Decode(jpeg, decoded));
+  }
+
+  void ExpectSameImage(const DecodedImage& reference,
+                       const DecodedImage& tiled) {
+    EXPECT_EQ(reference.width, kWidth);
+    EXPECT_EQ(reference.height, kHeight);
+    EXPECT_EQ(tiled.width, reference.width);
+    EXPECT_EQ(tiled.height, reference.height);
+    EXPECT_EQ(tiled.has_jfif, reference.has_jfif);
+    EXPECT_EQ(tiled.app1, reference.app1);
+    // Restart markers only reset the DC prediction, so the decoded samples
+    // must be bit-exact.
+    EXPECT_TRUE(tiled.pixels == reference.pixels);
+  }
+
+  std::vector<uint8_t> image_;
+  std::vector<uint8_t> app1_;
+  std::unique_ptr<JpegCompressor> reference_compressor_;
+  std::unique_ptr<JpegCompressor> tiled_compressor_;
+};
+
+TEST_F(JpegCompressorImplTest, TiledLegacyEncodeMatchesSingleThread) {
+  DecodedImage reference;
+  DecodedImage tiled;
+  CompressImage(reference_compressor_.get(), {}, &reference);
+  CompressImage(tiled_compressor_.get(), {}, &tiled);
+  ExpectSameImage(reference, tiled);
+  EXPECT_TRUE(tiled.has_jfif);
+  EXPECT_TRUE(tiled.app1.empty());
+}
+
+TEST_F(JpegCompressorImplTest, TiledLegacyEncodeWithApp1MatchesSingleThread) {
+  DecodedImage reference;
+  DecodedImage tiled;
+  CompressImage(reference_compressor_.get(), app1_, &reference);
+  CompressImage(tiled_compressor_.get(), app1_, &tiled);
+  ExpectSameImage(reference, tiled);
+  EXPECT_EQ(tiled.app1, app1_);
+}
+
+TEST_F(JpegCompressorImplTest, TiledNV12EncodeWithApp1MatchesSingleThread) {
+  DecodedImage reference;
+  DecodedImage tiled;
+  CompressImageFromMemory(reference_compressor_.get(), app1_, &reference);
+  CompressImageFromMemory(tiled_compressor_.get(), app1_, &tiled);
+  ExpectSameImage(reference, tiled);
+  EXPECT_FALSE(tiled.has_jfif);
+  EXPECT_EQ(tiled.app1, app1_);
+}
+
+}  // namespace cros
+
+int main(int argc, char** argv) {
+  base::AtExitManager exit_manager;
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -11,6 +11,8 @@
 
 #include <hardware/camera3.h>
 
+#include <base/optional.h>
+#include <base/sys_info.h>
 #include <base/timer/elapsed_timer.h>
 #include "cros-camera/common.h"
 #include "cros-camera/exif_utils.h"
@@ -103,9 +105,10 @@ static bool ValidateThumbnailSize(
   return false;
 }
 
-CachedFrame::CachedFrame()
+CachedFrame::CachedFrame(RequestStageStats* request_stage_stats)
     : image_processor_(new ImageProcessor()),
       camera_metrics_(CameraMetrics::New()),
+      request_stage_stats_(request_stage_stats),
       jda_available_(false),
       force_jpeg_hw_encode_(false),
       force_jpeg_hw_decode_(false) {
@@ -124,6 +127,15 @@ CachedFrame::CachedFrame()
       constants::kCrosForceJpegHardwareDecodeOption, false);
   LOGF(INFO) << "Force JPEG hardware encode: " << force_jpeg_hw_encode_;
   LOGF(INFO) << "Force JPEG hardware decode: " << force_jpeg_hw_decode_;
+
+  // Read the number of SW JPEG encode threads from the camera config.
+  std::unique_ptr<CameraConfig> config =
+      CameraConfig::Create(constants::kCrosCameraConfigPathString);
+  int jpeg_sw_encode_threads =
+      config->GetInteger(constants::kCrosJpegSwEncodeThreads,
+                         base::SysInfo::NumberOfProcessors());
+  jpeg_compressor_->SetSwEncodeThreads(jpeg_sw_encode_threads);
+  LOGF(INFO) << "JPEG SW encode threads: " << jpeg_sw_encode_threads;
 }
 
 int CachedFrame::Convert(
@@ -178,6 +190,17 @@ int CachedFrame::Convert(
   // TODO(kamesan): optimize the SW paths to reduce I420 <-> NV12 copies, by
   // refactoring of the graph or libyuv support.
   //
+  // When MJPEG has to be decoded in SW and no rotation is needed, the graph
+  // above is replaced by a fused pipeline. The input is decoded in bands of
+  // MCU rows, and each band is cropped, scaled and converted into every output
+  // frame while it is still in cache:
+  //
+  //                 Crop + Scale + Convert
+  //      MJPEG band ----------------------> NV12/YU12/YV12 ( --> JPEG )
+  //
+  // Only one full-size NV12 frame is kept for a JPEG output with no same-size
+  // NV12 output to encode from.
+  //
   VLOGF(1) << "Input frame: " << in_frame.GetWidth() << "x"
            << in_frame.GetHeight() << " "
            << FormatToString(in_frame.GetFourcc()) << ", rotate "
@@ -189,6 +212,15 @@ int CachedFrame::Convert(
     return -EINVAL;
   }
 
+  if (CanConvertInBands(in_frame, rotate_degree, out_frames)) {
+    int ret = ConvertInBands(static_metadata, request_metadata, in_frame,
+                             out_frames, out_frame_status);
+    if (ret != -ENOTSUP) {
+      return ret;
+    }
+    VLOGF(1) << "Fall back to convert frame with full-frame buffers";
+  }
+
   // Try to find a temp NV12 buffer in |out_frames| that has the same size as
   // |in_frame|. If found, |in_frame| will be converted directly into it to save
   // a copy.
@@ -207,10 +239,17 @@ int CachedFrame::Convert(
     }
   }
 
-  FrameBuffer* nv12_frame;
+  // Otherwise a NV12 gralloc frame, as captured in dma-buf import mode, is
+  // converted from as is when it does not need rotation, which saves a copy
+  // into a temp NV12 buffer.
+  const bool use_in_frame =
+      nv12_frame_index == out_frames.size() && rotate_degree == 0 &&
+      in_frame.GetFourcc() == V4L2_PIX_FMT_NV12 && in_frame.GetBufferHandle();
+
+  FrameBuffer* nv12_frame = nullptr;
   if (nv12_frame_index < out_frames.size()) {
     nv12_frame = out_frames[nv12_frame_index].get();
-  } else {
+  } else if (!use_in_frame) {
     if (!ReallocateGrallocFrameBuffer(in_frame.GetWidth(), in_frame.GetHeight(),
                                       V4L2_PIX_FMT_NV12, &temp_nv12_frame_)) {
       return -EINVAL;
@@ -219,20 +258,25 @@ int CachedFrame::Convert(
   }
 
   // Convert |in_frame| into |nv12_frame|.
-  if (in_frame.GetFourcc() == V4L2_PIX_FMT_MJPEG) {
-    int ret = DecodeToNV12(in_frame, nv12_frame);
-    if (ret)
-      return ret;
-  } else {
-    if (nv12_frame->Map()) {
-      LOG(ERROR) << "Failed to map frame";
-      return -EINVAL;
+  base::Optional<ScopedRequestStage> stage;
+  if (nv12_frame) {
+    stage.emplace(request_stage_stats_, RequestStage::kDecode);
+    if (in_frame.GetFourcc() == V4L2_PIX_FMT_MJPEG) {
+      int ret = DecodeToNV12(in_frame, nv12_frame);
+      if (ret)
+        return ret;
+    } else {
+      if (nv12_frame->Map()) {
+        LOG(ERROR) << "Failed to map frame";
+        return -EINVAL;
+      }
+      int ret = image_processor_->ConvertFormat(in_frame, nv12_frame);
+      if (ret)
+        return ret;
     }
-    int ret = image_processor_->ConvertFormat(in_frame, nv12_frame);
-    if (ret)
-      return ret;
   }
 
+  stage.emplace(request_stage_stats_, RequestStage::kConvert);
   if (rotate_degree > 0) {
     int ret = CropRotateScale(rotate_degree, nv12_frame);
     if (ret)
@@ -242,6 +286,7 @@ int CachedFrame::Convert(
   // Convert |nv12_frame| into the output frames. At this time, this
   // function will always return 0 and record the per-output-frame conversion
   // status in |out_frame_status|.
+  const FrameBuffer& nv12_source = nv12_frame ? *nv12_frame : in_frame;
   out_frame_status->resize(out_frames.size());
   for (size_t i = 0; i < out_frames.size(); i++) {
     if (i == nv12_frame_index) {
@@ -254,7 +299,116 @@ int CachedFrame::Convert(
       continue;
     }
     (*out_frame_status)[i] = ConvertFromNV12(static_metadata, request_metadata,
-                                             *nv12_frame, out_frames[i].get());
+                                             nv12_source, out_frames[i].get());
+  }
+  return 0;
+}
+
+bool CachedFrame::CanConvertInBands(
+    const FrameBuffer& in_frame,
+    int rotate_degree,
+    const std::vector<std::unique_ptr<FrameBuffer>>& out_frames) const {
+  // HW JDA decodes into a NV12 buffer directly, so the default pipeline is
+  // preferred when it's available.
+  if (in_frame.GetFourcc() != V4L2_PIX_FMT_MJPEG || rotate_degree != 0 ||
+      jda_available_ || force_jpeg_hw_decode_) {
+    return false;
+  }
+  int num_jpeg_frames = 0;
+  for (const auto& out_frame : out_frames) {
+    if (out_frame->GetFourcc() == V4L2_PIX_FMT_JPEG) {
+      num_jpeg_frames++;
+    } else if (!ImageProcessor::IsSupportedBandFormat(
+                   out_frame->GetFourcc())) {
+      return false;
+    }
+  }
+  return num_jpeg_frames <= 1;
+}
+
+int CachedFrame::ConvertInBands(
+    const android::CameraMetadata& static_metadata,
+    const android::CameraMetadata& request_metadata,
+    const FrameBuffer& in_frame,
+    const std::vector<std::unique_ptr<FrameBuffer>>& out_frames,
+    std::vector<int>* out_frame_status) {
+  const Size in_size(in_frame.GetWidth(), in_frame.GetHeight());
+  out_frame_status->assign(out_frames.size(), 0);
+
+  std::vector<FrameBuffer*> band_frames;
+  std::vector<Size> crop_sizes;
+  size_t jpeg_frame_index = out_frames.size();
+  for (size_t i = 0; i < out_frames.size(); i++) {
+    FrameBuffer* out_frame = out_frames[i].get();
+    if (out_frame->Map()) {
+      LOG(ERROR) << "Failed to map frame";
+      (*out_frame_status)[i] = -EINVAL;
+      continue;
+    }
+    if (out_frame->GetFourcc() == V4L2_PIX_FMT_JPEG) {
+      jpeg_frame_index = i;
+      continue;
+    }
+    const Size out_size(out_frame->GetWidth(), out_frame->GetHeight());
+    band_frames.push_back(out_frame);
+    crop_sizes.push_back(CalculateCropSize(in_size, out_size));
+  }
+
+  // The JPEG output is encoded from a NV12 frame of the same size, which is
+  // taken from the other outputs if possible.
+  FrameBuffer* jpeg_frame = nullptr;
+  FrameBuffer* jpeg_src_frame = nullptr;
+  if (jpeg_frame_index < out_frames.size()) {
+    jpeg_frame = out_frames[jpeg_frame_index].get();
+    const Size jpeg_size(jpeg_frame->GetWidth(), jpeg_frame->GetHeight());
+    for (FrameBuffer* frame : band_frames) {
+      if (frame->GetWidth() == jpeg_size.width &&
+          frame->GetHeight() == jpeg_size.height &&
+          (frame->GetFourcc() == V4L2_PIX_FMT_NV12 ||
+           frame->GetFourcc() == V4L2_PIX_FMT_NV12M)) {
+        jpeg_src_frame = frame;
+        break;
+      }
+    }
+    if (jpeg_src_frame == nullptr) {
+      if (!ReallocateGrallocFrameBuffer(jpeg_size.width, jpeg_size.height,
+                                        V4L2_PIX_FMT_NV12,
+                                        &temp_nv12_frame2_)) {
+        return -EINVAL;
+      }
+      if (temp_nv12_frame2_->Map()) {
+        LOG(ERROR) << "Failed to map frame";
+        return -EINVAL;
+      }
+      jpeg_src_frame = temp_nv12_frame2_.get();
+      band_frames.push_back(jpeg_src_frame);
+      crop_sizes.push_back(CalculateCropSize(in_size, jpeg_size));
+    }
+  }
+
+  // Decoding and conversion are fused, and recorded as the decode stage. It is
+  // not recorded when the frame is left to the full-frame pipeline, which
+  // records its own decode stage.
+  const base::TimeTicks decode_start = base::TimeTicks::Now();
+  base::ElapsedTimer timer;
+  int ret =
+      image_processor_->DecodeMJPEGToFrames(in_frame, band_frames, crop_sizes);
+  if (ret != -ENOTSUP && request_stage_stats_) {
+    request_stage_stats_->Record(RequestStage::kDecode, decode_start);
+  }
+  if (ret) {
+    // An -EAGAIN lets HAL skip the corrupted frame.
+    return ret;
+  }
+  camera_metrics_->SendJpegProcessLatency(
+      JpegProcessType::kDecode, JpegProcessMethod::kSoftware, timer.Elapsed());
+  camera_metrics_->SendJpegResolution(
+      JpegProcessType::kDecode, JpegProcessMethod::kSoftware,
+      in_frame.GetWidth(), in_frame.GetHeight());
+
+  if (jpeg_frame != nullptr) {
+    (*out_frame_status)[jpeg_frame_index] = CompressNV12(
+        static_metadata, request_metadata, *jpeg_src_frame, jpeg_frame);
   }
   return 0;
 }
@@ -461,6 +615,7 @@ int CachedFrame::CompressNV12(const android::CameraMetadata& static_metadata,
                               const android::CameraMetadata& request_metadata,
                               const FrameBuffer& in_frame,
                               FrameBuffer* out_frame) {
+  ScopedRequestStage stage(request_stage_stats_, RequestStage::kEncode);
   ExifUtils utils;
   if (!utils.Initialize()) {
     LOGF(ERROR) << "ExifUtils initialization failed.";
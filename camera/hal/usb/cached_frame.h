@@ -15,6 +15,7 @@
 #include "cros-camera/jpeg_compressor.h"
 #include "cros-camera/jpeg_decode_accelerator.h"
 #include "hal/usb/image_processor.h"
+#include "hal/usb/request_stage_stats.h"
 
 namespace cros {
 
@@ -23,7 +24,9 @@ namespace cros {
 // format of libyuv, to allow convenient processing.
 class CachedFrame {
  public:
-  CachedFrame();
+  // The latency of decoding and conversion is recorded into
+  // |request_stage_stats| if it is not nullptr.
+  explicit CachedFrame(RequestStageStats* request_stage_stats);
 
   // Convert |in_frame| into |out_frames| with |rotate_degree|, cropping,
   // scaling, and format conversion. |rotate_degree| should be 0, 90, or 270.
@@ -40,6 +43,23 @@ class CachedFrame {
               std::vector<int>* out_frame_status);
 
  private:
+  // Returns true if |in_frame| can be converted into |out_frames| by
+  // ConvertInBands().
+  bool CanConvertInBands(
+      const FrameBuffer& in_frame,
+      int rotate_degree,
+      const std::vector<std::unique_ptr<FrameBuffer>>& out_frames) const;
+
+  // Decodes the MJPEG |in_frame| band by band and writes every band straight
+  // into |out_frames|, skipping the full-frame temporary buffers of the default
+  // pipeline. Returns -ENOTSUP if the default pipeline should be used instead.
+  int ConvertInBands(
+      const android::CameraMetadata& static_metadata,
+      const android::CameraMetadata& request_metadata,
+      const FrameBuffer& in_frame,
+      const std::vector<std::unique_ptr<FrameBuffer>>& out_frames,
+      std::vector<int>* out_frame_status);
+
   int ConvertFromNV12(const android::CameraMetadata& static_metadata,
                       const android::CameraMetadata& request_metadata,
                       const FrameBuffer& in_frame,
@@ -83,6 +103,8 @@ class CachedFrame {
   // Metrics that used to record things like decoding latency.
   std::unique_ptr<CameraMetrics> camera_metrics_;
 
+  RequestStageStats* request_stage_stats_;
+
   // Indicate if JDA started successfully
   bool jda_available_;
 
@@ -85,6 +85,10 @@ void SetEntry(const std::string& key,
   } else if (key == "constant_framerate_unsupported") {
     std::istringstream(value) >> std::boolalpha >>
         info->constant_framerate_unsupported;
+  } else if (key == "num_video_buffers") {
+    info->num_video_buffers = stoi(value);
+  } else if (key == "dmabuf_import") {
+    std::istringstream(value) >> std::boolalpha >> info->dmabuf_import;
   } else if (key == "quirks") {
     info->quirks = ParseQuirks(value);
   } else if (key == "lens_facing") {
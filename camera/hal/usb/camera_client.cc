@@ -59,11 +59,18 @@ CameraClient::CameraClient(int id,
   SupportedFormats supported_formats =
       device_->GetDeviceSupportedFormats(device_info_.device_path);
   qualified_formats_ =
-      GetQualifiedFormats(supported_formats, device_info_.quirks);
+      GetQualifiedFormats(supported_formats, device_info_.quirks,
+                          device_info_.dmabuf_import);
 
   metadata_handler_ = std::make_unique<MetadataHandler>(
       static_metadata, request_template, device_info, device_.get(),
       qualified_formats_);
+
+  std::unique_ptr<CameraConfig> camera_config =
+      CameraConfig::Create(constants::kCrosCameraTestConfigPathString);
+  request_stage_stats_ = std::make_unique<RequestStageStats>(
+      id_, camera_config->GetString(constants::kCrosUsbRequestTraceFileOption,
+                                    ""));
 }
 
 CameraClient::~CameraClient() {}
@@ -284,6 +291,7 @@ int CameraClient::ProcessCaptureRequest(camera3_capture_request_t* request) {
 
 void CameraClient::Dump(int fd) {
   VLOGFID(1, id_);
+  request_stage_stats_->Dump(fd);
 }
 
 int CameraClient::Flush(const camera3_device_t* dev) {
@@ -364,7 +372,8 @@ int CameraClient::StreamOn(Size stream_on_resolution,
 
     request_handler_.reset(new RequestHandler(
         id_, device_info_, static_metadata_, device_.get(), callback_ops_,
-        request_task_runner_, metadata_handler_.get()));
+        request_task_runner_, metadata_handler_.get(),
+        request_stage_stats_.get()));
   }
 
   auto future = cros::Future<int>::Create(nullptr);
@@ -516,13 +525,18 @@ CameraClient::RequestHandler::RequestHandler(
     V4L2CameraDevice* device,
     const camera3_callback_ops_t* callback_ops,
     const scoped_refptr<base::SingleThreadTaskRunner>& task_runner,
-    MetadataHandler* metadata_handler)
+    MetadataHandler* metadata_handler,
+    RequestStageStats* request_stage_stats)
     : device_id_(device_id),
       device_info_(device_info),
       static_metadata_(static_metadata),
       device_(device),
       callback_ops_(callback_ops),
       task_runner_(task_runner),
+      dmabuf_import_(false),
+      dmabuf_size_(0),
+      request_stage_stats_(request_stage_stats),
+      cached_frame_(request_stage_stats),
       metadata_handler_(metadata_handler),
       stream_on_fps_(0.0),
       stream_on_resolution_(0, 0),
@@ -535,7 +549,8 @@ CameraClient::RequestHandler::RequestHandler(
   SupportedFormats supported_formats =
       device_->GetDeviceSupportedFormats(device_info_.device_path);
   qualified_formats_ =
-      GetQualifiedFormats(supported_formats, device_info_.quirks);
+      GetQualifiedFormats(supported_formats, device_info_.quirks,
+                          device_info_.dmabuf_import);
 }
 
 CameraClient::RequestHandler::~RequestHandler() {}
@@ -586,6 +601,8 @@ void CameraClient::RequestHandler::StreamOff(
 void CameraClient::RequestHandler::HandleRequest(
     std::unique_ptr<CaptureRequest> request) {
   DCHECK(task_runner_->BelongsToCurrentThread());
+  request_stage_stats_->SetFrameNumber(request->GetFrameNumber());
+  ScopedRequestStage total_stage(request_stage_stats_, RequestStage::kTotal);
   camera3_capture_result_t capture_result;
   memset(&capture_result, 0, sizeof(camera3_capture_result_t));
 
@@ -604,7 +621,13 @@ void CameraClient::RequestHandler::HandleRequest(
     return;
   }
 
-  if (!WaitGrallocBufferSync(&capture_result)) {
+  bool buffer_synced;
+  {
+    ScopedRequestStage stage(request_stage_stats_,
+                             RequestStage::kWaitBufferSync);
+    buffer_synced = WaitGrallocBufferSync(&capture_result);
+  }
+  if (!buffer_synced) {
     HandleAbortedRequest(&capture_result);
     return;
   }
@@ -680,7 +703,11 @@ void CameraClient::RequestHandler::HandleRequest(
   bool keep_trying;
   do {
     VLOGFID(2, device_id_) << "before DequeueV4L2Buffer";
-    ret = DequeueV4L2Buffer(pattern_mode);
+    {
+      ScopedRequestStage stage(request_stage_stats_,
+                               RequestStage::kDequeueFrame);
+      ret = DequeueV4L2Buffer(pattern_mode);
+    }
     keep_trying = false;
     if (!ret) {
       if (metadata_handler_->PreHandleRequest(
@@ -688,6 +715,8 @@ void CameraClient::RequestHandler::HandleRequest(
         LOGFID(WARNING, device_id_)
             << "Update metadata in PreHandleRequest failed";
       }
+      ScopedRequestStage stage(request_stage_stats_,
+                               RequestStage::kWriteStreamBuffers);
       ret = WriteStreamBuffers(*metadata, &capture_result);
     } else if (ret == -ETIMEDOUT &&
                (device_info_.quirks & kQuirkRestartOnTimeout)) {
@@ -802,29 +831,42 @@ int CameraClient::RequestHandler::StreamOnImpl(Size stream_on_resolution,
                          << ", constant_frame_rate " << std::boolalpha
                          << constant_frame_rate;
 
-  std::vector<base::ScopedFD> fds;
-  std::vector<uint32_t> buffer_sizes;
-  ret = device_->StreamOn(format->width, format->height, format->fourcc,
-                          target_frame_rate, constant_frame_rate, &fds,
-                          &buffer_sizes);
-  if (ret) {
-    LOGFID(ERROR, device_id_)
-        << "StreamOn failed: " << base::safe_strerror(-ret);
-    return ret;
+  // NV12 frames can be captured into gralloc buffers, which the conversion
+  // graph and the JPEG encoder take as is.
+  if (device_info_.dmabuf_import && format->fourcc == V4L2_PIX_FMT_NV12) {
+    ret = StreamOnDmaBufImpl(*format, constant_frame_rate, target_frame_rate);
+    if (ret) {
+      LOGFID(WARNING, device_id_)
+          << "Fall back to MMAP buffers: " << base::safe_strerror(-ret);
+      StreamOffImpl();
+    }
   }
 
-  for (size_t i = 0; i < fds.size(); i++) {
-    auto frame = std::make_unique<V4L2FrameBuffer>(
-        std::move(fds[i]), buffer_sizes[i], format->width, format->height,
-        format->fourcc);
-    ret = frame->Map();
+  if (!dmabuf_import_) {
+    std::vector<base::ScopedFD> fds;
+    std::vector<uint32_t> buffer_sizes;
+    ret = device_->StreamOn(format->width, format->height, format->fourcc,
+                            target_frame_rate, constant_frame_rate, &fds,
+                            &buffer_sizes);
     if (ret) {
-      return -errno;
+      LOGFID(ERROR, device_id_)
+          << "StreamOn failed: " << base::safe_strerror(-ret);
+      return ret;
+    }
+
+    for (size_t i = 0; i < fds.size(); i++) {
+      auto frame = std::make_unique<V4L2FrameBuffer>(
+          std::move(fds[i]), buffer_sizes[i], format->width, format->height,
+          format->fourcc);
+      ret = frame->Map();
+      if (ret) {
+        return -errno;
+      }
+      VLOGFID(1, device_id_) << "Buffer " << i << ", fd: " << frame->GetFd()
+                             << " address: " << std::hex
+                             << reinterpret_cast<uintptr_t>(frame->GetData());
+      input_buffers_.push_back(std::move(frame));
     }
-    VLOGFID(1, device_id_) << "Buffer " << i << ", fd: " << frame->GetFd()
-                           << " address: " << std::hex
-                           << reinterpret_cast<uintptr_t>(frame->GetData());
-    input_buffers_.push_back(std::move(frame));
   }
 
   stream_on_resolution_ = stream_on_resolution;
@@ -843,9 +885,55 @@ int CameraClient::RequestHandler::StreamOnImpl(Size stream_on_resolution,
   return 0;
 }
 
+int CameraClient::RequestHandler::StreamOnDmaBufImpl(
+    const SupportedFormat& format,
+    bool constant_frame_rate,
+    float target_frame_rate) {
+  DCHECK(task_runner_->BelongsToCurrentThread());
+
+  // Request as many slots as the MMAP ring, each with its own buffer that is
+  // queued again as soon as its frame is used, so that frames are not dropped
+  // while a request is handled.
+  const uint32_t num_buffers = device_->GetNumVideoBuffers();
+  int ret = device_->StreamOnImported(format.width, format.height,
+                                      format.fourcc, target_frame_rate,
+                                      constant_frame_rate, num_buffers,
+                                      &dmabuf_size_);
+  if (ret) {
+    return ret;
+  }
+
+  for (uint32_t i = 0; i < num_buffers; i++) {
+    auto frame = std::make_unique<GrallocFrameBuffer>(
+        format.width, format.height, V4L2_PIX_FMT_NV12);
+    if (!frame->GetBufferHandle() ||
+        !IsImportableBuffer(frame->GetBufferHandle(),
+                            Size(format.width, format.height))) {
+      LOGFID(WARNING, device_id_) << "Buffer " << i << " cannot be imported";
+      return -EINVAL;
+    }
+    ret = frame->Map();
+    if (ret) {
+      return ret;
+    }
+    const int fd = frame->GetBufferHandle()->data[0];
+    ret = device_->QueueImportedBuffer(i, fd);
+    if (ret) {
+      LOGFID(ERROR, device_id_)
+          << "QueueImportedBuffer failed: " << base::safe_strerror(-ret);
+      return ret;
+    }
+    VLOGFID(1, device_id_) << "Buffer " << i << ", fd: " << fd;
+    input_buffers_.push_back(std::move(frame));
+  }
+  dmabuf_import_ = true;
+  return 0;
+}
+
 int CameraClient::RequestHandler::StreamOffImpl() {
   DCHECK(task_runner_->BelongsToCurrentThread());
   input_buffers_.clear();
+  dmabuf_import_ = false;
   int ret = device_->StreamOff();
   if (ret) {
     LOGFID(ERROR, device_id_)
@@ -1081,6 +1169,20 @@ void CameraClient::RequestHandler::NotifyRequestError(uint32_t frame_number) {
   callback_ops_->notify(callback_ops_, &m);
 }
 
+bool CameraClient::RequestHandler::IsImportableBuffer(buffer_handle_t buffer,
+                                                      const Size& resolution) {
+  if (CameraBufferManager::GetV4L2PixelFormat(buffer) != V4L2_PIX_FMT_NV12 ||
+      CameraBufferManager::GetWidth(buffer) != resolution.width ||
+      CameraBufferManager::GetHeight(buffer) != resolution.height) {
+    return false;
+  }
+  // V4L2 NV12 frames have no padding between rows or planes.
+  size_t y_size = resolution.width * resolution.height;
+  return CameraBufferManager::GetPlaneStride(buffer, 0) == resolution.width &&
+         CameraBufferManager::GetPlaneOffset(buffer, 1) == y_size &&
+         y_size + CameraBufferManager::GetPlaneSize(buffer, 1) >= dmabuf_size_;
+}
+
 int CameraClient::RequestHandler::DequeueV4L2Buffer(int32_t pattern_mode) {
   DCHECK(task_runner_->BelongsToCurrentThread());
   int ret;
@@ -1105,7 +1207,7 @@ int CameraClient::RequestHandler::DequeueV4L2Buffer(int32_t pattern_mode) {
     if (delta_user_ts > 0) {
       VLOGF(1) << "Drop outdated frame: delta_user_ts = " << delta_user_ts
                << ", delta_v4l2_ts = " << delta_v4l2_ts;
-      device_->ReuseFrameBuffer(buffer_id);
+      ret = device_->ReuseFrameBuffer(buffer_id);
       drop_count++;
       if (ret) {
         LOGFID(ERROR, device_id_)
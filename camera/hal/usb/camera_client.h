@@ -27,6 +27,7 @@
 #include "hal/usb/common_types.h"
 #include "hal/usb/frame_buffer.h"
 #include "hal/usb/metadata_handler.h"
+#include "hal/usb/request_stage_stats.h"
 #include "hal/usb/test_pattern.h"
 #include "hal/usb/v4l2_camera_device.h"
 
@@ -152,6 +153,9 @@ class CameraClient {
   // The formats used to report to apps.
   SupportedFormats qualified_formats_;
 
+  // Latency of each stage of handling requests, which is dumped by Dump().
+  std::unique_ptr<RequestStageStats> request_stage_stats_;
+
   // RequestHandler is used to handle in-flight requests. All functions in the
   // class run on |request_thread_|. The class will be created in StreamOn and
   // destroyed in StreamOff.
@@ -164,7 +168,8 @@ class CameraClient {
         V4L2CameraDevice* device,
         const camera3_callback_ops_t* callback_ops,
         const scoped_refptr<base::SingleThreadTaskRunner>& task_runner,
-        MetadataHandler* metadata_handler);
+        MetadataHandler* metadata_handler,
+        RequestStageStats* request_stage_stats);
     ~RequestHandler();
 
     // Synchronous call to start streaming.
@@ -190,6 +195,12 @@ class CameraClient {
                      bool use_native_sensor_ratio,
                      float target_frame_rate);
 
+    // Start streaming in dma-buf import mode with |format|. Frames are
+    // captured into a ring of gralloc buffers instead of V4L2 MMAP buffers.
+    int StreamOnDmaBufImpl(const SupportedFormat& format,
+                           bool constant_frame_rate,
+                           float target_frame_rate);
+
     // Stop streaming implementation.
     int StreamOffImpl();
 
@@ -235,6 +246,11 @@ class CameraClient {
     // Notify request error event.
     void NotifyRequestError(uint32_t frame_number);
 
+    // Returns true if |buffer| can be imported to capture frames of
+    // |resolution| in dma-buf import mode, i.e. it is a NV12 buffer with the
+    // same packed layout as the V4L2 frame.
+    bool IsImportableBuffer(buffer_handle_t buffer, const Size& resolution);
+
     // Dequeue V4L2 frame buffer.
     int DequeueV4L2Buffer(int32_t pattern_mode);
 
@@ -275,8 +291,19 @@ class CameraClient {
     // The formats used to report to apps.
     SupportedFormats qualified_formats_;
 
-    // Memory mapped buffers which are shared from |device_|.
-    std::vector<std::unique_ptr<V4L2FrameBuffer>> input_buffers_;
+    // Memory mapped buffers which are shared from |device_|. In dma-buf
+    // import mode, these are the gralloc buffers imported into |device_|.
+    std::vector<std::unique_ptr<FrameBuffer>> input_buffers_;
+
+    // True if the stream is on in dma-buf import mode.
+    bool dmabuf_import_;
+
+    // The minimum size of a buffer to capture a frame in dma-buf import mode.
+    uint32_t dmabuf_size_;
+
+    // Records the latency of each stage of handling requests. CameraClient
+    // takes the ownership.
+    RequestStageStats* request_stage_stats_;
 
     // Used to convert to different output formats.
     CachedFrame cached_frame_;
@@ -15,6 +15,7 @@
 
 #include "cros-camera/common.h"
 #include "cros-camera/udev_watcher.h"
+#include "cros-camera/utils/camera_config.h"
 #include "hal/usb/camera_characteristics.h"
 #include "hal/usb/common_types.h"
 #include "hal/usb/metadata_handler.h"
@@ -43,7 +44,8 @@ bool FillMetadata(const DeviceInfo& device_info,
   SupportedFormats supported_formats =
       V4L2CameraDevice::GetDeviceSupportedFormats(device_info.device_path);
   SupportedFormats qualified_formats =
-      GetQualifiedFormats(supported_formats, device_info.quirks);
+      GetQualifiedFormats(supported_formats, device_info.quirks,
+                          device_info.dmabuf_import);
   if (MetadataHandler::FillMetadataFromSupportedFormats(
           qualified_formats, device_info, static_metadata, request_metadata) !=
       0) {
@@ -411,6 +413,15 @@ void CameraHal::OnDeviceAdded(ScopedUdevDevicePtr dev) {
     info.quirks |= GetQuirks(vid, pid);
   }
 
+  std::unique_ptr<CameraConfig> camera_config =
+      CameraConfig::Create(constants::kCrosCameraConfigPathString);
+  if (info.num_video_buffers == 0) {
+    info.num_video_buffers =
+        camera_config->GetInteger(constants::kCrosUsbNumVideoBuffers, 0);
+  }
+  info.dmabuf_import |=
+      camera_config->GetBoolean(constants::kCrosUsbDmaBufImport, false);
+
   if (info_ptr == nullptr) {
     info.lens_facing = ANDROID_LENS_FACING_EXTERNAL;
 
@@ -44,6 +44,16 @@ struct DeviceInfo {
   // light environment.
   bool constant_framerate_unsupported = false;
 
+  // The number of V4L2 buffers to request in kernel, which is the depth of the
+  // capture ring. 0 means to use the value from camera_config.json.
+  uint32_t num_video_buffers = 0;
+
+  // Capture NV12 frames with V4L2_MEMORY_DMABUF into a ring of gralloc
+  // buffers owned by the HAL instead of the V4L2 MMAP buffers, and prefer NV12
+  // over YUYV. Each frame is still copied into the output buffers; only the
+  // copy into a temporary NV12 buffer for JPEG encoding is saved.
+  bool dmabuf_import = false;
+
   // Member definitions can be found in https://developer.android.com/
   // reference/android/hardware/camera2/CameraCharacteristics.html
   uint32_t lens_facing;
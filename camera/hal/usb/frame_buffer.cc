@@ -116,6 +116,16 @@ void SharedFrameBuffer::SetData() {
       data_[UPLANE] = data_[YPLANE] + stride_[YPLANE] * height_;
       data_[VPLANE] = data_[UPLANE] + stride_[UPLANE] * height_ / 2;
       break;
+    case V4L2_PIX_FMT_NV12:   // NV12
+    case V4L2_PIX_FMT_NV12M:  // NM12, multiple planes NV12
+      if (num_planes_ != 2) {
+        LOGF(ERROR) << "Stride is not set correctly";
+        return;
+      }
+      data_.resize(num_planes_, 0);
+      data_[YPLANE] = static_cast<uint8_t*>(shm_buffer_->memory());
+      data_[UPLANE] = data_[YPLANE] + stride_[YPLANE] * height_;
+      break;
     default:
       data_.resize(num_planes_, 0);
       data_[0] = static_cast<uint8_t*>(shm_buffer_->memory());
@@ -137,6 +147,12 @@ void SharedFrameBuffer::SetStride() {
       stride_[YPLANE] = width_;
       stride_[UPLANE] = stride_[VPLANE] = width_ / 2;
       break;
+    case V4L2_PIX_FMT_NV12:   // NV12
+    case V4L2_PIX_FMT_NV12M:  // NM12, multiple planes NV12
+      num_planes_ = 2;
+      stride_.resize(num_planes_, 0);
+      stride_[YPLANE] = stride_[UPLANE] = width_;
+      break;
     default:
       LOGF(ERROR) << "Pixel format " << FormatToString(fourcc_)
                   << " is unsupported.";
@@ -154,9 +170,16 @@ V4L2FrameBuffer::V4L2FrameBuffer(base::ScopedFD fd,
   width_ = width;
   height_ = height;
   fourcc_ = fourcc;
-  num_planes_ = 1;
-  data_.resize(num_planes_, nullptr);
-  stride_.resize(num_planes_, 0);
+  if (fourcc_ == V4L2_PIX_FMT_NV12) {
+    // The UV plane follows the Y plane in the same buffer without padding.
+    num_planes_ = 2;
+    data_.resize(num_planes_, nullptr);
+    stride_.resize(num_planes_, width_);
+  } else {
+    num_planes_ = 1;
+    data_.resize(num_planes_, nullptr);
+    stride_.resize(num_planes_, 0);
+  }
 }
 
 V4L2FrameBuffer::~V4L2FrameBuffer() {
@@ -176,6 +199,9 @@ int V4L2FrameBuffer::Map() {
     return -EINVAL;
   }
   data_[0] = static_cast<uint8_t*>(addr);
+  if (fourcc_ == V4L2_PIX_FMT_NV12) {
+    data_[UPLANE] = data_[YPLANE] + stride_[YPLANE] * height_;
+  }
   is_mapped_ = true;
   return 0;
 }
@@ -7,6 +7,7 @@
 
 #include <errno.h>
 #include <libyuv.h>
+#include <libyuv/mjpeg_decoder.h>
 #include <time.h>
 
 #include <base/memory/ptr_util.h>
@@ -58,6 +59,191 @@ namespace cros {
  *                                 -> NM12 / YV12 (video encoder)
  */
 
+namespace {
+
+// State of one output frame of ImageProcessor::DecodeMJPEGToFrames().
+struct BandOutput {
+  FrameBuffer* frame;
+  // Centered crop region in the decoded frame. Offsets are even.
+  int crop_x;
+  int crop_y;
+  int crop_width;
+  int crop_height;
+  // The next Y and chroma rows of |frame| to be written.
+  int next_y_row;
+  int next_uv_row;
+  // Scaled chroma rows to be interleaved into NV12 frames.
+  std::vector<uint8_t> u_row;
+  std::vector<uint8_t> v_row;
+};
+
+// State shared by the callbacks of ImageProcessor::DecodeMJPEGToFrames().
+struct BandDecodeContext {
+  int width;
+  // The first Y row of the next decoded band.
+  int band_top;
+  // Whether the decoded chroma planes are 4:2:2 and need to be subsampled
+  // vertically into 4:2:0.
+  bool subsample_chroma;
+  // Subsampled chroma planes of the current band.
+  std::vector<uint8_t> band_u;
+  std::vector<uint8_t> band_v;
+  std::vector<BandOutput>* outputs;
+};
+
+// The source row sampled by output row |row| with nearest neighbor scaling of
+// |src_size| rows from |src_offset| into |dst_size| rows.
+int SourceRow(int row, int src_offset, int src_size, int dst_size) {
+  return src_offset + (2 * row + 1) * src_size / (2 * dst_size);
+}
+
+// Returns the first output row at or after |row| that samples a source row at
+// or after |src_end|.
+int EndOfReadyRows(int row,
+                   int dst_size,
+                   int src_offset,
+                   int src_size,
+                   int src_end) {
+  while (row < dst_size &&
+         SourceRow(row, src_offset, src_size, dst_size) < src_end) {
+    ++row;
+  }
+  return row;
+}
+
+// Crops and scales the output rows [|row|, |end_row|) of a plane from the band
+// |band| whose first row is |band_top| in the source plane. |dst| points to
+// output row |row|.
+void ScaleBandRows(const uint8_t* band,
+                   int band_stride,
+                   int band_top,
+                   int crop_x,
+                   int crop_y,
+                   int crop_width,
+                   int crop_height,
+                   int row,
+                   int end_row,
+                   uint8_t* dst,
+                   int dst_stride,
+                   int dst_width,
+                   int dst_height) {
+  if (row >= end_row) {
+    return;
+  }
+  if (crop_height == dst_height) {
+    // No vertical scaling. The rows are consecutive in the band.
+    const uint8_t* src =
+        band + (crop_y + row - band_top) * band_stride + crop_x;
+    libyuv::ScalePlane(src, band_stride, crop_width, end_row - row, dst,
+                       dst_stride, dst_width, end_row - row,
+                       libyuv::FilterMode::kFilterNone);
+    return;
+  }
+  for (; row < end_row; ++row, dst += dst_stride) {
+    int src_row = SourceRow(row, crop_y, crop_height, dst_height);
+    const uint8_t* src = band + (src_row - band_top) * band_stride + crop_x;
+    libyuv::ScalePlane(src, band_stride, crop_width, 1, dst, dst_stride,
+                       dst_width, 1, libyuv::FilterMode::kFilterNone);
+  }
+}
+
+// Writes all rows of |output| which sample the decoded I420 band.
+void WriteBand(const uint8_t* band_y,
+               int band_y_stride,
+               const uint8_t* band_u,
+               const uint8_t* band_v,
+               int band_uv_stride,
+               int band_top,
+               int band_rows,
+               BandOutput* output) {
+  FrameBuffer* frame = output->frame;
+  int width = frame->GetWidth();
+  int height = frame->GetHeight();
+
+  int end_y_row = EndOfReadyRows(output->next_y_row, height, output->crop_y,
+                                 output->crop_height, band_top + band_rows);
+  ScaleBandRows(band_y, band_y_stride, band_top, output->crop_x,
+                output->crop_y, output->crop_width, output->crop_height,
+                output->next_y_row, end_y_row,
+                frame->GetData(FrameBuffer::YPLANE) +
+                    output->next_y_row * frame->GetStride(FrameBuffer::YPLANE),
+                frame->GetStride(FrameBuffer::YPLANE), width, height);
+  output->next_y_row = end_y_row;
+
+  int uv_top = band_top / 2;
+  int crop_uv_x = output->crop_x / 2;
+  int crop_uv_y = output->crop_y / 2;
+  int crop_uv_width = output->crop_width / 2;
+  int crop_uv_height = output->crop_height / 2;
+  int end_uv_row = EndOfReadyRows(output->next_uv_row, height / 2, crop_uv_y,
+                                  crop_uv_height, uv_top + band_rows / 2);
+  if (frame->GetFourcc() == V4L2_PIX_FMT_NV12 ||
+      frame->GetFourcc() == V4L2_PIX_FMT_NV12M) {
+    uint8_t* dst_uv = frame->GetData(FrameBuffer::UPLANE);
+    int dst_uv_stride = frame->GetStride(FrameBuffer::UPLANE);
+    for (int row = output->next_uv_row; row < end_uv_row; ++row) {
+      ScaleBandRows(band_u, band_uv_stride, uv_top, crop_uv_x, crop_uv_y,
+                    crop_uv_width, crop_uv_height, row, row + 1,
+                    output->u_row.data(), width / 2, width / 2, height / 2);
+      ScaleBandRows(band_v, band_uv_stride, uv_top, crop_uv_x, crop_uv_y,
+                    crop_uv_width, crop_uv_height, row, row + 1,
+                    output->v_row.data(), width / 2, width / 2, height / 2);
+      libyuv::MergeUVPlane(output->u_row.data(), width / 2,
+                           output->v_row.data(), width / 2,
+                           dst_uv + row * dst_uv_stride, dst_uv_stride,
+                           width / 2, 1);
+    }
+  } else {
+    ScaleBandRows(band_u, band_uv_stride, uv_top, crop_uv_x, crop_uv_y,
+                  crop_uv_width, crop_uv_height, output->next_uv_row,
+                  end_uv_row,
+                  frame->GetData(FrameBuffer::UPLANE) +
+                      output->next_uv_row *
+                          frame->GetStride(FrameBuffer::UPLANE),
+                  frame->GetStride(FrameBuffer::UPLANE), width / 2,
+                  height / 2);
+    ScaleBandRows(band_v, band_uv_stride, uv_top, crop_uv_x, crop_uv_y,
+                  crop_uv_width, crop_uv_height, output->next_uv_row,
+                  end_uv_row,
+                  frame->GetData(FrameBuffer::VPLANE) +
+                      output->next_uv_row *
+                          frame->GetStride(FrameBuffer::VPLANE),
+                  frame->GetStride(FrameBuffer::VPLANE), width / 2,
+                  height / 2);
+  }
+  output->next_uv_row = end_uv_row;
+}
+
+// Called by libyuv::MJpegDecoder with every decoded band of rows.
+void OnBandDecoded(void* opaque,
+                   const uint8_t* const* data,
+                   const int* strides,
+                   int rows) {
+  BandDecodeContext* context = static_cast<BandDecodeContext*>(opaque);
+  const uint8_t* band_u = data[1];
+  const uint8_t* band_v = data[2];
+  int band_uv_stride = strides[1];
+  if (context->subsample_chroma) {
+    int uv_width = context->width / 2;
+    libyuv::ScalePlane(data[1], strides[1], uv_width, rows,
+                       context->band_u.data(), uv_width, uv_width, rows / 2,
+                       libyuv::FilterMode::kFilterBilinear);
+    libyuv::ScalePlane(data[2], strides[2], uv_width, rows,
+                       context->band_v.data(), uv_width, uv_width, rows / 2,
+                       libyuv::FilterMode::kFilterBilinear);
+    band_u = context->band_u.data();
+    band_v = context->band_v.data();
+    band_uv_stride = uv_width;
+  }
+  for (auto& output : *context->outputs) {
+    WriteBand(data[0], strides[0], band_u, band_v, band_uv_stride,
+              context->band_top, rows, &output);
+  }
+  context->band_top += rows;
+}
+
+}  // namespace
+
 size_t ImageProcessor::GetConvertedSize(const FrameBuffer& frame) {
   if ((frame.GetWidth() % 2) || (frame.GetHeight() % 2)) {
     LOGF(ERROR) << "Width or height is not even (" << frame.GetWidth() << " x "
@@ -453,4 +639,119 @@ int ImageProcessor::Crop(const FrameBuffer& in_frame, FrameBuffer* out_frame) {
   return 0;
 }
 
+// static
+bool ImageProcessor::IsSupportedBandFormat(uint32_t fourcc) {
+  switch (fourcc) {
+    case V4L2_PIX_FMT_YUV420:   // YU12
+    case V4L2_PIX_FMT_YUV420M:  // YM12, multiple planes YU12
+    case V4L2_PIX_FMT_YVU420:   // YV12
+    case V4L2_PIX_FMT_YVU420M:  // YM21, multiple planes YV12
+    case V4L2_PIX_FMT_NV12:     // NV12
+    case V4L2_PIX_FMT_NV12M:    // NM12
+      return true;
+    default:
+      return false;
+  }
+}
+
+int ImageProcessor::DecodeMJPEGToFrames(
+    const FrameBuffer& in_frame,
+    const std::vector<FrameBuffer*>& out_frames,
+    const std::vector<Size>& crop_sizes) {
+  if (in_frame.GetFourcc() != V4L2_PIX_FMT_MJPEG) {
+    LOGF(ERROR) << "Pixel format " << FormatToString(in_frame.GetFourcc())
+                << " is unsupported.";
+    return -EINVAL;
+  }
+  if (out_frames.size() != crop_sizes.size()) {
+    LOGF(ERROR) << "Number of output frames and crop sizes mismatch";
+    return -EINVAL;
+  }
+
+  std::vector<BandOutput> outputs(out_frames.size());
+  for (size_t i = 0; i < out_frames.size(); i++) {
+    FrameBuffer* frame = out_frames[i];
+    if (!IsSupportedBandFormat(frame->GetFourcc())) {
+      LOGF(ERROR) << "Destination pixel format "
+                  << FormatToString(frame->GetFourcc())
+                  << " is unsupported for band decoding.";
+      return -EINVAL;
+    }
+    if (crop_sizes[i].width > in_frame.GetWidth() ||
+        crop_sizes[i].height > in_frame.GetHeight() ||
+        frame->GetWidth() % 2 || frame->GetHeight() % 2) {
+      LOGF(ERROR) << "Invalid crop size " << crop_sizes[i].width << "x"
+                  << crop_sizes[i].height << " for output "
+                  << frame->GetWidth() << "x" << frame->GetHeight();
+      return -EINVAL;
+    }
+    BandOutput& output = outputs[i];
+    output.frame = frame;
+    // Crop from even pixels for correct YUV image.
+    output.crop_x = ((in_frame.GetWidth() - crop_sizes[i].width) / 2) & ~1;
+    output.crop_y = ((in_frame.GetHeight() - crop_sizes[i].height) / 2) & ~1;
+    output.crop_width = crop_sizes[i].width;
+    output.crop_height = crop_sizes[i].height;
+    output.next_y_row = 0;
+    output.next_uv_row = 0;
+    if (frame->GetFourcc() == V4L2_PIX_FMT_NV12 ||
+        frame->GetFourcc() == V4L2_PIX_FMT_NV12M) {
+      output.u_row.resize(frame->GetWidth() / 2);
+      output.v_row.resize(frame->GetWidth() / 2);
+    }
+  }
+
+  libyuv::MJpegDecoder decoder;
+  if (!decoder.LoadFrame(in_frame.GetData(), in_frame.GetDataSize())) {
+    LOGF(ERROR) << "Failed to load MJPEG frame";
+    return -EAGAIN;
+  }
+  if (decoder.GetWidth() != static_cast<int>(in_frame.GetWidth()) ||
+      decoder.GetHeight() != static_cast<int>(in_frame.GetHeight())) {
+    LOGF(ERROR) << "MJPEG frame size " << decoder.GetWidth() << "x"
+                << decoder.GetHeight() << " doesn't match "
+                << in_frame.GetWidth() << "x" << in_frame.GetHeight();
+    decoder.UnloadFrame();
+    return -EAGAIN;
+  }
+
+  // Only 4:2:0 and 4:2:2 YCbCr, which cover the USB cameras, are handled.
+  // Others go through ConvertFormat().
+  bool is_yuv420 = decoder.GetVertSampFactor(0) == 2 &&
+                   decoder.GetHorizSampFactor(0) == 2;
+  bool is_yuv422 = decoder.GetVertSampFactor(0) == 1 &&
+                   decoder.GetHorizSampFactor(0) == 2;
+  if (decoder.GetColorSpace() != libyuv::MJpegDecoder::kColorSpaceYCbCr ||
+      decoder.GetNumComponents() != 3 || (!is_yuv420 && !is_yuv422) ||
+      decoder.GetVertSampFactor(1) != 1 ||
+      decoder.GetHorizSampFactor(1) != 1 ||
+      decoder.GetVertSampFactor(2) != 1 ||
+      decoder.GetHorizSampFactor(2) != 1) {
+    VLOGF(1) << "Unsupported MJPEG chroma subsampling";
+    decoder.UnloadFrame();
+    return -ENOTSUP;
+  }
+
+  BandDecodeContext context;
+  context.width = in_frame.GetWidth();
+  context.band_top = 0;
+  context.subsample_chroma = is_yuv422;
+  if (is_yuv422) {
+    size_t band_uv_size = in_frame.GetWidth() / 2 *
+                          decoder.GetImageScanlinesPerImcuRow() / 2;
+    context.band_u.resize(band_uv_size);
+    context.band_v.resize(band_uv_size);
+  }
+  context.outputs = &outputs;
+  bool decoded = decoder.DecodeToCallback(&OnBandDecoded, &context,
+                                          in_frame.GetWidth(),
+                                          in_frame.GetHeight());
+  decoder.UnloadFrame();
+  if (!decoded) {
+    LOGF(ERROR) << "Failed to decode MJPEG frame";
+    return -EAGAIN;
+  }
+  return 0;
+}
+
 }  // namespace cros
@@ -8,6 +8,7 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 // FourCC pixel formats (defined as V4L2_PIX_FMT_*).
 #include <linux/videodev2.h>
@@ -17,6 +18,7 @@
 #include <base/memory/ptr_util.h>
 #include <camera/camera_metadata.h>
 
+#include "hal/usb/common_types.h"
 #include "hal/usb/frame_buffer.h"
 
 namespace cros {
@@ -56,6 +58,21 @@ class ImageProcessor {
   // |height|, and |buffer_size| of |out_frame|. The function will fill
   // |data_size| and |fourcc| of |out_frame|.
   int Crop(const FrameBuffer& in_frame, FrameBuffer* out_frame);
+
+  // Return true if DecodeMJPEGToFrames() can write |fourcc| frames.
+  static bool IsSupportedBandFormat(uint32_t fourcc);
+
+  // Decode the V4L2_PIX_FMT_MJPEG |in_frame| band by band, and crop, scale and
+  // convert each decoded band straight into all |out_frames| while it is still
+  // in cache. The decoded frame is never stored as a whole. |crop_sizes| are
+  // the sizes of the centered regions of |in_frame| that are scaled into the
+  // corresponding |out_frames|. Scaling uses nearest neighbor sampling like
+  // Scale(). All |out_frames| should be mapped and have a format supported by
+  // IsSupportedBandFormat(). Return -ENOTSUP if the chroma subsampling of
+  // |in_frame| is unsupported, and -EAGAIN if |in_frame| is corrupted.
+  int DecodeMJPEGToFrames(const FrameBuffer& in_frame,
+                          const std::vector<FrameBuffer*>& out_frames,
+                          const std::vector<Size>& crop_sizes);
 };
 
 }  // namespace cros
@@ -0,0 +1,152 @@
+/* Copyright 2020 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "hal/usb/request_stage_stats.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include <base/files/file_path.h>
+#include <base/strings/stringprintf.h>
+
+#include "cros-camera/common.h"
+
+namespace cros {
+
+namespace {
+
+// Only one of every |kUmaSampleInterval| latencies of a stage is reported to
+// UMA, to avoid writing the metrics file for every frame.
+constexpr uint64_t kUmaSampleInterval = 30;
+
+size_t GetBucket(base::TimeDelta latency) {
+  int64_t us = latency.InMicroseconds();
+  size_t bucket = 0;
+  while (us > 1 && bucket + 1 < RequestStageStats::kNumBuckets) {
+    us >>= 1;
+    bucket++;
+  }
+  return bucket;
+}
+
+// Returns the upper bound of the bucket where |percent| of |count| samples in
+// |buckets| fall.
+int64_t GetPercentileUs(
+    const std::array<uint64_t, RequestStageStats::kNumBuckets>& buckets,
+    uint64_t count,
+    int percent) {
+  uint64_t target = (count * percent + 99) / 100;
+  uint64_t accumulated = 0;
+  for (size_t i = 0; i < buckets.size(); i++) {
+    accumulated += buckets[i];
+    if (accumulated >= target) {
+      return int64_t{1} << (i + 1);
+    }
+  }
+  return int64_t{1} << buckets.size();
+}
+
+}  // namespace
+
+RequestStageStats::RequestStageStats(int camera_id,
+                                     const std::string& trace_file_path)
+    : camera_id_(camera_id),
+      camera_metrics_(CameraMetrics::New()),
+      frame_number_(0) {
+  if (trace_file_path.empty()) {
+    return;
+  }
+  trace_file_.Initialize(
+      base::FilePath(base::StringPrintf("%s.%d", trace_file_path.c_str(),
+                                        camera_id_)),
+      base::File::FLAG_CREATE_ALWAYS | base::File::FLAG_WRITE);
+  if (!trace_file_.IsValid()) {
+    LOGF(ERROR) << "Failed to create trace file " << trace_file_path << ": "
+                << base::File::ErrorToString(trace_file_.error_details());
+    return;
+  }
+  // The JSON array format of Chrome trace. The closing bracket is optional, so
+  // that the file stays loadable if the process goes away abruptly.
+  std::string header = base::StringPrintf(
+      "[\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,"
+      "\"args\":{\"name\":\"Camera %d requests\"}},\n",
+      getpid(), camera_id_, camera_id_);
+  trace_file_.WriteAtCurrentPos(header.data(), header.size());
+}
+
+RequestStageStats::~RequestStageStats() {}
+
+void RequestStageStats::SetFrameNumber(uint32_t frame_number) {
+  base::AutoLock l(lock_);
+  frame_number_ = frame_number;
+}
+
+void RequestStageStats::Record(RequestStage stage, base::TimeTicks start) {
+  base::TimeDelta latency = base::TimeTicks::Now() - start;
+  base::AutoLock l(lock_);
+  Histogram& histogram = histograms_[static_cast<size_t>(stage)];
+  histogram.buckets[GetBucket(latency)]++;
+  histogram.count++;
+  histogram.sum += latency;
+  histogram.max = std::max(histogram.max, latency);
+  if (histogram.count % kUmaSampleInterval == 1) {
+    camera_metrics_->SendRequestStageLatency(stage, latency);
+  }
+  if (trace_file_.IsValid()) {
+    WriteTraceEvent(stage, start, latency);
+  }
+}
+
+void RequestStageStats::Dump(int fd) {
+  base::AutoLock l(lock_);
+  dprintf(fd, "Camera %d request stage latency (us):\n", camera_id_);
+  for (size_t i = 0; i < kNumStages; i++) {
+    const Histogram& histogram = histograms_[i];
+    const char* name = RequestStageToString(static_cast<RequestStage>(i));
+    if (histogram.count == 0) {
+      dprintf(fd, "  %s: no samples\n", name);
+      continue;
+    }
+    dprintf(fd,
+            "  %s: count %" PRIu64 ", mean %" PRId64 ", max %" PRId64
+            ", p50 < %" PRId64 ", p90 < %" PRId64 ", p99 < %" PRId64 "\n",
+            name, histogram.count,
+            histogram.sum.InMicroseconds() /
+                static_cast<int64_t>(histogram.count),
+            histogram.max.InMicroseconds(),
+            GetPercentileUs(histogram.buckets, histogram.count, 50),
+            GetPercentileUs(histogram.buckets, histogram.count, 90),
+            GetPercentileUs(histogram.buckets, histogram.count, 99));
+    for (size_t j = 0; j < kNumBuckets; j++) {
+      if (histogram.buckets[j] == 0) {
+        continue;
+      }
+      dprintf(fd, "    [%" PRId64 ", %" PRId64 "): %" PRIu64 "\n",
+              j == 0 ? int64_t{0} : int64_t{1} << j, int64_t{1} << (j + 1),
+              histogram.buckets[j]);
+    }
+  }
+}
+
+void RequestStageStats::WriteTraceEvent(RequestStage stage,
+                                        base::TimeTicks start,
+                                        base::TimeDelta latency) {
+  lock_.AssertAcquired();
+  std::string event = base::StringPrintf(
+      "{\"name\":\"%s\",\"cat\":\"usb_hal\",\"ph\":\"X\",\"ts\":%" PRId64
+      ",\"dur\":%" PRId64 ",\"pid\":%d,\"tid\":%d,"
+      "\"args\":{\"frame_number\":%u}},\n",
+      RequestStageToString(stage), (start - base::TimeTicks()).InMicroseconds(),
+      latency.InMicroseconds(), getpid(), camera_id_, frame_number_);
+  if (trace_file_.WriteAtCurrentPos(event.data(), event.size()) < 0) {
+    LOGF(ERROR) << "Failed to write trace event, stop tracing";
+    trace_file_.Close();
+  }
+}
+
+}  // namespace cros
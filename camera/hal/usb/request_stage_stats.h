@@ -0,0 +1,101 @@
+/* Copyright 2020 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#ifndef CAMERA_HAL_USB_REQUEST_STAGE_STATS_H_
+#define CAMERA_HAL_USB_REQUEST_STAGE_STATS_H_
+
+#include <array>
+#include <memory>
+#include <string>
+
+#include <base/files/file.h>
+#include <base/macros.h>
+#include <base/synchronization/lock.h>
+#include <base/time/time.h>
+
+#include "cros-camera/camera_metrics.h"
+
+namespace cros {
+
+// Collects the latency of each stage of handling capture requests for one
+// camera. The latencies are kept in histograms which can be dumped, a sample of
+// them is reported to UMA, and every stage can be optionally written into a
+// Chrome trace JSON file to be loaded in a trace viewer.
+// The class is thread-safe.
+class RequestStageStats {
+ public:
+  // Latencies are put into buckets of [2^i, 2^(i+1)) microseconds. The last
+  // bucket also holds everything longer.
+  static constexpr size_t kNumBuckets = 24;
+
+  // Writes the trace events into |trace_file_path| if it is not empty.
+  RequestStageStats(int camera_id, const std::string& trace_file_path);
+  ~RequestStageStats();
+
+  // Sets the frame number of the request being handled, which is attached to
+  // the following trace events.
+  void SetFrameNumber(uint32_t frame_number);
+
+  // Records that |stage| of the current request started at |start| and ended
+  // now.
+  void Record(RequestStage stage, base::TimeTicks start);
+
+  // Writes the histograms in human readable text into |fd|.
+  void Dump(int fd);
+
+ private:
+  static constexpr size_t kNumStages =
+      static_cast<size_t>(RequestStage::kMaxValue) + 1;
+
+  struct Histogram {
+    std::array<uint64_t, kNumBuckets> buckets = {};
+    uint64_t count = 0;
+    base::TimeDelta sum;
+    base::TimeDelta max;
+  };
+
+  void WriteTraceEvent(RequestStage stage,
+                       base::TimeTicks start,
+                       base::TimeDelta latency);
+
+  const int camera_id_;
+
+  std::unique_ptr<CameraMetrics> camera_metrics_;
+
+  base::File trace_file_;
+
+  uint32_t frame_number_;
+
+  std::array<Histogram, kNumStages> histograms_;
+
+  // Used to guard all variables above.
+  base::Lock lock_;
+
+  DISALLOW_COPY_AND_ASSIGN(RequestStageStats);
+};
+
+// Records the latency of |stage| from construction to destruction into
+// |stats|, which can be nullptr to record nothing.
+class ScopedRequestStage {
+ public:
+  ScopedRequestStage(RequestStageStats* stats, RequestStage stage)
+      : stats_(stats), stage_(stage), start_(base::TimeTicks::Now()) {}
+  ~ScopedRequestStage() {
+    if (stats_) {
+      stats_->Record(stage_, start_);
+    }
+  }
+
+ private:
+  RequestStageStats* stats_;
+  RequestStage stage_;
+  base::TimeTicks start_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScopedRequestStage);
+};
+
+}  // namespace cros
+
+#endif  // CAMERA_HAL_USB_REQUEST_STAGE_STATS_H_
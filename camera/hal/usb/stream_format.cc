@@ -23,18 +23,29 @@ constexpr int kSupportedHalFormats[] = {
     HAL_PIXEL_FORMAT_BLOB, HAL_PIXEL_FORMAT_YCbCr_420_888,
     HAL_PIXEL_FORMAT_IMPLEMENTATION_DEFINED};
 
-std::vector<uint32_t> GetSupportedFourCCs(bool prefer_mjpeg) {
+std::vector<uint32_t> GetSupportedFourCCs(bool prefer_mjpeg,
+                                          bool dmabuf_import) {
   // The preference of supported fourccs in the list is from high to low.
+  std::vector<uint32_t> fourccs;
   if (prefer_mjpeg) {
-    return {
+    fourccs = {
         V4L2_PIX_FMT_MJPEG,
         V4L2_PIX_FMT_YUYV,
     };
+  } else {
+    fourccs = {
+        V4L2_PIX_FMT_YUYV,
+        V4L2_PIX_FMT_MJPEG,
+    };
+  }
+  // In dma-buf import mode, NV12 is captured into gralloc buffers that are
+  // converted from as is, so it is preferred over YUYV.
+  if (dmabuf_import) {
+    fourccs.insert(
+        std::find(fourccs.begin(), fourccs.end(), V4L2_PIX_FMT_YUYV),
+        V4L2_PIX_FMT_NV12);
   }
-  return {
-      V4L2_PIX_FMT_YUYV,
-      V4L2_PIX_FMT_MJPEG,
-  };
+  return fourccs;
 }
 
 }  // namespace
@@ -128,11 +139,12 @@ std::vector<int32_t> GetJpegAvailableThumbnailSizes(
 }
 
 SupportedFormats GetQualifiedFormats(const SupportedFormats& supported_formats,
-                                     uint32_t quirks) {
+                                     uint32_t quirks,
+                                     bool dmabuf_import) {
   // The preference of supported fourccs in the list is from high to low.
   bool prefer_mjpeg = quirks & kQuirkPreferMjpeg;
   const std::vector<uint32_t> supported_fourccs =
-      GetSupportedFourCCs(prefer_mjpeg);
+      GetSupportedFourCCs(prefer_mjpeg, dmabuf_import);
   SupportedFormats qualified_formats;
   for (const auto& supported_fourcc : supported_fourccs) {
     for (const auto& supported_format : supported_formats) {
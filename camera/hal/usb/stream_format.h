@@ -29,10 +29,12 @@ SupportedFormat GetMaximumFormat(const SupportedFormats& supported_formats);
 std::vector<int32_t> GetJpegAvailableThumbnailSizes(
     const SupportedFormats& supported_formats);
 
-// Find all formats in preference order.
+// Find all formats in preference order. NV12 is only qualified for cameras
+// using |dmabuf_import|.
 // The resolutions in returned SupportedFormats vector are unique.
 SupportedFormats GetQualifiedFormats(const SupportedFormats& supported_formats,
-                                     uint32_t quirks);
+                                     uint32_t quirks,
+                                     bool dmabuf_import);
 
 // Check |stream| is supported in |supported_formats|.
 bool IsFormatSupported(const SupportedFormats& supported_formats,
@@ -8,6 +8,15 @@
 
 #include <sys/mman.h>
 
+// We must include cstdio before jpeglib.h. It is a requirement of libjpeg.
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+extern "C" {
+#include <jpeglib.h>
+}
+
 #include <base/at_exit.h>
 #include <gtest/gtest.h>
 
@@ -21,6 +30,128 @@ class ImageProcessorTest : public ::testing::Test {
  public:
   ImageProcessorTest() = default;
 
+ protected:
+  // Creates a YU12 frame of |width|x|height|.
+  static std::unique_ptr<SharedFrameBuffer> CreateYU12Frame(int width,
+                                                            int height) {
+    std::unique_ptr<SharedFrameBuffer> frame(new SharedFrameBuffer(0));
+    frame->SetFourcc(V4L2_PIX_FMT_YUV420);
+    frame->SetWidth(width);
+    frame->SetHeight(height);
+    EXPECT_EQ(frame->SetDataSize(ImageProcessor::GetConvertedSize(*frame)), 0);
+    return frame;
+  }
+
+  // Creates a NV12 frame of |width|x|height|.
+  static std::unique_ptr<SharedFrameBuffer> CreateNV12Frame(int width,
+                                                            int height) {
+    std::unique_ptr<SharedFrameBuffer> frame(new SharedFrameBuffer(0));
+    frame->SetFourcc(V4L2_PIX_FMT_NV12);
+    frame->SetWidth(width);
+    frame->SetHeight(height);
+    EXPECT_EQ(frame->SetDataSize(ImageProcessor::GetConvertedSize(*frame)), 0);
+    return frame;
+  }
+
+  // Creates a MJPEG frame of a gradient pattern with |v_samp_factor| as the
+  // vertical sampling factor of the Y component. It's 2 for 4:2:0 and 1 for
+  // 4:2:2 chroma subsampling.
+  static std::unique_ptr<SharedFrameBuffer> CreateMJPEGFrame(
+      int width, int height, int v_samp_factor) {
+    jpeg_compress_struct cinfo;
+    jpeg_error_mgr jerr;
+    cinfo.err = jpeg_std_error(&jerr);
+    jpeg_create_compress(&cinfo);
+    unsigned char* jpeg_data = nullptr;
+    unsigned long jpeg_size = 0;  // NOLINT(runtime/int)
+    jpeg_mem_dest(&cinfo, &jpeg_data, &jpeg_size);
+    cinfo.image_width = width;
+    cinfo.image_height = height;
+    cinfo.input_components = 3;
+    cinfo.in_color_space = JCS_RGB;
+    jpeg_set_defaults(&cinfo);
+    jpeg_set_quality(&cinfo, 90, TRUE);
+    cinfo.comp_info[0].h_samp_factor = 2;
+    cinfo.comp_info[0].v_samp_factor = v_samp_factor;
+    jpeg_start_compress(&cinfo, TRUE);
+    std::vector<uint8_t> row(width * 3);
+    while (cinfo.next_scanline < cinfo.image_height) {
+      for (int x = 0; x < width; x++) {
+        row[x * 3] = static_cast<uint8_t>(x);
+        row[x * 3 + 1] = static_cast<uint8_t>(cinfo.next_scanline);
+        row[x * 3 + 2] = static_cast<uint8_t>(x + cinfo.next_scanline);
+      }
+      JSAMPROW row_pointer = row.data();
+      jpeg_write_scanlines(&cinfo, &row_pointer, 1);
+    }
+    jpeg_finish_compress(&cinfo);
+    jpeg_destroy_compress(&cinfo);
+
+    std::unique_ptr<SharedFrameBuffer> frame(
+        new SharedFrameBuffer(static_cast<int>(jpeg_size)));
+    frame->SetFourcc(V4L2_PIX_FMT_MJPEG);
+    frame->SetWidth(width);
+    frame->SetHeight(height);
+    EXPECT_EQ(frame->SetDataSize(jpeg_size), 0);
+    memcpy(frame->GetData(), jpeg_data, jpeg_size);
+    free(jpeg_data);
+    return frame;
+  }
+
+  // Compares the image content of two YU12 frames.
+  static bool IsSameYU12Frame(const FrameBuffer& a, const FrameBuffer& b) {
+    if (a.GetWidth() != b.GetWidth() || a.GetHeight() != b.GetHeight()) {
+      return false;
+    }
+    for (size_t plane = FrameBuffer::YPLANE; plane <= FrameBuffer::VPLANE;
+         plane++) {
+      size_t width = plane == FrameBuffer::YPLANE ? a.GetWidth()
+                                                  : a.GetWidth() / 2;
+      size_t height = plane == FrameBuffer::YPLANE ? a.GetHeight()
+                                                   : a.GetHeight() / 2;
+      for (size_t y = 0; y < height; y++) {
+        if (memcmp(a.GetData(plane) + y * a.GetStride(plane),
+                   b.GetData(plane) + y * b.GetStride(plane), width)) {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  // Compares the image content of the YU12 frame |yu12| and the NV12 frame
+  // |nv12|.
+  static bool IsSameYU12AndNV12Frame(const FrameBuffer& yu12,
+                                     const FrameBuffer& nv12) {
+    if (yu12.GetWidth() != nv12.GetWidth() ||
+        yu12.GetHeight() != nv12.GetHeight()) {
+      return false;
+    }
+    for (size_t y = 0; y < yu12.GetHeight(); y++) {
+      if (memcmp(yu12.GetData(FrameBuffer::YPLANE) +
+                     y * yu12.GetStride(FrameBuffer::YPLANE),
+                 nv12.GetData(FrameBuffer::YPLANE) +
+                     y * nv12.GetStride(FrameBuffer::YPLANE),
+                 yu12.GetWidth())) {
+        return false;
+      }
+    }
+    for (size_t y = 0; y < yu12.GetHeight() / 2; y++) {
+      const uint8_t* u = yu12.GetData(FrameBuffer::UPLANE) +
+                         y * yu12.GetStride(FrameBuffer::UPLANE);
+      const uint8_t* v = yu12.GetData(FrameBuffer::VPLANE) +
+                         y * yu12.GetStride(FrameBuffer::VPLANE);
+      const uint8_t* uv = nv12.GetData(FrameBuffer::UPLANE) +
+                          y * nv12.GetStride(FrameBuffer::UPLANE);
+      for (size_t x = 0; x < yu12.GetWidth() / 2; x++) {
+        if (uv[2 * x] != u[x] || uv[2 * x + 1] != v[x]) {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
  private:
   DISALLOW_COPY_AND_ASSIGN(ImageProcessorTest);
 };
@@ -38,6 +169,136 @@ TEST_F(ImageProcessorTest, GetConvertedSize) {
   EXPECT_EQ(image_processor->GetConvertedSize(*frame.get()), 1280 * 720 * 1.5);
 }
 
+TEST_F(ImageProcessorTest, DecodeMJPEGToFrames) {
+  const int kWidth = 640;
+  const int kHeight = 480;
+  std::unique_ptr<ImageProcessor> image_processor(new ImageProcessor());
+  std::unique_ptr<SharedFrameBuffer> in_frame =
+      CreateMJPEGFrame(kWidth, kHeight, 2);
+
+  // Decoding into a same-size frame should match the full-frame decoder.
+  std::unique_ptr<SharedFrameBuffer> expected_frame =
+      CreateYU12Frame(kWidth, kHeight);
+  ASSERT_EQ(image_processor->ConvertFormat(*in_frame, expected_frame.get()),
+            0);
+  std::unique_ptr<SharedFrameBuffer> out_frame =
+      CreateYU12Frame(kWidth, kHeight);
+  std::unique_ptr<SharedFrameBuffer> scaled_frame = CreateYU12Frame(320, 180);
+  ASSERT_EQ(image_processor->DecodeMJPEGToFrames(
+                *in_frame, {out_frame.get(), scaled_frame.get()},
+                {Size(kWidth, kHeight), Size(kWidth, 360)}),
+            0);
+  EXPECT_TRUE(IsSameYU12Frame(*expected_frame, *out_frame));
+
+  // Scaling by 2 with nearest neighbor sampling picks the odd rows and columns
+  // of the cropped region.
+  const int kCropY = (kHeight - 360) / 2;
+  for (int y = 0; y < 180; y++) {
+    for (int x = 0; x < 320; x++) {
+      ASSERT_EQ(scaled_frame->GetData(FrameBuffer::YPLANE)
+                    [y * scaled_frame->GetStride(FrameBuffer::YPLANE) + x],
+                expected_frame->GetData(FrameBuffer::YPLANE)
+                    [(kCropY + 2 * y + 1) *
+                         expected_frame->GetStride(FrameBuffer::YPLANE) +
+                     2 * x + 1]);
+    }
+  }
+
+  // Corrupted MJPEG frames should be skipped.
+  memset(in_frame->GetData(), 0, in_frame->GetDataSize());
+  EXPECT_EQ(image_processor->DecodeMJPEGToFrames(*in_frame, {out_frame.get()},
+                                                 {Size(kWidth, kHeight)}),
+            -EAGAIN);
+}
+
+TEST_F(ImageProcessorTest, DecodeMJPEGToNV12Frames) {
+  const int kWidth = 640;
+  const int kHeight = 480;
+  std::unique_ptr<ImageProcessor> image_processor(new ImageProcessor());
+  std::unique_ptr<SharedFrameBuffer> in_frame =
+      CreateMJPEGFrame(kWidth, kHeight, 2);
+
+  // The chroma rows of NV12 outputs are scaled separately and interleaved, so
+  // they should match the YU12 outputs of the same decode.
+  std::unique_ptr<SharedFrameBuffer> yu12_frame =
+      CreateYU12Frame(kWidth, kHeight);
+  std::unique_ptr<SharedFrameBuffer> nv12_frame =
+      CreateNV12Frame(kWidth, kHeight);
+  std::unique_ptr<SharedFrameBuffer> scaled_yu12_frame =
+      CreateYU12Frame(320, 180);
+  std::unique_ptr<SharedFrameBuffer> scaled_nv12_frame =
+      CreateNV12Frame(320, 180);
+  ASSERT_EQ(image_processor->DecodeMJPEGToFrames(
+                *in_frame,
+                {yu12_frame.get(), nv12_frame.get(), scaled_yu12_frame.get(),
+                 scaled_nv12_frame.get()},
+                {Size(kWidth, kHeight), Size(kWidth, kHeight),
+                 Size(kWidth, 360), Size(kWidth, 360)}),
+            0);
+  EXPECT_TRUE(IsSameYU12AndNV12Frame(*yu12_frame, *nv12_frame));
+  EXPECT_TRUE(IsSameYU12AndNV12Frame(*scaled_yu12_frame, *scaled_nv12_frame));
+
+  std::unique_ptr<SharedFrameBuffer> expected_frame =
+      CreateYU12Frame(kWidth, kHeight);
+  ASSERT_EQ(image_processor->ConvertFormat(*in_frame, expected_frame.get()),
+            0);
+  EXPECT_TRUE(IsSameYU12AndNV12Frame(*expected_frame, *nv12_frame));
+}
+
+// Compares the fused band pipeline with the full-frame pipeline, which decodes
+// into a temporary frame and then crops and scales it into every output, for
+// 4:2:2 MJPEG that most USB cameras produce and a typical preview + video +
+// YUV callback configuration.
+TEST_F(ImageProcessorTest, DecodeMJPEG422ToFrames) {
+  const int kWidth = 1920;
+  const int kHeight = 1080;
+  const std::vector<Size> kOutputSizes = {
+      Size(1920, 1080), Size(1280, 720), Size(640, 480)};
+  std::unique_ptr<ImageProcessor> image_processor(new ImageProcessor());
+  std::unique_ptr<SharedFrameBuffer> in_frame =
+      CreateMJPEGFrame(kWidth, kHeight, 1);
+
+  std::vector<std::unique_ptr<SharedFrameBuffer>> out_frames;
+  std::vector<FrameBuffer*> out_frame_ptrs;
+  std::vector<Size> crop_sizes;
+  for (const auto& size : kOutputSizes) {
+    out_frames.push_back(CreateYU12Frame(size.width, size.height));
+    out_frame_ptrs.push_back(out_frames.back().get());
+    // Crop to the aspect ratio of the output.
+    if (size.width * kHeight > kWidth * size.height) {
+      crop_sizes.emplace_back(kWidth, kWidth * size.height / size.width);
+    } else {
+      crop_sizes.emplace_back(kHeight * size.width / size.height, kHeight);
+    }
+  }
+  // Write the smallest output as NV12 to cover the interleaved chroma path.
+  std::unique_ptr<SharedFrameBuffer> nv12_frame =
+      CreateNV12Frame(kOutputSizes.back().width, kOutputSizes.back().height);
+  out_frame_ptrs.push_back(nv12_frame.get());
+  crop_sizes.push_back(crop_sizes.back());
+  ASSERT_EQ(image_processor->DecodeMJPEGToFrames(*in_frame, out_frame_ptrs,
+                                                 crop_sizes),
+            0);
+
+  std::unique_ptr<SharedFrameBuffer> decoded_frame =
+      CreateYU12Frame(kWidth, kHeight);
+  ASSERT_EQ(image_processor->ConvertFormat(*in_frame, decoded_frame.get()),
+            0);
+  for (size_t i = 0; i < kOutputSizes.size(); i++) {
+    std::unique_ptr<SharedFrameBuffer> cropped_frame =
+        CreateYU12Frame(crop_sizes[i].width, crop_sizes[i].height);
+    std::unique_ptr<SharedFrameBuffer> expected_frame =
+        CreateYU12Frame(kOutputSizes[i].width, kOutputSizes[i].height);
+    ASSERT_EQ(image_processor->Crop(*decoded_frame, cropped_frame.get()), 0);
+    ASSERT_EQ(image_processor->Scale(*cropped_frame, expected_frame.get()), 0);
+    EXPECT_TRUE(IsSameYU12Frame(*expected_frame, *out_frames[i]))
+        << "Output " << i << " differs from the full-frame pipeline";
+    if (i == kOutputSizes.size() - 1) {
+      EXPECT_TRUE(IsSameYU12AndNV12Frame(*expected_frame, *nv12_frame));
+    }
+  }
+}
+
 }  // namespace tests
 
 }  // namespace cros
@@ -35,11 +35,17 @@ constexpr float kFpsDifferenceThreshold = 1.0f;
 
 namespace cros {
 
-V4L2CameraDevice::V4L2CameraDevice()
-    : stream_on_(false), device_info_(DeviceInfo()) {}
+V4L2CameraDevice::V4L2CameraDevice() : V4L2CameraDevice(DeviceInfo()) {}
 
 V4L2CameraDevice::V4L2CameraDevice(const DeviceInfo& device_info)
-    : stream_on_(false), device_info_(device_info) {}
+    : num_video_buffers_(
+          device_info.num_video_buffers
+              ? std::min<uint32_t>(device_info.num_video_buffers,
+                                   VIDEO_MAX_FRAME)
+              : kDefaultNumVideoBuffers),
+      memory_(V4L2_MEMORY_MMAP),
+      stream_on_(false),
+      device_info_(device_info) {}
 
 V4L2CameraDevice::~V4L2CameraDevice() {
   device_fd_.reset();
@@ -120,6 +126,7 @@ void V4L2CameraDevice::Disconnect() {
   stream_on_ = false;
   device_fd_.reset();
   buffers_at_client_.clear();
+  imported_fds_.clear();
 }
 
 int V4L2CameraDevice::StreamOn(uint32_t width,
@@ -130,65 +137,25 @@ int V4L2CameraDevice::StreamOn(uint32_t width,
                                std::vector<base::ScopedFD>* fds,
                                std::vector<uint32_t>* buffer_sizes) {
   base::AutoLock l(lock_);
-  if (!device_fd_.is_valid()) {
-    LOGF(ERROR) << "Device is not opened";
-    return -ENODEV;
-  }
-  if (stream_on_) {
-    LOGF(ERROR) << "Device has stream already started";
-    return -EIO;
-  }
-
-  int ret;
-  struct v4l2_control control;
-  control.id = V4L2_CID_EXPOSURE_AUTO_PRIORITY;
-  control.value = constant_frame_rate ? 0 : 1;
-  ret = TEMP_FAILURE_RETRY(ioctl(device_fd_.get(), VIDIOC_S_CTRL, &control));
-  if (ret < 0) {
-    LOGF(WARNING) << "Failed to set V4L2_CID_EXPOSURE_AUTO_PRIORITY";
-  }
-
-  // Some drivers use rational time per frame instead of float frame rate, this
-  // constant k is used to convert between both: A fps -> [k/k*A] seconds/frame.
-  v4l2_format fmt = {};
-  fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-  fmt.fmt.pix.width = width;
-  fmt.fmt.pix.height = height;
-  fmt.fmt.pix.pixelformat = pixel_format;
-  ret = TEMP_FAILURE_RETRY(ioctl(device_fd_.get(), VIDIOC_S_FMT, &fmt));
-  if (ret < 0) {
-    PLOGF(ERROR) << "Unable to S_FMT";
-    return -errno;
-  }
-  VLOGF(1) << "Actual width: " << fmt.fmt.pix.width
-           << ", height: " << fmt.fmt.pix.height
-           << ", pixelformat: " << std::hex << fmt.fmt.pix.pixelformat;
-
-  if (width != fmt.fmt.pix.width || height != fmt.fmt.pix.height ||
-      pixel_format != fmt.fmt.pix.pixelformat) {
-    LOGF(ERROR) << "Unsupported format: width " << width << ", height "
-                << height << ", pixelformat " << pixel_format;
-    return -EINVAL;
-  }
-
-  if (frame_rate != frame_rate_) {
-    ret = SetFrameRate(frame_rate);
-    if (ret < 0) {
-      return ret;
-    }
+  uint32_t size_image;
+  int ret = SetUpStream(width, height, pixel_format, frame_rate,
+                        constant_frame_rate, &size_image);
+  if (ret) {
+    return ret;
   }
 
   v4l2_requestbuffers req_buffers;
   memset(&req_buffers, 0, sizeof(req_buffers));
   req_buffers.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
   req_buffers.memory = V4L2_MEMORY_MMAP;
-  req_buffers.count = kNumVideoBuffers;
+  req_buffers.count = num_video_buffers_;
   if (TEMP_FAILURE_RETRY(
           ioctl(device_fd_.get(), VIDIOC_REQBUFS, &req_buffers)) < 0) {
     PLOGF(ERROR) << "REQBUFS fails";
     return -errno;
   }
   VLOGF(1) << "Requested buffer number: " << req_buffers.count;
+  memory_ = V4L2_MEMORY_MMAP;
 
   buffers_at_client_.resize(req_buffers.count);
   std::vector<base::ScopedFD> temp_fds;
@@ -234,6 +201,115 @@ int V4L2CameraDevice::StreamOn(uint32_t width,
   return 0;
 }
 
+int V4L2CameraDevice::StreamOnImported(uint32_t width,
+                                       uint32_t height,
+                                       uint32_t pixel_format,
+                                       float frame_rate,
+                                       bool constant_frame_rate,
+                                       uint32_t num_buffers,
+                                       uint32_t* buffer_size) {
+  base::AutoLock l(lock_);
+  uint32_t size_image;
+  int ret = SetUpStream(width, height, pixel_format, frame_rate,
+                        constant_frame_rate, &size_image);
+  if (ret) {
+    return ret;
+  }
+
+  v4l2_requestbuffers req_buffers;
+  memset(&req_buffers, 0, sizeof(req_buffers));
+  req_buffers.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+  req_buffers.memory = V4L2_MEMORY_DMABUF;
+  req_buffers.count = num_buffers;
+  if (TEMP_FAILURE_RETRY(
+          ioctl(device_fd_.get(), VIDIOC_REQBUFS, &req_buffers)) < 0) {
+    PLOGF(ERROR) << "REQBUFS fails";
+    return -errno;
+  }
+  VLOGF(1) << "Requested buffer number: " << req_buffers.count;
+  if (req_buffers.count < num_buffers) {
+    LOGF(ERROR) << "Only " << req_buffers.count << " of " << num_buffers
+                << " dma-buf slots are available";
+    req_buffers.count = 0;
+    TEMP_FAILURE_RETRY(ioctl(device_fd_.get(), VIDIOC_REQBUFS, &req_buffers));
+    return -ENOMEM;
+  }
+  memory_ = V4L2_MEMORY_DMABUF;
+
+  // No slot is queued until the caller imports a buffer into it.
+  buffers_at_client_.assign(req_buffers.count, true);
+  imported_fds_.assign(req_buffers.count, -1);
+
+  v4l2_buf_type capture_type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+  if (TEMP_FAILURE_RETRY(
+          ioctl(device_fd_.get(), VIDIOC_STREAMON, &capture_type)) < 0) {
+    PLOGF(ERROR) << "STREAMON fails";
+    return -errno;
+  }
+
+  *buffer_size = size_image;
+  stream_on_ = true;
+  return 0;
+}
+
+int V4L2CameraDevice::SetUpStream(uint32_t width,
+                                  uint32_t height,
+                                  uint32_t pixel_format,
+                                  float frame_rate,
+                                  bool constant_frame_rate,
+                                  uint32_t* size_image) {
+  lock_.AssertAcquired();
+  if (!device_fd_.is_valid()) {
+    LOGF(ERROR) << "Device is not opened";
+    return -ENODEV;
+  }
+  if (stream_on_) {
+    LOGF(ERROR) << "Device has stream already started";
+    return -EIO;
+  }
+
+  int ret;
+  struct v4l2_control control;
+  control.id = V4L2_CID_EXPOSURE_AUTO_PRIORITY;
+  control.value = constant_frame_rate ? 0 : 1;
+  ret = TEMP_FAILURE_RETRY(ioctl(device_fd_.get(), VIDIOC_S_CTRL, &control));
+  if (ret < 0) {
+    LOGF(WARNING) << "Failed to set V4L2_CID_EXPOSURE_AUTO_PRIORITY";
+  }
+
+  // Some drivers use rational time per frame instead of float frame rate, this
+  // constant k is used to convert between both: A fps -> [k/k*A] seconds/frame.
+  v4l2_format fmt = {};
+  fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+  fmt.fmt.pix.width = width;
+  fmt.fmt.pix.height = height;
+  fmt.fmt.pix.pixelformat = pixel_format;
+  ret = TEMP_FAILURE_RETRY(ioctl(device_fd_.get(), VIDIOC_S_FMT, &fmt));
+  if (ret < 0) {
+    PLOGF(ERROR) << "Unable to S_FMT";
+    return -errno;
+  }
+  VLOGF(1) << "Actual width: " << fmt.fmt.pix.width
+           << ", height: " << fmt.fmt.pix.height
+           << ", pixelformat: " << std::hex << fmt.fmt.pix.pixelformat;
+
+  if (width != fmt.fmt.pix.width || height != fmt.fmt.pix.height ||
+      pixel_format != fmt.fmt.pix.pixelformat) {
+    LOGF(ERROR) << "Unsupported format: width " << width << ", height "
+                << height << ", pixelformat " << pixel_format;
+    return -EINVAL;
+  }
+  *size_image = fmt.fmt.pix.sizeimage;
+
+  if (frame_rate != frame_rate_) {
+    ret = SetFrameRate(frame_rate);
+    if (ret < 0) {
+      return ret;
+    }
+  }
+  return 0;
+}
+
 int V4L2CameraDevice::StreamOff() {
   base::AutoLock l(lock_);
   if (!device_fd_.is_valid()) {
@@ -255,7 +331,7 @@ int V4L2CameraDevice::StreamOff() {
   v4l2_requestbuffers req_buffers;
   memset(&req_buffers, 0, sizeof(req_buffers));
   req_buffers.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-  req_buffers.memory = V4L2_MEMORY_MMAP;
+  req_buffers.memory = memory_;
   req_buffers.count = 0;
   if (TEMP_FAILURE_RETRY(
           ioctl(device_fd_.get(), VIDIOC_REQBUFS, &req_buffers)) < 0) {
@@ -263,6 +339,7 @@ int V4L2CameraDevice::StreamOff() {
     return -errno;
   }
   buffers_at_client_.clear();
+  imported_fds_.clear();
   stream_on_ = false;
   return 0;
 }
@@ -307,7 +384,7 @@ int V4L2CameraDevice::GetNextFrameBuffer(uint32_t* buffer_id,
   v4l2_buffer buffer;
   memset(&buffer, 0, sizeof(buffer));
   buffer.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-  buffer.memory = V4L2_MEMORY_MMAP;
+  buffer.memory = memory_;
   if (TEMP_FAILURE_RETRY(ioctl(device_fd_.get(), VIDIOC_DQBUF, &buffer)) < 0) {
     PLOGF(ERROR) << "DQBUF fails";
     return -errno;
@@ -357,11 +434,50 @@ int V4L2CameraDevice::ReuseFrameBuffer(uint32_t buffer_id) {
     LOGF(ERROR) << "Invalid buffer id: " << buffer_id;
     return -EINVAL;
   }
+  if (memory_ == V4L2_MEMORY_DMABUF && imported_fds_[buffer_id] < 0) {
+    LOGF(ERROR) << "No dma-buf is imported into buffer id: " << buffer_id;
+    return -EINVAL;
+  }
+  return QueueBuffer(buffer_id, memory_ == V4L2_MEMORY_DMABUF
+                                    ? imported_fds_[buffer_id]
+                                    : -1);
+}
+
+int V4L2CameraDevice::QueueImportedBuffer(uint32_t buffer_id, int fd) {
+  base::AutoLock l(lock_);
+  if (!device_fd_.is_valid()) {
+    LOGF(ERROR) << "Device is not opened";
+    return -ENODEV;
+  }
+  if (!stream_on_ || memory_ != V4L2_MEMORY_DMABUF) {
+    LOGF(ERROR) << "Streaming is not started in dma-buf mode";
+    return -EIO;
+  }
+
+  VLOGF(1) << "Import fd " << fd << " into buffer id: " << buffer_id;
+  if (buffer_id >= buffers_at_client_.size() ||
+      !buffers_at_client_[buffer_id]) {
+    LOGF(ERROR) << "Invalid buffer id: " << buffer_id;
+    return -EINVAL;
+  }
+  int ret = QueueBuffer(buffer_id, fd);
+  if (ret) {
+    return ret;
+  }
+  imported_fds_[buffer_id] = fd;
+  return 0;
+}
+
+int V4L2CameraDevice::QueueBuffer(uint32_t buffer_id, int fd) {
+  lock_.AssertAcquired();
   v4l2_buffer buffer;
   memset(&buffer, 0, sizeof(buffer));
   buffer.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-  buffer.memory = V4L2_MEMORY_MMAP;
+  buffer.memory = memory_;
   buffer.index = buffer_id;
+  if (memory_ == V4L2_MEMORY_DMABUF) {
+    buffer.m.fd = fd;
+  }
   if (TEMP_FAILURE_RETRY(ioctl(device_fd_.get(), VIDIOC_QBUF, &buffer)) < 0) {
     PLOGF(ERROR) << "QBUF fails";
     return -errno;
@@ -373,7 +489,7 @@ int V4L2CameraDevice::ReuseFrameBuffer(uint32_t buffer_id) {
 bool V4L2CameraDevice::IsBufferFilled(uint32_t buffer_id) {
   v4l2_buffer buffer = {};
   buffer.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-  buffer.memory = V4L2_MEMORY_MMAP;
+  buffer.memory = memory_;
   buffer.index = buffer_id;
   if (TEMP_FAILURE_RETRY(ioctl(device_fd_.get(), VIDIOC_QUERYBUF, &buffer)) <
       0) {
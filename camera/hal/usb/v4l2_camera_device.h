@@ -7,6 +7,7 @@
 #ifndef CAMERA_HAL_USB_V4L2_CAMERA_DEVICE_H_
 #define CAMERA_HAL_USB_V4L2_CAMERA_DEVICE_H_
 
+#include <linux/videodev2.h>
 #include <time.h>
 
 #include <string>
@@ -54,6 +55,21 @@ class V4L2CameraDevice {
                std::vector<base::ScopedFD>* fds,
                std::vector<uint32_t>* buffer_sizes);
 
+  // Enable camera device stream in V4L2_MEMORY_DMABUF mode. The stream is set
+  // up the same as StreamOn(), but no buffer is allocated in kernel. Instead
+  // |num_buffers| empty slots are requested and the caller captures into its
+  // own dma-bufs with QueueImportedBuffer(). |buffer_size| is the minimum size
+  // of a dma-buf to hold a frame. Return 0 if device supports the format.
+  // Otherwise, return -|errno|. This function should be called after
+  // Connect().
+  int StreamOnImported(uint32_t width,
+                       uint32_t height,
+                       uint32_t pixel_format,
+                       float frame_rate,
+                       bool constant_frame_rate,
+                       uint32_t num_buffers,
+                       uint32_t* buffer_size);
+
   // Disable camera device stream. Return 0 if device disables stream
   // successfully. Otherwise, return -|errno|. This function is a no-op if the
   // stream is already stopped.
@@ -73,9 +89,17 @@ class V4L2CameraDevice {
 
   // Return |buffer_id| buffer to device. Return 0 if the buffer is returned
   // successfully. Otherwise, return -|errno|. This function should be called
-  // after StreamOn().
+  // after StreamOn(). After StreamOnImported(), the dma-buf last queued into
+  // |buffer_id| is queued again.
   int ReuseFrameBuffer(uint32_t buffer_id);
 
+  // Queue dma-buf |fd| into the empty slot |buffer_id|, so that a following
+  // frame is captured into it. |fd| is not owned and should be kept open until
+  // the frame is returned by GetNextFrameBuffer(). Return 0 if the buffer is
+  // queued successfully. Otherwise, return -|errno|. This function should be
+  // called after StreamOnImported().
+  int QueueImportedBuffer(uint32_t buffer_id, int fd);
+
   // Return true if buffer specified by |buffer_id| is filled and moved to
   // outgoing queue.
   bool IsBufferFilled(uint32_t buffer_id);
@@ -86,6 +110,9 @@ class V4L2CameraDevice {
 
   // TODO(shik): Change the type of |device_path| to base::FilePath.
 
+  // Gets the number of video buffers requested in kernel by StreamOn().
+  uint32_t GetNumVideoBuffers() const { return num_video_buffers_; }
+
   // Gets the frame rate which is set previously.
   float GetFrameRate();
 
@@ -129,8 +156,27 @@ class V4L2CameraDevice {
   // Returns true if the current connected device is an external camera.
   bool IsExternalCamera();
 
+  // Set up the stream format and frame rate shared by StreamOn() and
+  // StreamOnImported(). |size_image| is the size of a frame in bytes.
+  int SetUpStream(uint32_t width,
+                  uint32_t height,
+                  uint32_t pixel_format,
+                  float frame_rate,
+                  bool constant_frame_rate,
+                  uint32_t* size_image);
+
+  // Queue slot |buffer_id|, with dma-buf |fd| in V4L2_MEMORY_DMABUF mode.
+  int QueueBuffer(uint32_t buffer_id, int fd);
+
+  // The default number of video buffers we want to request in kernel, if not
+  // configured in |device_info_|.
+  const uint32_t kDefaultNumVideoBuffers = 4;
+
   // The number of video buffers we want to request in kernel.
-  const int kNumVideoBuffers = 4;
+  const uint32_t num_video_buffers_;
+
+  // V4L2_MEMORY_MMAP or V4L2_MEMORY_DMABUF, set when the stream is on.
+  v4l2_memory memory_;
 
   // The opened device fd.
   base::ScopedFD device_fd_;
@@ -144,9 +190,14 @@ class V4L2CameraDevice {
 
   float frame_rate_;
 
-  // True if the buffer is used by client after GetNextFrameBuffer().
+  // True if the buffer is used by client after GetNextFrameBuffer(). In
+  // V4L2_MEMORY_DMABUF mode, slots are also at client until the first
+  // QueueImportedBuffer().
   std::vector<bool> buffers_at_client_;
 
+  // The dma-buf last queued into each slot in V4L2_MEMORY_DMABUF mode.
+  std::vector<int> imported_fds_;
+
   // Keep internal camera devices to distinguish external camera.
   // First index is VID:PID and second index is the device info.
   std::unordered_map<std::string, DeviceInfo> internal_devices_;
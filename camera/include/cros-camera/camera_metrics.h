@@ -18,6 +18,24 @@ enum class JpegProcessType { kDecode, kEncode };
 
 enum class JpegProcessMethod { kHardware, kSoftware };
 
+// The stages of handling a capture request in USB HAL. When MJPEG is decoded
+// in bands, kDecode also covers the conversion into the output frames. kEncode
+// is the JPEG encoding of a BLOB output, which is part of kConvert when full
+// frames are converted.
+enum class RequestStage {
+  kWaitBufferSync,
+  kDequeueFrame,
+  kDecode,
+  kConvert,
+  kEncode,
+  kWriteStreamBuffers,
+  kTotal,
+  kMaxValue = kTotal,
+};
+
+// Returns the name of |stage|, as used in UMA and traces.
+CROS_CAMERA_EXPORT const char* RequestStageToString(RequestStage stage);
+
 class CROS_CAMERA_EXPORT CameraMetrics {
  public:
   static std::unique_ptr<CameraMetrics> New();
@@ -54,6 +72,10 @@ class CROS_CAMERA_EXPORT CameraMetrics {
 
   // Records the duration of the closing session.
   virtual void SendSessionDuration(base::TimeDelta duration) = 0;
+
+  // Records the process time of |stage| of a capture request.
+  virtual void SendRequestStageLatency(RequestStage stage,
+                                       base::TimeDelta latency) = 0;
 };
 
 }  // namespace cros
@@ -29,6 +29,9 @@ const char kCrosForceJpegHardwareDecodeOption[] = "force_jpeg_hw_dec";
 const char kCrosEnableFrontCameraOption[] = "enable_front_camera";
 const char kCrosEnableBackCameraOption[] = "enable_back_camera";
 const char kCrosEnableExternalCameraOption[] = "enable_external_camera";
+// String value for the path to write the Chrome trace JSON of capture requests
+// handled by USB HAL. The camera id is appended to the path.
+const char kCrosUsbRequestTraceFileOption[] = "usb_request_trace_file";
 // ------End configuration for |kCrosCameraTestConfigPathString|-------
 
 // ------Configuration for |kCrosCameraConfigPathString|-------
@@ -45,6 +48,18 @@ const char kCrosMaxPrivateHeight[] = "max_private_height";
 // Restrict max resolutions for native ratio.
 const char kCrosMaxNativeWidth[] = "max_native_width";
 const char kCrosMaxNativeHeight[] = "max_native_height";
+// Integer value for the number of threads used by SW JPEG encode in USB HAL.
+// Defaults to the number of processors.
+const char kCrosJpegSwEncodeThreads[] = "jpeg_sw_enc_threads";
+// Integer value for the number of V4L2 buffers requested by USB HAL, i.e. the
+// depth of the capture ring. Can be overridden per camera by
+// |num_video_buffers| in camera_characteristics.conf.
+const char kCrosUsbNumVideoBuffers[] = "usb_num_video_buffers";
+// Boolean value to capture NV12 frames with V4L2_MEMORY_DMABUF into a ring of
+// gralloc buffers owned by USB HAL, instead of the V4L2 MMAP buffers. Frames
+// are still copied into every output buffer, but the JPEG encoder reads the
+// captured buffer directly. YUYV is always captured into MMAP buffers.
+const char kCrosUsbDmaBufImport[] = "usb_dmabuf_import";
 // ------End configuration for |kCrosCameraConfigPathString|-------
 
 }  // namespace constants
@@ -38,6 +38,13 @@ class CROS_CAMERA_EXPORT JpegCompressor {
 
   virtual ~JpegCompressor() {}
 
+  // Sets the number of threads used for SW encode. When |num_threads| is
+  // larger than 1, large images are split into horizontal strips aligned to
+  // JPEG restart intervals, the strips are encoded in parallel and the
+  // resulting bitstreams are stitched into a single baseline JPEG. Values less
+  // than or equal to 1 keep the single-threaded SW encode. Defaults to 1.
+  virtual void SetSwEncodeThreads(int num_threads) = 0;
+
   // Compresses YU12 image to JPEG format with HW encode acceleration. It would
   // fallback to SW encode if HW encode fails by default.
   // |quality| is the resulted jpeg image quality. It ranges from 1
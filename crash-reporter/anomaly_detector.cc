@@ -5,8 +5,10 @@
 #include "crash-reporter/anomaly_detector.h"
 
 #include <utility>
+#include <vector>
 
 #include <anomaly_detector/proto_bindings/anomaly_detector.pb.h>
+#include <base/logging.h>
 #include <base/strings/string_util.h>
 #include <base/strings/stringprintf.h>
 #include <chromeos/dbus/service_constants.h>
@@ -14,6 +16,7 @@
 #include <dbus/exported_object.h>
 #include <dbus/message.h>
 #include <re2/re2.h>
+#include <re2/set.h>
 
 namespace {
 
@@ -78,7 +81,7 @@ MaybeCrashReport ServiceParser::ParseLogEntry(const std::string& line) {
   return {{std::move(text), std::move(flag)}};
 }
 
-std::string GetField(const std::string& line, std::string pattern) {
+std::string GetField(const std::string& line, const RE2& pattern) {
   std::string field_value;
   RE2::PartialMatch(line, pattern, &field_value);
   // This will return the empty string if there wasn't a match.
@@ -86,6 +89,11 @@ std::string GetField(const std::string& line, std::string pattern) {
 }
 
 constexpr LazyRE2 granted = {"avc:[ ]*granted"};
+constexpr LazyRE2 scontext_field = {R"(scontext=(\S*))"};
+constexpr LazyRE2 tcontext_field = {R"(tcontext=(\S*))"};
+constexpr LazyRE2 permission_field = {R"(\{ (\S*) \})"};
+constexpr LazyRE2 comm_field = {R"'(comm="([^"]*)")'"};
+constexpr LazyRE2 name_field = {R"'(name="([^"]*)")'"};
 
 MaybeCrashReport SELinuxParser::ParseLogEntry(const std::string& line) {
   std::string only_alpha = OnlyAsciiAlpha(line);
@@ -98,11 +106,11 @@ MaybeCrashReport SELinuxParser::ParseLogEntry(const std::string& line) {
   if (RE2::PartialMatch(line, *granted))
     signature += "granted-";
 
-  std::string scontext = GetField(line, R"(scontext=(\S*))");
-  std::string tcontext = GetField(line, R"(tcontext=(\S*))");
-  std::string permission = GetField(line, R"(\{ (\S*) \})");
-  std::string comm = GetField(line, R"'(comm="([^"]*)")'");
-  std::string name = GetField(line, R"'(name="([^"]*)")'");
+  std::string scontext = GetField(line, *scontext_field);
+  std::string tcontext = GetField(line, *tcontext_field);
+  std::string permission = GetField(line, *permission_field);
+  std::string comm = GetField(line, *comm_field);
+  std::string name = GetField(line, *name_field);
 
   signature += base::JoinString({scontext, tcontext, permission,
                                  OnlyAsciiAlpha(comm), OnlyAsciiAlpha(name)},
@@ -146,7 +154,7 @@ constexpr LazyRE2 header = {R"(^WARNING:(?: CPU: \d+ PID: \d+)? at (.+))"};
 
 MaybeCrashReport KernelParser::ParseLogEntry(const std::string& line) {
   if (last_line_ == LineType::None) {
-    if (line.find(cut_here) == 0)
+    if (base::StartsWith(line, cut_here, base::CompareCase::SENSITIVE))
       last_line_ = LineType::Start;
   } else if (last_line_ == LineType::Start || last_line_ == LineType::Header) {
     std::string info;
@@ -176,7 +184,7 @@ MaybeCrashReport KernelParser::ParseLogEntry(const std::string& line) {
       last_line_ = LineType::None;
     }
   } else if (last_line_ == LineType::Body) {
-    if (line.find(end_trace) == 0) {
+    if (base::StartsWith(line, end_trace, base::CompareCase::SENSITIVE)) {
       last_line_ = LineType::None;
       std::string text_tmp;
       text_tmp.swap(text_);
@@ -210,7 +218,9 @@ constexpr LazyRE2 last_failed_step = {
     R"(\s*last_failed_step: (.+))"};
 
 MaybeCrashReport SuspendParser::ParseLogEntry(const std::string& line) {
-  if (last_line_ == LineType::None && line.find(begin_suspend_stats) == 0) {
+  if (last_line_ == LineType::None &&
+      base::StartsWith(line, begin_suspend_stats,
+                       base::CompareCase::SENSITIVE)) {
     last_line_ = LineType::Start;
     dev_str_ = "none";
     errno_str_ = "unknown";
@@ -222,7 +232,8 @@ MaybeCrashReport SuspendParser::ParseLogEntry(const std::string& line) {
     return base::nullopt;
   }
 
-  if (line.find(end_suspend_stats) != 0) {
+  if (!base::StartsWith(line, end_suspend_stats,
+                        base::CompareCase::SENSITIVE)) {
     std::string info;
     if (RE2::FullMatch(line, *last_failed_dev, &info)) {
       dev_str_ = info;
@@ -243,6 +254,11 @@ MaybeCrashReport SuspendParser::ParseLogEntry(const std::string& line) {
   return {{std::move(text), "--suspend_failure"}};
 }
 
+// Both chrome crash messages start with this, which is looked for first so
+// that the other messages are not run through the regexes.
+constexpr char chrome_crash_notification[] =
+    "Received crash notification for chrome[";
+
 constexpr LazyRE2 chrome_crash_called_directly = {
     "Received crash notification for chrome\\[(\\d+)\\][[:alnum:] ]+"
     "\\(called directly\\)"};
@@ -263,6 +279,9 @@ CrashReporterParser::CrashReporterParser(
 }
 
 MaybeCrashReport CrashReporterParser::ParseLogEntry(const std::string& line) {
+  if (line.find(chrome_crash_notification) == std::string::npos)
+    return base::nullopt;
+
   int pid = 0;
   UnmatchedCrash crash;
   if (RE2::PartialMatch(line, *chrome_crash_called_directly, &pid)) {
@@ -321,22 +340,35 @@ void CrashReporterParser::PeriodicUpdate() {
 
 TerminaParser::TerminaParser(scoped_refptr<dbus::Bus> dbus) : dbus_(dbus) {}
 
-constexpr LazyRE2 btrfs_extent_corruption = {
+constexpr const char* btrfs_corruptions[] = {
+    // Extent corruption.
     R"(BTRFS warning \(device .*\): csum failed root [[:digit:]]+ )"
     R"(ino [[:digit:]]+ off [[:digit:]]+ csum 0x[[:xdigit:]]+ expected )"
-    R"(csum 0x[[:xdigit:]]+ mirror [[:digit:]]+)"};
-constexpr LazyRE2 btrfs_tree_node_corruption = {
+    R"(csum 0x[[:xdigit:]]+ mirror [[:digit:]]+)",
+    // Tree node corruption.
     R"(BTRFS warning \(device .*\): .* checksum verify failed on )"
     R"([[:digit:]]+ wanted [[:xdigit:]]+ found [[:xdigit:]]+ level )"
-    R"([[:digit:]]+)"};
+    R"([[:digit:]]+)",
+};
 constexpr LazyRE2 vsock_cid = {R"(VM\(([[:digit:]]+)\))"};
 
+// Matches a line against all the btrfs_corruptions patterns in a single scan.
+const RE2::Set& BtrfsCorruptionSet() {
+  static const RE2::Set* set = [] {
+    auto* set = new RE2::Set(RE2::DefaultOptions, RE2::UNANCHORED);
+    for (const char* pattern : btrfs_corruptions)
+      CHECK_GE(set->Add(pattern, nullptr), 0) << pattern;
+    CHECK(set->Compile());
+    return set;
+  }();
+  return *set;
+}
+
 MaybeCrashReport TerminaParser::ParseLogEntry(const std::string& tag,
                                               const std::string& line) {
-  if (!RE2::PartialMatch(line, *btrfs_extent_corruption) &&
-      !RE2::PartialMatch(line, *btrfs_tree_node_corruption)) {
+  std::vector<int> matches;
+  if (!BtrfsCorruptionSet().Match(line, &matches))
     return base::nullopt;
-  }
 
   int cid;
   anomaly_detector::GuestFileCorruptionSignal message;
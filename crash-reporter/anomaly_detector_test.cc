@@ -367,3 +367,16 @@ TEST(AnomalyDetectorTest, BTRFSTreeCorruption) {
                        "BTRFS warning (device vdb): vdb checksum verify failed "
                        "on 122798080 wanted 4E5B4C99 found 5F261FEB level 0");
 }
+
+TEST(AnomalyDetectorTest, BTRFSOtherMessage) {
+  dbus::Bus::Options options;
+  options.bus_type = dbus::Bus::SYSTEM;
+  scoped_refptr<dbus::MockBus> bus = new dbus::MockBus(options);
+  EXPECT_CALL(*bus, GetExportedObject(_)).Times(0);
+
+  TerminaParser parser(bus);
+
+  parser.ParseLogEntry("VM(3)",
+                       "BTRFS info (device vdb): disk space caching is "
+                       "enabled");
+}
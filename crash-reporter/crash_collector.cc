@@ -42,6 +42,7 @@
 #include <zlib.h>
 
 #include "crash-reporter/constants.h"
+#include "crash-reporter/crash_spool_index.h"
 #include "crash-reporter/paths.h"
 #include "crash-reporter/util.h"
 
@@ -128,31 +129,6 @@ using base::FileEnumerator;
 using base::FilePath;
 using base::StringPrintf;
 
-// Walk the directory tree to make sure we avoid symlinks.
-// All parent parts must already exist else we abort.
-bool ValidatePathAndOpen(const FilePath& dir, int* outfd) {
-  std::vector<FilePath::StringType> components;
-  dir.GetComponents(&components);
-  int parentfd = AT_FDCWD;
-
-  for (const auto& component : components) {
-    int dirfd = openat(parentfd, component.c_str(),
-                       O_CLOEXEC | O_DIRECTORY | O_NOFOLLOW | O_PATH);
-    if (dirfd < 0) {
-      PLOG(ERROR) << "Unable to access crash path: " << dir.value() << " ("
-                  << component << ")";
-      if (parentfd != AT_FDCWD)
-        close(parentfd);
-      return false;
-    }
-    if (parentfd != AT_FDCWD)
-      close(parentfd);
-    parentfd = dirfd;
-  }
-  *outfd = parentfd;
-  return true;
-}
-
 // Create a directory using the specified mode/user/group, and make sure it
 // is actually a directory with the specified permissions.
 // static
@@ -166,7 +142,7 @@ bool CrashCollector::CreateDirectoryWithSettings(const FilePath& dir,
   const FilePath final_dir = dir.BaseName();
 
   int parentfd;
-  if (!ValidatePathAndOpen(parent_dir, &parentfd)) {
+  if (!util::ValidatePathAndOpen(parent_dir, &parentfd)) {
     return false;
   }
 
@@ -251,7 +227,7 @@ bool CrashCollector::CreateDirectoryWithSettings(const FilePath& dir,
         if (subdir_path == dir) {
           subdir_fd = dirfd;
         } else {
-          if (!ValidatePathAndOpen(subdir_path, &subdir_fd)) {
+          if (!util::ValidatePathAndOpen(subdir_path, &subdir_fd)) {
             close(dirfd);
             return false;
           }
@@ -1198,6 +1174,13 @@ void CrashCollector::FinishCrash(const FilePath& meta_path,
   // might have created.
   if (WriteNewFile(meta_path, meta_data.c_str(), meta_data.size()) < 0) {
     PLOG(ERROR) << "Unable to write " << meta_path.value();
+  } else if (crash_sending_mode_ != kCrashLoopSendingMode) {
+    // Spare crash_sender from reading the meta file to find the payload.
+    int64_t payload_size = 0;
+    if (!base::GetFileSize(payload_path, &payload_size))
+      payload_size = 0;
+    CrashSpoolIndex(meta_path.DirName())
+        .AddReport(meta_path.BaseName().value(), payload_name, payload_size);
   }
 
   // Record report created metric in UMA.
@@ -34,6 +34,7 @@
 
 #include "crash-reporter/crash_sender.pb.h"
 #include "crash-reporter/crash_sender_paths.h"
+#include "crash-reporter/crash_spool_index.h"
 #include "crash-reporter/paths.h"
 #include "crash-reporter/util.h"
 
@@ -210,6 +211,13 @@ void RemoveOrphanedCrashFiles(const base::FilePath& crash_dir) {
   base::FileEnumerator iter(crash_dir, true /* recursive */,
                             base::FileEnumerator::FILES, "*");
   for (base::FilePath file = iter.Next(); !file.empty(); file = iter.Next()) {
+    // The spool index is not part of a report.
+    const std::string base_name = file.BaseName().value();
+    if (base_name == paths::kCrashSpoolIndex ||
+        base_name == paths::kCrashSpoolIndexTemp) {
+      continue;
+    }
+
     // Get the meta data file path.
     const base::FilePath meta_file =
         base::FilePath(GetBasePartOfCrashFile(file).value() + ".meta");
@@ -256,6 +264,8 @@ void RemoveReportFiles(const base::FilePath& meta_file) {
     if (!base::DeleteFile(file, false /* recursive */))
       PLOG(WARNING) << "Failed to remove " << file.value();
   }
+  CrashSpoolIndex(meta_file.DirName())
+      .RemoveReport(meta_file.BaseName().value());
 }
 
 std::vector<base::FilePath> GetMetaFiles(const base::FilePath& crash_dir) {
@@ -679,9 +689,18 @@ Sender::Action Sender::ChooseAction(const base::FilePath& meta_file,
 
 void Sender::RemoveAndPickCrashFiles(const base::FilePath& crash_dir,
                                      std::vector<MetaFile>* to_send) {
-  std::vector<base::FilePath> meta_files = GetMetaFiles(crash_dir);
-
-  for (const auto& meta_file : meta_files) {
+  CrashSpoolIndex index(crash_dir);
+  // Reports are checked oldest first, and only until there are enough of them
+  // to reach the rate limit; the newer ones are left for the next runs.
+  int picked_count = 0;
+  int64_t picked_bytes = 0;
+  for (const auto& report : index.Load()) {
+    const base::FilePath& meta_file = report.meta_file;
+    if (picked_count >= max_crash_rate_ && picked_bytes >= max_crash_bytes_) {
+      LOG(INFO) << "Rate limit reached, leaving the other reports in "
+                << crash_dir.value();
+      break;
+    }
     LOG(INFO) << "Checking metadata: " << meta_file.value();
 
     std::string reason;
@@ -695,12 +714,19 @@ void Sender::RemoveAndPickCrashFiles(const base::FilePath& crash_dir,
         LOG(INFO) << "Ignoring: " << reason;
         break;
       case kSend:
+        if (report.failed_uploads > 0)
+          LOG(INFO) << "Failed uploads so far: " << report.failed_uploads;
+        picked_count++;
+        // Like IsBelowRate(), assume the maximum size for unknown sizes.
+        picked_bytes += report.payload_size > 0 ? report.payload_size
+                                                : util::kDefaultMaxUploadBytes;
         to_send->push_back(std::make_pair(meta_file, std::move(info)));
         break;
       default:
         NOTREACHED();
     }
   }
+  index.DeleteIfEmpty();
 }
 
 void Sender::SendCrashes(const std::vector<MetaFile>& crash_meta_files) {
@@ -775,6 +801,8 @@ void Sender::SendCrashes(const std::vector<MetaFile>& crash_meta_files) {
     if (!RequestToSendCrash(details)) {
       LOG(WARNING) << "Failed to send " << meta_file.value()
                    << ", not removing; will retry later";
+      CrashSpoolIndex(meta_file.DirName())
+          .AddFailedUpload(meta_file.BaseName().value());
       continue;
     }
     LOG(INFO) << "Successfully sent crash " << meta_file.value()
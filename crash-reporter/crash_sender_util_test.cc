@@ -883,6 +883,60 @@ TEST_F(CrashSenderUtilTest, RemoveAndPickCrashFiles) {
   EXPECT_EQ(devcore_meta_.value(), to_send[3].first.value());
 }
 
+TEST_F(CrashSenderUtilTest, RemoveAndPickCrashFilesStopsAtRateLimit) {
+  auto mock =
+      std::make_unique<org::chromium::SessionManagerInterfaceProxyMock>();
+  test_util::SetActiveSessions(mock.get(), {{"user", "hash"}});
+  MetricsLibraryMock* raw_metrics_lib = metrics_lib_.get();
+
+  Sender::Options options;
+  options.session_manager_proxy = mock.release();
+  // Reports are picked until both limits are reached.
+  options.max_crash_rate = 1;
+  options.max_crash_bytes = 15;
+  Sender sender(std::move(metrics_lib_),
+                std::make_unique<test_util::AdvancingClock>(), options);
+  ASSERT_TRUE(sender.Init());
+  ASSERT_TRUE(SetConditions(kOfficialBuild, kSignInMode, kMetricsEnabled,
+                            raw_metrics_lib));
+
+  const base::FilePath crash_directory =
+      paths::Get(paths::kSystemCrashDirectory);
+  ASSERT_TRUE(CreateDirectory(crash_directory));
+  const base::Time now = test_util::GetDefaultTime();
+  const base::TimeDelta hour = base::TimeDelta::FromHours(1);
+  // Oldest first: a report without payload, three good ones with 10-byte
+  // payloads, and another report without payload.
+  const std::vector<std::pair<std::string, std::string>> reports = {
+      {"corrupt1", "done=1\n"},
+      {"good1", "payload=good1.log\ndone=1\n"},
+      {"good2", "payload=good2.log\ndone=1\n"},
+      {"good3", "payload=good3.log\ndone=1\n"},
+      {"corrupt2", "done=1\n"},
+  };
+  for (size_t i = 0; i < reports.size(); i++) {
+    const base::Time time = now - hour * (reports.size() - i);
+    const std::string& name = reports[i].first;
+    ASSERT_TRUE(CreateFile(crash_directory.Append(name + ".meta"),
+                           reports[i].second, time));
+    ASSERT_TRUE(
+        CreateFile(crash_directory.Append(name + ".log"), "0123456789", time));
+  }
+
+  std::vector<MetaFile> to_send;
+  sender.RemoveAndPickCrashFiles(crash_directory, &to_send);
+  ASSERT_EQ(2, to_send.size());
+  EXPECT_EQ(crash_directory.Append("good1.meta"), to_send[0].first);
+  EXPECT_EQ(crash_directory.Append("good2.meta"), to_send[1].first);
+  // The corrupt report checked before the limit was reached is removed, while
+  // the reports after it are left for the next runs without being checked.
+  EXPECT_FALSE(base::PathExists(crash_directory.Append("corrupt1.meta")));
+  EXPECT_TRUE(base::PathExists(crash_directory.Append("good3.meta")));
+  EXPECT_TRUE(base::PathExists(crash_directory.Append("corrupt2.meta")));
+  EXPECT_TRUE(
+      base::PathExists(crash_directory.Append(paths::kCrashSpoolIndex)));
+}
+
 TEST_F(CrashSenderUtilTest, RemoveReportFiles) {
   const base::FilePath crash_directory =
       paths::Get(paths::kSystemCrashDirectory);
@@ -0,0 +1,364 @@
+// Copyright 2020 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "crash-reporter/crash_spool_index.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <base/files/file_enumerator.h>
+#include <base/files/file_util.h>
+#include <base/logging.h>
+#include <base/posix/eintr_wrapper.h>
+#include <base/strings/string_number_conversions.h>
+#include <base/strings/string_split.h>
+#include <base/strings/string_util.h>
+#include <base/strings/stringprintf.h>
+
+#include "crash-reporter/paths.h"
+#include "crash-reporter/util.h"
+
+namespace {
+
+constexpr char kHeader[] = "crash-spool-index\t1\n";
+
+// Meta files larger than this are not read; crash_sender removes them.
+constexpr int64_t kMaxMetaFileSize = 1024 * 1024;
+
+// Number of times opening the index is retried when it is replaced while
+// waiting for its lock.
+constexpr int kMaxOpenAttempts = 5;
+
+// The index is compacted when it holds more than this many records which do
+// not describe a current report.
+constexpr size_t kMaxStaleRecords = 64;
+
+// What the index records about a report.
+struct Entry {
+  std::string payload_name;
+  int64_t payload_size = 0;
+  int failed_uploads = 0;
+};
+
+// Names which cannot be stored in a record.
+bool IsValidName(const std::string& name) {
+  return name.find_first_of("\t\n") == std::string::npos;
+}
+
+std::string FormatAddRecord(const std::string& meta_name, const Entry& entry) {
+  return base::StringPrintf("A\t%s\t%s\t%" PRId64 "\t%d\n", meta_name.c_str(),
+                            entry.payload_name.c_str(), entry.payload_size,
+                            entry.failed_uploads);
+}
+
+// Parses the index in |contents| into |entries|, setting |*num_records| to
+// the number of records. Returns false if the index is corrupt.
+bool ParseIndex(const std::string& contents,
+                std::map<std::string, Entry>* entries,
+                size_t* num_records) {
+  if (!base::StartsWith(contents, kHeader, base::CompareCase::SENSITIVE))
+    return false;
+  const base::StringPiece records =
+      base::StringPiece(contents).substr(strlen(kHeader));
+  std::vector<base::StringPiece> lines = base::SplitStringPiece(
+      records, "\n", base::KEEP_WHITESPACE, base::SPLIT_WANT_ALL);
+  // The last line is either empty or the partial record of an interrupted
+  // write.
+  lines.pop_back();
+  *num_records = lines.size();
+  for (const auto& line : lines) {
+    std::vector<std::string> fields = base::SplitString(
+        line, "\t", base::KEEP_WHITESPACE, base::SPLIT_WANT_ALL);
+    if (fields.size() == 5 && fields[0] == "A") {
+      Entry entry;
+      entry.payload_name = fields[2];
+      if (!base::StringToInt64(fields[3], &entry.payload_size) ||
+          !base::StringToInt(fields[4], &entry.failed_uploads)) {
+        return false;
+      }
+      (*entries)[fields[1]] = entry;
+    } else if (fields.size() == 2 && fields[0] == "F") {
+      auto it = entries->find(fields[1]);
+      if (it != entries->end())
+        it->second.failed_uploads++;
+    } else if (fields.size() == 2 && fields[0] == "R") {
+      entries->erase(fields[1]);
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Reads the payload of the report of |meta_file| from the meta file.
+Entry ReadEntry(const base::FilePath& meta_file) {
+  Entry entry;
+  std::string contents;
+  if (!base::ReadFileToStringWithMaxSize(meta_file, &contents,
+                                         kMaxMetaFileSize)) {
+    return entry;
+  }
+  for (const auto& line : base::SplitStringPiece(
+           contents, "\n", base::KEEP_WHITESPACE, base::SPLIT_WANT_NONEMPTY)) {
+    if (!base::StartsWith(line, "payload=", base::CompareCase::SENSITIVE))
+      continue;
+    const base::FilePath payload =
+        base::FilePath(line.substr(strlen("payload=")).as_string()).BaseName();
+    if (payload.empty() || payload.IsAbsolute() ||
+        !IsValidName(payload.value())) {
+      break;
+    }
+    entry.payload_name = payload.value();
+    if (!base::GetFileSize(meta_file.DirName().Append(payload),
+                           &entry.payload_size)) {
+      entry.payload_size = 0;
+    }
+    break;
+  }
+  return entry;
+}
+
+// Returns whether |fd|, opened from the crash directory |dir_fd|, is a regular
+// file written by us or by the owner of the directory. crash_sender runs as
+// root, and must not write through a link or a device planted in the
+// directory by someone else.
+bool IsTrustedFile(int dir_fd, int fd, const base::FilePath& path) {
+  struct stat dir_stat, file_stat;
+  if (fstat(dir_fd, &dir_stat) < 0 || fstat(fd, &file_stat) < 0) {
+    PLOG(WARNING) << "Could not stat " << path.value();
+    return false;
+  }
+  if (!S_ISREG(file_stat.st_mode) || file_stat.st_nlink != 1 ||
+      (file_stat.st_uid != geteuid() && file_stat.st_uid != dir_stat.st_uid)) {
+    LOG(WARNING) << "Ignoring unexpected file " << path.value();
+    return false;
+  }
+  return true;
+}
+
+bool ReadFromFile(int fd, std::string* contents) {
+  char buffer[4096];
+  while (true) {
+    ssize_t result = HANDLE_EINTR(read(fd, buffer, sizeof(buffer)));
+    if (result < 0)
+      return false;
+    if (result == 0)
+      return true;
+    contents->append(buffer, result);
+  }
+}
+
+}  // namespace
+
+CrashSpoolIndex::CrashSpoolIndex(const base::FilePath& crash_dir)
+    : crash_dir_(crash_dir),
+      index_file_(crash_dir.Append(paths::kCrashSpoolIndex)) {}
+
+void CrashSpoolIndex::AddReport(const std::string& meta_name,
+                                const std::string& payload_name,
+                                int64_t payload_size) {
+  if (!IsValidName(meta_name) || !IsValidName(payload_name))
+    return;
+  Entry entry;
+  entry.payload_name = payload_name;
+  entry.payload_size = payload_size;
+  Append(FormatAddRecord(meta_name, entry));
+}
+
+void CrashSpoolIndex::AddFailedUpload(const std::string& meta_name) {
+  if (IsValidName(meta_name))
+    Append("F\t" + meta_name + "\n");
+}
+
+void CrashSpoolIndex::RemoveReport(const std::string& meta_name) {
+  if (IsValidName(meta_name))
+    Append("R\t" + meta_name + "\n");
+}
+
+std::vector<CrashSpoolIndex::Report> CrashSpoolIndex::Load() {
+  std::vector<Report> reports;
+  if (!base::DirectoryExists(crash_dir_))
+    return reports;
+
+  // Without the index, the reports are still returned from their meta files.
+  base::ScopedFD dir_fd = OpenDirectory();
+  base::ScopedFD fd;
+  if (dir_fd.is_valid())
+    fd = OpenLocked(dir_fd.get(), true);
+  std::map<std::string, Entry> entries;
+  size_t num_records = 0;
+  bool rewrite = false;
+  std::string contents;
+  if (fd.is_valid() && (!ReadFromFile(fd.get(), &contents) ||
+                        !ParseIndex(contents, &entries, &num_records))) {
+    // A new index is empty.
+    if (!contents.empty()) {
+      LOG(WARNING) << "Rebuilding corrupt crash spool index "
+                   << index_file_.value();
+    }
+    entries.clear();
+    num_records = 0;
+    rewrite = true;
+  } else if (!contents.empty() && contents.back() != '\n') {
+    // Records appended after a partial one would not be parsed.
+    rewrite = true;
+  }
+
+  base::FileEnumerator iter(crash_dir_, false /* recursive */,
+                            base::FileEnumerator::FILES, "*.meta");
+  for (base::FilePath file = iter.Next(); !file.empty(); file = iter.Next()) {
+    Report report;
+    report.meta_file = file;
+    report.last_modified = iter.GetInfo().GetLastModifiedTime();
+    auto it = entries.find(file.BaseName().value());
+    const Entry entry = it != entries.end() ? it->second : ReadEntry(file);
+    if (it == entries.end())
+      rewrite = true;
+    report.payload_name = entry.payload_name;
+    report.payload_size = entry.payload_size;
+    report.failed_uploads = entry.failed_uploads;
+    reports.push_back(report);
+  }
+  std::stable_sort(reports.begin(), reports.end(),
+                   [](const Report& a, const Report& b) {
+                     return a.last_modified < b.last_modified;
+                   });
+
+  if (reports.size() != entries.size() ||
+      num_records > reports.size() + kMaxStaleRecords) {
+    rewrite = true;
+  }
+  if (fd.is_valid() && rewrite)
+    Rewrite(dir_fd.get(), reports);
+  return reports;
+}
+
+void CrashSpoolIndex::DeleteIfEmpty() {
+  base::ScopedFD dir_fd = OpenDirectory();
+  if (!dir_fd.is_valid())
+    return;
+  base::ScopedFD fd = OpenLocked(dir_fd.get(), false);
+  if (!fd.is_valid())
+    return;
+  std::string contents;
+  std::map<std::string, Entry> entries;
+  size_t num_records = 0;
+  if (!ReadFromFile(fd.get(), &contents) ||
+      !ParseIndex(contents, &entries, &num_records) || !entries.empty()) {
+    return;
+  }
+  if (unlinkat(dir_fd.get(), paths::kCrashSpoolIndex, 0) < 0)
+    PLOG(WARNING) << "Could not remove " << index_file_.value();
+}
+
+base::ScopedFD CrashSpoolIndex::OpenDirectory() {
+  int dir_fd = -1;
+  if (!util::ValidatePathAndOpen(crash_dir_, &dir_fd))
+    return base::ScopedFD();
+  return base::ScopedFD(dir_fd);
+}
+
+base::ScopedFD CrashSpoolIndex::OpenLocked(int dir_fd, bool create) {
+  // O_NONBLOCK keeps a FIFO in place of the index from blocking the open.
+  const int flags = O_RDWR | O_APPEND | O_CLOEXEC | O_NOFOLLOW | O_NONBLOCK |
+                    (create ? O_CREAT : 0);
+  for (int attempt = 0; attempt < kMaxOpenAttempts; attempt++) {
+    base::ScopedFD fd(
+        HANDLE_EINTR(openat(dir_fd, paths::kCrashSpoolIndex, flags, 0600)));
+    if (!fd.is_valid() && errno != ELOOP) {
+      if (errno != ENOENT)
+        PLOG(WARNING) << "Could not open " << index_file_.value();
+      return fd;
+    }
+    if (!fd.is_valid() || !IsTrustedFile(dir_fd, fd.get(), index_file_)) {
+      // Only crash_sender creates the index; it replaces a symlink or another
+      // unexpected file with a new index.
+      if (!create || unlinkat(dir_fd, paths::kCrashSpoolIndex, 0) < 0)
+        return base::ScopedFD();
+      continue;
+    }
+    if (HANDLE_EINTR(flock(fd.get(), LOCK_EX)) < 0) {
+      PLOG(WARNING) << "Could not lock " << index_file_.value();
+      return base::ScopedFD();
+    }
+    // The index may have been replaced or removed while waiting for the lock.
+    struct stat fd_stat, path_stat;
+    if (fstat(fd.get(), &fd_stat) == 0 &&
+        fstatat(dir_fd, paths::kCrashSpoolIndex, &path_stat,
+                AT_SYMLINK_NOFOLLOW) == 0 &&
+        fd_stat.st_dev == path_stat.st_dev &&
+        fd_stat.st_ino == path_stat.st_ino) {
+      return fd;
+    }
+    if (!create && errno == ENOENT)
+      return base::ScopedFD();
+  }
+  LOG(WARNING) << "Could not lock " << index_file_.value();
+  return base::ScopedFD();
+}
+
+void CrashSpoolIndex::Append(const std::string& records) {
+  base::ScopedFD dir_fd = OpenDirectory();
+  if (!dir_fd.is_valid())
+    return;
+  base::ScopedFD fd = OpenLocked(dir_fd.get(), false);
+  if (!fd.is_valid())
+    return;
+  if (!base::WriteFileDescriptor(fd.get(), records.data(), records.size()))
+    PLOG(WARNING) << "Could not write " << index_file_.value();
+}
+
+bool CrashSpoolIndex::Rewrite(int dir_fd, const std::vector<Report>& reports) {
+  std::string contents = kHeader;
+  for (const Report& report : reports) {
+    const std::string meta_name = report.meta_file.BaseName().value();
+    if (!IsValidName(meta_name))
+      continue;
+    Entry entry;
+    entry.payload_name = report.payload_name;
+    entry.payload_size = report.payload_size;
+    entry.failed_uploads = report.failed_uploads;
+    contents += FormatAddRecord(meta_name, entry);
+  }
+
+  // Whatever is left at the temporary path, from an interrupted rewrite or
+  // not, is removed so that the new index is always a file of our own.
+  const base::FilePath temp_file =
+      crash_dir_.Append(paths::kCrashSpoolIndexTemp);
+  if (unlinkat(dir_fd, paths::kCrashSpoolIndexTemp, 0) < 0 && errno != ENOENT) {
+    PLOG(WARNING) << "Could not remove " << temp_file.value();
+    return false;
+  }
+  base::ScopedFD fd(HANDLE_EINTR(openat(
+      dir_fd, paths::kCrashSpoolIndexTemp,
+      O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC | O_NOFOLLOW | O_NONBLOCK,
+      0600)));
+  if (!fd.is_valid()) {
+    PLOG(WARNING) << "Could not create " << temp_file.value();
+    return false;
+  }
+  if (!base::WriteFileDescriptor(fd.get(), contents.data(), contents.size()) ||
+      HANDLE_EINTR(fdatasync(fd.get())) < 0) {
+    PLOG(WARNING) << "Could not write " << temp_file.value();
+    unlinkat(dir_fd, paths::kCrashSpoolIndexTemp, 0);
+    return false;
+  }
+  if (renameat(dir_fd, paths::kCrashSpoolIndexTemp, dir_fd,
+               paths::kCrashSpoolIndex) < 0) {
+    PLOG(WARNING) << "Could not replace " << index_file_.value();
+    unlinkat(dir_fd, paths::kCrashSpoolIndexTemp, 0);
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,96 @@
+// Copyright 2020 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CRASH_REPORTER_CRASH_SPOOL_INDEX_H_
+#define CRASH_REPORTER_CRASH_SPOOL_INDEX_H_
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include <base/files/file_path.h>
+#include <base/files/scoped_file.h>
+#include <base/macros.h>
+#include <base/time/time.h>
+
+// Keeps what crash_sender needs to know about the reports of a crash directory
+// without reading their meta files: the payload of each report, its size, and
+// how many uploads of it failed.
+//
+// The index is a file in the crash directory, created by crash_sender. It
+// holds a header followed by one record per line, with tab-separated fields:
+//   A <meta> <payload> <payload size> <failed uploads>  a report was added,
+//   F <meta>                                            an upload failed,
+//   R <meta>                                            a report was removed.
+// Collectors and crash_sender append records while holding a lock on the
+// file, each with a single write, so that a crash leaves at most a partial
+// last line, which is ignored. crash_sender compacts the index by writing a
+// new file and renaming it over the old one.
+//
+// The index is only a cache: reports found in the directory but not in the
+// index are added to it from their meta files, and an index which cannot be
+// parsed is rebuilt.
+class CrashSpoolIndex {
+ public:
+  // A report of the crash directory.
+  struct Report {
+    base::FilePath meta_file;
+    // Last modification time of the meta file.
+    base::Time last_modified;
+    // Base name of the payload, which can be empty if it is not known.
+    std::string payload_name;
+    // Size of the payload in bytes, or 0 if it is not known.
+    int64_t payload_size = 0;
+    int failed_uploads = 0;
+  };
+
+  explicit CrashSpoolIndex(const base::FilePath& crash_dir);
+
+  // Records the report whose meta file |meta_name| was just written in the
+  // crash directory. Does nothing if the index does not exist.
+  void AddReport(const std::string& meta_name,
+                 const std::string& payload_name,
+                 int64_t payload_size);
+
+  // Records a failed upload of the report of |meta_name|. Does nothing if the
+  // index does not exist.
+  void AddFailedUpload(const std::string& meta_name);
+
+  // Records the removal of the report of |meta_name|. Does nothing if the
+  // index does not exist.
+  void RemoveReport(const std::string& meta_name);
+
+  // Returns the reports of the crash directory, oldest first. Creates the
+  // index if it does not exist, and brings it up to date with the meta files
+  // of the directory, which are only read for the reports not in the index.
+  std::vector<Report> Load();
+
+  // Deletes the index if it holds no report.
+  void DeleteIfEmpty();
+
+ private:
+  // Opens the crash directory, checking that no component of its path is a
+  // symlink. Returns an invalid descriptor on failure.
+  base::ScopedFD OpenDirectory();
+
+  // Opens and locks the index of the crash directory |dir_fd|, creating it if
+  // |create| is true. Returns an invalid descriptor if the index cannot be
+  // opened, or is not a regular file of ours or of the directory owner.
+  base::ScopedFD OpenLocked(int dir_fd, bool create);
+
+  // Appends |records| to the index if it exists.
+  void Append(const std::string& records);
+
+  // Replaces the index of the crash directory |dir_fd| with one holding only
+  // |reports|.
+  bool Rewrite(int dir_fd, const std::vector<Report>& reports);
+
+  const base::FilePath crash_dir_;
+  const base::FilePath index_file_;
+
+  DISALLOW_COPY_AND_ASSIGN(CrashSpoolIndex);
+};
+
+#endif  // CRASH_REPORTER_CRASH_SPOOL_INDEX_H_
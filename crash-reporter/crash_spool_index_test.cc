@@ -0,0 +1,169 @@
+// Copyright 2020 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "crash-reporter/crash_spool_index.h"
+
+#include <string>
+#include <vector>
+
+#include <base/files/file_path.h>
+#include <base/files/file_util.h>
+#include <base/files/scoped_temp_dir.h>
+#include <base/time/time.h>
+#include <gtest/gtest.h>
+
+#include "crash-reporter/paths.h"
+
+namespace {
+
+class CrashSpoolIndexTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    ASSERT_TRUE(temp_dir_.CreateUniqueTempDir());
+    crash_dir_ = temp_dir_.GetPath();
+    index_file_ = crash_dir_.Append(paths::kCrashSpoolIndex);
+  }
+
+  // Creates a file in the crash directory, last modified |age| ago.
+  void CreateFile(const std::string& name,
+                  const std::string& contents,
+                  base::TimeDelta age) {
+    const base::FilePath path = crash_dir_.Append(name);
+    ASSERT_EQ(static_cast<int>(contents.size()),
+              base::WriteFile(path, contents.data(), contents.size()));
+    const base::Time time = base::Time::Now() - age;
+    ASSERT_TRUE(base::TouchFile(path, time, time));
+  }
+
+  // Creates a report whose payload has |payload_size| bytes.
+  void CreateReport(const std::string& name,
+                    size_t payload_size,
+                    base::TimeDelta age) {
+    CreateFile(name + ".meta", "payload=" + name + ".log\ndone=1\n", age);
+    CreateFile(name + ".log", std::string(payload_size, 'x'), age);
+  }
+
+  base::ScopedTempDir temp_dir_;
+  base::FilePath crash_dir_;
+  base::FilePath index_file_;
+};
+
+TEST_F(CrashSpoolIndexTest, LoadBuildsIndexFromMetaFiles) {
+  CreateReport("new", 10, base::TimeDelta::FromMinutes(1));
+  CreateReport("old", 20, base::TimeDelta::FromHours(1));
+
+  CrashSpoolIndex index(crash_dir_);
+  std::vector<CrashSpoolIndex::Report> reports = index.Load();
+  ASSERT_EQ(2, reports.size());
+  EXPECT_EQ(crash_dir_.Append("old.meta"), reports[0].meta_file);
+  EXPECT_EQ("old.log", reports[0].payload_name);
+  EXPECT_EQ(20, reports[0].payload_size);
+  EXPECT_EQ(crash_dir_.Append("new.meta"), reports[1].meta_file);
+  EXPECT_EQ("new.log", reports[1].payload_name);
+  EXPECT_EQ(10, reports[1].payload_size);
+  EXPECT_TRUE(base::PathExists(index_file_));
+
+  // The payloads are now known from the index.
+  ASSERT_TRUE(base::DeleteFile(crash_dir_.Append("old.log"), false));
+  reports = index.Load();
+  ASSERT_EQ(2, reports.size());
+  EXPECT_EQ(20, reports[0].payload_size);
+}
+
+TEST_F(CrashSpoolIndexTest, AddReportSparesReadingMetaFile) {
+  CrashSpoolIndex index(crash_dir_);
+  // Without an index, nothing is recorded.
+  index.AddReport("early.meta", "early.dmp", 42);
+  EXPECT_FALSE(base::PathExists(index_file_));
+
+  EXPECT_TRUE(index.Load().empty());
+  CreateFile("crash.meta", "not read", base::TimeDelta());
+  index.AddReport("crash.meta", "crash.dmp", 42);
+  std::vector<CrashSpoolIndex::Report> reports = index.Load();
+  ASSERT_EQ(1, reports.size());
+  EXPECT_EQ("crash.dmp", reports[0].payload_name);
+  EXPECT_EQ(42, reports[0].payload_size);
+}
+
+TEST_F(CrashSpoolIndexTest, FailedUploadsAreCounted) {
+  CreateReport("crash", 10, base::TimeDelta());
+  CrashSpoolIndex index(crash_dir_);
+  ASSERT_EQ(1, index.Load().size());
+  index.AddFailedUpload("crash.meta");
+  index.AddFailedUpload("crash.meta");
+  std::vector<CrashSpoolIndex::Report> reports = index.Load();
+  ASSERT_EQ(1, reports.size());
+  EXPECT_EQ(2, reports[0].failed_uploads);
+
+  // The count survives the index being rewritten.
+  CreateReport("other", 10, base::TimeDelta());
+  reports = index.Load();
+  ASSERT_EQ(2, reports.size());
+  EXPECT_EQ(2, reports[0].failed_uploads);
+  EXPECT_EQ(0, reports[1].failed_uploads);
+}
+
+TEST_F(CrashSpoolIndexTest, RemovedReportsAreDropped) {
+  CreateReport("crash", 10, base::TimeDelta());
+  CrashSpoolIndex index(crash_dir_);
+  ASSERT_EQ(1, index.Load().size());
+  ASSERT_TRUE(base::DeleteFile(crash_dir_.Append("crash.meta"), false));
+  index.RemoveReport("crash.meta");
+  EXPECT_TRUE(index.Load().empty());
+  index.DeleteIfEmpty();
+  EXPECT_FALSE(base::PathExists(index_file_));
+}
+
+TEST_F(CrashSpoolIndexTest, DeleteIfEmptyKeepsIndexWithReports) {
+  CreateReport("crash", 10, base::TimeDelta());
+  CrashSpoolIndex index(crash_dir_);
+  ASSERT_EQ(1, index.Load().size());
+  index.DeleteIfEmpty();
+  EXPECT_TRUE(base::PathExists(index_file_));
+}
+
+TEST_F(CrashSpoolIndexTest, CorruptIndexIsRebuilt) {
+  CreateReport("crash", 10, base::TimeDelta());
+  CreateFile(paths::kCrashSpoolIndex, "garbage\n", base::TimeDelta());
+  CrashSpoolIndex index(crash_dir_);
+  std::vector<CrashSpoolIndex::Report> reports = index.Load();
+  ASSERT_EQ(1, reports.size());
+  EXPECT_EQ(10, reports[0].payload_size);
+
+  // A partial last record, as left by a crash while appending, is ignored.
+  ASSERT_TRUE(base::AppendToFile(index_file_, "A\tother.me", 10));
+  reports = index.Load();
+  ASSERT_EQ(1, reports.size());
+  EXPECT_EQ(10, reports[0].payload_size);
+}
+
+TEST_F(CrashSpoolIndexTest, SymlinksAreNotFollowed) {
+  base::ScopedTempDir other_dir;
+  ASSERT_TRUE(other_dir.CreateUniqueTempDir());
+  const base::FilePath target = other_dir.GetPath().Append("target");
+  ASSERT_EQ(6, base::WriteFile(target, "target", 6));
+  ASSERT_TRUE(base::CreateSymbolicLink(target, index_file_));
+  const base::FilePath temp_file =
+      crash_dir_.Append(paths::kCrashSpoolIndexTemp);
+  ASSERT_TRUE(base::CreateSymbolicLink(target, temp_file));
+
+  CreateReport("crash", 10, base::TimeDelta());
+  CrashSpoolIndex index(crash_dir_);
+  std::vector<CrashSpoolIndex::Report> reports = index.Load();
+  ASSERT_EQ(1, reports.size());
+  EXPECT_EQ(10, reports[0].payload_size);
+
+  std::string contents;
+  ASSERT_TRUE(base::ReadFileToString(target, &contents));
+  EXPECT_EQ("target", contents);
+  // The symlinks were replaced by a new index.
+  EXPECT_FALSE(base::IsLink(index_file_));
+  EXPECT_FALSE(base::PathExists(temp_file));
+  index.AddFailedUpload("crash.meta");
+  reports = index.Load();
+  ASSERT_EQ(1, reports.size());
+  EXPECT_EQ(1, reports[0].failed_uploads);
+}
+
+}  // namespace
@@ -58,6 +58,15 @@ constexpr char kLeaveCoreFile[] = "/root/.leave_core";
 // repo)
 constexpr char kCrashTestInProgress[] = "crash-test-in-progress";
 
+// Base name of file in the state directory that keeps track of the user crashes
+// repeating, so that only some of them are processed.
+constexpr char kRepeatedCrashes[] = "repeated-crashes";
+
+// Base name of file in crash directories that indexes the reports for
+// crash_sender, and of the file written to replace it.
+constexpr char kCrashSpoolIndex[] = "spool-index";
+constexpr char kCrashSpoolIndexTemp[] = "spool-index.tmp";
+
 // Base name of file whose existence indicates that the anomaly detector is
 // ready for anomalies.
 constexpr char kAnomalyDetectorReady[] = "anomaly-detector-ready";
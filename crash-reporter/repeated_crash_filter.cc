@@ -0,0 +1,157 @@
+// Copyright 2020 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "crash-reporter/repeated_crash_filter.h"
+
+#include <fcntl.h>
+#include <inttypes.h>
+#include <sys/file.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <base/files/file_util.h>
+#include <base/files/scoped_file.h>
+#include <base/logging.h>
+#include <base/posix/eintr_wrapper.h>
+#include <base/strings/string_number_conversions.h>
+#include <base/strings/string_split.h>
+#include <base/strings/stringprintf.h>
+
+namespace {
+
+// A kind of crash, with the start of its current window and the number of
+// crashes counted in it.
+struct Entry {
+  int64_t window_start;
+  int skipped_count;
+  int signal;
+  std::string exec;
+};
+
+// The state file has one line per entry, with tab-separated fields.
+std::vector<Entry> ParseEntries(const std::string& contents) {
+  std::vector<Entry> entries;
+  for (const auto& line : base::SplitStringPiece(
+           contents, "\n", base::KEEP_WHITESPACE, base::SPLIT_WANT_NONEMPTY)) {
+    std::vector<std::string> fields = base::SplitString(
+        line, "\t", base::KEEP_WHITESPACE, base::SPLIT_WANT_ALL);
+    Entry entry;
+    if (fields.size() != 4 ||
+        !base::StringToInt64(fields[0], &entry.window_start) ||
+        !base::StringToInt(fields[1], &entry.skipped_count) ||
+        !base::StringToInt(fields[2], &entry.signal) || fields[3].empty()) {
+      LOG(WARNING) << "Ignoring bad repeated crash entry: " << line;
+      continue;
+    }
+    entry.exec = fields[3];
+    entries.push_back(entry);
+  }
+  return entries;
+}
+
+std::string FormatEntries(const std::vector<Entry>& entries) {
+  std::string contents;
+  for (const Entry& entry : entries) {
+    base::StringAppendF(&contents, "%" PRId64 "\t%d\t%d\t%s\n",
+                        entry.window_start, entry.skipped_count, entry.signal,
+                        entry.exec.c_str());
+  }
+  return contents;
+}
+
+bool ReadFromFile(int fd, std::string* contents) {
+  char buffer[4096];
+  while (true) {
+    ssize_t result = HANDLE_EINTR(read(fd, buffer, sizeof(buffer)));
+    if (result < 0)
+      return false;
+    if (result == 0)
+      return true;
+    contents->append(buffer, result);
+  }
+}
+
+}  // namespace
+
+RepeatedCrashFilter::RepeatedCrashFilter(const base::FilePath& state_file,
+                                         base::TimeDelta window,
+                                         size_t max_entries)
+    : state_file_(state_file), window_(window), max_entries_(max_entries) {}
+
+bool RepeatedCrashFilter::ShouldProcess(const std::string& exec,
+                                        int signal,
+                                        base::Time now,
+                                        int* skipped_count) {
+  *skipped_count = 0;
+  // Such names cannot be stored. They are unlikely enough not to matter.
+  if (exec.empty() || exec.find_first_of("\t\n") != std::string::npos)
+    return true;
+
+  // Crashes are processed when the state cannot be used, so that they are not
+  // lost.
+  base::ScopedFD fd(HANDLE_EINTR(
+      open(state_file_.value().c_str(),
+           O_RDWR | O_CREAT | O_CLOEXEC | O_NOFOLLOW, 0600)));
+  if (!fd.is_valid()) {
+    PLOG(WARNING) << "Could not open " << state_file_.value();
+    return true;
+  }
+  if (HANDLE_EINTR(flock(fd.get(), LOCK_EX)) < 0) {
+    PLOG(WARNING) << "Could not lock " << state_file_.value();
+    return true;
+  }
+  std::string contents;
+  if (!ReadFromFile(fd.get(), &contents)) {
+    PLOG(WARNING) << "Could not read " << state_file_.value();
+    return true;
+  }
+  std::vector<Entry> entries = ParseEntries(contents);
+
+  const int64_t now_seconds = now.ToTimeT();
+  auto in_window = [this, now_seconds](const Entry& entry) {
+    return now_seconds >= entry.window_start &&
+           now_seconds - entry.window_start < window_.InSeconds();
+  };
+
+  bool process = true;
+  auto it = std::find_if(entries.begin(), entries.end(),
+                         [&exec, signal](const Entry& entry) {
+                           return entry.signal == signal && entry.exec == exec;
+                         });
+  if (it != entries.end() && in_window(*it)) {
+    it->skipped_count++;
+    process = false;
+  } else if (it != entries.end()) {
+    *skipped_count = it->skipped_count;
+    it->window_start = now_seconds;
+    it->skipped_count = 0;
+  } else {
+    // Forget the kinds of crashes with nothing left to report first, then the
+    // oldest ones.
+    entries.erase(std::remove_if(entries.begin(), entries.end(),
+                                 [&in_window](const Entry& entry) {
+                                   return entry.skipped_count == 0 &&
+                                          !in_window(entry);
+                                 }),
+                  entries.end());
+    std::stable_sort(entries.begin(), entries.end(),
+                     [](const Entry& a, const Entry& b) {
+                       return a.window_start > b.window_start;
+                     });
+    if (max_entries_ > 0 && entries.size() >= max_entries_)
+      entries.resize(max_entries_ - 1);
+    entries.push_back(Entry{now_seconds, 0, signal, exec});
+  }
+
+  contents = FormatEntries(entries);
+  if (HANDLE_EINTR(ftruncate(fd.get(), 0)) < 0 ||
+      lseek(fd.get(), 0, SEEK_SET) < 0 ||
+      !base::WriteFileDescriptor(fd.get(), contents.data(), contents.size())) {
+    PLOG(WARNING) << "Could not write " << state_file_.value();
+  }
+  return process;
+}
@@ -0,0 +1,48 @@
+// Copyright 2020 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CRASH_REPORTER_REPEATED_CRASH_FILTER_H_
+#define CRASH_REPORTER_REPEATED_CRASH_FILTER_H_
+
+#include <stddef.h>
+
+#include <string>
+
+#include <base/files/file_path.h>
+#include <base/macros.h>
+#include <base/time/time.h>
+
+// Keeps track of the recent user crashes across crash_reporter instances, so
+// that a program crashing in a loop gets only its first crash in a time window
+// converted and enqueued. The other crashes of the same kind in the window are
+// counted, and the count is reported with the next crash converted.
+//
+// Crashes are of the same kind if they come from the same executable with the
+// same signal. The state is kept in a file locked while it is updated, which
+// holds a bounded number of kinds of crashes.
+class RepeatedCrashFilter {
+ public:
+  // |state_file| should be on a filesystem cleared at boot.
+  RepeatedCrashFilter(const base::FilePath& state_file,
+                      base::TimeDelta window,
+                      size_t max_entries);
+
+  // Records a crash of |exec| with |signal| at |now|. Returns true if the
+  // crash should be processed, in which case |*skipped_count| is set to the
+  // number of crashes of the same kind only counted since the last one
+  // processed. Returns false if the crash should only be counted.
+  bool ShouldProcess(const std::string& exec,
+                     int signal,
+                     base::Time now,
+                     int* skipped_count);
+
+ private:
+  const base::FilePath state_file_;
+  const base::TimeDelta window_;
+  const size_t max_entries_;
+
+  DISALLOW_COPY_AND_ASSIGN(RepeatedCrashFilter);
+};
+
+#endif  // CRASH_REPORTER_REPEATED_CRASH_FILTER_H_
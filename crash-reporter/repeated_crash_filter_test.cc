@@ -0,0 +1,107 @@
+// Copyright 2020 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "crash-reporter/repeated_crash_filter.h"
+
+#include <signal.h>
+
+#include <base/files/file_path.h>
+#include <base/files/scoped_temp_dir.h>
+#include <gtest/gtest.h>
+
+namespace {
+
+constexpr base::TimeDelta kWindow = base::TimeDelta::FromMinutes(5);
+constexpr size_t kMaxEntries = 3;
+
+class RepeatedCrashFilterTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    ASSERT_TRUE(temp_dir_.CreateUniqueTempDir());
+    state_file_ = temp_dir_.GetPath().Append("repeated-crashes");
+    start_ = base::Time::FromTimeT(1000000);
+  }
+
+  bool ShouldProcess(const std::string& exec,
+                     int signal,
+                     base::TimeDelta since_start,
+                     int* skipped_count) {
+    // A new filter every time, like every crash_reporter instance.
+    RepeatedCrashFilter filter(state_file_, kWindow, kMaxEntries);
+    return filter.ShouldProcess(exec, signal, start_ + since_start,
+                                skipped_count);
+  }
+
+  base::ScopedTempDir temp_dir_;
+  base::FilePath state_file_;
+  base::Time start_;
+};
+
+TEST_F(RepeatedCrashFilterTest, RepeatedCrashesCounted) {
+  int skipped = -1;
+  EXPECT_TRUE(ShouldProcess("foo", SIGSEGV, base::TimeDelta(), &skipped));
+  EXPECT_EQ(0, skipped);
+  EXPECT_FALSE(ShouldProcess("foo", SIGSEGV, base::TimeDelta::FromSeconds(1),
+                             &skipped));
+  EXPECT_FALSE(ShouldProcess("foo", SIGSEGV, base::TimeDelta::FromMinutes(4),
+                             &skipped));
+
+  // Other kinds of crashes are processed.
+  EXPECT_TRUE(ShouldProcess("foo", SIGABRT, base::TimeDelta::FromSeconds(2),
+                            &skipped));
+  EXPECT_EQ(0, skipped);
+  EXPECT_TRUE(ShouldProcess("bar", SIGSEGV, base::TimeDelta::FromSeconds(3),
+                            &skipped));
+  EXPECT_EQ(0, skipped);
+
+  // The crashes counted are reported after the window.
+  EXPECT_TRUE(ShouldProcess("foo", SIGSEGV, base::TimeDelta::FromMinutes(5),
+                            &skipped));
+  EXPECT_EQ(2, skipped);
+  EXPECT_FALSE(ShouldProcess("foo", SIGSEGV, base::TimeDelta::FromMinutes(6),
+                             &skipped));
+}
+
+TEST_F(RepeatedCrashFilterTest, ClockGoingBackwards) {
+  int skipped = -1;
+  EXPECT_TRUE(ShouldProcess("foo", SIGSEGV, base::TimeDelta::FromMinutes(1),
+                            &skipped));
+  EXPECT_TRUE(ShouldProcess("foo", SIGSEGV, base::TimeDelta(), &skipped));
+  EXPECT_EQ(0, skipped);
+}
+
+TEST_F(RepeatedCrashFilterTest, BoundedEntries) {
+  int skipped = -1;
+  EXPECT_TRUE(ShouldProcess("a", SIGSEGV, base::TimeDelta(), &skipped));
+  EXPECT_FALSE(ShouldProcess("a", SIGSEGV, base::TimeDelta::FromSeconds(1),
+                             &skipped));
+  EXPECT_TRUE(
+      ShouldProcess("b", SIGSEGV, base::TimeDelta::FromSeconds(2), &skipped));
+  EXPECT_TRUE(
+      ShouldProcess("c", SIGSEGV, base::TimeDelta::FromSeconds(3), &skipped));
+  EXPECT_TRUE(
+      ShouldProcess("d", SIGSEGV, base::TimeDelta::FromSeconds(4), &skipped));
+  // The oldest entry was forgotten.
+  EXPECT_TRUE(
+      ShouldProcess("a", SIGSEGV, base::TimeDelta::FromSeconds(5), &skipped));
+  EXPECT_EQ(0, skipped);
+  EXPECT_FALSE(
+      ShouldProcess("d", SIGSEGV, base::TimeDelta::FromSeconds(6), &skipped));
+}
+
+TEST_F(RepeatedCrashFilterTest, UnusableStateProcessesCrashes) {
+  // The state file cannot be created.
+  state_file_ = temp_dir_.GetPath().Append("missing").Append("state");
+  int skipped = -1;
+  EXPECT_TRUE(ShouldProcess("foo", SIGSEGV, base::TimeDelta(), &skipped));
+  EXPECT_TRUE(ShouldProcess("foo", SIGSEGV, base::TimeDelta(), &skipped));
+  EXPECT_EQ(0, skipped);
+
+  // Names which cannot be stored.
+  state_file_ = temp_dir_.GetPath().Append("state");
+  EXPECT_TRUE(ShouldProcess("foo\tbar", SIGSEGV, base::TimeDelta(), &skipped));
+  EXPECT_TRUE(ShouldProcess("foo\tbar", SIGSEGV, base::TimeDelta(), &skipped));
+}
+
+}  // namespace
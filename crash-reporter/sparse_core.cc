@@ -0,0 +1,532 @@
+// Copyright 2020 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "crash-reporter/sparse_core.h"
+
+#include <elf.h>
+#include <link.h>
+#include <string.h>
+#include <sys/procfs.h>
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <sys/reg.h>
+#endif
+
+#include <algorithm>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include <base/files/file_util.h>
+#include <base/logging.h>
+#include <base/macros.h>
+#include <base/posix/eintr_wrapper.h>
+
+namespace sparse_core {
+namespace {
+
+// Indexes of the stack and instruction pointers in the registers of
+// NT_PRSTATUS notes.
+#if defined(__x86_64__)
+constexpr int kStackPointerIndex = RSP;
+constexpr int kInstructionPointerIndex = RIP;
+#elif defined(__i386__)
+constexpr int kStackPointerIndex = UESP;
+constexpr int kInstructionPointerIndex = EIP;
+#elif defined(__aarch64__)
+constexpr int kStackPointerIndex = 31;
+constexpr int kInstructionPointerIndex = 32;
+#elif defined(__arm__)
+constexpr int kStackPointerIndex = 13;
+constexpr int kInstructionPointerIndex = 15;
+#else
+// Cores are copied unchanged.
+constexpr int kStackPointerIndex = -1;
+constexpr int kInstructionPointerIndex = -1;
+#endif
+
+#if __WORDSIZE == 64
+constexpr unsigned char kElfClass = ELFCLASS64;
+#else
+constexpr unsigned char kElfClass = ELFCLASS32;
+#endif
+
+// The headers and notes of a core are read in memory. They are normally a few
+// kilobytes per thread.
+constexpr uint64_t kMaxHeadersSize = 16 * 1024 * 1024;
+
+constexpr size_t kCopyBufferSize = 64 * 1024;
+
+// Alignment of the segment content in the output, as done by the kernel.
+constexpr uint64_t kPageSize = 4096;
+
+// Bounds on what is read from the crashed process to find its modules.
+constexpr uint64_t kMaxProgramHeaders = 256;
+constexpr uint64_t kMaxDynamicSize = 64 * 1024;
+constexpr size_t kMaxModules = 4096;
+
+uint64_t AlignDown(uint64_t value, uint64_t alignment) {
+  return value / alignment * alignment;
+}
+
+uint64_t AlignUp(uint64_t value, uint64_t alignment) {
+  return AlignDown(value + alignment - 1, alignment);
+}
+
+// Reads |fd| sequentially, keeping track of the offset.
+class Input {
+ public:
+  explicit Input(int fd) : fd_(fd), offset_(0) {}
+
+  // Appends up to |size| bytes to |data|, less only at the end of the input.
+  // Returns false on errors.
+  bool Append(size_t size, std::string* data) {
+    size_t old_size = data->size();
+    data->resize(old_size + size);
+    size_t done = 0;
+    while (done < size) {
+      ssize_t result =
+          HANDLE_EINTR(read(fd_, &(*data)[old_size + done], size - done));
+      if (result < 0) {
+        PLOG(ERROR) << "Could not read core";
+        return false;
+      }
+      if (result == 0)
+        break;
+      done += result;
+    }
+    data->resize(old_size + done);
+    offset_ += done;
+    return true;
+  }
+
+  // Reads up to |size| bytes into |buffer|. Returns the number of bytes read,
+  // 0 at the end of the input, or -1 on errors.
+  ssize_t Read(char* buffer, size_t size) {
+    ssize_t result = HANDLE_EINTR(read(fd_, buffer, size));
+    if (result < 0)
+      PLOG(ERROR) << "Could not read core";
+    else
+      offset_ += result;
+    return result;
+  }
+
+  uint64_t offset() const { return offset_; }
+
+ private:
+  int fd_;
+  uint64_t offset_;
+
+  DISALLOW_COPY_AND_ASSIGN(Input);
+};
+
+// Writes |fd| sequentially, keeping track of the offset.
+class Output {
+ public:
+  explicit Output(int fd) : fd_(fd), offset_(0) {}
+
+  bool Write(const char* data, size_t size) {
+    while (size > 0) {
+      size_t chunk = std::min(size, kCopyBufferSize);
+      if (!base::WriteFileDescriptor(fd_, data, chunk)) {
+        PLOG(ERROR) << "Could not write core";
+        return false;
+      }
+      offset_ += chunk;
+      data += chunk;
+      size -= chunk;
+    }
+    return true;
+  }
+
+  // Writes zeros up to |offset|.
+  bool PadTo(uint64_t offset) {
+    DCHECK_GE(offset, offset_);
+    std::string zeros(offset - offset_, '\0');
+    return Write(zeros.data(), zeros.size());
+  }
+
+  uint64_t offset() const { return offset_; }
+
+ private:
+  int fd_;
+  uint64_t offset_;
+
+  DISALLOW_COPY_AND_ASSIGN(Output);
+};
+
+// Copies |size| bytes from |input| to |output|. The bytes are discarded if
+// |output| is null.
+bool Copy(Input* input, Output* output, uint64_t size) {
+  char buffer[kCopyBufferSize];
+  while (size > 0) {
+    ssize_t result =
+        input->Read(buffer, std::min<uint64_t>(size, sizeof(buffer)));
+    if (result < 0)
+      return false;
+    if (result == 0) {
+      LOG(ERROR) << "Core is truncated";
+      return false;
+    }
+    if (output && !output->Write(buffer, result))
+      return false;
+    size -= result;
+  }
+  return true;
+}
+
+// Copies everything left in |input| to |output|, or discards it if |output| is
+// null.
+bool CopyRest(Input* input, Output* output) {
+  char buffer[kCopyBufferSize];
+  while (true) {
+    ssize_t result = input->Read(buffer, sizeof(buffer));
+    if (result <= 0)
+      return result == 0;
+    if (output && !output->Write(buffer, result))
+      return false;
+  }
+}
+
+// Copies |head|, which has already been read from |input|, and the rest of
+// |input| unchanged.
+bool CopyUnchanged(const std::string& head, Input* input, Output* output) {
+  return output->Write(head.data(), head.size()) && CopyRest(input, output);
+}
+
+// What the notes of a core tell about the crashed process.
+struct CoreNotes {
+  // Stack and instruction pointers of the threads.
+  std::vector<uint64_t> stack_pointers;
+  std::vector<uint64_t> instruction_pointers;
+  // Address and number of the program headers of the executable, from the
+  // auxiliary vector.
+  uint64_t phdr = 0;
+  uint64_t phnum = 0;
+};
+
+// Adds what the notes of |size| bytes at |data| tell to |notes|.
+void ParseNotes(const char* data, size_t size, CoreNotes* notes) {
+  size_t offset = 0;
+  while (size - offset >= sizeof(ElfW(Nhdr))) {
+    ElfW(Nhdr) note;
+    memcpy(&note, data + offset, sizeof(note));
+    offset += sizeof(note);
+    uint64_t name_size = AlignUp(note.n_namesz, 4);
+    uint64_t desc_size = AlignUp(note.n_descsz, 4);
+    if (name_size > size - offset || desc_size > size - offset - name_size) {
+      LOG(WARNING) << "Truncated note in core";
+      return;
+    }
+    const char* desc = data + offset + name_size;
+    if (note.n_type == NT_PRSTATUS &&
+        note.n_descsz >= sizeof(struct elf_prstatus)) {
+      struct elf_prstatus status;
+      memcpy(&status, desc, sizeof(status));
+      notes->stack_pointers.push_back(status.pr_reg[kStackPointerIndex]);
+      notes->instruction_pointers.push_back(
+          status.pr_reg[kInstructionPointerIndex]);
+    } else if (note.n_type == NT_AUXV) {
+      for (size_t i = 0; i + sizeof(ElfW(auxv_t)) <= note.n_descsz;
+           i += sizeof(ElfW(auxv_t))) {
+        ElfW(auxv_t) entry;
+        memcpy(&entry, desc + i, sizeof(entry));
+        if (entry.a_type == AT_PHDR)
+          notes->phdr = entry.a_un.a_val;
+        else if (entry.a_type == AT_PHNUM)
+          notes->phnum = entry.a_un.a_val;
+      }
+    }
+    offset += name_size + desc_size;
+  }
+}
+
+// A range [begin, end) of addresses in the crashed process.
+struct Range {
+  uint64_t begin;
+  uint64_t end;
+};
+
+// Adds the |size| bytes at |address| to |ranges|, unless they wrap around.
+void AddRange(uint64_t address, uint64_t size, std::vector<Range>* ranges) {
+  if (address != 0 && size <= std::numeric_limits<uint64_t>::max() - address)
+    ranges->push_back({address, address + size});
+}
+
+// Reads |size| bytes at |address| in the crashed process from |memory_fd|.
+bool ReadMemory(int memory_fd, uint64_t address, void* buffer, size_t size) {
+  if (memory_fd < 0)
+    return false;
+  ssize_t result =
+      HANDLE_EINTR(pread(memory_fd, buffer, size, static_cast<off_t>(address)));
+  return result == static_cast<ssize_t>(size);
+}
+
+// Adds to |ranges| the memory which the minidump writer reads to list the
+// modules of the process, as found through |memory_fd|: the program headers
+// and the dynamic section of the executable, the r_debug structure which its
+// DT_DEBUG entry points to, and the link_map entries and names of the modules.
+// Returns false if the program headers of the executable cannot be read, in
+// which case the modules cannot be found.
+bool FindModuleMemory(int memory_fd,
+                      const CoreNotes& notes,
+                      std::vector<Range>* ranges) {
+  if (notes.phdr == 0 || notes.phnum == 0 ||
+      notes.phnum > kMaxProgramHeaders) {
+    LOG(WARNING) << "No program headers in the auxiliary vector";
+    return false;
+  }
+  std::vector<ElfW(Phdr)> program_headers(notes.phnum);
+  size_t program_headers_size = notes.phnum * sizeof(ElfW(Phdr));
+  if (!ReadMemory(memory_fd, notes.phdr, program_headers.data(),
+                  program_headers_size)) {
+    LOG(WARNING) << "Could not read the program headers of the executable";
+    return false;
+  }
+  AddRange(notes.phdr, program_headers_size, ranges);
+
+  // The executable is loaded at |bias| from the addresses in its headers.
+  // Without PT_PHDR, the headers are assumed to be in the first page of the
+  // segment mapped from the start of the file, as the minidump writer does.
+  uint64_t bias = 0;
+  const ElfW(Phdr)* phdr = nullptr;
+  const ElfW(Phdr)* first_load = nullptr;
+  const ElfW(Phdr)* dynamic = nullptr;
+  for (const auto& program_header : program_headers) {
+    if (program_header.p_type == PT_PHDR)
+      phdr = &program_header;
+    else if (program_header.p_type == PT_LOAD && program_header.p_offset == 0)
+      first_load = &program_header;
+    else if (program_header.p_type == PT_DYNAMIC)
+      dynamic = &program_header;
+  }
+  if (phdr)
+    bias = notes.phdr - phdr->p_vaddr;
+  else if (first_load)
+    bias = AlignDown(notes.phdr, kPageSize) - first_load->p_vaddr;
+  // A static executable has no modules to list.
+  if (!dynamic)
+    return true;
+
+  uint64_t dynamic_address = bias + dynamic->p_vaddr;
+  uint64_t dynamic_size = std::min<uint64_t>(dynamic->p_memsz, kMaxDynamicSize);
+  std::vector<ElfW(Dyn)> entries(dynamic_size / sizeof(ElfW(Dyn)));
+  AddRange(dynamic_address, entries.size() * sizeof(ElfW(Dyn)), ranges);
+  if (!ReadMemory(memory_fd, dynamic_address, entries.data(),
+                  entries.size() * sizeof(ElfW(Dyn)))) {
+    LOG(WARNING) << "Could not read the dynamic section of the executable";
+    return true;
+  }
+  uint64_t debug_address = 0;
+  for (const auto& entry : entries) {
+    if (entry.d_tag == DT_NULL)
+      break;
+    if (entry.d_tag == DT_DEBUG)
+      debug_address = entry.d_un.d_ptr;
+  }
+
+  struct r_debug debug;
+  AddRange(debug_address, sizeof(debug), ranges);
+  if (!ReadMemory(memory_fd, debug_address, &debug, sizeof(debug)))
+    return true;
+  uint64_t map_address = reinterpret_cast<uintptr_t>(debug.r_map);
+  for (size_t i = 0; i < kMaxModules && map_address != 0; i++) {
+    struct link_map map;
+    AddRange(map_address, sizeof(map), ranges);
+    if (!ReadMemory(memory_fd, map_address, &map, sizeof(map)))
+      break;
+    AddRange(reinterpret_cast<uintptr_t>(map.l_name), kModuleNameSize, ranges);
+    map_address = reinterpret_cast<uintptr_t>(map.l_next);
+  }
+  return true;
+}
+
+// Returns the range of the file content of |segment| to keep, as offsets from
+// the start of the segment. |*begin| is not less than |*end| if nothing needs
+// to be kept.
+void GetKeptRange(const ElfW(Phdr)& segment,
+                  const CoreNotes& notes,
+                  const std::vector<Range>& module_ranges,
+                  uint64_t* begin,
+                  uint64_t* end) {
+  if (segment.p_filesz <= kMaxWholeSegmentSize) {
+    *begin = 0;
+    *end = segment.p_filesz;
+    return;
+  }
+
+  *begin = segment.p_filesz;
+  *end = 0;
+  for (uint64_t sp : notes.stack_pointers) {
+    if (sp < segment.p_vaddr || sp - segment.p_vaddr >= segment.p_filesz)
+      continue;
+    // Stacks grow down: what is used is above the stack pointer.
+    *begin = std::min(*begin, AlignDown(sp - segment.p_vaddr, kPageSize));
+    *end = segment.p_filesz;
+  }
+  for (uint64_t ip : notes.instruction_pointers) {
+    if (ip < segment.p_vaddr || ip - segment.p_vaddr >= segment.p_filesz)
+      continue;
+    uint64_t offset = ip - segment.p_vaddr;
+    uint64_t low =
+        offset > kInstructionContextSize ? offset - kInstructionContextSize : 0;
+    uint64_t high = std::min<uint64_t>(
+        AlignUp(offset + kInstructionContextSize, kPageSize),
+        segment.p_filesz);
+    *begin = std::min(*begin, AlignDown(low, kPageSize));
+    *end = std::max(*end, high);
+  }
+  for (const Range& range : module_ranges) {
+    if (range.end <= segment.p_vaddr ||
+        range.begin >= segment.p_vaddr + segment.p_filesz) {
+      continue;
+    }
+    uint64_t low =
+        range.begin > segment.p_vaddr ? range.begin - segment.p_vaddr : 0;
+    uint64_t high = std::min<uint64_t>(
+        AlignUp(range.end - segment.p_vaddr, kPageSize), segment.p_filesz);
+    *begin = std::min(*begin, AlignDown(low, kPageSize));
+    *end = std::max(*end, high);
+  }
+}
+
+bool Filter(Input* input, Output* output, int memory_fd) {
+  std::string head;
+  if (!input->Append(sizeof(ElfW(Ehdr)), &head))
+    return false;
+  if (kStackPointerIndex < 0 || head.size() < sizeof(ElfW(Ehdr)))
+    return CopyUnchanged(head, input, output);
+
+  ElfW(Ehdr) header;
+  memcpy(&header, head.data(), sizeof(header));
+  if (memcmp(header.e_ident, ELFMAG, SELFMAG) != 0 ||
+      header.e_ident[EI_CLASS] != kElfClass || header.e_type != ET_CORE ||
+      header.e_phentsize != sizeof(ElfW(Phdr)) || header.e_phnum == 0 ||
+      header.e_phnum == PN_XNUM || header.e_phoff < sizeof(header) ||
+      header.e_phoff > kMaxHeadersSize) {
+    LOG(WARNING) << "Unexpected core header, copying it unchanged";
+    return CopyUnchanged(head, input, output);
+  }
+
+  uint64_t program_headers_end =
+      header.e_phoff + header.e_phnum * sizeof(ElfW(Phdr));
+  if (!input->Append(program_headers_end - head.size(), &head))
+    return false;
+  if (head.size() < program_headers_end)
+    return CopyUnchanged(head, input, output);
+  std::vector<ElfW(Phdr)> segments(header.e_phnum);
+  memcpy(segments.data(), head.data() + header.e_phoff,
+         segments.size() * sizeof(ElfW(Phdr)));
+
+  // The notes come before the content of the memory segments, which the
+  // kernel writes in order.
+  uint64_t notes_end = program_headers_end;
+  uint64_t content_start = std::numeric_limits<uint64_t>::max();
+  uint64_t content_end = 0;
+  for (const auto& segment : segments) {
+    if (segment.p_filesz == 0)
+      continue;
+    if (segment.p_offset + segment.p_filesz < segment.p_offset)
+      return CopyUnchanged(head, input, output);
+    if (segment.p_type != PT_LOAD) {
+      notes_end = std::max(notes_end, segment.p_offset + segment.p_filesz);
+      continue;
+    }
+    if (segment.p_offset < content_end)
+      return CopyUnchanged(head, input, output);
+    content_start = std::min(content_start, segment.p_offset);
+    content_end = segment.p_offset + segment.p_filesz;
+  }
+  if (content_end == 0)
+    content_start = notes_end;
+  if (notes_end > content_start || content_start > kMaxHeadersSize) {
+    LOG(WARNING) << "Unexpected core layout, copying it unchanged";
+    return CopyUnchanged(head, input, output);
+  }
+  if (!input->Append(content_start - head.size(), &head))
+    return false;
+  if (head.size() < content_start)
+    return CopyUnchanged(head, input, output);
+
+  CoreNotes notes;
+  for (const auto& segment : segments) {
+    if (segment.p_type == PT_NOTE) {
+      ParseNotes(head.data() + segment.p_offset, segment.p_filesz, &notes);
+    }
+  }
+  if (notes.stack_pointers.empty()) {
+    LOG(WARNING) << "No thread in core, copying it unchanged";
+    return CopyUnchanged(head, input, output);
+  }
+  // Without the module list, the minidump would be of little use.
+  std::vector<Range> module_ranges;
+  if (!FindModuleMemory(memory_fd, notes, &module_ranges)) {
+    LOG(WARNING) << "Could not find the modules, copying the core unchanged";
+    return CopyUnchanged(head, input, output);
+  }
+
+  // Lay out the kept content, updating the program headers.
+  std::vector<ElfW(Phdr)> new_segments = segments;
+  std::vector<uint64_t> begins(segments.size());
+  uint64_t offset = content_start;
+  for (size_t i = 0; i < segments.size(); i++) {
+    const ElfW(Phdr)& segment = segments[i];
+    ElfW(Phdr)& new_segment = new_segments[i];
+    if (segment.p_type != PT_LOAD || segment.p_filesz == 0)
+      continue;
+    uint64_t begin, end;
+    GetKeptRange(segment, notes, module_ranges, &begin, &end);
+    if (begin >= end) {
+      new_segment.p_offset = offset;
+      new_segment.p_filesz = 0;
+      continue;
+    }
+    offset = AlignUp(offset, kPageSize);
+    new_segment.p_offset = offset;
+    new_segment.p_vaddr += begin;
+    if (new_segment.p_paddr)
+      new_segment.p_paddr += begin;
+    new_segment.p_memsz -= begin;
+    new_segment.p_filesz = end - begin;
+    begins[i] = begin;
+    offset += end - begin;
+  }
+
+  memcpy(&head[header.e_phoff], new_segments.data(),
+         new_segments.size() * sizeof(ElfW(Phdr)));
+  if (!output->Write(head.data(), head.size()))
+    return false;
+  for (size_t i = 0; i < segments.size(); i++) {
+    const ElfW(Phdr)& new_segment = new_segments[i];
+    if (new_segment.p_type != PT_LOAD || new_segment.p_filesz == 0)
+      continue;
+    uint64_t start = segments[i].p_offset + begins[i];
+    if (!Copy(input, nullptr, start - input->offset()) ||
+        !output->PadTo(new_segment.p_offset) ||
+        !Copy(input, output, new_segment.p_filesz)) {
+      return false;
+    }
+  }
+  // Let the kernel finish writing the core.
+  return CopyRest(input, nullptr);
+}
+
+}  // namespace
+
+bool CopySparseCore(int input_fd,
+                    int output_fd,
+                    int memory_fd,
+                    uint64_t* bytes_written) {
+  Input input(input_fd);
+  Output output(output_fd);
+  bool result = Filter(&input, &output, memory_fd);
+  *bytes_written = output.offset();
+  if (result) {
+    LOG(INFO) << "Wrote " << output.offset() << " bytes of core out of "
+              << input.offset();
+  }
+  return result;
+}
+
+}  // namespace sparse_core
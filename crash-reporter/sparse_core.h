@@ -0,0 +1,49 @@
+// Copyright 2020 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Copies an ELF core dump while leaving out the memory which the
+// core-to-minidump conversion does not use.
+
+#ifndef CRASH_REPORTER_SPARSE_CORE_H_
+#define CRASH_REPORTER_SPARSE_CORE_H_
+
+#include <stdint.h>
+
+namespace sparse_core {
+
+// Segments of at most this size are always kept whole. They hold most of the
+// data of small mappings, like the ELF headers and dynamic sections of modules,
+// which minidump writers read.
+constexpr uint64_t kMaxWholeSegmentSize = 64 * 1024;
+
+// Bytes kept on each side of the instruction pointer of every thread.
+constexpr uint64_t kInstructionContextSize = 256;
+
+// Bytes kept from the name of each module, as many as minidump writers read.
+constexpr uint64_t kModuleNameSize = 256;
+
+// Reads a core dump from |input_fd|, which can be a pipe, and writes to
+// |output_fd|, which must be a new empty file, a core dump with the same notes
+// and memory segments, but where the file content of the segments is reduced
+// to what a minidump holds:
+//  - the segments no larger than kMaxWholeSegmentSize,
+//  - the stacks of all threads, from their stack pointer up,
+//  - the memory around the instruction pointer of all threads,
+//  - the pages which the module list is read from: the program headers and
+//    dynamic section of the executable, and the r_debug structure, link_map
+//    entries and module names of the dynamic linker.
+// The content of the other segments is dropped, and their file size set to 0.
+// The module list is found by reading the memory of the crashed process from
+// |memory_fd|, its /proc/<pid>/mem, before the core reaches that memory. If
+// it cannot be read, or the input is not a core dump of this architecture,
+// the input is copied unchanged. Sets |*bytes_written| to the size of the
+// output. Returns false on I/O errors.
+bool CopySparseCore(int input_fd,
+                    int output_fd,
+                    int memory_fd,
+                    uint64_t* bytes_written);
+
+}  // namespace sparse_core
+
+#endif  // CRASH_REPORTER_SPARSE_CORE_H_
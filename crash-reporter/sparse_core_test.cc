@@ -0,0 +1,420 @@
+// Copyright 2020 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "crash-reporter/sparse_core.h"
+
+#include <elf.h>
+#include <fcntl.h>
+#include <link.h>
+#include <string.h>
+#include <sys/procfs.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <sys/reg.h>
+#endif
+
+#include <unistd.h>
+
+#include <array>
+#include <iterator>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <base/files/file_path.h>
+#include <base/files/file_util.h>
+#include <base/files/scoped_file.h>
+#include <base/files/scoped_temp_dir.h>
+#include <base/macros.h>
+#include <base/posix/eintr_wrapper.h>
+#include <gtest/gtest.h>
+
+namespace sparse_core {
+namespace {
+
+#if defined(__x86_64__)
+constexpr int kStackPointerIndex = RSP;
+constexpr int kInstructionPointerIndex = RIP;
+#elif defined(__i386__)
+constexpr int kStackPointerIndex = UESP;
+constexpr int kInstructionPointerIndex = EIP;
+#elif defined(__aarch64__)
+constexpr int kStackPointerIndex = 31;
+constexpr int kInstructionPointerIndex = 32;
+#elif defined(__arm__)
+constexpr int kStackPointerIndex = 13;
+constexpr int kInstructionPointerIndex = 15;
+#endif
+
+constexpr uint64_t kSmallAddress = 0x10000;
+constexpr uint64_t kSmallSize = 0x1000;
+constexpr uint64_t kStackAddress = 0x100000;
+constexpr uint64_t kStackSize = 0x40000;
+constexpr uint64_t kStackPointer = kStackAddress + 0x32064;
+constexpr uint64_t kHeapAddress = 0x200000;
+constexpr uint64_t kHeapSize = 0x100000;
+constexpr uint64_t kInstructionPointer = kHeapAddress + 0x50000;
+constexpr uint64_t kDataAddress = 0x400000;
+constexpr uint64_t kDataSize = 0x100000;
+
+// The executable headers are in the small segment, and the module list
+// spread over the data segment, with a module name across a page boundary.
+constexpr uint64_t kPhdrAddress = kSmallAddress + 0x40;
+constexpr uint64_t kDynamicAddress = kDataAddress + 0x20000;
+constexpr uint64_t kDebugAddress = kDataAddress + 0x40000;
+constexpr uint64_t kLinkMapAddress = kDataAddress + 0x60000;
+constexpr uint64_t kNameAddress = kDataAddress + 0x80ff8;
+constexpr uint64_t kNameSpacing = 0x100;
+const char* const kModuleNames[] = {"/usr/bin/crasher", "/lib/libc.so.6"};
+
+// Memory of the process the test cores are dumped from, by segment address.
+using Memory = std::map<uint64_t, std::string>;
+
+char* MemoryAt(Memory* memory, uint64_t address) {
+  auto segment = --memory->upper_bound(address);
+  return &segment->second[address - segment->first];
+}
+
+template <typename T>
+void Store(Memory* memory, uint64_t address, const T& value) {
+  memcpy(MemoryAt(memory, address), &value, sizeof(value));
+}
+
+template <typename T>
+T* ToPointer(uint64_t address) {
+  return reinterpret_cast<T*>(static_cast<uintptr_t>(address));
+}
+
+// Content of the memory at |address| outside of the module list.
+char MemoryByte(uint64_t address) {
+  return static_cast<char>(address * 7 + address / 4096);
+}
+
+// Builds the memory of a process with a small, a stack, a heap and a data
+// segment, holding a dynamically linked executable and its module list.
+Memory BuildMemory() {
+  Memory memory;
+  const uint64_t addresses[] = {kSmallAddress, kStackAddress, kHeapAddress,
+                                kDataAddress};
+  const uint64_t sizes[] = {kSmallSize, kStackSize, kHeapSize, kDataSize};
+  for (size_t i = 0; i < arraysize(addresses); i++) {
+    std::string& content = memory[addresses[i]];
+    for (uint64_t address = addresses[i]; address < addresses[i] + sizes[i];
+         address++) {
+      content.push_back(MemoryByte(address));
+    }
+  }
+
+  ElfW(Phdr) program_headers[2] = {};
+  program_headers[0].p_type = PT_PHDR;
+  program_headers[0].p_vaddr = kPhdrAddress - kSmallAddress;
+  program_headers[0].p_memsz = sizeof(program_headers);
+  program_headers[1].p_type = PT_DYNAMIC;
+  program_headers[1].p_vaddr = kDynamicAddress - kSmallAddress;
+  program_headers[1].p_memsz = 2 * sizeof(ElfW(Dyn));
+  Store(&memory, kPhdrAddress, program_headers);
+
+  ElfW(Dyn) dynamic[2] = {};
+  dynamic[0].d_tag = DT_DEBUG;
+  dynamic[0].d_un.d_ptr = kDebugAddress;
+  dynamic[1].d_tag = DT_NULL;
+  Store(&memory, kDynamicAddress, dynamic);
+
+  struct r_debug debug = {};
+  debug.r_version = 1;
+  debug.r_map = ToPointer<struct link_map>(kLinkMapAddress);
+  Store(&memory, kDebugAddress, debug);
+
+  const size_t num_modules = arraysize(kModuleNames);
+  for (size_t i = 0; i < num_modules; i++) {
+    struct link_map map = {};
+    map.l_name = ToPointer<char>(kNameAddress + i * kNameSpacing);
+    if (i + 1 < num_modules) {
+      map.l_next = ToPointer<struct link_map>(kLinkMapAddress +
+                                              (i + 1) * sizeof(map));
+    }
+    Store(&memory, kLinkMapAddress + i * sizeof(map), map);
+    strcpy(MemoryAt(&memory, kNameAddress + i * kNameSpacing),  // NOLINT
+           kModuleNames[i]);
+  }
+  return memory;
+}
+
+// Builds a core of the process with |memory| and a thread.
+std::string BuildCore(const Memory& memory) {
+  constexpr char kNoteName[] = "CORE";
+  const size_t name_size = (sizeof(kNoteName) + 3) / 4 * 4;
+  ElfW(auxv_t) auxv[3] = {};
+  auxv[0].a_type = AT_PHDR;
+  auxv[0].a_un.a_val = kPhdrAddress;
+  auxv[1].a_type = AT_PHNUM;
+  auxv[1].a_un.a_val = 2;
+  auxv[2].a_type = AT_NULL;
+  const size_t notes_size = 2 * (sizeof(ElfW(Nhdr)) + name_size) +
+                            sizeof(auxv) + sizeof(struct elf_prstatus);
+
+  ElfW(Ehdr) header = {};
+  memcpy(header.e_ident, ELFMAG, SELFMAG);
+#if __WORDSIZE == 64
+  header.e_ident[EI_CLASS] = ELFCLASS64;
+#else
+  header.e_ident[EI_CLASS] = ELFCLASS32;
+#endif
+  header.e_ident[EI_DATA] = ELFDATA2LSB;
+  header.e_ident[EI_VERSION] = EV_CURRENT;
+  header.e_type = ET_CORE;
+  header.e_version = EV_CURRENT;
+  header.e_phoff = sizeof(header);
+  header.e_ehsize = sizeof(header);
+  header.e_phentsize = sizeof(ElfW(Phdr));
+  header.e_phnum = memory.size() + 1;
+
+  std::vector<ElfW(Phdr)> segments(header.e_phnum);
+  segments[0].p_type = PT_NOTE;
+  segments[0].p_offset = sizeof(header) + segments.size() * sizeof(ElfW(Phdr));
+  segments[0].p_filesz = notes_size;
+  uint64_t offset = 0x1000;
+  size_t i = 1;
+  for (const auto& segment : memory) {
+    segments[i].p_type = PT_LOAD;
+    segments[i].p_flags = PF_R | PF_W;
+    segments[i].p_offset = offset;
+    segments[i].p_vaddr = segment.first;
+    segments[i].p_filesz = segment.second.size();
+    segments[i].p_memsz = segment.second.size();
+    segments[i].p_align = 0x1000;
+    offset += segment.second.size();
+    i++;
+  }
+
+  std::string core(reinterpret_cast<const char*>(&header), sizeof(header));
+  core.append(reinterpret_cast<const char*>(segments.data()),
+              segments.size() * sizeof(ElfW(Phdr)));
+
+  // The thread status comes last, for tests to change it.
+  ElfW(Nhdr) note = {};
+  note.n_namesz = sizeof(kNoteName);
+  note.n_descsz = sizeof(auxv);
+  note.n_type = NT_AUXV;
+  core.append(reinterpret_cast<const char*>(&note), sizeof(note));
+  core.append(kNoteName, sizeof(kNoteName));
+  core.resize(core.size() + name_size - sizeof(kNoteName));
+  core.append(reinterpret_cast<const char*>(auxv), sizeof(auxv));
+
+  note.n_descsz = sizeof(struct elf_prstatus);
+  note.n_type = NT_PRSTATUS;
+  struct elf_prstatus status = {};
+  status.pr_reg[kStackPointerIndex] = kStackPointer;
+  status.pr_reg[kInstructionPointerIndex] = kInstructionPointer;
+  core.append(reinterpret_cast<const char*>(&note), sizeof(note));
+  core.append(kNoteName, sizeof(kNoteName));
+  core.resize(core.size() + name_size - sizeof(kNoteName));
+  core.append(reinterpret_cast<const char*>(&status), sizeof(status));
+
+  core.resize(0x1000);
+  for (const auto& segment : memory)
+    core.append(segment.second);
+  return core;
+}
+
+// Reads the program headers of |core|.
+std::vector<ElfW(Phdr)> GetSegments(const std::string& core) {
+  ElfW(Ehdr) header;
+  memcpy(&header, core.data(), sizeof(header));
+  std::vector<ElfW(Phdr)> segments(header.e_phnum);
+  memcpy(segments.data(), core.data() + header.e_phoff,
+         segments.size() * sizeof(ElfW(Phdr)));
+  return segments;
+}
+
+// Reads |*value| at |address| from the memory content of |core|.
+template <typename T>
+bool ReadCoreMemory(const std::string& core, uint64_t address, T* value) {
+  for (const auto& segment : GetSegments(core)) {
+    if (segment.p_type == PT_LOAD && address >= segment.p_vaddr &&
+        address + sizeof(T) <= segment.p_vaddr + segment.p_filesz) {
+      memcpy(value, core.data() + segment.p_offset + address - segment.p_vaddr,
+             sizeof(T));
+      return true;
+    }
+  }
+  return false;
+}
+
+class SparseCoreTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    ASSERT_TRUE(temp_dir_.CreateUniqueTempDir());
+    input_path_ = temp_dir_.GetPath().Append("input");
+    output_path_ = temp_dir_.GetPath().Append("output");
+    memory_path_ = temp_dir_.GetPath().Append("mem");
+
+    // Stands for /proc/<pid>/mem, with the memory at its address.
+    memory_ = BuildMemory();
+    base::ScopedFD memory_fd(HANDLE_EINTR(
+        open(memory_path_.value().c_str(), O_WRONLY | O_CREAT, 0600)));
+    ASSERT_TRUE(memory_fd.is_valid());
+    for (const auto& segment : memory_) {
+      ASSERT_EQ(static_cast<ssize_t>(segment.second.size()),
+                HANDLE_EINTR(pwrite(memory_fd.get(), segment.second.data(),
+                                    segment.second.size(), segment.first)));
+    }
+  }
+
+  // Runs CopySparseCore() on |input|, putting the output in |output|. The
+  // process memory is read from |memory_path_| if it exists.
+  bool Copy(const std::string& input, std::string* output) {
+    EXPECT_EQ(static_cast<int>(input.size()),
+              base::WriteFile(input_path_, input.data(), input.size()));
+    base::ScopedFD input_fd(
+        HANDLE_EINTR(open(input_path_.value().c_str(), O_RDONLY)));
+    base::ScopedFD output_fd(HANDLE_EINTR(open(
+        output_path_.value().c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600)));
+    base::ScopedFD memory_fd(
+        HANDLE_EINTR(open(memory_path_.value().c_str(), O_RDONLY)));
+    EXPECT_TRUE(input_fd.is_valid());
+    EXPECT_TRUE(output_fd.is_valid());
+    uint64_t bytes_written = 0;
+    bool result = CopySparseCore(input_fd.get(), output_fd.get(),
+                                 memory_fd.get(), &bytes_written);
+    EXPECT_TRUE(base::ReadFileToString(output_path_, output));
+    EXPECT_EQ(output->size(), bytes_written);
+    return result;
+  }
+
+  base::ScopedTempDir temp_dir_;
+  base::FilePath input_path_;
+  base::FilePath output_path_;
+  base::FilePath memory_path_;
+  Memory memory_;
+};
+
+TEST_F(SparseCoreTest, KeepsMemoryUsedByMinidump) {
+  std::string input = BuildCore(memory_);
+  std::string output;
+  ASSERT_TRUE(Copy(input, &output));
+  EXPECT_LT(output.size(), input.size() / 4);
+
+  ElfW(Ehdr) header;
+  ASSERT_GE(output.size(), sizeof(header));
+  memcpy(&header, output.data(), sizeof(header));
+  EXPECT_EQ(0, memcmp(input.data(), output.data(), sizeof(header)));
+  ASSERT_EQ(5, header.e_phnum);
+  ASSERT_GE(output.size(), header.e_phoff + sizeof(ElfW(Phdr)) * 5);
+  std::vector<ElfW(Phdr)> segments = GetSegments(output);
+
+  // The notes are unchanged.
+  EXPECT_EQ(PT_NOTE, segments[0].p_type);
+  EXPECT_EQ(0, memcmp(input.data() + segments[0].p_offset,
+                      output.data() + segments[0].p_offset,
+                      segments[0].p_filesz));
+
+  // The small segment is kept whole, the stack from the page of the stack
+  // pointer, the pages around the instruction pointer in the heap, and the
+  // pages from the dynamic section to the last module name in the data.
+  const uint64_t expected_addresses[] = {
+      kSmallAddress, kStackAddress + 0x32000, kHeapAddress + 0x4f000,
+      kDynamicAddress};
+  const uint64_t expected_sizes[] = {kSmallSize, kStackSize - 0x32000, 0x2000,
+                                     0x62000};
+  for (size_t i = 0; i < 4; i++) {
+    const ElfW(Phdr)& segment = segments[i + 1];
+    EXPECT_EQ(PT_LOAD, segment.p_type);
+    EXPECT_EQ(expected_addresses[i], segment.p_vaddr);
+    EXPECT_EQ(expected_sizes[i], segment.p_filesz);
+    EXPECT_EQ(0, segment.p_offset % 0x1000);
+    ASSERT_LE(segment.p_offset + segment.p_filesz, output.size());
+    EXPECT_EQ(0, memcmp(MemoryAt(&memory_, segment.p_vaddr),
+                        output.data() + segment.p_offset, segment.p_filesz));
+  }
+}
+
+// Follows the module list as the minidump writer does in
+// WriteDSODebugStream(), but in the output core.
+TEST_F(SparseCoreTest, KeepsModuleList) {
+  std::string output;
+  ASSERT_TRUE(Copy(BuildCore(memory_), &output));
+
+  ElfW(Phdr) program_headers[2];
+  ASSERT_TRUE(ReadCoreMemory(output, kPhdrAddress, &program_headers));
+  ASSERT_EQ(PT_PHDR, program_headers[0].p_type);
+  ASSERT_EQ(PT_DYNAMIC, program_headers[1].p_type);
+  uint64_t bias = kPhdrAddress - program_headers[0].p_vaddr;
+
+  ElfW(Dyn) dynamic[2];
+  ASSERT_TRUE(
+      ReadCoreMemory(output, bias + program_headers[1].p_vaddr, &dynamic));
+  ASSERT_EQ(DT_DEBUG, dynamic[0].d_tag);
+
+  struct r_debug debug;
+  ASSERT_TRUE(ReadCoreMemory(output, dynamic[0].d_un.d_ptr, &debug));
+  std::vector<std::string> names;
+  uint64_t map_address = reinterpret_cast<uintptr_t>(debug.r_map);
+  while (map_address != 0 && names.size() < 10) {
+    struct link_map map;
+    ASSERT_TRUE(ReadCoreMemory(output, map_address, &map));
+    std::array<char, kModuleNameSize> name;
+    ASSERT_TRUE(ReadCoreMemory(
+        output, reinterpret_cast<uintptr_t>(map.l_name), &name));
+    names.emplace_back(name.data(), strnlen(name.data(), name.size()));
+    map_address = reinterpret_cast<uintptr_t>(map.l_next);
+  }
+  EXPECT_EQ(std::vector<std::string>(std::begin(kModuleNames),
+                                     std::end(kModuleNames)),
+            names);
+}
+
+TEST_F(SparseCoreTest, DropsSegmentsWithoutThreadData) {
+  std::string input = BuildCore(memory_);
+  // Move the instruction pointer out of the heap.
+  ElfW(Phdr) notes;
+  memcpy(&notes, input.data() + sizeof(ElfW(Ehdr)), sizeof(notes));
+  struct elf_prstatus status;
+  size_t status_offset = notes.p_offset + notes.p_filesz - sizeof(status);
+  memcpy(&status, input.data() + status_offset, sizeof(status));
+  status.pr_reg[kInstructionPointerIndex] = kSmallAddress;
+  memcpy(&input[status_offset], &status, sizeof(status));
+
+  std::string output;
+  ASSERT_TRUE(Copy(input, &output));
+  ElfW(Phdr) heap;
+  memcpy(&heap, output.data() + sizeof(ElfW(Ehdr)) + 3 * sizeof(heap),
+         sizeof(heap));
+  EXPECT_EQ(kHeapAddress, heap.p_vaddr);
+  EXPECT_EQ(kHeapSize, heap.p_memsz);
+  EXPECT_EQ(0, heap.p_filesz);
+}
+
+TEST_F(SparseCoreTest, CopiesOtherFilesUnchanged) {
+  std::string output;
+  ASSERT_TRUE(Copy("not a core", &output));
+  EXPECT_EQ("not a core", output);
+
+  std::string input = BuildCore(memory_);
+  // A core of another type.
+  ElfW(Ehdr) header;
+  memcpy(&header, input.data(), sizeof(header));
+  header.e_type = ET_EXEC;
+  memcpy(&input[0], &header, sizeof(header));
+  ASSERT_TRUE(Copy(input, &output));
+  EXPECT_EQ(input, output);
+}
+
+TEST_F(SparseCoreTest, CopiesCoreUnchangedWithoutProcessMemory) {
+  ASSERT_TRUE(base::DeleteFile(memory_path_, false));
+  std::string input = BuildCore(memory_);
+  std::string output;
+  ASSERT_TRUE(Copy(input, &output));
+  EXPECT_EQ(input, output);
+}
+
+TEST_F(SparseCoreTest, TruncatedCoreFails) {
+  std::string input = BuildCore(memory_);
+  // Cut in the middle of the stack.
+  input.resize(0x1000 + kSmallSize + kStackSize - 1);
+  std::string output;
+  EXPECT_FALSE(Copy(input, &output));
+}
+
+}  // namespace
+}  // namespace sparse_core
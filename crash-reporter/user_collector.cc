@@ -8,17 +8,20 @@
 #include <elf.h>
 #include <fcntl.h>
 #include <stdint.h>
+#include <unistd.h>
 
 #include <unordered_set>
 #include <utility>
 
 #include <base/files/file_util.h>
+#include <base/files/scoped_file.h>
 #include <base/logging.h>
 #include <base/posix/eintr_wrapper.h>
 #include <base/stl_util.h>
 #include <base/strings/stringprintf.h>
 #include <brillo/process.h>
 
+#include "crash-reporter/sparse_core.h"
 #include "crash-reporter/user_collector_base.h"
 #include "crash-reporter/util.h"
 #include "crash-reporter/vm_support.h"
@@ -271,6 +274,31 @@ bool UserCollector::CopyStdinToCoreFile(const FilePath& core_path) {
   return false;
 }
 
+bool UserCollector::CopyStdinToSparseCoreFile(pid_t pid,
+                                              const FilePath& core_path) {
+  // The crashed process stays around while its core is read, so its memory
+  // can be read ahead of the core. Without it, the core is copied whole.
+  FilePath memory_path = GetProcessPath(pid).Append("mem");
+  base::ScopedFD memory_fd(
+      HANDLE_EINTR(open(memory_path.value().c_str(), O_RDONLY | O_CLOEXEC)));
+  if (!memory_fd.is_valid())
+    PLOG(WARNING) << "Could not open " << memory_path.value();
+
+  base::ScopedFD core_fd(HANDLE_EINTR(
+      open(core_path.value().c_str(),
+           O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC | O_NOFOLLOW, 0600)));
+  uint64_t bytes_written;
+  if (core_fd.is_valid() &&
+      sparse_core::CopySparseCore(STDIN_FILENO, core_fd.get(), memory_fd.get(),
+                                  &bytes_written)) {
+    return true;
+  }
+
+  PLOG(ERROR) << "Could not write core file";
+  base::DeleteFile(core_path, false);
+  return false;
+}
+
 bool UserCollector::RunCoreToMinidump(const FilePath& core_path,
                                       const FilePath& procfs_directory,
                                       const FilePath& minidump_path,
@@ -384,7 +412,13 @@ UserCollector::ErrorType UserCollector::ConvertCoreToMinidump(
   bool proc_files_usable =
       CopyOffProcFiles(pid, container_dir) && ValidateProcFiles(container_dir);
 
-  if (!CopyStdinToCoreFile(core_path)) {
+  // The core is only kept on developer images. Otherwise, only what goes into
+  // the minidump is written, which avoids writing hundreds of megabytes for
+  // large processes.
+  bool core_copied = util::IsDeveloperImage()
+                         ? CopyStdinToCoreFile(core_path)
+                         : CopyStdinToSparseCoreFile(pid, core_path);
+  if (!core_copied) {
     return kErrorReadCoreData;
   }
 
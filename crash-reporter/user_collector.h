@@ -102,6 +102,10 @@ class UserCollector : public UserCollectorBase {
   // type otherwise.
   ErrorType ValidateCoreFile(const base::FilePath& core_path) const;
   bool CopyStdinToCoreFile(const base::FilePath& core_path);
+  // Like CopyStdinToCoreFile(), but only writes the parts of the core which
+  // the minidump needs, as done by sparse_core::CopySparseCore(), using the
+  // memory of process |pid| to find the module list.
+  bool CopyStdinToSparseCoreFile(pid_t pid, const base::FilePath& core_path);
   bool RunCoreToMinidump(const base::FilePath& core_path,
                          const base::FilePath& procfs_directory,
                          const base::FilePath& minidump_path,
@@ -12,10 +12,13 @@
 #endif  // USE_DIRENCRYPTION
 
 #include <base/files/file_util.h>
+#include <base/strings/string_number_conversions.h>
 #include <base/strings/string_split.h>
 #include <base/strings/stringprintf.h>
 #include <brillo/process.h>
 
+#include "crash-reporter/paths.h"
+#include "crash-reporter/repeated_crash_filter.h"
 #include "crash-reporter/util.h"
 
 using base::FilePath;
@@ -27,6 +30,16 @@ namespace {
 const char kStatePrefix[] = "State:\t";
 const char kUptimeField[] = "ptime";
 const char kUserCrashSignal[] = "org.chromium.CrashReporter.UserCrash";
+const char kSkippedRepeatedCrashesField[] = "skipped_repeated_crashes";
+
+// Crashes of a program with the same signal within this time of one processed
+// are only counted. This keeps programs crashing in a loop from keeping the
+// system busy converting core dumps, and from filling the crash directories.
+constexpr base::TimeDelta kRepeatedCrashWindow =
+    base::TimeDelta::FromMinutes(5);
+
+// Number of kinds of crashes kept track of.
+constexpr size_t kMaxRepeatedCrashEntries = 32;
 
 #if USE_DIRENCRYPTION
 // Name of the session keyring.
@@ -141,6 +154,17 @@ bool UserCollectorBase::HandleCrash(const std::string& crash_attributes,
     AddExtraMetadata(exec, pid);
 
     if (generate_diagnostics_) {
+      int skipped_count = 0;
+      if (!ShouldProcessRepeatedCrash(exec, signal, &skipped_count)) {
+        LOG(INFO) << "Only counting repeated crash of " << exec << " sig "
+                  << signal;
+        return true;
+      }
+      if (skipped_count > 0) {
+        AddCrashMetaUploadData(kSkippedRepeatedCrashesField,
+                               base::IntToString(skipped_count));
+      }
+
       bool out_of_capacity = false;
       ErrorType error_type =
           ConvertAndEnqueueCrash(pid, exec, supplied_ruid, supplied_rgid,
@@ -280,6 +304,21 @@ const FilePath UserCollectorBase::GetCrashProcessingDir() {
   return FilePath("/tmp/crash_reporter");
 }
 
+bool UserCollectorBase::ShouldProcessRepeatedCrash(const std::string& exec,
+                                                   int signal,
+                                                   int* skipped_count) {
+  *skipped_count = 0;
+  // Tests crash the same programs on purpose, and expect all the crashes to be
+  // processed.
+  if (!filter_in_.empty() || util::IsCrashTestInProgress())
+    return true;
+
+  RepeatedCrashFilter filter(
+      paths::GetAt(paths::kSystemRunStateDirectory, paths::kRepeatedCrashes),
+      kRepeatedCrashWindow, kMaxRepeatedCrashEntries);
+  return filter.ShouldProcess(exec, signal, base::Time::Now(), skipped_count);
+}
+
 UserCollectorBase::ErrorType UserCollectorBase::ConvertAndEnqueueCrash(
     pid_t pid,
     const std::string& exec,
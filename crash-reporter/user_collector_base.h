@@ -105,6 +105,13 @@ class UserCollectorBase : public CrashCollector {
   // Adds additional metadata for a crash of executable |exec| with |pid|.
   virtual void AddExtraMetadata(const std::string& exec, pid_t pid) {}
 
+  // Returns false if the crash of |exec| with |signal| repeats a recent one and
+  // should only be counted. Otherwise sets |*skipped_count| to the number of
+  // crashes of the same kind only counted before this one.
+  bool ShouldProcessRepeatedCrash(const std::string& exec,
+                                  int signal,
+                                  int* skipped_count);
+
   ErrorType ConvertAndEnqueueCrash(pid_t pid,
                                    const std::string& exec,
                                    uid_t supplied_ruid,
@@ -4,9 +4,11 @@
 
 #include "crash-reporter/util.h"
 
+#include <fcntl.h>
 #include <poll.h>
 #include <signal.h>
 #include <stdlib.h>
+#include <unistd.h>
 
 #include <map>
 #include <memory>
@@ -384,4 +386,27 @@ bool ReadFdToStream(unsigned int fd, std::stringstream* stream) {
   }
 }
 
+bool ValidatePathAndOpen(const base::FilePath& dir, int* outfd) {
+  std::vector<base::FilePath::StringType> components;
+  dir.GetComponents(&components);
+  int parentfd = AT_FDCWD;
+
+  for (const auto& component : components) {
+    int dirfd = openat(parentfd, component.c_str(),
+                       O_CLOEXEC | O_DIRECTORY | O_NOFOLLOW | O_PATH);
+    if (dirfd < 0) {
+      PLOG(ERROR) << "Unable to access crash path: " << dir.value() << " ("
+                  << component << ")";
+      if (parentfd != AT_FDCWD)
+        close(parentfd);
+      return false;
+    }
+    if (parentfd != AT_FDCWD)
+      close(parentfd);
+    parentfd = dirfd;
+  }
+  *outfd = parentfd;
+  return true;
+}
+
 }  // namespace util
@@ -107,6 +107,10 @@ int GetServiceFailureWeight();
 // Read the content binding to fd to stream.
 bool ReadFdToStream(unsigned int fd, std::stringstream* stream);
 
+// Opens |dir| with O_PATH in |*outfd|, walking the directory tree so that no
+// component of the path is a symlink. Returns false if any of them is missing.
+bool ValidatePathAndOpen(const base::FilePath& dir, int* outfd);
+
 }  // namespace util
 
 #endif  // CRASH_REPORTER_UTIL_H_
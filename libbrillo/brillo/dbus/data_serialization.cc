@@ -66,6 +66,16 @@ void AppendValueToWriter(dbus::MessageWriter* writer,
   writer->AppendFileDescriptor(value.get());
 }
 
+void AppendValueToWriter(dbus::MessageWriter* writer,
+                         const std::vector<uint8_t>& value) {
+  writer->AppendArrayOfBytes(value.data(), value.size());
+}
+
+void AppendValueToWriter(dbus::MessageWriter* writer,
+                         base::span<const uint8_t> value) {
+  writer->AppendArrayOfBytes(value.data(), value.size());
+}
+
 void AppendValueToWriter(dbus::MessageWriter* writer,
                          const brillo::Any& value) {
   value.AppendToDBusMessageWriter(writer);
@@ -146,6 +156,27 @@ bool PopValueFromReader(dbus::MessageReader* reader,
          reader->PopFileDescriptor(value);
 }
 
+bool PopValueFromReader(dbus::MessageReader* reader,
+                        base::span<const uint8_t>* value) {
+  dbus::MessageReader variant_reader(nullptr);
+  const uint8_t* data = nullptr;
+  size_t length = 0;
+  if (!details::DescendIntoVariantIfPresent(&reader, &variant_reader) ||
+      !reader->PopArrayOfBytes(&data, &length))
+    return false;
+  *value = base::make_span(data, length);
+  return true;
+}
+
+bool PopValueFromReader(dbus::MessageReader* reader,
+                        std::vector<uint8_t>* value) {
+  base::span<const uint8_t> bytes;
+  if (!PopValueFromReader(reader, &bytes))
+    return false;
+  value->assign(bytes.begin(), bytes.end());
+  return true;
+}
+
 namespace {
 
 // Helper methods for PopValueFromReader(dbus::MessageReader*, Any*)
@@ -32,6 +32,7 @@
 //   STRING      |        s        |  std::string
 //   OBJECT_PATH |        o        |  dbus::ObjectPath
 //   ARRAY       |        aT       |  std::vector<T>
+//               |        ay       |  base::span<const uint8_t> (no copy)
 //   STRUCT      |       (UV)      |  std::pair<U,V>
 //               |     (UVW...)    |  std::tuple<U,V,W,...>
 //   DICT        |       a{KV}     |  std::map<K,V>
@@ -58,6 +59,7 @@
 #include <utility>
 #include <vector>
 
+#include <base/containers/span.h>
 #include <base/files/scoped_file.h>
 #include <base/logging.h>
 #include <brillo/brillo_export.h>
@@ -462,6 +464,34 @@ struct DBusType<brillo::Any> {
   }
 };
 
+// std::vector<uint8_t> and base::span<const uint8_t> = D-Bus ARRAY of BYTE ---
+// Arrays of bytes are copied to and from the message in one go rather than
+// byte by byte. Reading into a span copies nothing: the span points into the
+// message and is only valid as long as the message is.
+BRILLO_EXPORT void AppendValueToWriter(::dbus::MessageWriter* writer,
+                                       const std::vector<uint8_t>& value);
+BRILLO_EXPORT bool PopValueFromReader(::dbus::MessageReader* reader,
+                                      std::vector<uint8_t>* value);
+BRILLO_EXPORT void AppendValueToWriter(::dbus::MessageWriter* writer,
+                                       base::span<const uint8_t> value);
+BRILLO_EXPORT bool PopValueFromReader(::dbus::MessageReader* reader,
+                                      base::span<const uint8_t>* value);
+
+template<>
+struct DBusType<base::span<const uint8_t>> {
+  inline static std::string GetSignature() {
+    return DBUS_TYPE_ARRAY_AS_STRING DBUS_TYPE_BYTE_AS_STRING;
+  }
+  inline static void Write(::dbus::MessageWriter* writer,
+                           base::span<const uint8_t> value) {
+    AppendValueToWriter(writer, value);
+  }
+  inline static bool Read(::dbus::MessageReader* reader,
+                          base::span<const uint8_t>* value) {
+    return PopValueFromReader(reader, value);
+  }
+};
+
 // std::vector = D-Bus ARRAY. -------------------------------------------------
 template <typename T, typename ALLOC>
 typename std::enable_if<IsTypeSupported<T>::value>::type AppendValueToWriter(
@@ -5,7 +5,9 @@
 #include <brillo/dbus/data_serialization.h>
 
 #include <limits>
+#include <string>
 #include <tuple>
+#include <vector>
 
 #include <brillo/variant_dictionary.h>
 #include <gtest/gtest.h>
@@ -414,6 +416,28 @@ TEST(DBusUtils, ArrayOfBytes_Empty) {
   EXPECT_EQ(bytes, bytes_out);
 }
 
+TEST(DBusUtils, ArrayOfBytes_Span) {
+  std::unique_ptr<Response> message = Response::CreateEmpty();
+  MessageWriter writer(message.get());
+  const uint8_t bytes[] = {1, 2, 3};
+  AppendValueToWriter(&writer, base::make_span(bytes));
+  AppendValueToWriterAsVariant(&writer, base::make_span(bytes, 2));
+  AppendValueToWriter(&writer, std::vector<int32_t>{1, 2, 3});
+
+  EXPECT_EQ("ayvai", message->GetSignature());
+
+  MessageReader reader(message.get());
+  base::span<const uint8_t> span_out;
+  EXPECT_TRUE(PopValueFromReader(&reader, &span_out));
+  EXPECT_EQ(std::vector<uint8_t>({1, 2, 3}),
+            std::vector<uint8_t>(span_out.begin(), span_out.end()));
+  EXPECT_TRUE(PopValueFromReader(&reader, &span_out));
+  EXPECT_EQ(std::vector<uint8_t>({1, 2}),
+            std::vector<uint8_t>(span_out.begin(), span_out.end()));
+  // Only arrays of bytes can be read into a span of bytes.
+  EXPECT_FALSE(PopValueFromReader(&reader, &span_out));
+}
+
 TEST(DBusUtils, ArrayOfStrings) {
   std::unique_ptr<Response> message = Response::CreateEmpty();
   MessageWriter writer(message.get());
@@ -817,5 +841,65 @@ TEST(DBusUtils, Protobuf) {
   EXPECT_EQ("abcd", test_message_out.bar());
 }
 
+namespace {
+
+const size_t kLargePayloadSize = 1024 * 1024;
+
+// Returns |size| bytes that vary, so misplaced bytes are noticed.
+std::vector<uint8_t> CreateLargePayload(size_t size) {
+  std::vector<uint8_t> bytes(size);
+  for (size_t i = 0; i < size; i++)
+    bytes[i] = static_cast<uint8_t>(i * 7 + i / 256);
+  return bytes;
+}
+
+}  // namespace
+
+TEST(DBusUtils, LargeByteArray) {
+  const std::vector<uint8_t> bytes = CreateLargePayload(kLargePayloadSize);
+  std::unique_ptr<Response> message = Response::CreateEmpty();
+  MessageWriter writer(message.get());
+  AppendValueToWriter(&writer, bytes);
+
+  MessageReader reader(message.get());
+  std::vector<uint8_t> bytes_out;
+  ASSERT_TRUE(PopValueFromReader(&reader, &bytes_out));
+  EXPECT_FALSE(reader.HasMoreData());
+  EXPECT_EQ(bytes, bytes_out);
+}
+
+TEST(DBusUtils, LargeByteSpan) {
+  const std::vector<uint8_t> bytes = CreateLargePayload(kLargePayloadSize);
+  std::unique_ptr<Response> message = Response::CreateEmpty();
+  MessageWriter writer(message.get());
+  AppendValueToWriter(&writer, base::make_span(bytes));
+
+  // The span points into |message|, which is still alive.
+  MessageReader reader(message.get());
+  base::span<const uint8_t> span_out;
+  ASSERT_TRUE(PopValueFromReader(&reader, &span_out));
+  EXPECT_FALSE(reader.HasMoreData());
+  EXPECT_EQ(bytes, std::vector<uint8_t>(span_out.begin(), span_out.end()));
+}
+
+TEST(DBusUtils, LargeProtobuf) {
+  std::string bar(kLargePayloadSize, 'a');
+  for (size_t i = 0; i < bar.size(); i++)
+    bar[i] += i % 26;
+  dbus_utils_test::TestMessage test_message;
+  test_message.set_foo(123);
+  test_message.set_bar(bar);
+  std::unique_ptr<Response> message = Response::CreateEmpty();
+  MessageWriter writer(message.get());
+  AppendValueToWriter(&writer, test_message);
+
+  MessageReader reader(message.get());
+  dbus_utils_test::TestMessage test_message_out;
+  ASSERT_TRUE(PopValueFromReader(&reader, &test_message_out));
+  EXPECT_FALSE(reader.HasMoreData());
+  EXPECT_EQ(123, test_message_out.foo());
+  EXPECT_EQ(test_message.bar(), test_message_out.bar());
+}
+
 }  // namespace dbus_utils
 }  // namespace brillo
@@ -618,6 +618,15 @@ class BRILLO_EXPORT DBusObject {
   // Returns the reference to dbus::Bus this object is associated with.
   scoped_refptr<::dbus::Bus> GetBus() { return bus_; }
 
+  // Batches the PropertiesChanged signals of this object, see
+  // ExportedPropertySet::EnableSignalCoalescing().
+  void EnablePropertiesChangedCoalescing(base::TimeDelta delay) {
+    property_set_.EnableSignalCoalescing(delay);
+  }
+
+  // Sends the PropertiesChanged signals held back by coalescing now.
+  void FlushPropertiesChanged() { property_set_.FlushPropertiesChanged(); }
+
  private:
   // Add the org.freedesktop.DBus.Properties interface to the object.
   void RegisterPropertiesInterface();
@@ -7,6 +7,7 @@
 #include <utility>
 
 #include <base/bind.h>
+#include <base/threading/thread_task_runner_handle.h>
 #include <dbus/bus.h>
 #include <dbus/property.h>  // For kPropertyInterface
 
@@ -18,7 +19,7 @@ namespace brillo {
 namespace dbus_utils {
 
 ExportedPropertySet::ExportedPropertySet(dbus::Bus* bus)
-    : bus_(bus), weak_ptr_factory_(this) {
+    : bus_(bus), flush_weak_ptr_factory_(this), weak_ptr_factory_(this) {
 }
 
 void ExportedPropertySet::OnPropertiesInterfaceExported(
@@ -143,11 +144,65 @@ void ExportedPropertySet::HandlePropertyUpdated(
   // Send signal only if the object has been exported successfully.
   // This could happen when a property value is changed (which triggers
   // the notification) before D-Bus interface is completely exported/claimed.
+  if (signal_properties_changed_.expired())
+    return;
+  if (!coalesce_signals_) {
+    SendPropertiesChanged(interface_name,
+                          {{property_name, exported_property->GetValue()}});
+    return;
+  }
+  // The value is read when the signal is sent, so that a property updated
+  // several times is only sent once, with its last value.
+  pending_changes_[interface_name].insert(property_name);
+  // Without a task runner to send them later, the signals are sent now.
+  if (!base::ThreadTaskRunnerHandle::IsSet()) {
+    FlushPropertiesChanged();
+    return;
+  }
+  if (!flush_weak_ptr_factory_.HasWeakPtrs()) {
+    base::ThreadTaskRunnerHandle::Get()->PostDelayedTask(
+        FROM_HERE,
+        base::Bind(&ExportedPropertySet::FlushPropertiesChanged,
+                   flush_weak_ptr_factory_.GetWeakPtr()),
+        coalescing_delay_);
+  }
+}
+
+void ExportedPropertySet::EnableSignalCoalescing(base::TimeDelta delay) {
+  coalesce_signals_ = true;
+  coalescing_delay_ = delay;
+}
+
+void ExportedPropertySet::FlushPropertiesChanged() {
+  bus_->AssertOnOriginThread();
+  // Drops the posted task, if any.
+  flush_weak_ptr_factory_.InvalidateWeakPtrs();
+  std::map<std::string, std::set<std::string>> pending_changes;
+  pending_changes.swap(pending_changes_);
+  for (const auto& interface_changes : pending_changes) {
+    auto property_map_itr = properties_.find(interface_changes.first);
+    if (property_map_itr == properties_.end())
+      continue;
+    VariantDictionary changed_properties;
+    for (const auto& property_name : interface_changes.second) {
+      // The property may have been unregistered since it was updated.
+      auto property_itr = property_map_itr->second.find(property_name);
+      if (property_itr != property_map_itr->second.end()) {
+        changed_properties.insert(
+            std::make_pair(property_name, property_itr->second->GetValue()));
+      }
+    }
+    if (!changed_properties.empty())
+      SendPropertiesChanged(interface_changes.first, changed_properties);
+  }
+}
+
+void ExportedPropertySet::SendPropertiesChanged(
+    const std::string& interface_name,
+    const VariantDictionary& changed_properties) {
   auto signal = signal_properties_changed_.lock();
   if (!signal)
     return;
-  VariantDictionary changed_properties{
-      {property_name, exported_property->GetValue()}};
   // The interface specification tells us to include this list of properties
   // which have changed, but for whom no value is conveyed.  Currently, we
   // don't do anything interesting here.
@@ -9,10 +9,12 @@
 
 #include <map>
 #include <memory>
+#include <set>
 #include <string>
 #include <vector>
 
 #include <base/memory/weak_ptr.h>
+#include <base/time/time.h>
 #include <brillo/any.h>
 #include <brillo/brillo_export.h>
 #include <brillo/dbus/dbus_signal.h>
@@ -138,6 +140,17 @@ class BRILLO_EXPORT ExportedPropertySet {
   VariantDictionary GetInterfaceProperties(
       const std::string& interface_name) const;
 
+  // By default, every property update is sent in its own PropertiesChanged
+  // signal. Once this is called, the properties updated in a row are instead
+  // sent in one signal per interface, |delay| after the first update, or at
+  // the end of the current message loop task if |delay| is zero. The signals
+  // are sent from a task posted to the task runner of the current thread, or
+  // right away if there is none.
+  void EnableSignalCoalescing(base::TimeDelta delay);
+
+  // Sends the PropertiesChanged signals held back by signal coalescing now.
+  void FlushPropertiesChanged();
+
  private:
   // Used to write the dictionary of string->variant to a message.
   // This dictionary represents the property name/value pairs for the
@@ -148,12 +161,25 @@ class BRILLO_EXPORT ExportedPropertySet {
       const std::string& interface_name,
       const std::string& property_name,
       const ExportedPropertyBase* exported_property);
+  BRILLO_PRIVATE void SendPropertiesChanged(
+      const std::string& interface_name,
+      const VariantDictionary& changed_properties);
 
   ::dbus::Bus* bus_;  // weak; owned by outer DBusObject containing this object.
   // This is a map from interface name -> property name -> pointer to property.
   std::map<std::string, std::map<std::string, ExportedPropertyBase*>>
       properties_;
 
+  // Whether PropertiesChanged signals are coalesced, and how long they are
+  // held back for.
+  bool coalesce_signals_{false};
+  base::TimeDelta coalescing_delay_;
+  // The names of the properties updated since the last signal, by interface.
+  std::map<std::string, std::set<std::string>> pending_changes_;
+
+  // Bound to the task which sends the pending signals, if one is posted.
+  // Invalidated when they are sent.
+  base::WeakPtrFactory<ExportedPropertySet> flush_weak_ptr_factory_;
   // D-Bus callbacks may last longer the property set exporting those methods.
   base::WeakPtrFactory<ExportedPropertySet> weak_ptr_factory_;
 
@@ -9,6 +9,10 @@
 
 #include <base/bind.h>
 #include <base/macros.h>
+#include <base/memory/ref_counted.h>
+#include <base/strings/string_number_conversions.h>
+#include <base/test/test_mock_time_task_runner.h>
+#include <base/time/time.h>
 #include <brillo/dbus/dbus_object.h>
 #include <brillo/dbus/dbus_object_test_helpers.h>
 #include <brillo/errors/error_codes.h>
@@ -21,6 +25,7 @@
 #include <gtest/gtest.h>
 
 using ::testing::AnyNumber;
+using ::testing::ElementsAre;
 using ::testing::Return;
 using ::testing::Invoke;
 using ::testing::_;
@@ -127,7 +132,8 @@ class ExportedPropertySetTest : public ::testing::Test {
   }
 
   void TearDown() override {
-    EXPECT_CALL(*mock_exported_object_, Unregister()).Times(1);
+    if (p_)
+      EXPECT_CALL(*mock_exported_object_, Unregister()).Times(1);
   }
 
   void AssertMethodReturnsError(dbus::MethodCall* method_call) {
@@ -598,6 +604,150 @@ TEST_F(ExportedPropertySetTest, SignalsAreParsable) {
   p_->uint8_prop_.SetValue(57);
 }
 
+// Without a task runner to hold them back on, the signals are sent right away.
+TEST_F(ExportedPropertySetTest, CoalescingWithoutTaskRunner) {
+  p_->dbus_object_.EnablePropertiesChangedCoalescing(base::TimeDelta());
+  EXPECT_CALL(*mock_exported_object_, SendSignal(_)).Times(1);
+  p_->uint8_prop_.SetValue(1);
+}
+
+// Records the PropertiesChanged signals as "interface:property,property".
+class ExportedPropertySetCoalescingTest : public ExportedPropertySetTest {
+ public:
+  void SetUp() override {
+    ExportedPropertySetTest::SetUp();
+    EXPECT_CALL(*mock_exported_object_, SendSignal(_))
+        .WillRepeatedly(
+            Invoke(this, &ExportedPropertySetCoalescingTest::RecordSignal));
+  }
+
+  void RecordSignal(dbus::Signal* signal) {
+    std::string interface_name;
+    dbus::MessageReader reader(signal);
+    dbus::MessageReader array_reader(signal);
+    ASSERT_TRUE(reader.PopString(&interface_name));
+    ASSERT_TRUE(reader.PopArray(&array_reader));
+    std::string record = interface_name + ":";
+    while (array_reader.HasMoreData()) {
+      dbus::MessageReader dict_reader(signal);
+      std::string property_name;
+      ASSERT_TRUE(array_reader.PopDictEntry(&dict_reader));
+      ASSERT_TRUE(dict_reader.PopString(&property_name));
+      if (record.back() != ':')
+        record += ",";
+      record += property_name;
+    }
+    signals_.push_back(record);
+  }
+
+  // Changes every property of the object once.
+  void UpdateAllProperties(int value) {
+    p_->bool_prop_.SetValue(value % 2);
+    p_->uint8_prop_.SetValue(value);
+    p_->int16_prop_.SetValue(value);
+    p_->uint16_prop_.SetValue(value);
+    p_->int32_prop_.SetValue(value);
+    p_->uint32_prop_.SetValue(value);
+    p_->int64_prop_.SetValue(value);
+    p_->uint64_prop_.SetValue(value);
+    p_->double_prop_.SetValue(value);
+    p_->string_prop_.SetValue(base::IntToString(value));
+    p_->path_prop_.SetValue(
+        dbus::ObjectPath("/path_" + base::IntToString(value)));
+    p_->stringlist_prop_.SetValue({base::IntToString(value)});
+    p_->pathlist_prop_.SetValue(
+        {dbus::ObjectPath("/path_" + base::IntToString(value))});
+    p_->uint8list_prop_.SetValue({static_cast<uint8_t>(value)});
+  }
+
+ protected:
+  scoped_refptr<base::TestMockTimeTaskRunner> task_runner_{
+      new base::TestMockTimeTaskRunner()};
+  base::TestMockTimeTaskRunner::ScopedContext scoped_context_{task_runner_};
+  std::vector<std::string> signals_;
+};
+
+TEST_F(ExportedPropertySetCoalescingTest, UpdatesAreSentAtEndOfTask) {
+  p_->dbus_object_.EnablePropertiesChangedCoalescing(base::TimeDelta());
+  p_->uint8_prop_.SetValue(1);
+  p_->uint16_prop_.SetValue(1);
+  p_->bool_prop_.SetValue(true);
+  p_->uint8_prop_.SetValue(2);
+  EXPECT_TRUE(signals_.empty());
+
+  task_runner_->RunUntilIdle();
+  EXPECT_THAT(signals_,
+              ElementsAre(std::string(kTestInterface1) + ":" + kBoolPropName +
+                              "," + kUint8PropName,
+                          std::string(kTestInterface2) + ":" +
+                              kUint16PropName));
+  EXPECT_FALSE(task_runner_->HasPendingTask());
+}
+
+TEST_F(ExportedPropertySetCoalescingTest, UpdatesAreSentAfterDelay) {
+  p_->dbus_object_.EnablePropertiesChangedCoalescing(
+      base::TimeDelta::FromMilliseconds(100));
+  p_->uint8_prop_.SetValue(1);
+  task_runner_->FastForwardBy(base::TimeDelta::FromMilliseconds(50));
+  EXPECT_TRUE(signals_.empty());
+
+  p_->uint8_prop_.SetValue(2);
+  task_runner_->FastForwardBy(base::TimeDelta::FromMilliseconds(50));
+  EXPECT_THAT(signals_,
+              ElementsAre(std::string(kTestInterface1) + ":" + kUint8PropName));
+  EXPECT_FALSE(task_runner_->HasPendingTask());
+}
+
+TEST_F(ExportedPropertySetCoalescingTest, Flush) {
+  p_->dbus_object_.EnablePropertiesChangedCoalescing(
+      base::TimeDelta::FromSeconds(1));
+  p_->uint8_prop_.SetValue(1);
+  p_->dbus_object_.FlushPropertiesChanged();
+  EXPECT_THAT(signals_,
+              ElementsAre(std::string(kTestInterface1) + ":" + kUint8PropName));
+  // The posted task no longer sends anything.
+  task_runner_->FastForwardBy(base::TimeDelta::FromSeconds(1));
+  EXPECT_EQ(1u, signals_.size());
+
+  // A property removed before the flush is not sent.
+  p_->uint8_prop_.SetValue(2);
+  p_->dbus_object_.FindInterface(kTestInterface1)
+      ->RemoveProperty(kUint8PropName);
+  p_->dbus_object_.FlushPropertiesChanged();
+  EXPECT_EQ(1u, signals_.size());
+}
+
+// The pending signals are dropped with the property set.
+TEST_F(ExportedPropertySetCoalescingTest, DestroyedWithPendingSignals) {
+  p_->dbus_object_.EnablePropertiesChangedCoalescing(base::TimeDelta());
+  p_->uint8_prop_.SetValue(1);
+  EXPECT_CALL(*mock_exported_object_, Unregister()).Times(1);
+  p_.reset();
+  task_runner_->RunUntilIdle();
+  EXPECT_TRUE(signals_.empty());
+}
+
+// Counts the bus messages sent for bursts of updates of every property, with
+// and without coalescing.
+TEST_F(ExportedPropertySetCoalescingTest, SignalsPerBurst) {
+  const size_t kBursts = 100;
+
+  for (size_t i = 0; i < kBursts; i++) {
+    UpdateAllProperties(i + 1);
+    task_runner_->RunUntilIdle();
+  }
+  EXPECT_EQ(14 * kBursts, signals_.size());
+  signals_.clear();
+
+  p_->dbus_object_.EnablePropertiesChangedCoalescing(base::TimeDelta());
+  for (size_t i = 0; i < kBursts; i++) {
+    UpdateAllProperties(kBursts + i + 1);
+    task_runner_->RunUntilIdle();
+  }
+  // One signal per interface.
+  EXPECT_EQ(3 * kBursts, signals_.size());
+}
+
 }  // namespace dbus_utils
 
 }  // namespace brillo
@@ -17,8 +17,9 @@ static_assert(CURLOPTTYPE_LONG == 0 &&
               CURLOPTTYPE_OFF_T == 30000,
               "CURL option types are expected to be multiples of 10000");
 
-inline bool VerifyOptionType(CURLoption option, int expected_type) {
-  int option_type = (static_cast<int>(option) / 10000) * 10000;
+// Takes an int so that both CURLoption and CURLMoption values can be checked.
+inline bool VerifyOptionType(int option, int expected_type) {
+  int option_type = (option / 10000) * 10000;
   return (option_type == expected_type);
 }
 
@@ -193,5 +194,33 @@ CURLMcode CurlApi::MultiWait(CURLM* multi_handle,
                          numfds);
 }
 
+CURLMcode CurlApi::MultiSetOptInt(CURLM* multi_handle,
+                                  CURLMoption option,
+                                  int value) {
+  CHECK(VerifyOptionType(option, CURLOPTTYPE_LONG))
+      << "Only options that expect a LONG data type must be specified here";
+  // NOLINTNEXTLINE(runtime/int)
+  return curl_multi_setopt(multi_handle, option, static_cast<long>(value));
+}
+
+CURLSH* CurlApi::ShareInit() {
+  return curl_share_init();
+}
+
+CURLSHcode CurlApi::ShareCleanup(CURLSH* share_handle) {
+  return curl_share_cleanup(share_handle);
+}
+
+CURLSHcode CurlApi::ShareSetOptInt(CURLSH* share_handle,
+                                   CURLSHoption option,
+                                   int value) {
+  // CURLSHOPT_SHARE and CURLSHOPT_UNSHARE take an int, not a long.
+  return curl_share_setopt(share_handle, option, value);
+}
+
+std::string CurlApi::ShareStrError(CURLSHcode code) const {
+  return curl_share_strerror(code);
+}
+
 }  // namespace http
 }  // namespace brillo
@@ -124,6 +124,26 @@ class CurlInterface {
                               int timeout_ms,
                               int* numfds) = 0;
 
+  // Wrapper around curl_multi_setopt() for options of "long" type.
+  virtual CURLMcode MultiSetOptInt(CURLM* multi_handle,
+                                   CURLMoption option,
+                                   int value) = 0;
+
+  // Wrapper around curl_share_init().
+  virtual CURLSH* ShareInit() = 0;
+
+  // Wrapper around curl_share_cleanup().
+  virtual CURLSHcode ShareCleanup(CURLSH* share_handle) = 0;
+
+  // Wrapper around curl_share_setopt() for options of "long" type, such as
+  // CURLSHOPT_SHARE.
+  virtual CURLSHcode ShareSetOptInt(CURLSH* share_handle,
+                                    CURLSHoption option,
+                                    int value) = 0;
+
+  // Wrapper around curl_share_strerror().
+  virtual std::string ShareStrError(CURLSHcode code) const = 0;
+
  private:
   DISALLOW_COPY_AND_ASSIGN(CurlInterface);
 };
@@ -222,6 +242,26 @@ class BRILLO_EXPORT CurlApi : public CurlInterface {
                       int timeout_ms,
                       int* numfds) override;
 
+  // Wrapper around curl_multi_setopt() for options of "long" type.
+  CURLMcode MultiSetOptInt(CURLM* multi_handle,
+                           CURLMoption option,
+                           int value) override;
+
+  // Wrapper around curl_share_init().
+  CURLSH* ShareInit() override;
+
+  // Wrapper around curl_share_cleanup().
+  CURLSHcode ShareCleanup(CURLSH* share_handle) override;
+
+  // Wrapper around curl_share_setopt() for options of "long" type, such as
+  // CURLSHOPT_SHARE.
+  CURLSHcode ShareSetOptInt(CURLSH* share_handle,
+                            CURLSHoption option,
+                            int value) override;
+
+  // Wrapper around curl_share_strerror().
+  std::string ShareStrError(CURLSHcode code) const override;
+
  private:
   DISALLOW_COPY_AND_ASSIGN(CurlApi);
 };
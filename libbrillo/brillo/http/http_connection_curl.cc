@@ -159,6 +159,8 @@ bool Connection::FinishRequest(brillo::ErrorPtr* error) {
     Transport::AddEasyCurlError(error, FROM_HERE, ret, curl_interface_.get());
   } else {
     // Rewind our data stream to the beginning so that it can be read back.
+    if (pooling_transport_)
+      pooling_transport_->RecordPooledTransfer(curl_handle_);
     if (response_data_stream_->CanSeek() &&
         !response_data_stream_->SetPosition(0, error))
       return false;
@@ -94,6 +94,12 @@ class BRILLO_EXPORT Connection : public http::Connection {
 
  private:
   friend class http::curl::Transport;
+
+  // The transport which created this connection, if it pools connections, so
+  // that it can account for synchronous transfers too. |transport_| keeps it
+  // alive.
+  Transport* pooling_transport_{nullptr};
+
   DISALLOW_COPY_AND_ASSIGN(Connection);
 };
 
@@ -99,6 +99,10 @@ struct Transport::AsyncRequestData {
   RequestID request_id;
 };
 
+double Transport::PoolStats::ReuseRate() const {
+  return transfers ? static_cast<double>(reused) / transfers : 0.0;
+}
+
 Transport::Transport(const std::shared_ptr<CurlInterface>& curl_interface)
     : curl_interface_{curl_interface} {
   VLOG(2) << "curl::Transport created";
@@ -115,6 +119,10 @@ Transport::Transport(const std::shared_ptr<CurlInterface>& curl_interface,
 Transport::~Transport() {
   ClearHost();
   ShutDownAsyncCurl();
+  // The connections hold a reference to this transport, so none of their
+  // CURL handles still use the share at this point.
+  if (share_handle_)
+    curl_interface_->ShareCleanup(share_handle_);
   VLOG(2) << "curl::Transport destroyed";
 }
 
@@ -183,6 +191,21 @@ std::shared_ptr<http::Connection> Transport::CreateConnection(
     code = curl_interface_->EasySetOptPtr(curl_handle, CURLOPT_RESOLVE,
                                           host_list_);
   }
+  if (code == CURLE_OK && share_handle_) {
+    code = curl_interface_->EasySetOptPtr(curl_handle, CURLOPT_SHARE,
+                                          share_handle_);
+    // Have the kernel notice when the peer of an idle pooled connection goes
+    // away, rather than failing the next request sent over it.
+    if (code == CURLE_OK) {
+      code = curl_interface_->EasySetOptInt(curl_handle, CURLOPT_TCP_KEEPALIVE,
+                                            1);
+    }
+    if (code == CURLE_OK && pool_options_.max_idle_connections > 0) {
+      code = curl_interface_->EasySetOptInt(
+          curl_handle, CURLOPT_MAXCONNECTS,
+          pool_options_.max_idle_connections);
+    }
+  }
 
   // Setup HTTP request method and optional request body.
   if (code == CURLE_OK) {
@@ -212,8 +235,11 @@ std::shared_ptr<http::Connection> Transport::CreateConnection(
     return connection;
   }
 
-  connection = std::make_shared<http::curl::Connection>(
+  auto curl_connection = std::make_shared<http::curl::Connection>(
       curl_handle, method, curl_interface_, shared_from_this());
+  if (share_handle_)
+    curl_connection->pooling_transport_ = this;
+  connection = curl_connection;
   if (!connection->SendHeaders(headers, error)) {
     connection.reset();
   }
@@ -311,6 +337,36 @@ void Transport::ClearHost() {
   host_list_ = nullptr;
 }
 
+bool Transport::EnableConnectionPooling(const PoolOptions& options,
+                                        brillo::ErrorPtr* error) {
+  if (!share_handle_) {
+    share_handle_ = curl_interface_->ShareInit();
+    if (!share_handle_) {
+      LOG(ERROR) << "Failed to initialize CURL share";
+      brillo::Error::AddTo(error, FROM_HERE, http::kErrorDomain,
+                           "curl_init_failed", "Failed to initialize CURL");
+      return false;
+    }
+    CURLSHcode code = CURLSHE_OK;
+    for (int data : {CURL_LOCK_DATA_DNS, CURL_LOCK_DATA_SSL_SESSION,
+                     CURL_LOCK_DATA_CONNECT}) {
+      code = curl_interface_->ShareSetOptInt(share_handle_, CURLSHOPT_SHARE,
+                                             data);
+      if (code != CURLSHE_OK)
+        break;
+    }
+    if (code != CURLSHE_OK) {
+      AddShareCurlError(error, FROM_HERE, code, curl_interface_.get());
+      curl_interface_->ShareCleanup(share_handle_);
+      share_handle_ = nullptr;
+      return false;
+    }
+  }
+  pool_options_ = options;
+  // Asynchronous requests may already have set up the multi-handle.
+  return !curl_multi_handle_ || SetMultiPoolOptions(error);
+}
+
 void Transport::AddEasyCurlError(brillo::ErrorPtr* error,
                                  const base::Location& location,
                                  CURLcode code,
@@ -329,6 +385,15 @@ void Transport::AddMultiCurlError(brillo::ErrorPtr* error,
                        curl_interface->MultiStrError(code));
 }
 
+void Transport::AddShareCurlError(brillo::ErrorPtr* error,
+                                  const base::Location& location,
+                                  CURLSHcode code,
+                                  CurlInterface* curl_interface) {
+  brillo::Error::AddTo(error, location, "curl_share_error",
+                       brillo::string_utils::ToString(code),
+                       curl_interface->ShareStrError(code));
+}
+
 bool Transport::SetupAsyncCurl(brillo::ErrorPtr* error) {
   if (curl_multi_handle_)
     return true;
@@ -351,9 +416,45 @@ bool Transport::SetupAsyncCurl(brillo::ErrorPtr* error) {
     AddMultiCurlError(error, FROM_HERE, code, curl_interface_.get());
     return false;
   }
+  return !share_handle_ || SetMultiPoolOptions(error);
+}
+
+bool Transport::SetMultiPoolOptions(brillo::ErrorPtr* error) {
+  CURLMcode code = curl_interface_->MultiSetOptInt(
+      curl_multi_handle_, CURLMOPT_MAX_HOST_CONNECTIONS,
+      pool_options_.max_host_connections);
+  if (code == CURLM_OK) {
+    code = curl_interface_->MultiSetOptInt(
+        curl_multi_handle_, CURLMOPT_MAX_TOTAL_CONNECTIONS,
+        pool_options_.max_total_connections);
+  }
+  if (code == CURLM_OK && pool_options_.max_idle_connections > 0) {
+    code = curl_interface_->MultiSetOptInt(curl_multi_handle_,
+                                           CURLMOPT_MAXCONNECTS,
+                                           pool_options_.max_idle_connections);
+  }
+  if (code != CURLM_OK) {
+    AddMultiCurlError(error, FROM_HERE, code, curl_interface_.get());
+    return false;
+  }
   return true;
 }
 
+void Transport::RecordPooledTransfer(CURL* curl_handle) {
+  int new_connections = 0;
+  if (curl_interface_->EasyGetInfoInt(curl_handle, CURLINFO_NUM_CONNECTS,
+                                      &new_connections) != CURLE_OK) {
+    return;
+  }
+  pool_stats_.transfers++;
+  if (new_connections == 0)
+    pool_stats_.reused++;
+  pool_stats_.new_connections += new_connections;
+  VLOG(2) << "Transfer opened " << new_connections << " connection(s); "
+          << pool_stats_.ReuseRate() * 100 << "% of the transfers so far "
+          << "reused a pooled connection";
+}
+
 void Transport::ShutDownAsyncCurl() {
   if (!curl_multi_handle_)
     return;
@@ -476,6 +577,8 @@ void Transport::OnTransferComplete(Connection* connection, CURLcode code) {
                                 p->second->request_id,
                                 base::Owned(error.release())));
   } else {
+    if (share_handle_)
+      RecordPooledTransfer(connection->curl_handle_);
     if (connection->GetResponseStatusCode() != status_code::Ok) {
       LOG(INFO) << "Response: " << connection->GetResponseStatusCode() << " ("
                 << connection->GetResponseStatusText() << ")";
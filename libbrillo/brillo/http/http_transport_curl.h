@@ -31,6 +31,29 @@ class Connection;
 ///////////////////////////////////////////////////////////////////////////////
 class BRILLO_EXPORT Transport : public http::Transport {
  public:
+  // Limits of the connection pool. See EnableConnectionPooling().
+  struct PoolOptions {
+    // Connections open at once to a single host. Further requests to the host
+    // wait for one of them to be free. 0 means no limit.
+    int max_host_connections{6};
+    // Connections open at once over all hosts. 0 means no limit.
+    int max_total_connections{0};
+    // Connections kept open for later requests once they are idle.
+    int max_idle_connections{16};
+  };
+
+  struct PoolStats {
+    // Share of the transfers which did not have to open a connection.
+    double ReuseRate() const;
+
+    // Transfers completed successfully.
+    uint64_t transfers{0};
+    // Transfers sent over a connection left open by an earlier one.
+    uint64_t reused{0};
+    // Connections opened by the transfers.
+    uint64_t new_connections{0};
+  };
+
   // Constructs the transport using the current message loop for async
   // operations.
   explicit Transport(const std::shared_ptr<CurlInterface>& curl_interface);
@@ -71,8 +94,19 @@ class BRILLO_EXPORT Transport : public http::Transport {
                        uint16_t port,
                        const std::string& ip_address) override;
 
-  // Helper methods to convert CURL error codes (CURLcode and CURLMcode)
-  // into brillo::Error object.
+  // Makes the requests of this transport share their connections, DNS cache
+  // and TLS sessions, so that consecutive requests to a host reuse a
+  // keep-alive connection instead of opening a new one each time. The limits
+  // of |options| apply to asynchronous requests. Must be called before the
+  // first request is made. Returns false and leaves pooling off on failure.
+  bool EnableConnectionPooling(const PoolOptions& options,
+                               brillo::ErrorPtr* error);
+
+  // Statistics of the transfers made since pooling was enabled.
+  const PoolStats& pool_stats() const { return pool_stats_; }
+
+  // Helper methods to convert CURL error codes (CURLcode, CURLMcode and
+  // CURLSHcode) into brillo::Error object.
   static void AddEasyCurlError(brillo::ErrorPtr* error,
                                const base::Location& location,
                                CURLcode code,
@@ -83,10 +117,17 @@ class BRILLO_EXPORT Transport : public http::Transport {
                                 CURLMcode code,
                                 CurlInterface* curl_interface);
 
+  static void AddShareCurlError(brillo::ErrorPtr* error,
+                                const base::Location& location,
+                                CURLSHcode code,
+                                CurlInterface* curl_interface);
+
  protected:
   void ClearHost() override;
 
  private:
+  friend class Connection;
+
   // Forward-declaration of internal implementation structures.
   struct AsyncRequestData;
   class SocketPollData;
@@ -94,6 +135,12 @@ class BRILLO_EXPORT Transport : public http::Transport {
   // Initializes CURL for async operation.
   bool SetupAsyncCurl(brillo::ErrorPtr* error);
 
+  // Applies |pool_options_| to |curl_multi_handle_|.
+  bool SetMultiPoolOptions(brillo::ErrorPtr* error);
+
+  // Adds the transfer just completed on |curl_handle| to |pool_stats_|.
+  void RecordPooledTransfer(CURL* curl_handle);
+
   // Stops CURL's async operations.
   void ShutDownAsyncCurl();
 
@@ -145,6 +192,12 @@ class BRILLO_EXPORT Transport : public http::Transport {
   std::string ip_address_;
   base::FilePath certificate_path_;
   curl_slist* host_list_{nullptr};
+  // CURL "share"-handle holding the connections, DNS cache and TLS sessions
+  // of all requests when pooling is enabled, nullptr otherwise. The transport
+  // is only used on its message loop, so the share needs no locking.
+  CURLSH* share_handle_{nullptr};
+  PoolOptions pool_options_;
+  PoolStats pool_stats_;
 
   base::WeakPtrFactory<Transport> weak_ptr_factory_for_timer_{this};
   base::WeakPtrFactory<Transport> weak_ptr_factory_{this};
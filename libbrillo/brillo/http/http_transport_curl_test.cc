@@ -14,8 +14,10 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+using testing::AnyNumber;
 using testing::DoAll;
 using testing::Invoke;
+using testing::NiceMock;
 using testing::Return;
 using testing::SaveArg;
 using testing::SetArgPointee;
@@ -354,6 +356,135 @@ TEST_F(HttpCurlTransportTest, RequestGetResolveHost) {
   connection.reset();
 }
 
+class HttpCurlTransportPoolTest : public testing::Test {
+ public:
+  void SetUp() override {
+    curl_api_ = std::make_shared<NiceMock<MockCurlInterface>>();
+    transport_ = std::make_shared<Transport>(curl_api_);
+    ON_CALL(*curl_api_, EasyInit()).WillByDefault(Return(handle_));
+    ON_CALL(*curl_api_, MultiInit()).WillByDefault(Return(multi_handle_));
+    // Let the tests expect only the calls pertaining to pooling.
+    EXPECT_CALL(*curl_api_, EasySetOptInt(_, _, _)).Times(AnyNumber());
+    EXPECT_CALL(*curl_api_, EasySetOptPtr(_, _, _)).Times(AnyNumber());
+    EXPECT_CALL(*curl_api_, EasyGetInfoInt(_, _, _)).Times(AnyNumber());
+    EXPECT_CALL(*curl_api_, MultiSetOptInt(_, _, _)).Times(AnyNumber());
+  }
+
+  void EnablePooling() {
+    EXPECT_CALL(*curl_api_, ShareInit()).WillOnce(Return(share_handle_));
+    EXPECT_CALL(*curl_api_, ShareSetOptInt(share_handle_, CURLSHOPT_SHARE,
+                                           CURL_LOCK_DATA_DNS))
+        .WillOnce(Return(CURLSHE_OK));
+    EXPECT_CALL(*curl_api_, ShareSetOptInt(share_handle_, CURLSHOPT_SHARE,
+                                           CURL_LOCK_DATA_SSL_SESSION))
+        .WillOnce(Return(CURLSHE_OK));
+    EXPECT_CALL(*curl_api_, ShareSetOptInt(share_handle_, CURLSHOPT_SHARE,
+                                           CURL_LOCK_DATA_CONNECT))
+        .WillOnce(Return(CURLSHE_OK));
+    ASSERT_TRUE(transport_->EnableConnectionPooling(options_, nullptr));
+  }
+
+ protected:
+  std::shared_ptr<NiceMock<MockCurlInterface>> curl_api_;
+  std::shared_ptr<Transport> transport_;
+  Transport::PoolOptions options_;
+  CURL* handle_{reinterpret_cast<CURL*>(123)};            // Mock handle value.
+  CURLM* multi_handle_{reinterpret_cast<CURLM*>(456)};    // Mock handle value.
+  CURLSH* share_handle_{reinterpret_cast<CURLSH*>(789)};  // Mock handle value.
+};
+
+TEST_F(HttpCurlTransportPoolTest, RequestsShareConnections) {
+  options_.max_idle_connections = 4;
+  EnablePooling();
+
+  EXPECT_CALL(*curl_api_, EasySetOptPtr(handle_, CURLOPT_SHARE, share_handle_))
+      .Times(2)
+      .WillRepeatedly(Return(CURLE_OK));
+  EXPECT_CALL(*curl_api_, EasySetOptInt(handle_, CURLOPT_TCP_KEEPALIVE, 1))
+      .Times(2)
+      .WillRepeatedly(Return(CURLE_OK));
+  EXPECT_CALL(*curl_api_, EasySetOptInt(handle_, CURLOPT_MAXCONNECTS, 4))
+      .Times(2)
+      .WillRepeatedly(Return(CURLE_OK));
+  EXPECT_CALL(*curl_api_, EasyPerform(handle_))
+      .Times(2)
+      .WillRepeatedly(Return(CURLE_OK));
+  // The first request opens a connection, which the second one reuses.
+  EXPECT_CALL(*curl_api_, EasyGetInfoInt(handle_, CURLINFO_NUM_CONNECTS, _))
+      .WillOnce(DoAll(SetArgPointee<2>(1), Return(CURLE_OK)))
+      .WillOnce(DoAll(SetArgPointee<2>(0), Return(CURLE_OK)));
+  for (int i = 0; i < 2; i++) {
+    auto connection = transport_->CreateConnection(
+        "http://foo.bar/get", request_type::kGet, {}, "", "", nullptr);
+    ASSERT_NE(nullptr, connection.get());
+    EXPECT_TRUE(connection->FinishRequest(nullptr));
+  }
+
+  const Transport::PoolStats& stats = transport_->pool_stats();
+  EXPECT_EQ(2u, stats.transfers);
+  EXPECT_EQ(1u, stats.reused);
+  EXPECT_EQ(1u, stats.new_connections);
+  EXPECT_DOUBLE_EQ(0.5, stats.ReuseRate());
+
+  EXPECT_CALL(*curl_api_, ShareCleanup(share_handle_))
+      .WillOnce(Return(CURLSHE_OK));
+  transport_.reset();
+}
+
+TEST_F(HttpCurlTransportPoolTest, LimitsApplyToAsyncRequests) {
+  options_.max_host_connections = 2;
+  options_.max_total_connections = 8;
+  options_.max_idle_connections = 4;
+  EnablePooling();
+
+  auto connection = transport_->CreateConnection(
+      "http://foo.bar/get", request_type::kGet, {}, "", "", nullptr);
+  ASSERT_NE(nullptr, connection.get());
+
+  EXPECT_CALL(*curl_api_, MultiSetOptInt(multi_handle_,
+                                         CURLMOPT_MAX_HOST_CONNECTIONS, 2))
+      .WillOnce(Return(CURLM_OK));
+  EXPECT_CALL(*curl_api_, MultiSetOptInt(multi_handle_,
+                                         CURLMOPT_MAX_TOTAL_CONNECTIONS, 8))
+      .WillOnce(Return(CURLM_OK));
+  EXPECT_CALL(*curl_api_,
+              MultiSetOptInt(multi_handle_, CURLMOPT_MAXCONNECTS, 4))
+      .WillOnce(Return(CURLM_OK));
+  RequestID request_id = transport_->StartAsyncTransfer(
+      connection.get(), SuccessCallback(), ErrorCallback());
+  EXPECT_EQ(1, request_id);
+  EXPECT_TRUE(transport_->CancelRequest(request_id));
+  connection.reset();
+
+  EXPECT_CALL(*curl_api_, MultiCleanup(multi_handle_))
+      .WillOnce(Return(CURLM_OK));
+  EXPECT_CALL(*curl_api_, ShareCleanup(share_handle_))
+      .WillOnce(Return(CURLSHE_OK));
+  transport_.reset();
+}
+
+TEST_F(HttpCurlTransportPoolTest, ShareFailure) {
+  EXPECT_CALL(*curl_api_, ShareInit()).WillOnce(Return(share_handle_));
+  EXPECT_CALL(*curl_api_, ShareSetOptInt(share_handle_, CURLSHOPT_SHARE, _))
+      .WillOnce(Return(CURLSHE_OK))
+      .WillOnce(Return(CURLSHE_OK))
+      .WillOnce(Return(CURLSHE_NOT_BUILT_IN));
+  EXPECT_CALL(*curl_api_, ShareStrError(CURLSHE_NOT_BUILT_IN))
+      .WillOnce(Return("Feature not enabled in this library"));
+  EXPECT_CALL(*curl_api_, ShareCleanup(share_handle_))
+      .WillOnce(Return(CURLSHE_OK));
+  ErrorPtr error;
+  EXPECT_FALSE(transport_->EnableConnectionPooling(options_, &error));
+  EXPECT_EQ("curl_share_error", error->GetDomain());
+  EXPECT_EQ(std::to_string(CURLSHE_NOT_BUILT_IN), error->GetCode());
+
+  // Requests go on without the share.
+  EXPECT_CALL(*curl_api_, EasySetOptPtr(handle_, CURLOPT_SHARE, _)).Times(0);
+  auto connection = transport_->CreateConnection(
+      "http://foo.bar/get", request_type::kGet, {}, "", "", nullptr);
+  EXPECT_NE(nullptr, connection.get());
+}
+
 }  // namespace curl
 }  // namespace http
 }  // namespace brillo
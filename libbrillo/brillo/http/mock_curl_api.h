@@ -81,6 +81,17 @@ class MockCurlInterface : public CurlInterface {
               MultiWait,
               (CURLM*, curl_waitfd[], unsigned int, int, int*),
               (override));
+  MOCK_METHOD(CURLMcode,
+              MultiSetOptInt,
+              (CURLM*, CURLMoption, int),
+              (override));
+  MOCK_METHOD(CURLSH*, ShareInit, (), (override));
+  MOCK_METHOD(CURLSHcode, ShareCleanup, (CURLSH*), (override));
+  MOCK_METHOD(CURLSHcode,
+              ShareSetOptInt,
+              (CURLSH*, CURLSHoption, int),
+              (override));
+  MOCK_METHOD(std::string, ShareStrError, (CURLSHcode), (const, override));
 
  private:
   DISALLOW_COPY_AND_ASSIGN(MockCurlInterface);
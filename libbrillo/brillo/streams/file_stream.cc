@@ -155,6 +155,8 @@ class FileDescriptor : public FileStream::FileDescriptorInterface {
     write_watcher_ = nullptr;
   }
 
+  int GetFileDescriptor() const override { return fd_; }
+
   // Called from the brillo::MessageLoop when the file descriptor is available
   // for reading.
   void OnReadable() {
@@ -535,4 +537,8 @@ void FileStream::CancelPendingAsyncOperations() {
   Stream::CancelPendingAsyncOperations();
 }
 
+int FileStream::GetFileDescriptor() const {
+  return fd_interface_->GetFileDescriptor();
+}
+
 }  // namespace brillo
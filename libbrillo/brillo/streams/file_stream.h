@@ -54,6 +54,7 @@ class BRILLO_EXPORT FileStream : public Stream {
                                     base::TimeDelta timeout,
                                     AccessMode* out_mode) = 0;
     virtual void CancelPendingAsyncOperations() = 0;
+    virtual int GetFileDescriptor() const = 0;
   };
 
   // == Construction ==========================================================
@@ -148,6 +149,9 @@ class BRILLO_EXPORT FileStream : public Stream {
   // Cancels pending asynchronous read/write operations.
   void CancelPendingAsyncOperations() override;
 
+  // Returns the underlying file descriptor, or -1 if the stream is closed.
+  int GetFileDescriptor() const override;
+
  private:
   friend class FileStreamTest;
 
@@ -391,4 +391,8 @@ void Stream::CancelPendingAsyncOperations() {
   is_async_write_pending_ = false;
 }
 
+int Stream::GetFileDescriptor() const {
+  return -1;
+}
+
 }  // namespace brillo
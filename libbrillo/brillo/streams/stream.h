@@ -390,6 +390,12 @@ class BRILLO_EXPORT Stream {
   // Cancels pending asynchronous read/write operations.
   virtual void CancelPendingAsyncOperations();
 
+  // Returns the file descriptor which the stream reads from and writes to
+  // as is, or -1 if there is none. This lets operations such as
+  // stream_utils::CopyData() have the kernel move the data. The stream keeps
+  // owning the descriptor.
+  virtual int GetFileDescriptor() const;
+
  protected:
   Stream() = default;
 
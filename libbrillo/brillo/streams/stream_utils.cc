@@ -4,6 +4,13 @@
 
 #include <brillo/streams/stream_utils.h>
 
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include <algorithm>
 #include <limits>
 #include <memory>
@@ -11,6 +18,9 @@
 #include <vector>
 
 #include <base/bind.h>
+#include <base/macros.h>
+#include <base/posix/eintr_wrapper.h>
+#include <brillo/errors/error_codes.h>
 #include <brillo/message_loops/message_loop.h>
 #include <brillo/streams/stream_errors.h>
 
@@ -19,17 +29,44 @@ namespace stream_utils {
 
 namespace {
 
+// The buffer which CopyData() starts with when the caller does not choose one,
+// and the size it may grow to while the input keeps filling it.
+const size_t kDefaultCopyBufferSize = 4096;
+const size_t kMaxCopyBufferSize = 64 * 1024;
+
+// Data moved by a single system call, and by all the system calls made in a
+// single message loop task, when the kernel copies the data.
+const uint64_t kKernelCopyChunkSize = 1024 * 1024;
+const uint64_t kKernelCopySizePerTask = 8 * 1024 * 1024;
+
 // Status of asynchronous CopyData operation.
 struct CopyDataState {
   brillo::StreamPtr in_stream;
   brillo::StreamPtr out_stream;
   std::vector<uint8_t> buffer;
+  // The buffer is doubled, up to this size, each time a read fills it.
+  size_t max_buffer_size;
+  bool grow_buffer{false};
   uint64_t remaining_to_copy;
   uint64_t size_copied;
   CopyDataSuccessCallback success_callback;
   CopyDataErrorCallback error_callback;
+  // The file descriptors of the streams, and the system calls which may still
+  // copy between them, when the kernel copies the data.
+  int in_fd{-1};
+  int out_fd{-1};
+  bool try_copy_file_range{false};
+  bool try_splice{false};
+  bool try_sendfile{false};
 };
 
+// Async CopyData success.
+void OnCopyDataSuccess(const std::shared_ptr<CopyDataState>& state) {
+  state->success_callback.Run(std::move(state->in_stream),
+                              std::move(state->out_stream),
+                              state->size_copied);
+}
+
 // Async CopyData I/O error callback.
 void OnCopyDataError(const std::shared_ptr<CopyDataState>& state,
                      const brillo::Error* error) {
@@ -43,12 +80,9 @@ void PerformRead(const std::shared_ptr<CopyDataState>& state);
 // Callback from read operation for CopyData. Writes the read data to the output
 // stream and invokes PerformRead when done to restart the copy cycle.
 void PerformWrite(const std::shared_ptr<CopyDataState>& state, size_t size) {
-  if (size == 0) {
-    state->success_callback.Run(std::move(state->in_stream),
-                                std::move(state->out_stream),
-                                state->size_copied);
-    return;
-  }
+  if (size == 0)
+    return OnCopyDataSuccess(state);
+  state->grow_buffer = size == state->buffer.size();
   state->size_copied += size;
   CHECK_GE(state->remaining_to_copy, size);
   state->remaining_to_copy -= size;
@@ -67,6 +101,10 @@ void PerformWrite(const std::shared_ptr<CopyDataState>& state, size_t size) {
 // the output stream.
 void PerformRead(const std::shared_ptr<CopyDataState>& state) {
   brillo::ErrorPtr error;
+  if (state->grow_buffer && state->buffer.size() < state->max_buffer_size) {
+    state->buffer.resize(
+        std::min(state->buffer.size() * 2, state->max_buffer_size));
+  }
   const uint64_t buffer_size = state->buffer.size();
   // |buffer_size| is guaranteed to fit in size_t, so |size_to_read| value will
   // also not overflow size_t, so the static_cast below is safe.
@@ -82,6 +120,148 @@ void PerformRead(const std::shared_ptr<CopyDataState>& state) {
     OnCopyDataError(state, error.get());
 }
 
+// Returns true if |error| from a kernel copy means that the system call does
+// not support the pair of files, rather than that the copy failed.
+bool IsUnsupportedKernelCopyError(int error) {
+  return error == EINVAL || error == ENOSYS || error == EXDEV ||
+         error == EOPNOTSUPP || error == EBADF;
+}
+
+// Has the kernel copy up to |size| bytes from |state->in_fd| to
+// |state->out_fd| with the first system call which may support them, and
+// returns what it returned. Drops the system calls which turn out not to
+// support the files, and returns -1 with errno set to EOPNOTSUPP when none is
+// left.
+ssize_t KernelCopy(CopyDataState* state, size_t size) {
+  for (;;) {
+    ssize_t copied = -1;
+    bool* supported = nullptr;
+    if (state->try_copy_file_range) {
+      supported = &state->try_copy_file_range;
+      copied = HANDLE_EINTR(copy_file_range(state->in_fd, nullptr,
+                                            state->out_fd, nullptr, size, 0));
+    } else if (state->try_splice) {
+      supported = &state->try_splice;
+      copied = HANDLE_EINTR(splice(state->in_fd, nullptr, state->out_fd,
+                                   nullptr, size,
+                                   SPLICE_F_MOVE | SPLICE_F_NONBLOCK));
+    } else if (state->try_sendfile) {
+      supported = &state->try_sendfile;
+      copied =
+          HANDLE_EINTR(sendfile(state->out_fd, state->in_fd, nullptr, size));
+    } else {
+      errno = EOPNOTSUPP;
+      return -1;
+    }
+    if (copied >= 0 || !IsUnsupportedKernelCopyError(errno))
+      return copied;
+    *supported = false;
+  }
+}
+
+// Forward declaration.
+void PerformKernelCopy(const std::shared_ptr<CopyDataState>& state);
+
+// Callback from WaitForData() when the kernel copy can go on.
+void OnKernelCopyReady(const std::shared_ptr<CopyDataState>& state,
+                       Stream::AccessMode /* mode */) {
+  PerformKernelCopy(state);
+}
+
+// Waits for the stream which made the kernel copy return EAGAIN.
+void WaitForKernelCopy(const std::shared_ptr<CopyDataState>& state) {
+  pollfd fds[] = {{state->in_fd, POLLIN, 0}, {state->out_fd, POLLOUT, 0}};
+  HANDLE_EINTR(poll(fds, arraysize(fds), 0));
+  const bool input_ready = fds[0].revents != 0;
+  brillo::ErrorPtr error;
+  bool success =
+      input_ready
+          ? state->out_stream->WaitForData(
+                Stream::AccessMode::WRITE,
+                base::Bind(&OnKernelCopyReady, state), &error)
+          : state->in_stream->WaitForData(
+                Stream::AccessMode::READ,
+                base::Bind(&OnKernelCopyReady, state), &error);
+  if (!success)
+    OnCopyDataError(state, error.get());
+}
+
+// Performs CopyData in the kernel, without bringing the data to user space.
+// Gives the message loop back after every kKernelCopySizePerTask bytes, and
+// falls back to PerformRead if no system call supports the streams.
+void PerformKernelCopy(const std::shared_ptr<CopyDataState>& state) {
+  uint64_t size_to_copy =
+      std::min(state->remaining_to_copy, kKernelCopySizePerTask);
+  while (size_to_copy > 0) {
+    ssize_t copied = KernelCopy(
+        state.get(),
+        static_cast<size_t>(std::min(size_to_copy, kKernelCopyChunkSize)));
+    if (copied == 0)
+      return OnCopyDataSuccess(state);  // End of the input stream.
+    if (copied < 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK)
+        return WaitForKernelCopy(state);
+      if (errno == EOPNOTSUPP && !state->try_copy_file_range &&
+          !state->try_splice && !state->try_sendfile) {
+        return PerformRead(state);
+      }
+      brillo::ErrorPtr error;
+      brillo::errors::system::AddSystemError(&error, FROM_HERE, errno);
+      return OnCopyDataError(state, error.get());
+    }
+    state->size_copied += copied;
+    state->remaining_to_copy -= copied;
+    size_to_copy -= copied;
+  }
+  if (state->remaining_to_copy == 0)
+    return OnCopyDataSuccess(state);
+  brillo::MessageLoop::current()->PostTask(
+      FROM_HERE, base::BindOnce(&PerformKernelCopy, state));
+}
+
+// Performs CopyData. Lets the kernel copy the data if both streams are backed
+// by file descriptors which some system call can copy between:
+// copy_file_range() between regular files, splice() to or from a pipe, and
+// sendfile() from a regular file to anything else.
+void PerformCopy(const std::shared_ptr<CopyDataState>& state) {
+  state->in_fd = state->in_stream->GetFileDescriptor();
+  state->out_fd = state->out_stream->GetFileDescriptor();
+  struct stat in_stat;
+  struct stat out_stat;
+  if (state->in_fd < 0 || state->out_fd < 0 || !state->in_stream->CanRead() ||
+      !state->out_stream->CanWrite() || fstat(state->in_fd, &in_stat) < 0 ||
+      fstat(state->out_fd, &out_stat) < 0) {
+    return PerformRead(state);
+  }
+  const bool in_file = S_ISREG(in_stat.st_mode);
+  const bool out_file = S_ISREG(out_stat.st_mode);
+  state->try_copy_file_range = in_file && out_file;
+  state->try_splice = S_ISFIFO(in_stat.st_mode) || S_ISFIFO(out_stat.st_mode);
+  state->try_sendfile = in_file;
+  PerformKernelCopy(state);
+}
+
+// Implements both variants of CopyData.
+void StartCopyData(StreamPtr in_stream,
+                   StreamPtr out_stream,
+                   uint64_t max_size_to_copy,
+                   size_t buffer_size,
+                   size_t max_buffer_size,
+                   const CopyDataSuccessCallback& success_callback,
+                   const CopyDataErrorCallback& error_callback) {
+  auto state = std::make_shared<CopyDataState>();
+  state->in_stream = std::move(in_stream);
+  state->out_stream = std::move(out_stream);
+  state->buffer.resize(buffer_size);
+  state->max_buffer_size = max_buffer_size;
+  state->remaining_to_copy = max_size_to_copy;
+  state->size_copied = 0;
+  state->success_callback = success_callback;
+  state->error_callback = error_callback;
+  brillo::MessageLoop::current()->PostTask(FROM_HERE,
+                                           base::BindOnce(&PerformCopy, state));
+}
+
 }  // anonymous namespace
 
 bool ErrorStreamClosed(const base::Location& location,
@@ -193,9 +373,9 @@ void CopyData(StreamPtr in_stream,
               StreamPtr out_stream,
               const CopyDataSuccessCallback& success_callback,
               const CopyDataErrorCallback& error_callback) {
-  CopyData(std::move(in_stream), std::move(out_stream),
-           std::numeric_limits<uint64_t>::max(), 4096, success_callback,
-           error_callback);
+  StartCopyData(std::move(in_stream), std::move(out_stream),
+                std::numeric_limits<uint64_t>::max(), kDefaultCopyBufferSize,
+                kMaxCopyBufferSize, success_callback, error_callback);
 }
 
 void CopyData(StreamPtr in_stream,
@@ -204,16 +384,8 @@ void CopyData(StreamPtr in_stream,
               size_t buffer_size,
               const CopyDataSuccessCallback& success_callback,
               const CopyDataErrorCallback& error_callback) {
-  auto state = std::make_shared<CopyDataState>();
-  state->in_stream = std::move(in_stream);
-  state->out_stream = std::move(out_stream);
-  state->buffer.resize(buffer_size);
-  state->remaining_to_copy = max_size_to_copy;
-  state->size_copied = 0;
-  state->success_callback = success_callback;
-  state->error_callback = error_callback;
-  brillo::MessageLoop::current()->PostTask(FROM_HERE,
-                                           base::BindOnce(&PerformRead, state));
+  StartCopyData(std::move(in_stream), std::move(out_stream), max_size_to_copy,
+                buffer_size, buffer_size, success_callback, error_callback);
 }
 
 }  // namespace stream_utils
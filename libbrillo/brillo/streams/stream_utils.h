@@ -88,7 +88,11 @@ using CopyDataErrorCallback =
 // streams for the duration of the operation and then gives them back when
 // either the |success_callback| or |error_callback| is called.
 // |success_callback| also provides the number of bytes actually copied.
-// This variant of CopyData uses internal buffer of 4 KiB for the operation.
+// When both streams are backed by file descriptors (see
+// Stream::GetFileDescriptor()) which the kernel can copy between, the data is
+// not brought to user space. Otherwise this variant of CopyData uses an
+// internal buffer which starts at 4 KiB and grows up to 64 KiB while the
+// reads keep filling it.
 BRILLO_EXPORT void CopyData(StreamPtr in_stream,
                             StreamPtr out_stream,
                             const CopyDataSuccessCallback& success_callback,
@@ -100,7 +104,8 @@ BRILLO_EXPORT void CopyData(StreamPtr in_stream,
 // streams for the duration of the operation and then gives them back when
 // either the |success_callback| or |error_callback| is called.
 // |success_callback| also provides the number of bytes actually copied.
-// |buffer_size| specifies the size of the read buffer to use for the operation.
+// |buffer_size| specifies the size of the read buffer to use for the operation
+// when the data cannot be copied by the kernel, as described above.
 BRILLO_EXPORT void CopyData(StreamPtr in_stream,
                             StreamPtr out_stream,
                             uint64_t max_size_to_copy,
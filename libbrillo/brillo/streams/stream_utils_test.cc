@@ -4,14 +4,29 @@
 
 #include <brillo/streams/stream_utils.h>
 
+#include <sys/socket.h>
+#include <unistd.h>
+
 #include <limits>
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include <base/bind.h>
+#include <base/files/file_util.h>
+#include <base/files/scoped_file.h>
+#include <base/files/scoped_temp_dir.h>
+#include <base/message_loop/message_loop.h>
+#include <base/posix/eintr_wrapper.h>
+#include <base/threading/thread.h>
+#include <base/time/time.h>
+#include <brillo/message_loops/base_message_loop.h>
 #include <brillo/message_loops/fake_message_loop.h>
 #include <brillo/message_loops/message_loop.h>
+#include <brillo/message_loops/message_loop_utils.h>
+#include <brillo/streams/file_stream.h>
+#include <brillo/streams/input_stream_set.h>
 #include <brillo/streams/mock_stream.h>
 #include <brillo/streams/stream_errors.h>
 #include <gmock/gmock.h>
@@ -299,4 +314,171 @@ TEST_F(CopyStreamDataTest, ErrorWrite) {
   ExpectFailure();
 }
 
+namespace {
+
+const size_t kFileStreamCopySize = 4 * 1024 * 1024;
+const size_t kFdChunkSize = 64 * 1024;
+
+// Writes |size| bytes to |fd|, then closes it.
+void FeedFd(base::ScopedFD fd, size_t size) {
+  const std::vector<char> data(kFdChunkSize, 'x');
+  for (size_t written = 0; written < size; written += data.size())
+    ASSERT_TRUE(base::WriteFileDescriptor(fd.get(), data.data(), data.size()));
+}
+
+// Returns |kFileStreamCopySize| bytes that vary, so misplaced bytes are
+// noticed.
+std::string CreateSourceData() {
+  std::string data(kFileStreamCopySize, 0);
+  for (size_t i = 0; i < data.size(); i++)
+    data[i] = static_cast<char>(i * 7 + i / 4096);
+  return data;
+}
+
+// Reads |size| bytes from |fd|.
+void DrainFd(base::ScopedFD fd, size_t size) {
+  std::vector<char> data(kFdChunkSize);
+  for (size_t read_size = 0; read_size < size;) {
+    ssize_t result = HANDLE_EINTR(read(fd.get(), data.data(), data.size()));
+    ASSERT_GT(result, 0);
+    read_size += result;
+  }
+}
+
+}  // namespace
+
+class CopyDataFileStreamTest : public testing::Test {
+ public:
+  void SetUp() override {
+    brillo_loop_.SetAsCurrent();
+    ASSERT_TRUE(temp_dir_.CreateUniqueTempDir());
+    source_path_ = temp_dir_.GetPath().Append("source");
+    dest_path_ = temp_dir_.GetPath().Append("dest");
+    source_data_ = CreateSourceData();
+    ASSERT_EQ(static_cast<int>(source_data_.size()),
+              base::WriteFile(source_path_, source_data_.data(),
+                              source_data_.size()));
+  }
+
+  StreamPtr OpenSource() {
+    return FileStream::Open(source_path_, Stream::AccessMode::READ,
+                            FileStream::Disposition::OPEN_EXISTING, nullptr);
+  }
+
+  StreamPtr CreateDest() {
+    return FileStream::Open(dest_path_, Stream::AccessMode::WRITE,
+                            FileStream::Disposition::CREATE_ALWAYS, nullptr);
+  }
+
+  // Copies |in_stream| to |out_stream| with CopyData(), through user space if
+  // |kernel| is false, and checks that all the data is copied.
+  void Copy(bool kernel, StreamPtr in_stream, StreamPtr out_stream) {
+    ASSERT_NE(nullptr, in_stream);
+    ASSERT_NE(nullptr, out_stream);
+    if (!kernel) {
+      // Hide the file descriptor of the input.
+      std::vector<StreamPtr> streams;
+      streams.push_back(std::move(in_stream));
+      in_stream = InputStreamSet::Create(std::move(streams), nullptr);
+    }
+
+    auto on_success = [](bool* done, uint64_t* copied, StreamPtr, StreamPtr,
+                         uint64_t size) {
+      *copied = size;
+      *done = true;
+    };
+    auto on_error = [](bool* done, StreamPtr, StreamPtr, const Error* error) {
+      ADD_FAILURE() << error->GetMessage();
+      *done = true;
+    };
+    bool done = false;
+    uint64_t copied = 0;
+    stream_utils::CopyData(std::move(in_stream), std::move(out_stream),
+                           base::Bind(on_success, &done, &copied),
+                           base::Bind(on_error, &done));
+    MessageLoopRunUntil(&brillo_loop_, base::TimeDelta::FromSeconds(60),
+                        base::Bind([](bool* done) { return *done; }, &done));
+    EXPECT_TRUE(done);
+    EXPECT_EQ(kFileStreamCopySize, copied);
+  }
+
+ protected:
+  base::MessageLoopForIO base_loop_;
+  BaseMessageLoop brillo_loop_{&base_loop_};
+  base::ScopedTempDir temp_dir_;
+  base::FilePath source_path_;
+  base::FilePath dest_path_;
+  std::string source_data_;
+};
+
+TEST_F(CopyDataFileStreamTest, KernelCopyStopsAtMaxSize) {
+  bool succeeded = false;
+  stream_utils::CopyData(
+      OpenSource(), CreateDest(), 1000, 4096,
+      base::Bind(
+          [](bool* succeeded, StreamPtr, StreamPtr, uint64_t size) {
+            EXPECT_EQ(1000u, size);
+            *succeeded = true;
+          },
+          &succeeded),
+      base::Bind([](StreamPtr, StreamPtr, const Error* error) {
+        ADD_FAILURE() << error->GetMessage();
+      }));
+  MessageLoopRunMaxIterations(&brillo_loop_, 10);
+  EXPECT_TRUE(succeeded);
+  std::string data;
+  EXPECT_TRUE(base::ReadFileToString(dest_path_, &data));
+  EXPECT_EQ(source_data_.substr(0, 1000), data);
+}
+
+TEST_F(CopyDataFileStreamTest, FileToFile) {
+  for (bool kernel : {true, false}) {
+    Copy(kernel, OpenSource(), CreateDest());
+    std::string data;
+    EXPECT_TRUE(base::ReadFileToString(dest_path_, &data));
+    EXPECT_EQ(kFileStreamCopySize, data.size());
+    EXPECT_TRUE(data == source_data_) << "kernel: " << kernel;
+  }
+}
+
+TEST_F(CopyDataFileStreamTest, FileToPipe) {
+  for (bool kernel : {true, false}) {
+    int fds[2];
+    ASSERT_EQ(0, pipe(fds));
+    base::Thread reader("reader");
+    ASSERT_TRUE(reader.Start());
+    reader.task_runner()->PostTask(
+        FROM_HERE, base::BindOnce(&DrainFd, base::ScopedFD(fds[0]),
+                                  kFileStreamCopySize));
+    Copy(kernel, OpenSource(),
+         FileStream::FromFileDescriptor(fds[1], true, nullptr));
+    reader.Stop();
+  }
+}
+
+TEST_F(CopyDataFileStreamTest, PipeToSocket) {
+  for (bool kernel : {true, false}) {
+    int pipe_fds[2];
+    int socket_fds[2];
+    ASSERT_EQ(0, pipe(pipe_fds));
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, socket_fds));
+    base::Thread writer("writer");
+    base::Thread reader("reader");
+    ASSERT_TRUE(writer.Start());
+    ASSERT_TRUE(reader.Start());
+    writer.task_runner()->PostTask(
+        FROM_HERE,
+        base::BindOnce(&FeedFd, base::ScopedFD(pipe_fds[1]),
+                       kFileStreamCopySize));
+    reader.task_runner()->PostTask(
+        FROM_HERE,
+        base::BindOnce(&DrainFd, base::ScopedFD(socket_fds[1]),
+                       kFileStreamCopySize));
+    Copy(kernel, FileStream::FromFileDescriptor(pipe_fds[0], true, nullptr),
+         FileStream::FromFileDescriptor(socket_fds[0], true, nullptr));
+    writer.Stop();
+    reader.Stop();
+  }
+}
+
 }  // namespace brillo
@@ -86,6 +86,9 @@ constexpr base::TimeDelta kVmlogInterval = base::TimeDelta::FromSeconds(2);
 
 constexpr char kVmlogDir[] = "/var/log/vmlog";
 
+// Number of threads reading /proc for process memory reports.
+constexpr int kProcessMeterThreads = 4;
+
 // Memory use stats collection intervals.  We collect some memory use interval
 // at these intervals after boot, and we stop collecting after the last one,
 // with the assumption that in most cases the memory use won't change much
@@ -998,18 +1001,21 @@ void MetricsDaemon::ReportProcessMemoryCallback(base::TimeDelta wait) {
 }
 
 void MetricsDaemon::ReportProcessMemory() {
-  base::FilePath procfs_path("/proc");
-  base::FilePath run_path("/run");
-  ProcessInfo info(procfs_path, run_path);
-  info.Collect();
-  info.Classify();
+  if (!process_info_) {
+    process_info_ = std::make_unique<ProcessInfo>(base::FilePath("/proc"),
+                                                  base::FilePath("/run"));
+    process_info_->SetNumThreads(kProcessMeterThreads);
+  }
+  process_info_->Collect();
+  process_info_->Classify();
+  process_info_->CollectMemoryStats();
   for (int i = 0; i < PG_KINDS_COUNT; i++) {
     ProcessGroupKind kind = static_cast<ProcessGroupKind>(i);
     ProcessMemoryStats stats;
     static_assert(
         arraysize(kProcessMemoryUMANames[i]) == arraysize(stats.rss_sizes),
         "RSS array size mismatch");
-    AccumulateProcessGroupStats(procfs_path, info.GetGroup(kind), &stats);
+    process_info_->GetGroupMemoryStats(kind, &stats);
     ReportProcessGroupStats(kProcessMemoryUMANames[i], stats);
   }
 }
@@ -507,6 +507,10 @@ class MetricsDaemon : public brillo::DBusDaemon {
   std::unique_ptr<UploadService> upload_service_;
   std::unique_ptr<VmlogWriter> vmlog_writer_;
 
+  // Kept between process memory reports to reuse data about processes that
+  // are still alive.
+  std::unique_ptr<ProcessInfo> process_info_;
+
   // The backing directory for persistent integers.
   base::FilePath backing_dir_;
 
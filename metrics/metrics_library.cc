@@ -4,12 +4,14 @@
 
 #include "metrics/metrics_library.h"
 
+#include <base/bind.h>
 #include <base/files/file_util.h>
 #include <base/files/scoped_file.h>
 #include <base/guid.h>
 #include <base/logging.h>
 #include <base/strings/string_util.h>
 #include <base/strings/stringprintf.h>
+#include <base/threading/thread_task_runner_handle.h>
 #include <errno.h>
 #include <session_manager/dbus-proxies.h>
 #include <sys/file.h>
@@ -20,6 +22,7 @@
 #include <vector>
 
 #include "metrics/serialization/metric_sample.h"
+#include "metrics/serialization/sample_ring.h"
 #include "metrics/serialization/serialization_utils.h"
 
 #include "policy/device_policy.h"
@@ -33,6 +36,10 @@ const char kConsentFile[] = "/home/chronos/Consent To Send Stats";
 const char kCrosEventHistogramName[] = "Platform.CrOSEvent";
 const int kCrosEventHistogramMax = 100;
 
+// How long to wait before looking again for a missing sample ring.
+constexpr base::TimeDelta kSampleRingRetryDelay =
+    base::TimeDelta::FromMinutes(1);
+
 // Add new cros events here.
 //
 // The index of the event is sent in the message, so please do not
@@ -84,7 +91,9 @@ MetricsLibrary::MetricsLibrary()
     : uma_events_file_(base::FilePath(kUMAEventsPath)),
       consent_file_(base::FilePath(kConsentFile)) {}
 
-MetricsLibrary::~MetricsLibrary() {}
+MetricsLibrary::~MetricsLibrary() {
+  Flush();
+}
 
 bool MetricsLibrary::IsGuestMode() {
   // Shortcut check whether there is any logged-in user.
@@ -216,10 +225,17 @@ void MetricsLibrary::Init() {
 }
 
 void MetricsLibrary::SetOutputFile(const std::string& output_file) {
+  // Samples sent so far belong to the previous output file.
+  Flush();
   uma_events_file_ = base::FilePath(output_file);
+  use_sample_ring_ = false;
+  sample_ring_.reset();
 }
 
 bool MetricsLibrary::Replay(const std::string& input_file) {
+  // Keep the replayed samples after the ones already sent.
+  if (!Flush())
+    return false;
   std::vector<metrics::MetricSample> samples;
   if (!metrics::SerializationUtils::ReadAndTruncateMetricsFromFile(
           input_file, &samples,
@@ -230,12 +246,85 @@ bool MetricsLibrary::Replay(const std::string& input_file) {
       samples, uma_events_file_.value());
 }
 
+void MetricsLibrary::EnableBatching(size_t max_bytes,
+                                    base::TimeDelta max_delay) {
+  // The buffer belongs to the sequence which sends the first sample.
+  DETACH_FROM_SEQUENCE(batch_sequence_checker_);
+  batching_enabled_ = true;
+  batch_max_bytes_ = max_bytes;
+  batch_max_delay_ = max_delay;
+}
+
+bool MetricsLibrary::Flush() {
+  if (!batching_enabled_)
+    return true;
+  DCHECK_CALLED_ON_VALID_SEQUENCE(batch_sequence_checker_);
+  flush_timer_.Stop();
+  if (pending_samples_.empty())
+    return true;
+  bool result = WriteSerializedSamples(pending_samples_);
+  // Drop the samples on failure too, since retrying would most likely fail
+  // again and the buffer would grow without bound.
+  pending_samples_.clear();
+  return result;
+}
+
+bool MetricsLibrary::SendSample(const metrics::MetricSample& sample) {
+  if (!batching_enabled_) {
+    std::string serialized;
+    if (!metrics::SerializationUtils::SerializeSample(sample, &serialized))
+      return false;
+    return WriteSerializedSamples(serialized);
+  }
+
+  DCHECK_CALLED_ON_VALID_SEQUENCE(batch_sequence_checker_);
+  base::TimeTicks now = base::TimeTicks::Now();
+  const bool was_empty = pending_samples_.empty();
+  if (was_empty)
+    pending_since_ = now;
+  if (!metrics::SerializationUtils::SerializeSample(sample, &pending_samples_))
+    return false;
+  if (pending_samples_.size() >= batch_max_bytes_ ||
+      now - pending_since_ >= batch_max_delay_) {
+    return Flush();
+  }
+  if (was_empty && base::ThreadTaskRunnerHandle::IsSet()) {
+    // |flush_timer_| is owned by this object, so it cannot outlive it.
+    flush_timer_.Start(FROM_HERE, batch_max_delay_,
+                       base::Bind(base::IgnoreResult(&MetricsLibrary::Flush),
+                                  base::Unretained(this)));
+  }
+  return true;
+}
+
+bool MetricsLibrary::WriteSerializedSamples(const std::string& serialized) {
+  metrics::SampleRing* ring = GetSampleRing();
+  if (ring && ring->Append(serialized))
+    return true;
+  return metrics::SerializationUtils::WriteSerializedMetricsToFile(
+      serialized, uma_events_file_.value());
+}
+
+metrics::SampleRing* MetricsLibrary::GetSampleRing() {
+  if (!use_sample_ring_)
+    return nullptr;
+  if (!sample_ring_) {
+    base::TimeTicks now = base::TimeTicks::Now();
+    if (!sample_ring_open_time_.is_null() &&
+        now - sample_ring_open_time_ < kSampleRingRetryDelay) {
+      return nullptr;
+    }
+    sample_ring_open_time_ = now;
+    sample_ring_ =
+        metrics::SampleRing::Open(base::FilePath(metrics::kSampleRingPath));
+  }
+  return sample_ring_.get();
+}
+
 bool MetricsLibrary::SendToUMA(
     const std::string& name, int sample, int min, int max, int nbuckets) {
-  return metrics::SerializationUtils::WriteMetricsToFile(
-      {metrics::MetricSample::HistogramSample(name, sample, min, max,
-                                              nbuckets)},
-      uma_events_file_.value());
+  return SendSample(metrics::MetricSample::HistogramSample(name, sample, min,
+                                                           max, nbuckets));
 }
 
 #if USE_METRICS_UPLOADER
@@ -245,10 +334,8 @@ bool MetricsLibrary::SendRepeatedToUMA(const std::string& name,
                                        int max,
                                        int nbuckets,
                                        int num_samples) {
-  return metrics::SerializationUtils::WriteMetricsToFile(
-      {metrics::MetricSample::HistogramSample(name, sample, min, max, nbuckets,
-                                              num_samples)},
-      uma_events_file_.value());
+  return SendSample(metrics::MetricSample::HistogramSample(
+      name, sample, min, max, nbuckets, num_samples));
 }
 #endif
 
@@ -259,33 +346,25 @@ void MetricsLibrary::SetConsentFileForTest(const base::FilePath& consent_file) {
 bool MetricsLibrary::SendEnumToUMA(const std::string& name,
                                    int sample,
                                    int max) {
-  return metrics::SerializationUtils::WriteMetricsToFile(
-      {metrics::MetricSample::LinearHistogramSample(name, sample, max)},
-      uma_events_file_.value());
+  return SendSample(
+      metrics::MetricSample::LinearHistogramSample(name, sample, max));
 }
 
 bool MetricsLibrary::SendBoolToUMA(const std::string& name, bool sample) {
-  return metrics::SerializationUtils::WriteMetricsToFile(
-      {metrics::MetricSample::LinearHistogramSample(name, sample ? 1 : 0, 2)},
-      uma_events_file_.value());
+  return SendSample(
+      metrics::MetricSample::LinearHistogramSample(name, sample ? 1 : 0, 2));
 }
 
 bool MetricsLibrary::SendSparseToUMA(const std::string& name, int sample) {
-  return metrics::SerializationUtils::WriteMetricsToFile(
-      {metrics::MetricSample::SparseHistogramSample(name, sample)},
-      uma_events_file_.value());
+  return SendSample(metrics::MetricSample::SparseHistogramSample(name, sample));
 }
 
 bool MetricsLibrary::SendUserActionToUMA(const std::string& action) {
-  return metrics::SerializationUtils::WriteMetricsToFile(
-      {metrics::MetricSample::UserActionSample(action)},
-      uma_events_file_.value());
+  return SendSample(metrics::MetricSample::UserActionSample(action));
 }
 
 bool MetricsLibrary::SendCrashToUMA(const char* crash_kind) {
-  return metrics::SerializationUtils::WriteMetricsToFile(
-      {metrics::MetricSample::CrashSample(crash_kind)},
-      uma_events_file_.value());
+  return SendSample(metrics::MetricSample::CrashSample(crash_kind));
 }
 
 void MetricsLibrary::SetPolicyProvider(policy::PolicyProvider* provider) {
@@ -13,10 +13,18 @@
 #include <base/compiler_specific.h>
 #include <base/files/file_path.h>
 #include <base/macros.h>
+#include <base/sequence_checker.h>
+#include <base/time/time.h>
+#include <base/timer/timer.h>
 #include <gtest/gtest_prod.h>  // for FRIEND_TEST
 
 #include "policy/libpolicy.h"
 
+namespace metrics {
+class MetricSample;
+class SampleRing;
+}  // namespace metrics
+
 class MetricsLibraryInterface {
  public:
   virtual void Init() = 0;  // TODO(chromium:940343): Remove this function.
@@ -78,12 +86,31 @@ class MetricsLibrary : public MetricsLibraryInterface {
   // fully available (e.g. when /var is not mounted). Note that the contents of
   // custom output files will not be sent to the server automatically, but need
   // to be imported via Replay() to get picked up by the reporting pipeline.
+  // Samples sent after this call always go to the file, never to the sample
+  // ring.
   void SetOutputFile(const std::string& output_file);
 
   // Replays metrics from the given file as if the events contained in |file|
   // where being generated via the SendXYZ functions.
   bool Replay(const std::string& input_file);
 
+  // Keeps the samples sent via the SendXYZ functions in memory instead of
+  // writing each of them to the output file, which costs an open, a lock and a
+  // write per sample. The buffered samples are written together when they
+  // reach |max_bytes| once serialized, |max_delay| after the oldest of them was
+  // sent, on Flush() and on destruction. The delay is kept by a timer on the
+  // current message loop; without one, samples older than |max_delay| are only
+  // written as the next sample is sent. Intended for daemons that send bursts
+  // of samples. Buffered samples are lost if the process crashes.
+  // Once batching is enabled, the SendXYZ functions, Flush() and the
+  // destruction must all happen on the same sequence: the buffer is not
+  // thread-safe.
+  void EnableBatching(size_t max_bytes, base::TimeDelta max_delay);
+
+  // Writes the samples buffered since batching was enabled to the output file.
+  // Returns true on success, including when there is nothing to write.
+  bool Flush();
+
   // Sends histogram data to Chrome for transport to UMA and returns
   // true on success. This method results in the equivalent of an
   // asynchronous non-blocking RPC to UMA_HISTOGRAM_CUSTOM_COUNTS
@@ -179,6 +206,17 @@ class MetricsLibrary : public MetricsLibraryInterface {
   // This function is used by tests only to mock the device policies.
   void SetPolicyProvider(policy::PolicyProvider* provider);
 
+  // Writes |sample| to the output file, or buffers it if batching is enabled.
+  bool SendSample(const metrics::MetricSample& sample);
+
+  // Writes samples serialized by SerializationUtils::SerializeSample() to the
+  // sample ring if it is available, or to the output file otherwise.
+  bool WriteSerializedSamples(const std::string& serialized);
+
+  // Returns the sample ring, mapping it first if needed. Returns nullptr if
+  // there is no ring to write to.
+  metrics::SampleRing* GetSampleRing();
+
   // Time at which we last checked if metrics were enabled.
   static time_t cached_enabled_time_;
 
@@ -190,6 +228,28 @@ class MetricsLibrary : public MetricsLibraryInterface {
 
   std::unique_ptr<policy::PolicyProvider> policy_provider_;
 
+  // Batching parameters set by EnableBatching().
+  bool batching_enabled_ = false;
+  size_t batch_max_bytes_ = 0;
+  base::TimeDelta batch_max_delay_;
+
+  // Serialized samples waiting to be written, and when the oldest of them was
+  // sent.
+  std::string pending_samples_;
+  base::TimeTicks pending_since_;
+  // Flushes |pending_samples_| |batch_max_delay_| after the oldest of them was
+  // sent.
+  base::OneShotTimer flush_timer_;
+  SEQUENCE_CHECKER(batch_sequence_checker_);
+
+  // Shared memory ring used instead of the output file when it exists, which
+  // is when the metrics uploader of metrics_daemon collects the samples.
+  bool use_sample_ring_ = true;
+  std::unique_ptr<metrics::SampleRing> sample_ring_;
+  // Last time the ring was looked for, to look for it again only after a
+  // while if it was missing.
+  base::TimeTicks sample_ring_open_time_;
+
   DISALLOW_COPY_AND_ASSIGN(MetricsLibrary);
 };
 
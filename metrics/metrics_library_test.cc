@@ -5,9 +5,14 @@
 #include <unistd.h>
 
 #include <cstring>
+#include <string>
 #include <utility>
+#include <vector>
 
 #include <base/files/file_util.h>
+#include <base/message_loop/message_loop.h>
+#include <base/run_loop.h>
+#include <base/time/time.h>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 #include <policy/libpolicy.h>
@@ -15,6 +20,8 @@
 
 #include "metrics/c_metrics_library.h"
 #include "metrics/metrics_library.h"
+#include "metrics/serialization/metric_sample.h"
+#include "metrics/serialization/serialization_utils.h"
 
 using base::FilePath;
 using ::testing::_;
@@ -65,6 +72,15 @@ class MetricsLibraryTest : public testing::Test {
   void VerifyEnabledCacheHit(bool to_value);
   void VerifyEnabledCacheEviction(bool to_value);
 
+  // Reads and removes the samples written to the UMA events file.
+  std::vector<metrics::MetricSample> ReadSamples() {
+    std::vector<metrics::MetricSample> samples;
+    metrics::SerializationUtils::ReadAndTruncateMetricsFromFile(
+        kTestUMAEventsFile.value(), &samples,
+        metrics::SerializationUtils::kSampleBatchMaxLength);
+    return samples;
+  }
+
   MetricsLibrary lib_;
   policy::MockDevicePolicy* device_policy_;  // Not owned.
 };
@@ -210,6 +226,100 @@ TEST_F(MetricsLibraryTest, AreMetricsEnabledCaching) {
   VerifyEnabledCacheEviction(true);
 }
 
+TEST_F(MetricsLibraryTest, BatchedSamplesWrittenOnFlush) {
+  lib_.EnableBatching(1024 * 1024, base::TimeDelta::FromHours(1));
+  EXPECT_TRUE(lib_.SendToUMA("Test.Histogram", 5, 1, 100, 50));
+  EXPECT_TRUE(lib_.SendEnumToUMA("Test.Enum", 2, 10));
+  EXPECT_TRUE(lib_.SendUserActionToUMA("TestAction"));
+  EXPECT_TRUE(ReadSamples().empty());
+
+  EXPECT_TRUE(lib_.Flush());
+  std::vector<metrics::MetricSample> samples = ReadSamples();
+  ASSERT_EQ(3u, samples.size());
+  EXPECT_TRUE(samples[0].IsEqual(
+      metrics::MetricSample::HistogramSample("Test.Histogram", 5, 1, 100, 50)));
+  EXPECT_TRUE(samples[1].IsEqual(
+      metrics::MetricSample::LinearHistogramSample("Test.Enum", 2, 10)));
+  EXPECT_TRUE(samples[2].IsEqual(
+      metrics::MetricSample::UserActionSample("TestAction")));
+
+  // Nothing is left to write.
+  EXPECT_TRUE(lib_.Flush());
+  EXPECT_TRUE(ReadSamples().empty());
+}
+
+TEST_F(MetricsLibraryTest, BatchedSamplesWrittenWhenFull) {
+  std::string serialized;
+  ASSERT_TRUE(metrics::SerializationUtils::SerializeSample(
+      metrics::MetricSample::SparseHistogramSample("Test.Sparse", 1),
+      &serialized));
+  // Fits two samples.
+  lib_.EnableBatching(serialized.size() * 2, base::TimeDelta::FromHours(1));
+
+  EXPECT_TRUE(lib_.SendSparseToUMA("Test.Sparse", 1));
+  EXPECT_TRUE(ReadSamples().empty());
+  EXPECT_TRUE(lib_.SendSparseToUMA("Test.Sparse", 2));
+  EXPECT_EQ(2u, ReadSamples().size());
+  EXPECT_TRUE(lib_.SendSparseToUMA("Test.Sparse", 3));
+  EXPECT_TRUE(ReadSamples().empty());
+}
+
+TEST_F(MetricsLibraryTest, BatchedSamplesWrittenWhenOld) {
+  lib_.EnableBatching(1024 * 1024, base::TimeDelta());
+  EXPECT_TRUE(lib_.SendBoolToUMA("Test.Bool", true));
+  EXPECT_EQ(1u, ReadSamples().size());
+}
+
+TEST_F(MetricsLibraryTest, BatchedSamplesWrittenOnDestruction) {
+  {
+    MetricsLibrary lib;
+    lib.SetOutputFile(kTestUMAEventsFile.value());
+    lib.EnableBatching(1024 * 1024, base::TimeDelta::FromHours(1));
+    EXPECT_TRUE(lib.SendCrashToUMA("kernel"));
+    EXPECT_TRUE(ReadSamples().empty());
+  }
+  EXPECT_EQ(1u, ReadSamples().size());
+}
+
+TEST_F(MetricsLibraryTest, InvalidSampleNotBatched) {
+  lib_.EnableBatching(1024 * 1024, base::TimeDelta::FromHours(1));
+  EXPECT_FALSE(lib_.SendSparseToUMA("no space", 1));
+  EXPECT_TRUE(lib_.SendSparseToUMA("Test.Sparse", 1));
+  EXPECT_TRUE(lib_.Flush());
+  EXPECT_EQ(1u, ReadSamples().size());
+}
+
+TEST_F(MetricsLibraryTest, BatchedSamplesWrittenByTimer) {
+  base::MessageLoop message_loop;
+  lib_.EnableBatching(1024 * 1024, base::TimeDelta::FromMilliseconds(1));
+  EXPECT_TRUE(lib_.SendBoolToUMA("Test.Bool", true));
+  EXPECT_TRUE(lib_.SendBoolToUMA("Test.Bool", false));
+  EXPECT_TRUE(ReadSamples().empty());
+
+  // No further sample is sent, the timer writes the buffered ones.
+  base::RunLoop run_loop;
+  message_loop.task_runner()->PostDelayedTask(
+      FROM_HERE, run_loop.QuitClosure(), base::TimeDelta::FromMilliseconds(50));
+  run_loop.Run();
+  EXPECT_EQ(2u, ReadSamples().size());
+}
+
+// A burst spanning several full buffers is written completely and in order.
+TEST_F(MetricsLibraryTest, BatchedBurstKeepsOrder) {
+  const int kNumSamples = 5000;
+  lib_.EnableBatching(4 * 1024, base::TimeDelta::FromHours(1));
+  for (int i = 0; i < kNumSamples; i++) {
+    ASSERT_TRUE(lib_.SendSparseToUMA("Test.Sparse", i));
+  }
+  ASSERT_TRUE(lib_.Flush());
+
+  std::vector<metrics::MetricSample> samples = ReadSamples();
+  ASSERT_EQ(static_cast<size_t>(kNumSamples), samples.size());
+  for (int i = 0; i < kNumSamples; i++) {
+    EXPECT_EQ(i, samples[i].sample());
+  }
+}
+
 class CMetricsLibraryTest : public testing::Test {
  protected:
   void SetUp() override {
@@ -4,9 +4,11 @@
 
 #include "metrics/process_meter.h"
 
-#include <pcrecpp.h>
+#include <atomic>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
 #include <base/command_line.h>
@@ -18,12 +20,57 @@
 #include <base/strings/string_split.h>
 #include <base/strings/string_util.h>
 #include <base/strings/stringprintf.h>
+#include <base/threading/simple_thread.h>
 #include <gtest/gtest_prod.h>  // for FRIEND_TEST
 
 #include "metrics/metrics_library.h"
 
 namespace chromeos_metrics {
 
+namespace {
+
+// Set in the flags of kernel threads.  From include/linux/sched.h.
+constexpr uint64_t kPFKthread = 0x00200000;
+
+// Runs |function| on indices handed out to the threads of a pool.
+template <typename Function>
+class ParallelForDelegate : public base::DelegateSimpleThread::Delegate {
+ public:
+  ParallelForDelegate(size_t count, const Function& function)
+      : count_(count), function_(function) {}
+
+  void Run() override {
+    for (size_t i = next_++; i < count_; i = next_++)
+      function_(i);
+  }
+
+ private:
+  const size_t count_;
+  const Function& function_;
+  std::atomic<size_t> next_{0};
+
+  DISALLOW_COPY_AND_ASSIGN(ParallelForDelegate);
+};
+
+// Calls |function| with every index in [0, |count|), using up to
+// |num_threads| threads.  Reading /proc mostly waits on the kernel walking
+// process data, so this scales with the number of cores.
+template <typename Function>
+void ParallelFor(size_t count, int num_threads, const Function& function) {
+  if (num_threads <= 1 || count <= 1) {
+    for (size_t i = 0; i < count; i++)
+      function(i);
+    return;
+  }
+  ParallelForDelegate<Function> delegate(count, function);
+  base::DelegateSimpleThreadPool pool("process_meter", num_threads);
+  pool.AddWork(&delegate, num_threads);
+  pool.Start();
+  pool.JoinAll();
+}
+
+}  // namespace
+
 // UMA histogram names for process memory usage, split by process groups and
 // types of memory.  They must match MemoryStatKind and ProcessGroupKind in
 // process_meter.h.  C++ doesn't have C-style static array initializers, so the
@@ -170,6 +217,9 @@ const void ProcessNode::CollectSubtree(std::vector<ProcessNode*>* processes) {
 }
 
 void ProcessInfo::Classify() {
+  for (auto& group : groups_)
+    group.clear();
+
   // Find all ARC processes starting from ARC init.
   int arc_init_pid;
   if (GetARCInitPID(run_root_, &arc_init_pid)) {
@@ -263,11 +313,37 @@ bool ProcessNode::RetrieveProcessData(const base::FilePath& procfs_root) {
     // Assume process has exited.
     return false;
   }
-  // stat: pid (comm) run_state ppid etc. The only parentheses in the file
-  // are around <comm>.
-  pcrecpp::RE re(R"(.*\((.*)\) \w+ (\d+)(.|\n)*)");
-  if (!re.FullMatch(file_content, &name_, &ppid_))
+  // stat: pid (comm) run_state ppid etc.  <comm> may contain spaces and
+  // parentheses, but the fields after it do not.
+  size_t comm_start = file_content.find('(');
+  size_t comm_end = file_content.rfind(')');
+  if (comm_start == std::string::npos || comm_end == std::string::npos ||
+      comm_end < comm_start)
+    LOG(FATAL) << "cannot parse /proc/pid/stat: " << file_content;
+  std::string name =
+      file_content.substr(comm_start + 1, comm_end - comm_start - 1);
+  // Fields from run_state, which is field 3 in proc(5).
+  const std::vector<base::StringPiece> fields = base::SplitStringPiece(
+      base::StringPiece(file_content).substr(comm_end + 1), " ",
+      base::TRIM_WHITESPACE, base::SPLIT_WANT_NONEMPTY);
+  if (fields.size() < 2 || !base::StringToInt(fields[1], &ppid_))
     LOG(FATAL) << "cannot parse /proc/pid/stat: " << file_content;
+  flags_ = 0;
+  if (fields.size() > 6)
+    base::StringToUint64(fields[6], &flags_);
+  uint64_t start_time = 0;
+  if (fields.size() > 19)
+    base::StringToUint64(fields[19], &start_time);
+
+  // The command line is replaced when the process execs, which also changes
+  // its name.  A process overwriting its own argv in place is not noticed.
+  const bool same_image =
+      has_cmdline_ && start_time == start_time_ && name == name_;
+  name_ = std::move(name);
+  if (same_image) {
+    return true;
+  }
+  start_time_ = start_time;
 
   // Get command line from /proc/#/cmdline and parse it.
   const std::string cmdline_name = base::StringPrintf("%d/cmdline", pid_);
@@ -279,10 +355,23 @@ bool ProcessNode::RetrieveProcessData(const base::FilePath& procfs_root) {
   cmdline_string_ = file_content;
   cmdline_ = base::CommandLine(base::SplitString(
       file_content, " ", base::TRIM_WHITESPACE, base::SPLIT_WANT_NONEMPTY));
+  has_cmdline_ = true;
 
   return true;
 }
 
+void ProcessNode::RetrieveMemoryStats(const base::FilePath& procfs_root) {
+  memory_stats_ = ProcessMemoryStats();
+  if (flags_ & kPFKthread)
+    return;
+  GetMemoryUsage(procfs_root, pid_, &memory_stats_);
+}
+
+void ProcessNode::ClearLinks() {
+  parent_ = nullptr;
+  children_.clear();
+}
+
 void ProcessNode::LinkToParent(
     const std::unordered_map<int, std::unique_ptr<ProcessNode>>& processes) {
   if (ppid_ == 0) {
@@ -304,7 +393,13 @@ void ProcessNode::LinkToParent(
 }
 
 void ProcessInfo::Collect() {
-  // Collect all processes.
+  // The groups point to nodes which may be deleted below.
+  for (auto& group : groups_)
+    group.clear();
+
+  // Collect all processes.  Nodes from a previous collection are kept, so that
+  // their command line is not read again.
+  std::unordered_set<int> pids;
   base::FileEnumerator proc_enum(procfs_root_, false,
                                  base::FileEnumerator::DIRECTORIES);
   for (base::FilePath path = proc_enum.Next(); !path.empty();
@@ -314,11 +409,20 @@ void ProcessInfo::Collect() {
     int pid;
     if (!base::StringToInt(pid_string, &pid))
       continue;
-    if (process_map_.find(pid) == process_map_.end()) {
-      process_map_.emplace(pid, std::make_unique<ProcessNode>(pid));
-    } else {
+    if (!pids.insert(pid).second) {
       // This seems rather unlikely, but just in case.
       LOG(WARNING) << "duplicate PID: " << pid;
+      continue;
+    }
+    if (process_map_.find(pid) == process_map_.end())
+      process_map_.emplace(pid, std::make_unique<ProcessNode>(pid));
+  }
+  for (auto pit = process_map_.begin(); pit != process_map_.end();) {
+    if (pids.find(pit->first) == pids.end()) {
+      pit = process_map_.erase(pit);
+    } else {
+      pit->second->ClearLinks();
+      ++pit;
     }
   }
 
@@ -326,15 +430,44 @@ void ProcessInfo::Collect() {
   if (process_map_.find(1) == process_map_.end())
     LOG(FATAL) << "cannot find init process";
 
+  // Read /proc for all processes in parallel.  Each call only touches its own
+  // node.
+  std::vector<ProcessNode*> processes;
+  processes.reserve(process_map_.size());
+  for (const auto& pit : process_map_)
+    processes.push_back(pit.second.get());
+  std::vector<char> retrieved(processes.size());
+  ParallelFor(processes.size(), num_threads_, [&](size_t i) {
+    retrieved[i] = processes[i]->RetrieveProcessData(procfs_root_);
+  });
+
   // Construct process tree.
-  for (const auto& pit : process_map_) {
-    ProcessNode* process = pit.second.get();
-    if (!process->RetrieveProcessData(procfs_root_)) {
+  for (size_t i = 0; i < processes.size(); i++) {
+    if (!retrieved[i]) {
       // Process went away, so ignore it.
       continue;
     }
     // Set up parent/children links.
-    process->LinkToParent(process_map_);
+    processes[i]->LinkToParent(process_map_);
+  }
+}
+
+void ProcessInfo::CollectMemoryStats() {
+  std::vector<ProcessNode*> processes;
+  processes.reserve(process_map_.size());
+  for (const auto& pit : process_map_)
+    processes.push_back(pit.second.get());
+  ParallelFor(processes.size(), num_threads_, [&](size_t i) {
+    processes[i]->RetrieveMemoryStats(procfs_root_);
+  });
+}
+
+void ProcessInfo::GetGroupMemoryStats(ProcessGroupKind group_kind,
+                                      ProcessMemoryStats* stats) {
+  for (const auto& process : groups_[group_kind]) {
+    for (int i = 0; i < MEM_KINDS_COUNT; i++) {
+      stats->rss_sizes[i] += process->GetMemoryStats().rss_sizes[i];
+    }
   }
 }
 
@@ -80,9 +80,20 @@ class ProcessNode {
   // Adds to |processes| this node and all its descendants.
   const void CollectSubtree(std::vector<ProcessNode*>* processes);
 
-  // Fills the process node with data from /proc.
+  // Fills the process node with data from /proc.  The command line is only
+  // read the first time, or when the PID has been reused by another process.
   bool RetrieveProcessData(const base::FilePath& procfs_root);
 
+  // Reads the memory usage of the process from /proc.  Kernel threads have no
+  // memory of their own and are skipped.
+  void RetrieveMemoryStats(const base::FilePath& procfs_root);
+
+  // Returns the memory usage read by RetrieveMemoryStats().
+  const ProcessMemoryStats& GetMemoryStats() const { return memory_stats_; }
+
+  // Removes the links to the parent and children, before rebuilding the tree.
+  void ClearLinks();
+
   // Links this process node to its parent based on the node PID,
   // and adds the node to the parent's children list.
   void LinkToParent(
@@ -97,9 +108,17 @@ class ProcessNode {
  private:
   const int pid_;
   int ppid_ = 0;
+  // Flags and start time from /proc/<pid>/stat.  The start time tells apart
+  // processes that had the same PID.
+  uint64_t flags_ = 0;
+  uint64_t start_time_ = 0;
   std::string name_;
+  // Whether |cmdline_| has been read, for the process started at
+  // |start_time_| and running the program named |name_|.
+  bool has_cmdline_ = false;
   base::CommandLine cmdline_;
   std::string cmdline_string_;
+  ProcessMemoryStats memory_stats_;
   // All ProcessNode instances are owned by process_map_ in ProcessInfo.
   ProcessNode* parent_ = nullptr;
   std::vector<ProcessNode*> children_;
@@ -117,22 +136,35 @@ bool FindProcessWithPrefix(
     const std::unordered_map<int, std::unique_ptr<ProcessNode>>& processes,
     ProcessNode** process);
 
-// Class for collecting information about all processes.
+// Class for collecting information about all processes.  An instance can be
+// kept to collect repeatedly, in which case data that does not change during
+// the life of a process is only read once.
 class ProcessInfo {
  public:
   ProcessInfo(const base::FilePath& procfs_root, const base::FilePath& run_root)
       : procfs_root_(procfs_root), run_root_(run_root) {}
   ~ProcessInfo() {}
 
+  // Sets the number of threads used to read /proc.
+  void SetNumThreads(int num_threads) { num_threads_ = num_threads; }
+
   // Takes a snapshot of existing processes and builds the process tree.
   void Collect();
 
   // Classifies processes in process_map_ into groups.
   void Classify();
 
+  // Reads the memory usage of all processes collected by Collect().
+  void CollectMemoryStats();
+
   // Returns process group |g| (for instance, g = PG_RENDERERS).
   const std::vector<ProcessNode*>& GetGroup(ProcessGroupKind group_kind);
 
+  // Adds up in |stats| the memory usage of process group |group_kind|, as read
+  // by CollectMemoryStats().
+  void GetGroupMemoryStats(ProcessGroupKind group_kind,
+                           ProcessMemoryStats* stats);
+
  private:
   // Maps PIDs to nodes in the process tree.  This is the owner of all process
   // nodes.
@@ -144,6 +176,8 @@ class ProcessInfo {
   base::FilePath procfs_root_;
   base::FilePath run_root_;
 
+  int num_threads_ = 1;
+
   DISALLOW_COPY_AND_ASSIGN(ProcessInfo);
 };
 
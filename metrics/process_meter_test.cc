@@ -4,7 +4,10 @@
 
 #include "metrics/process_meter.h"
 
+#include <inttypes.h>
+
 #include <memory>
+#include <string>
 
 #include <gtest/gtest.h>
 
@@ -148,6 +151,149 @@ TEST_F(ProcessMeterTest, ReportProcessStats) {
       EXPECT_EQ(stats.rss_sizes[j], expected_stats[i].rss_sizes[j]);
     }
   }
+
+  // Collect again with the same instance, reading in parallel.
+  info.SetNumThreads(4);
+  info.Collect();
+  info.Classify();
+  info.CollectMemoryStats();
+  for (int i = 0; i < PG_KINDS_COUNT; i++) {
+    ProcessMemoryStats stats;
+    info.GetGroupMemoryStats(static_cast<ProcessGroupKind>(i), &stats);
+    for (int j = 0; j < MEM_KINDS_COUNT; j++) {
+      EXPECT_EQ(stats.rss_sizes[j], expected_stats[i].rss_sizes[j]);
+    }
+  }
+}
+
+// Writes a /proc/<pid>/stat with all fields up to the start time.
+void CreateStat(const base::FilePath& procfs_path,
+                int pid,
+                int ppid,
+                const char* name,
+                uint64_t start_time) {
+  CreateFile(procfs_path.Append(base::StringPrintf("%d/stat", pid)),
+             base::StringPrintf("%d (%s) S %d %d %d 0 -1 4194560 100 0 0 0 "
+                                "1 2 0 0 20 0 1 0 %" PRIu64 " 1000 100\n",
+                                pid, name, ppid, pid, pid, start_time));
+}
+
+// Returns the command line of daemon |pid| as last collected by |info|.
+std::string GetDaemonCmdline(ProcessInfo* info, int pid) {
+  for (const auto& process : info->GetGroup(PG_DAEMONS)) {
+    if (process->GetPID() == pid)
+      return process->GetCmdlineString();
+  }
+  ADD_FAILURE() << "no daemon with PID " << pid;
+  return "";
+}
+
+// Test that command lines are only read again when a PID is reused or the
+// process runs another program.
+TEST_F(ProcessMeterTest, CmdlineCachedPerProcess) {
+  base::ScopedTempDir temp_dir;
+  ASSERT_TRUE(temp_dir.CreateUniqueTempDir());
+  base::FilePath run_path = temp_dir.GetPath().Append("run");
+  base::FilePath procfs_path = temp_dir.GetPath().Append("proc");
+  CHECK(CreateDirectory(procfs_path));
+  // clang-format off
+  CreateProcEntry(procfs_path, 1, 0, "init", "/sbin/init",
+                  10, 5, 5, 0, 7);
+  CreateProcEntry(procfs_path, 200, 1, "shill", "/usr/bin/shill",
+                  100, 30, 70, 0, 0);
+  // clang-format on
+  CreateStat(procfs_path, 200, 1, "shill", 1000);
+
+  ProcessInfo info(procfs_path, run_path);
+  info.Collect();
+  info.Classify();
+  EXPECT_EQ("/usr/bin/shill", GetDaemonCmdline(&info, 200));
+
+  // Same process: the command line is not read again.
+  const base::FilePath cmdline_path = procfs_path.Append("200/cmdline");
+  CreateFile(cmdline_path, "/usr/bin/powerd");
+  info.Collect();
+  info.Classify();
+  EXPECT_EQ("/usr/bin/shill", GetDaemonCmdline(&info, 200));
+
+  // The PID is reused by a process started later.
+  CreateStat(procfs_path, 200, 1, "powerd", 2000);
+  info.Collect();
+  info.Classify();
+  EXPECT_EQ("/usr/bin/powerd", GetDaemonCmdline(&info, 200));
+
+  // The process execs another program, which keeps its start time.
+  CreateFile(cmdline_path, "/usr/bin/debugd");
+  CreateStat(procfs_path, 200, 1, "debugd", 2000);
+  info.Collect();
+  info.Classify();
+  EXPECT_EQ("/usr/bin/debugd", GetDaemonCmdline(&info, 200));
+
+  // The process exits.
+  ASSERT_TRUE(base::DeleteFile(procfs_path.Append("200"), true));
+  info.Collect();
+  info.Classify();
+  EXPECT_EQ(1u, info.GetGroup(PG_DAEMONS).size());
+}
+
+// Test that collecting again from a kept ProcessInfo, with the memory stats
+// read in parallel, gives the same result as collecting from scratch.
+TEST_F(ProcessMeterTest, IncrementalCollectMatchesFromScratch) {
+  const int kNumProcesses = 50;
+  base::ScopedTempDir temp_dir;
+  ASSERT_TRUE(temp_dir.CreateUniqueTempDir());
+  base::FilePath run_path = temp_dir.GetPath().Append("run");
+  base::FilePath procfs_path = temp_dir.GetPath().Append("proc");
+  CHECK(CreateDirectory(procfs_path));
+  CreateProcEntry(procfs_path, 1, 0, "init", "/sbin/init", 10, 5, 5, 0, 7);
+  CreateProcEntry(procfs_path, 100, 1, "chrome",
+                  "/opt/google/chrome/chrome blah", 300, 200, 90, 10, 2);
+  for (int pid = 1000; pid < 1000 + kNumProcesses; pid++) {
+    CreateProcEntry(procfs_path, pid, 100, "chrome",
+                    "/opt/google/chrome/chrome --type=renderer", 100, 80, 10,
+                    10, 1);
+    CreateStat(procfs_path, pid, 100, "chrome", pid);
+  }
+
+  ProcessInfo info(procfs_path, run_path);
+  info.SetNumThreads(4);
+  info.Collect();
+
+  // Some renderers exit and others start before the next collection.
+  for (int pid = 1000; pid < 1010; pid++) {
+    ASSERT_TRUE(base::DeleteFile(
+        procfs_path.Append(base::StringPrintf("%d", pid)), true));
+  }
+  for (int pid = 2000; pid < 2005; pid++) {
+    CreateProcEntry(procfs_path, pid, 100, "chrome",
+                    "/opt/google/chrome/chrome --type=renderer", 50, 40, 5, 5,
+                    0);
+    CreateStat(procfs_path, pid, 100, "chrome", pid);
+  }
+  info.Collect();
+  info.Classify();
+  info.CollectMemoryStats();
+
+  ProcessInfo scratch_info(procfs_path, run_path);
+  scratch_info.Collect();
+  scratch_info.Classify();
+
+  for (int i = 0; i < PG_KINDS_COUNT; i++) {
+    const ProcessGroupKind group = static_cast<ProcessGroupKind>(i);
+    EXPECT_EQ(scratch_info.GetGroup(group).size(), info.GetGroup(group).size());
+    ProcessMemoryStats expected;
+    AccumulateProcessGroupStats(procfs_path, scratch_info.GetGroup(group),
+                                &expected);
+    ProcessMemoryStats stats;
+    info.GetGroupMemoryStats(group, &stats);
+    for (int j = 0; j < MEM_KINDS_COUNT; j++)
+      EXPECT_EQ(expected.rss_sizes[j], stats.rss_sizes[j]);
+  }
+
+  ProcessMemoryStats stats;
+  info.GetGroupMemoryStats(PG_RENDERERS, &stats);
+  EXPECT_EQ(((kNumProcesses - 10) * 100ULL + 5 * 50ULL) * (1 << 20),
+            stats.rss_sizes[MEM_TOTAL]);
 }
 
 void CheckPG(int pg, const char* field) {
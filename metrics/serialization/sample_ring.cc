@@ -0,0 +1,315 @@
+// Copyright 2020 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "metrics/serialization/sample_ring.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#include "base/files/scoped_file.h"
+#include "base/logging.h"
+#include "base/posix/eintr_wrapper.h"
+#include "metrics/serialization/metric_sample.h"
+#include "metrics/serialization/serialization_utils.h"
+
+namespace metrics {
+namespace {
+
+constexpr uint32_t kMagic = 0x474e5253;  // "SRNG"
+
+// Set in the first word of a record once its writer has copied it in. The
+// other bits hold the number of times the ring wrapped around before the
+// record, modulo 128, and the length of the record content.
+constexpr uint32_t kCommittedFlag = 0x80000000;
+constexpr int kLapShift = 24;
+constexpr uint32_t kLapMask = 0x7f;
+constexpr uint32_t kLengthMask = (1u << kLapShift) - 1;
+
+constexpr uint32_t kWordSize = sizeof(base::subtle::Atomic32);
+
+// Records are made of a word followed by their content, padded to a word
+// boundary so that the first word of a record never wraps around.
+uint32_t RecordSize(uint32_t content_length) {
+  return kWordSize + (content_length + kWordSize - 1) / kWordSize * kWordSize;
+}
+
+// The length of the record content is limited to a quarter of the capacity,
+// which keeps it within kLengthMask.
+uint32_t MaxContentLength(uint32_t capacity) {
+  return capacity / 4;
+}
+
+// Parses the samples serialized in |content| and adds the valid ones to
+// |samples|.
+void ParseRecord(const std::string& content,
+                 std::vector<MetricSample>* samples) {
+  size_t offset = 0;
+  while (offset < content.size()) {
+    int32_t size;
+    if (content.size() - offset < sizeof(size)) {
+      LOG(ERROR) << "truncated sample in metrics ring";
+      return;
+    }
+    memcpy(&size, content.data() + offset, sizeof(size));
+    if (size < static_cast<int32_t>(sizeof(size)) ||
+        static_cast<size_t>(size) > SerializationUtils::kMessageMaxLength ||
+        static_cast<size_t>(size) > content.size() - offset) {
+      LOG(ERROR) << "bad sample length in metrics ring: " << size;
+      return;
+    }
+    MetricSample sample = SerializationUtils::ParseSample(
+        content.substr(offset + sizeof(size), size - sizeof(size)));
+    if (sample.IsValid())
+      samples->push_back(std::move(sample));
+    offset += size;
+  }
+}
+
+}  // namespace
+
+struct SampleRing::Header {
+  // Set to kMagic once the ring is initialized.
+  base::subtle::Atomic32 magic;
+  uint32_t capacity;
+  // Total number of bytes reserved by writers and consumed by the reader,
+  // modulo 2^32. The ring holds the bytes in [consumed, reserved).
+  base::subtle::Atomic32 reserved;
+  base::subtle::Atomic32 consumed;
+};
+
+// static
+std::unique_ptr<SampleRing> SampleRing::Open(const base::FilePath& path) {
+  base::ScopedFD fd(HANDLE_EINTR(
+      open(path.value().c_str(), O_RDWR | O_CLOEXEC | O_NOFOLLOW)));
+  if (!fd.is_valid())
+    return nullptr;
+
+  struct stat stat_buf;
+  if (fstat(fd.get(), &stat_buf) < 0 ||
+      stat_buf.st_size <= static_cast<off_t>(sizeof(Header))) {
+    return nullptr;
+  }
+  size_t mapping_size = stat_buf.st_size;
+  void* mapping = mmap(nullptr, mapping_size, PROT_READ | PROT_WRITE,
+                       MAP_SHARED, fd.get(), 0);
+  if (mapping == MAP_FAILED) {
+    PLOG(ERROR) << path.value() << ": cannot map";
+    return nullptr;
+  }
+
+  // Pairs with the release store in Create(), after which the rest of the
+  // header is initialized.
+  const Header* header = static_cast<const Header*>(mapping);
+  const uint32_t capacity = header->capacity;
+  if (base::subtle::Acquire_Load(&header->magic) !=
+          static_cast<base::subtle::Atomic32>(kMagic) ||
+      capacity != mapping_size - sizeof(Header) || capacity < kWordSize ||
+      capacity > kMaxCapacity || (capacity & (capacity - 1)) != 0) {
+    // Not initialized yet, or not a ring.
+    munmap(mapping, mapping_size);
+    return nullptr;
+  }
+  return std::unique_ptr<SampleRing>(new SampleRing(mapping, mapping_size));
+}
+
+// static
+std::unique_ptr<SampleRing> SampleRing::Create(const base::FilePath& path,
+                                               uint32_t capacity) {
+  CHECK_GE(capacity, kWordSize);
+  CHECK_LE(capacity, kMaxCapacity);
+  CHECK_EQ(capacity & (capacity - 1), 0u) << "capacity must be a power of 2";
+
+  std::unique_ptr<SampleRing> ring = Open(path);
+  if (ring) {
+    // Keep the records written while the reader was away.
+    return ring;
+  }
+
+  base::ScopedFD fd(HANDLE_EINTR(open(path.value().c_str(),
+                                      O_RDWR | O_CREAT | O_CLOEXEC | O_NOFOLLOW,
+                                      0666)));
+  if (!fd.is_valid()) {
+    PLOG(ERROR) << path.value() << ": cannot open";
+    return nullptr;
+  }
+  // Every process sending metrics writes to the ring. Do not let the umask
+  // restrict that.
+  if (fchmod(fd.get(), 0666) < 0) {
+    PLOG(ERROR) << path.value() << ": cannot change mode";
+    return nullptr;
+  }
+  size_t mapping_size = sizeof(Header) + capacity;
+  // Truncating to zero first drops any stale content, which reads back as
+  // zeros once the file is extended.
+  if (ftruncate(fd.get(), 0) < 0 || ftruncate(fd.get(), mapping_size) < 0) {
+    PLOG(ERROR) << path.value() << ": cannot resize";
+    return nullptr;
+  }
+  void* mapping = mmap(nullptr, mapping_size, PROT_READ | PROT_WRITE,
+                       MAP_SHARED, fd.get(), 0);
+  if (mapping == MAP_FAILED) {
+    PLOG(ERROR) << path.value() << ": cannot map";
+    return nullptr;
+  }
+
+  ring.reset(new SampleRing(mapping, mapping_size));
+  ring->header_->capacity = capacity;
+  // Publish the ring to writers only once it is fully initialized.
+  base::subtle::Release_Store(&ring->header_->magic,
+                              static_cast<base::subtle::Atomic32>(kMagic));
+  return ring;
+}
+
+SampleRing::SampleRing(void* mapping, size_t mapping_size)
+    : mapping_(mapping),
+      mapping_size_(mapping_size),
+      header_(static_cast<Header*>(mapping)),
+      data_(static_cast<char*>(mapping) + sizeof(Header)),
+      // Validated against the header by Open(), or written to it by Create().
+      // The header itself can change under us.
+      capacity_(mapping_size - sizeof(Header)),
+      stalled_position_(0),
+      stalled_(false) {}
+
+SampleRing::~SampleRing() {
+  if (munmap(mapping_, mapping_size_) < 0)
+    PLOG(ERROR) << "cannot unmap metrics ring";
+}
+
+bool SampleRing::Append(const std::string& serialized) {
+  if (serialized.empty() || serialized.size() > MaxContentLength(capacity_))
+    return false;
+  uint32_t length = serialized.size();
+  uint32_t size = RecordSize(length);
+
+  // Reserve room for the record.
+  uint32_t start;
+  while (true) {
+    start = base::subtle::NoBarrier_Load(&header_->reserved);
+    // Pairs with the release store of the reader, after which the consumed
+    // bytes read as zeros.
+    uint32_t consumed = base::subtle::Acquire_Load(&header_->consumed);
+    // Every process sending metrics can write to the header. Do not let a
+    // corrupted one make us write outside of the data area.
+    if (start % kWordSize != 0 || start - consumed > capacity_ - size)
+      return false;
+    if (static_cast<uint32_t>(base::subtle::NoBarrier_CompareAndSwap(
+            &header_->reserved, start, start + size)) == start) {
+      break;
+    }
+  }
+
+  CopyIn(start + kWordSize, serialized.data(), length);
+  base::subtle::Release_Store(WordAt(start), CommittedWord(start, length));
+  return true;
+}
+
+bool SampleRing::Drain(std::vector<MetricSample>* samples,
+                       size_t max_length) {
+  uint32_t consumed = base::subtle::NoBarrier_Load(&header_->consumed);
+  uint32_t reserved = base::subtle::Acquire_Load(&header_->reserved);
+  // The ring is shared with every process sending metrics, so nothing read
+  // from it is trusted to stay within the data area.
+  if (reserved - consumed > capacity_ || consumed % kWordSize != 0 ||
+      reserved % kWordSize != 0) {
+    LOG(ERROR) << "resetting corrupted metrics ring";
+    Reset(reserved);
+    return true;
+  }
+  size_t total_length = 0;
+
+  while (consumed != reserved) {
+    uint32_t word = base::subtle::Acquire_Load(WordAt(consumed));
+    uint32_t length = word & kLengthMask;
+    // A record is committed only if its first word was written for this lap
+    // around the ring.
+    const bool committed = word == CommittedWord(consumed, length);
+    if (!committed || length > MaxContentLength(capacity_) ||
+        RecordSize(length) > reserved - consumed) {
+      if (!committed && (!stalled_ || stalled_position_ != consumed)) {
+        // The writer is most likely still copying the record in.
+        stalled_ = true;
+        stalled_position_ = consumed;
+        return true;
+      }
+      // The writer died before committing the record, or the ring is
+      // corrupted. The records after it cannot be found, so drop everything.
+      LOG(WARNING) << "dropping " << reserved - consumed
+                   << " bytes of metrics ring after a bad record";
+      Clear(consumed, reserved - consumed);
+      base::subtle::Release_Store(&header_->consumed, reserved);
+      stalled_ = false;
+      return true;
+    }
+    stalled_ = false;
+
+    std::string content(length, '\0');
+    CopyOut(consumed + kWordSize, &content[0], length);
+    ParseRecord(content, samples);
+
+    uint32_t size = RecordSize(length);
+    Clear(consumed, size);
+    consumed += size;
+    base::subtle::Release_Store(&header_->consumed, consumed);
+
+    total_length += size;
+    if (total_length > max_length)
+      return consumed == static_cast<uint32_t>(
+                             base::subtle::Acquire_Load(&header_->reserved));
+  }
+  return true;
+}
+
+base::subtle::Atomic32* SampleRing::WordAt(uint32_t position) {
+  return reinterpret_cast<base::subtle::Atomic32*>(
+      data_ + (position & (capacity_ - 1)));
+}
+
+uint32_t SampleRing::CommittedWord(uint32_t position, uint32_t length) const {
+  const uint32_t lap = (position / capacity_) & kLapMask;
+  return kCommittedFlag | (lap << kLapShift) | length;
+}
+
+void SampleRing::Reset(uint32_t reserved) {
+  uint32_t aligned = (reserved + kWordSize - 1) / kWordSize * kWordSize;
+  if (aligned != reserved &&
+      static_cast<uint32_t>(base::subtle::NoBarrier_CompareAndSwap(
+          &header_->reserved, reserved, aligned)) != reserved) {
+    // A writer moved on meanwhile. Try again on the next Drain().
+    return;
+  }
+  memset(data_, 0, capacity_);
+  base::subtle::Release_Store(&header_->consumed, aligned);
+  stalled_ = false;
+}
+
+void SampleRing::CopyIn(uint32_t position,
+                        const char* data,
+                        uint32_t length) {
+  uint32_t offset = position & (capacity_ - 1);
+  uint32_t first = std::min(length, capacity_ - offset);
+  memcpy(data_ + offset, data, first);
+  memcpy(data_, data + first, length - first);
+}
+
+void SampleRing::CopyOut(uint32_t position, char* data, uint32_t length) {
+  uint32_t offset = position & (capacity_ - 1);
+  uint32_t first = std::min(length, capacity_ - offset);
+  memcpy(data, data_ + offset, first);
+  memcpy(data + first, data_, length - first);
+}
+
+void SampleRing::Clear(uint32_t position, uint32_t length) {
+  uint32_t offset = position & (capacity_ - 1);
+  uint32_t first = std::min(length, capacity_ - offset);
+  memset(data_ + offset, 0, first);
+  memset(data_, 0, length - first);
+}
+
+}  // namespace metrics
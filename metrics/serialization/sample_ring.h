@@ -0,0 +1,107 @@
+// Copyright 2020 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef METRICS_SERIALIZATION_SAMPLE_RING_H_
+#define METRICS_SERIALIZATION_SAMPLE_RING_H_
+
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <base/atomicops.h>
+#include <base/files/file_path.h>
+#include <base/macros.h>
+
+namespace metrics {
+
+class MetricSample;
+
+// Default location of the ring, created by the uploader of metrics_daemon.
+constexpr char kSampleRingPath[] = "/run/metrics/uma-events-ring";
+
+// A ring buffer of serialized samples in a file mapped in memory by all the
+// processes sending metrics and by the one collecting them. Any number of
+// writers append records to it without taking a lock, and a single reader
+// drains it.
+//
+// This is an alternative to the events file written by
+// SerializationUtils::WriteMetricsToFile(), which writers and the reader have
+// to lock for every access. Writers fall back to the events file when the ring
+// does not exist or is full.
+class SampleRing {
+ public:
+  // Size of the data area of a ring, which must be a power of 2 no larger
+  // than kMaxCapacity.
+  static constexpr uint32_t kDefaultCapacity = 256 * 1024;
+  static constexpr uint32_t kMaxCapacity = 32 * 1024 * 1024;
+
+  // Maps the existing ring at |path| to append records to it. Returns nullptr
+  // if there is no valid ring at |path|.
+  static std::unique_ptr<SampleRing> Open(const base::FilePath& path);
+
+  // Maps the ring at |path| to drain it, creating it with a data area of
+  // |capacity| bytes if it does not exist or is not valid. There must be only
+  // one reader of a ring. Returns nullptr on errors.
+  static std::unique_ptr<SampleRing> Create(const base::FilePath& path,
+                                            uint32_t capacity);
+
+  ~SampleRing();
+
+  // Appends |serialized|, one or more samples serialized by
+  // SerializationUtils::SerializeSample(), as a single record. Returns false if
+  // there is not enough free space for it.
+  bool Append(const std::string& serialized);
+
+  // Removes records from the ring and adds the samples in them to |samples|.
+  // Stops after the records exceed |max_length| bytes. Returns false if there
+  // may be records left for further processing, true in all other cases.
+  bool Drain(std::vector<MetricSample>* samples, size_t max_length);
+
+ private:
+  struct Header;
+
+  SampleRing(void* mapping, size_t mapping_size);
+
+  // Returns the 32-bit word at |position| of the data area, modulo capacity.
+  base::subtle::Atomic32* WordAt(uint32_t position);
+
+  // Returns the first word of a committed record of |length| bytes starting
+  // at |position|. It holds the number of times the ring has wrapped around
+  // before |position|, so that a record committed after the reader gave up on
+  // it is not mistaken for one written later at the same offset.
+  uint32_t CommittedWord(uint32_t position, uint32_t length) const;
+
+  // Drops every record in the ring after finding it corrupted. |reserved| is
+  // the end of the last reserved record.
+  void Reset(uint32_t reserved);
+
+  // Copies between the data area and a buffer, wrapping around the end of the
+  // data area.
+  void CopyIn(uint32_t position, const char* data, uint32_t length);
+  void CopyOut(uint32_t position, char* data, uint32_t length);
+
+  // Zeroes |length| bytes of the data area from |position|, so that writers
+  // find records uncommitted until they commit them.
+  void Clear(uint32_t position, uint32_t length);
+
+  void* mapping_;
+  size_t mapping_size_;
+  Header* header_;
+  char* data_;
+  uint32_t capacity_;
+
+  // Position of an uncommitted record that stopped the last Drain(). If the
+  // writer of the record has not committed it by the next Drain(), it is
+  // considered dead and the record is skipped.
+  uint32_t stalled_position_;
+  bool stalled_;
+
+  DISALLOW_COPY_AND_ASSIGN(SampleRing);
+};
+
+}  // namespace metrics
+
+#endif  // METRICS_SERIALIZATION_SAMPLE_RING_H_
@@ -0,0 +1,264 @@
+// Copyright 2020 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "metrics/serialization/sample_ring.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <base/files/file.h>
+#include <base/files/file_path.h>
+#include <base/files/file_util.h>
+#include <base/files/scoped_temp_dir.h>
+#include <gtest/gtest.h>
+
+#include "metrics/serialization/metric_sample.h"
+#include "metrics/serialization/serialization_utils.h"
+
+namespace metrics {
+namespace {
+
+constexpr uint32_t kSmallCapacity = 1024;
+
+// Layout of the mapped file: the header, made of the magic, capacity, reserved
+// and consumed words, followed by the data area.
+constexpr int64_t kReservedOffset = 8;
+constexpr int64_t kConsumedOffset = 12;
+constexpr int64_t kDataOffset = 16;
+constexpr uint32_t kCommittedFlag = 0x80000000;
+
+std::string Serialize(const std::vector<MetricSample>& samples) {
+  std::string serialized;
+  for (const auto& sample : samples)
+    EXPECT_TRUE(SerializationUtils::SerializeSample(sample, &serialized));
+  return serialized;
+}
+
+class SampleRingTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    ASSERT_TRUE(temp_dir_.CreateUniqueTempDir());
+    path_ = temp_dir_.GetPath().Append("uma-events-ring");
+  }
+
+  // Writes to the ring as a buggy or hostile writer would, behind the back
+  // of SampleRing.
+  void WriteAt(int64_t offset, const std::string& data) {
+    base::File file(path_, base::File::FLAG_OPEN | base::File::FLAG_WRITE);
+    ASSERT_TRUE(file.IsValid());
+    ASSERT_EQ(static_cast<int>(data.size()),
+              file.Write(offset, data.data(), data.size()));
+  }
+
+  void WriteWordAt(int64_t offset, uint32_t word) {
+    WriteAt(offset, std::string(reinterpret_cast<const char*>(&word),
+                                sizeof(word)));
+  }
+
+  base::ScopedTempDir temp_dir_;
+  base::FilePath path_;
+};
+
+TEST_F(SampleRingTest, OpenFailsWithoutRing) {
+  EXPECT_FALSE(SampleRing::Open(path_));
+
+  // A file which is not a ring.
+  ASSERT_EQ(5, base::WriteFile(path_, "hello", 5));
+  EXPECT_FALSE(SampleRing::Open(path_));
+}
+
+TEST_F(SampleRingTest, AppendAndDrain) {
+  std::unique_ptr<SampleRing> reader =
+      SampleRing::Create(path_, kSmallCapacity);
+  ASSERT_TRUE(reader);
+  std::unique_ptr<SampleRing> writer = SampleRing::Open(path_);
+  ASSERT_TRUE(writer);
+
+  MetricSample crash = MetricSample::CrashSample("kernel");
+  MetricSample histogram =
+      MetricSample::HistogramSample("Test.Histogram", 5, 1, 100, 50);
+  MetricSample action = MetricSample::UserActionSample("TestAction");
+  EXPECT_TRUE(writer->Append(Serialize({crash})));
+  // Several samples can be appended as one record.
+  EXPECT_TRUE(writer->Append(Serialize({histogram, action})));
+
+  std::vector<MetricSample> samples;
+  EXPECT_TRUE(reader->Drain(&samples, SerializationUtils::kMessageMaxLength));
+  ASSERT_EQ(3u, samples.size());
+  EXPECT_TRUE(samples[0].IsEqual(crash));
+  EXPECT_TRUE(samples[1].IsEqual(histogram));
+  EXPECT_TRUE(samples[2].IsEqual(action));
+
+  samples.clear();
+  EXPECT_TRUE(reader->Drain(&samples, SerializationUtils::kMessageMaxLength));
+  EXPECT_TRUE(samples.empty());
+}
+
+TEST_F(SampleRingTest, FullRingRejectsAppend) {
+  std::unique_ptr<SampleRing> reader =
+      SampleRing::Create(path_, kSmallCapacity);
+  ASSERT_TRUE(reader);
+  std::unique_ptr<SampleRing> writer = SampleRing::Open(path_);
+  ASSERT_TRUE(writer);
+
+  std::string serialized =
+      Serialize({MetricSample::SparseHistogramSample("Test.Sparse", 1)});
+  size_t appended = 0;
+  while (writer->Append(serialized))
+    appended++;
+  EXPECT_GT(appended, 0u);
+  EXPECT_LT(appended * serialized.size(), kSmallCapacity);
+
+  std::vector<MetricSample> samples;
+  EXPECT_TRUE(reader->Drain(&samples, kSmallCapacity));
+  EXPECT_EQ(appended, samples.size());
+  EXPECT_TRUE(writer->Append(serialized));
+}
+
+TEST_F(SampleRingTest, TooLargeRecordRejected) {
+  std::unique_ptr<SampleRing> reader =
+      SampleRing::Create(path_, kSmallCapacity);
+  ASSERT_TRUE(reader);
+
+  std::vector<MetricSample> many(
+      20, MetricSample::SparseHistogramSample("Test.Sparse", 1));
+  EXPECT_FALSE(reader->Append(Serialize(many)));
+  EXPECT_FALSE(reader->Append(""));
+}
+
+TEST_F(SampleRingTest, RecordsWrapAround) {
+  std::unique_ptr<SampleRing> reader =
+      SampleRing::Create(path_, kSmallCapacity);
+  ASSERT_TRUE(reader);
+  std::unique_ptr<SampleRing> writer = SampleRing::Open(path_);
+  ASSERT_TRUE(writer);
+
+  // Goes around the ring many times, with records of varying length.
+  for (int i = 0; i < 200; i++) {
+    MetricSample sample = MetricSample::SparseHistogramSample(
+        "Test.Sparse" + std::string(i % 7, 'x'), i);
+    ASSERT_TRUE(writer->Append(Serialize({sample})));
+    std::vector<MetricSample> samples;
+    EXPECT_TRUE(reader->Drain(&samples, kSmallCapacity));
+    ASSERT_EQ(1u, samples.size());
+    EXPECT_TRUE(samples[0].IsEqual(sample));
+  }
+}
+
+TEST_F(SampleRingTest, DrainStopsAfterMaxLength) {
+  std::unique_ptr<SampleRing> reader =
+      SampleRing::Create(path_, kSmallCapacity);
+  ASSERT_TRUE(reader);
+
+  std::string serialized =
+      Serialize({MetricSample::SparseHistogramSample("Test.Sparse", 1)});
+  for (int i = 0; i < 3; i++)
+    ASSERT_TRUE(reader->Append(serialized));
+
+  std::vector<MetricSample> samples;
+  EXPECT_FALSE(reader->Drain(&samples, 1));
+  EXPECT_EQ(1u, samples.size());
+  EXPECT_TRUE(reader->Drain(&samples, kSmallCapacity));
+  EXPECT_EQ(3u, samples.size());
+}
+
+TEST_F(SampleRingTest, CreateKeepsExistingRecords) {
+  MetricSample crash = MetricSample::CrashSample("kernel");
+  {
+    std::unique_ptr<SampleRing> reader =
+        SampleRing::Create(path_, kSmallCapacity);
+    ASSERT_TRUE(reader);
+    ASSERT_TRUE(reader->Append(Serialize({crash})));
+  }
+
+  std::unique_ptr<SampleRing> reader =
+      SampleRing::Create(path_, kSmallCapacity);
+  ASSERT_TRUE(reader);
+  std::vector<MetricSample> samples;
+  EXPECT_TRUE(reader->Drain(&samples, kSmallCapacity));
+  ASSERT_EQ(1u, samples.size());
+  EXPECT_TRUE(samples[0].IsEqual(crash));
+}
+
+TEST_F(SampleRingTest, CorruptedPositionsResetRing) {
+  std::unique_ptr<SampleRing> reader =
+      SampleRing::Create(path_, kSmallCapacity);
+  ASSERT_TRUE(reader);
+  MetricSample crash = MetricSample::CrashSample("kernel");
+  ASSERT_TRUE(reader->Append(Serialize({crash})));
+
+  // More reserved bytes than the ring holds.
+  WriteWordAt(kReservedOffset, 4 * kSmallCapacity);
+  std::vector<MetricSample> samples;
+  EXPECT_TRUE(reader->Drain(&samples, kSmallCapacity));
+  EXPECT_TRUE(samples.empty());
+
+  // A position which is not word aligned.
+  WriteWordAt(kReservedOffset, 4 * kSmallCapacity + 2);
+  EXPECT_FALSE(reader->Append(Serialize({crash})));
+  EXPECT_TRUE(reader->Drain(&samples, kSmallCapacity));
+  EXPECT_TRUE(samples.empty());
+
+  // The ring works again once reset.
+  ASSERT_TRUE(reader->Append(Serialize({crash})));
+  EXPECT_TRUE(reader->Drain(&samples, kSmallCapacity));
+  ASSERT_EQ(1u, samples.size());
+  EXPECT_TRUE(samples[0].IsEqual(crash));
+}
+
+TEST_F(SampleRingTest, OversizedRecordDropped) {
+  std::unique_ptr<SampleRing> reader =
+      SampleRing::Create(path_, kSmallCapacity);
+  ASSERT_TRUE(reader);
+
+  // A committed record claiming more content than writers may append, and
+  // than the ring holds.
+  WriteWordAt(kDataOffset, kCommittedFlag | (kSmallCapacity * 2));
+  WriteWordAt(kReservedOffset, kSmallCapacity);
+  std::vector<MetricSample> samples;
+  EXPECT_TRUE(reader->Drain(&samples, kSmallCapacity));
+  EXPECT_TRUE(samples.empty());
+
+  MetricSample crash = MetricSample::CrashSample("kernel");
+  ASSERT_TRUE(reader->Append(Serialize({crash})));
+  EXPECT_TRUE(reader->Drain(&samples, kSmallCapacity));
+  ASSERT_EQ(1u, samples.size());
+}
+
+TEST_F(SampleRingTest, RecordCommittedAfterBeingDroppedIsIgnored) {
+  std::unique_ptr<SampleRing> reader =
+      SampleRing::Create(path_, kSmallCapacity);
+  ASSERT_TRUE(reader);
+  std::string serialized = Serialize({MetricSample::CrashSample("kernel")});
+  const uint32_t record_size = 4 + (serialized.size() + 3) / 4 * 4;
+
+  // A writer reserved a record at the start of the ring, and the reader
+  // dropped it for not being committed in time.
+  WriteWordAt(kReservedOffset, record_size);
+  std::vector<MetricSample> samples;
+  EXPECT_TRUE(reader->Drain(&samples, kSmallCapacity));
+  EXPECT_TRUE(reader->Drain(&samples, kSmallCapacity));
+  EXPECT_TRUE(samples.empty());
+
+  // Once the ring has wrapped around, another writer reserves the same
+  // space, and the first writer finally commits its record there.
+  WriteWordAt(kConsumedOffset, kSmallCapacity);
+  WriteWordAt(kReservedOffset, kSmallCapacity + record_size);
+  WriteAt(kDataOffset + 4, serialized);
+  WriteWordAt(kDataOffset, kCommittedFlag | serialized.size());
+
+  // The record is not taken for the one of the second writer.
+  EXPECT_TRUE(reader->Drain(&samples, kSmallCapacity));
+  EXPECT_TRUE(samples.empty());
+  EXPECT_TRUE(reader->Drain(&samples, kSmallCapacity));
+  EXPECT_TRUE(samples.empty());
+
+  ASSERT_TRUE(reader->Append(serialized));
+  EXPECT_TRUE(reader->Drain(&samples, kSmallCapacity));
+  EXPECT_EQ(1u, samples.size());
+}
+
+}  // namespace
+}  // namespace metrics
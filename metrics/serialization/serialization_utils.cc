@@ -269,19 +269,31 @@ bool SerializationUtils::WriteMetricsToFile(
     const std::vector<MetricSample>& samples, const std::string& filename) {
   std::string output;
   for (const auto& sample : samples) {
-    if (!sample.IsValid()) {
+    if (!SerializeSample(sample, &output)) {
       return false;
     }
-    std::string msg = sample.ToString();
-    int32_t size = msg.length() + sizeof(int32_t);
-    if (size > kMessageMaxLength) {
-      LOG(ERROR) << "cannot write message: too long, length = " << size;
-      return false;
-    }
-    output.append(reinterpret_cast<char*>(&size), sizeof(size));
-    output.append(msg);
   }
+  return WriteSerializedMetricsToFile(output, filename);
+}
+
+bool SerializationUtils::SerializeSample(const MetricSample& sample,
+                                         std::string* output) {
+  if (!sample.IsValid()) {
+    return false;
+  }
+  std::string msg = sample.ToString();
+  int32_t size = msg.length() + sizeof(int32_t);
+  if (size > kMessageMaxLength) {
+    LOG(ERROR) << "cannot write message: too long, length = " << size;
+    return false;
+  }
+  output->append(reinterpret_cast<char*>(&size), sizeof(size));
+  output->append(msg);
+  return true;
+}
 
+bool SerializationUtils::WriteSerializedMetricsToFile(
+    const std::string& output, const std::string& filename) {
   base::ScopedFD file_descriptor(open(filename.c_str(),
                                       O_WRONLY | O_APPEND | O_CREAT,
                                       READ_WRITE_ALL_FILE_FLAGS));
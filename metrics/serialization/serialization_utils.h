@@ -44,6 +44,16 @@ bool ReadAndTruncateMetricsFromFile(const std::string& filename,
 bool WriteMetricsToFile(const std::vector<MetricSample>& samples,
                         const std::string& filename);
 
+// Serializes |sample| in the format described above and appends it to
+// |output|. Returns false, leaving |output| untouched, if the sample is invalid
+// or too long.
+bool SerializeSample(const MetricSample& sample, std::string* output);
+
+// Writes |output|, samples serialized by SerializeSample(), to filename with a
+// single write while holding the file lock.
+bool WriteSerializedMetricsToFile(const std::string& output,
+                                  const std::string& filename);
+
 // Maximum length of a serialized message.
 static const size_t kMessageMaxLength = 1024;
 
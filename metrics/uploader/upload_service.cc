@@ -54,6 +54,11 @@ void UploadService::Init(const base::TimeDelta& upload_interval,
   skip_upload_ = !uploads_enabled;
 
   if (!testing_) {
+    sample_ring_ = metrics::SampleRing::Create(
+        base::FilePath(metrics::kSampleRingPath),
+        metrics::SampleRing::kDefaultCapacity);
+    if (!sample_ring_)
+      LOG(WARNING) << "Cannot create the sample ring, using the events file";
     base::MessageLoop::current()->task_runner()->PostDelayedTask(
         FROM_HERE,
         base::Bind(&UploadService::UploadEventCallback,
@@ -170,7 +175,14 @@ bool UploadService::ReadMetrics() {
       << "cannot read metrics until the old logs have been discarded";
 
   std::vector<metrics::MetricSample> samples;
-  bool result = metrics::SerializationUtils::ReadAndTruncateMetricsFromFile(
+  // Writers fall back to the file when the ring is full, so both need to be
+  // read. The ring has a fixed size much smaller than the batch limit.
+  bool result = true;
+  if (sample_ring_) {
+    result = sample_ring_->Drain(
+        &samples, metrics::SerializationUtils::kSampleBatchMaxLength);
+  }
+  result &= metrics::SerializationUtils::ReadAndTruncateMetricsFromFile(
       metrics_file_,
       &samples,
       metrics::SerializationUtils::kSampleBatchMaxLength);
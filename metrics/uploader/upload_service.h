@@ -13,6 +13,7 @@
 #include "base/metrics/histogram_snapshot_manager.h"
 
 #include "metrics/metrics_library.h"
+#include "metrics/serialization/sample_ring.h"
 #include "metrics/uploader/metrics_log.h"
 #include "metrics/uploader/sender.h"
 #include "metrics/uploader/system_profile_cache.h"
@@ -101,6 +102,7 @@ class UploadService : public base::HistogramFlattener {
   FRIEND_TEST(UploadServiceTest, LogKernelCrash);
   FRIEND_TEST(UploadServiceTest, LogUncleanShutdown);
   FRIEND_TEST(UploadServiceTest, LogUserCrash);
+  FRIEND_TEST(UploadServiceTest, SamplesInRingAreRead);
   FRIEND_TEST(UploadServiceTest, UnknownCrashIgnored);
   FRIEND_TEST(UploadServiceTest, ValuesInConfigFileAreSent);
 
@@ -117,8 +119,8 @@ class UploadService : public base::HistogramFlattener {
   // Resets the internal state.
   void Reset();
 
-  // Reads and consumes metrics from the message file, up to a max amount.
-  // Returns false if more metrics are remaining in the file.
+  // Reads and consumes metrics from the sample ring and the message file, up to
+  // a max amount. Returns false if more metrics are remaining.
   bool ReadMetrics();
 
   // Adds a generic sample to the current log.
@@ -151,6 +153,9 @@ class UploadService : public base::HistogramFlattener {
   std::unique_ptr<MetricsLog> staged_log_;
 
   std::string metrics_file_;
+  // Shared memory ring written by MetricsLibrary instead of |metrics_file_|
+  // when it exists.
+  std::unique_ptr<metrics::SampleRing> sample_ring_;
   bool skip_upload_;
 
   bool testing_;
@@ -13,6 +13,8 @@
 #include "base/sys_info.h"
 #include "metrics/metrics_library_mock.h"
 #include "metrics/serialization/metric_sample.h"
+#include "metrics/serialization/sample_ring.h"
+#include "metrics/serialization/serialization_utils.h"
 #include "metrics/uploader/metrics_log.h"
 #include "metrics/uploader/mock/mock_system_profile_setter.h"
 #include "metrics/uploader/mock/sender_mock.h"
@@ -92,6 +94,28 @@ TEST_F(UploadServiceTest, LogKernelCrash) {
                 .kernel_crash_count());
 }
 
+TEST_F(UploadServiceTest, SamplesInRingAreRead) {
+  base::FilePath ring_path = dir_.GetPath().Append("uma-events-ring");
+  upload_service_.sample_ring_ = metrics::SampleRing::Create(
+      ring_path, metrics::SampleRing::kDefaultCapacity);
+  ASSERT_TRUE(upload_service_.sample_ring_);
+
+  std::unique_ptr<metrics::SampleRing> writer =
+      metrics::SampleRing::Open(ring_path);
+  ASSERT_TRUE(writer);
+  std::string serialized;
+  ASSERT_TRUE(metrics::SerializationUtils::SerializeSample(Crash("kernel"),
+                                                           &serialized));
+  ASSERT_TRUE(writer->Append(serialized));
+
+  EXPECT_TRUE(upload_service_.ReadMetrics());
+  EXPECT_EQ(1,
+            upload_service_.current_log_->uma_proto()
+                ->system_profile()
+                .stability()
+                .kernel_crash_count());
+}
+
 TEST_F(UploadServiceTest, UnknownCrashIgnored) {
   upload_service_.AddSample(Crash("foo"));
 
@@ -30,6 +30,7 @@ using shill::mobile_operator_db::MobileAPN;
 using shill::mobile_operator_db::MobileNetworkOperator;
 using shill::mobile_operator_db::MobileOperatorDB;
 using shill::mobile_operator_db::MobileVirtualNetworkOperator;
+using shill::mobile_operator_db::OnlinePortal;
 using std::string;
 using std::vector;
 
@@ -74,8 +75,71 @@ string GetApnAuthentication(const MobileAPN& apn) {
   return string();
 }
 
+// Moves the operators of |from| to the end of those of |to|. Unlike
+// |MergeFrom|, this does not copy the operators, which make up most of the
+// database.
+void MoveOperators(MobileOperatorDB* from, MobileOperatorDB* to) {
+  vector<MobileNetworkOperator*> mnos(from->mno_size());
+  from->mutable_mno()->ExtractSubrange(0, mnos.size(), mnos.data());
+  for (auto* mno : mnos) {
+    to->mutable_mno()->AddAllocated(mno);
+  }
+
+  vector<MobileVirtualNetworkOperator*> mvnos(from->mvno_size());
+  from->mutable_mvno()->ExtractSubrange(0, mvnos.size(), mvnos.data());
+  for (auto* mvno : mvnos) {
+    to->mutable_mvno()->AddAllocated(mvno);
+  }
+}
+
 }  // namespace
 
+class MobileOperatorInfoImpl::CompiledRegex {
+ public:
+  explicit CompiledRegex(const string& regex) : regex_(regex) {
+    // |regexec| matches the given regular expression to a substring of the
+    // given query string. Ensure that |anchored_regex| uses anchors to accept
+    // only a full match.
+    string anchored_regex = regex;
+    if (anchored_regex.empty() || anchored_regex.front() != '^') {
+      anchored_regex = "^" + anchored_regex;
+    }
+    if (anchored_regex.back() != '$') {
+      anchored_regex = anchored_regex + "$";
+    }
+
+    // Must use GNU regex implementation, since C++11 implementation is
+    // incomplete.
+    int regcomp_error = regcomp(&compiled_, anchored_regex.c_str(),
+                                REG_EXTENDED | REG_NOSUB);
+    valid_ = (regcomp_error == 0);
+    if (!valid_) {
+      LOG(WARNING) << "Could not compile regex '" << regex << "'. "
+                   << "Error returned: "
+                   << GetRegError(regcomp_error, &compiled_) << ". ";
+    }
+  }
+
+  ~CompiledRegex() { regfree(&compiled_); }
+
+  const string& regex() const { return regex_; }
+  bool valid() const { return valid_; }
+
+  // Returns 0 if |value| matches, or the error returned by |regexec|.
+  int Match(const string& value) const {
+    return regexec(&compiled_, value.c_str(), 0, nullptr, 0);
+  }
+
+  string GetError(int code) const { return GetRegError(code, &compiled_); }
+
+ private:
+  const string regex_;
+  regex_t compiled_;
+  bool valid_;
+
+  DISALLOW_COPY_AND_ASSIGN(CompiledRegex);
+};
+
 MobileOperatorInfoImpl::MobileOperatorInfoImpl(EventDispatcher* dispatcher,
                                                const string& info_owner,
                                                const FilePath& default_db_path,
@@ -137,10 +201,7 @@ bool MobileOperatorInfoImpl::Init() {
     }
     LOG(INFO) << "Successfully loaded database: " << database_path_cstr;
     // Collate loaded databases into one as they're found.
-    // TODO(pprabhu) This merge might be very costly. Determine if we need to
-    // implement move semantics / bias the merge to use the largest database
-    // as the base database and merge other databases into it.
-    database_->MergeFrom(database);
+    MoveOperators(&database, database_.get());
     found_databases = true;
   }
 
@@ -423,12 +484,21 @@ void MobileOperatorInfoImpl::PreprocessDatabase() {
   mccmnc_to_mnos_.clear();
   sid_to_mnos_.clear();
   name_to_mnos_.clear();
+  compiled_regexes_.clear();
+
+  for (const auto& mvno : database_->mvno()) {
+    CompileFilterRegexes(mvno);
+  }
 
   const RepeatedPtrField<MobileNetworkOperator>& mnos = database_->mno();
   for (const auto& mno : mnos) {
     // MobileNetworkOperator::data is a required field.
     DCHECK(mno.has_data());
     const Data& data = mno.data();
+    CompileFilterRegexes(data);
+    for (const auto& mvno : mno.mvno()) {
+      CompileFilterRegexes(mvno);
+    }
 
     const RepeatedPtrField<string>& mccmncs = data.mccmnc();
     for (const auto& mccmnc : mccmncs) {
@@ -705,45 +775,49 @@ bool MobileOperatorInfoImpl::FilterMatches(const Filter& filter) {
     return false;
   }
 
-  // Must use GNU regex implementation, since C++11 implementation is
-  // incomplete.
-  regex_t filter_regex;
-  string filter_regex_str = filter.regex();
-
-  // |regexec| matches the given regular expression to a substring of the
-  // given query string. Ensure that |filter_regex_str| uses anchors to
-  // accept only a full match.
-  if (filter_regex_str.front() != '^') {
-    filter_regex_str = "^" + filter_regex_str;
-  }
-  if (filter_regex_str.back() != '$') {
-    filter_regex_str = filter_regex_str + "$";
-  }
-
-  int regcomp_error = regcomp(&filter_regex, filter_regex_str.c_str(),
-                              REG_EXTENDED | REG_NOSUB);
-  if (regcomp_error) {
-    LOG(WARNING) << "Could not compile regex '" << filter.regex() << "'. "
-                 << "Error returned: "
-                 << GetRegError(regcomp_error, &filter_regex) << ". ";
-    regfree(&filter_regex);
+  const CompiledRegex& filter_regex = GetCompiledRegex(filter.regex());
+  if (!filter_regex.valid()) {
     return false;
   }
 
-  int regexec_error = regexec(&filter_regex, to_match.c_str(), 0, nullptr, 0);
+  int regexec_error = filter_regex.Match(to_match);
   if (regexec_error) {
-    string error_string;
-    error_string = GetRegError(regcomp_error, &filter_regex);
     SLOG(this, 2) << "Could not match string " << to_match << " "
                   << "against regexp " << filter.regex() << ". "
-                  << "Error returned: " << error_string << ". ";
-    regfree(&filter_regex);
+                  << "Error returned: " << filter_regex.GetError(regexec_error)
+                  << ". ";
     return false;
   }
-  regfree(&filter_regex);
   return true;
 }
 
+const MobileOperatorInfoImpl::CompiledRegex&
+MobileOperatorInfoImpl::GetCompiledRegex(const string& regex) {
+  auto it = compiled_regexes_.find(regex);
+  if (it == compiled_regexes_.end()) {
+    it = compiled_regexes_
+             .emplace(regex, std::make_unique<CompiledRegex>(regex))
+             .first;
+  }
+  return *it->second;
+}
+
+void MobileOperatorInfoImpl::CompileFilterRegexes(const Data& data) {
+  for (const OnlinePortal& olp : data.olp()) {
+    if (olp.has_olp_filter()) {
+      GetCompiledRegex(olp.olp_filter().regex());
+    }
+  }
+}
+
+void MobileOperatorInfoImpl::CompileFilterRegexes(
+    const MobileVirtualNetworkOperator& mvno) {
+  for (const Filter& filter : mvno.mvno_filter()) {
+    GetCompiledRegex(filter.regex());
+  }
+  CompileFilterRegexes(mvno.data());
+}
+
 void MobileOperatorInfoImpl::RefreshDBInformation() {
   ClearDBInformation();
 
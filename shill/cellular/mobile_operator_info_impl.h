@@ -73,6 +73,9 @@ class MobileOperatorInfoImpl {
   friend class MobileOperatorInfoInitTest;
   friend class MobileOperatorInfoOverrideTest;
 
+  // A filter regex, compiled once.
+  class CompiledRegex;
+
   // ///////////////////////////////////////////////////////////////////////////
   // Constructor
   MobileOperatorInfoImpl(EventDispatcher* dispatcher,
@@ -103,6 +106,12 @@ class MobileOperatorInfoImpl {
   bool UpdateMNO();
   bool UpdateMVNO();
   bool FilterMatches(const shill::mobile_operator_db::Filter& filter);
+  // Returns |regex| compiled, compiling it the first time.
+  const CompiledRegex& GetCompiledRegex(const std::string& regex);
+  // Compiles the filter regexes of |data| or |mvno| ahead of their use.
+  void CompileFilterRegexes(const mobile_operator_db::Data& data);
+  void CompileFilterRegexes(
+      const mobile_operator_db::MobileVirtualNetworkOperator& mvno);
   const mobile_operator_db::MobileNetworkOperator* PickOneFromDuplicates(
       const std::vector<const mobile_operator_db::MobileNetworkOperator*>&
           duplicates) const;
@@ -167,6 +176,8 @@ class MobileOperatorInfoImpl {
   StringToMNOListMap mccmnc_to_mnos_;
   StringToMNOListMap sid_to_mnos_;
   StringToMNOListMap name_to_mnos_;
+  // The filter regexes of |database_|, compiled in |PreprocessDatabase|.
+  std::map<std::string, std::unique_ptr<CompiledRegex>> compiled_regexes_;
 
   // |candidates_by_operator_code| can be determined either using MCCMNC or
   // using SID.  At any one time, we only expect one of these operator codes to
@@ -145,8 +145,10 @@ TEST_F(MobileOperatorInfoInitTest, MultipleDBInit) {
   EXPECT_TRUE(SetUpDatabase({"init_test_multiple_db_init_1.pbf",
                              "init_test_multiple_db_init_2.pbf"}));
   EXPECT_TRUE(operator_info_->Init());
-  EXPECT_GT(GetDatabase()->mno_size(), 0);
-  EXPECT_GT(GetDatabase()->mvno_size(), 0);
+  ASSERT_EQ(1, GetDatabase()->mno_size());
+  ASSERT_EQ(1, GetDatabase()->mvno_size());
+  EXPECT_EQ("muahahahaha", GetDatabase()->mno(0).data().uuid());
+  EXPECT_EQ("teeheehee", GetDatabase()->mvno(0).data().uuid());
 }
 
 TEST_F(MobileOperatorInfoInitTest, InitWithObserver) {
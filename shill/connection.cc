@@ -16,6 +16,7 @@
 
 #include "shill/control_interface.h"
 #include "shill/device_info.h"
+#include "shill/dns_cache.h"
 #include "shill/logging.h"
 #include "shill/net/rtnl_handler.h"
 #include "shill/resolver.h"
@@ -89,6 +90,7 @@ Connection::~Connection() {
   if (blackhole_table_id_ != RT_TABLE_UNSPEC) {
     routing_table_->FreeAdditionalTableId(blackhole_table_id_);
   }
+  DnsCache::GetInstance()->ClearInterface(interface_name_);
 }
 
 bool Connection::SetupExcludedRoutes(const IPConfig::Properties& properties,
@@ -118,6 +120,10 @@ bool Connection::SetupExcludedRoutes(const IPConfig::Properties& properties,
 void Connection::UpdateFromIPConfig(const IPConfigRefPtr& config) {
   SLOG(this, 2) << __func__ << " " << interface_name_;
 
+  // A new configuration, as after a roam, may come with another network behind
+  // the same interface and DNS servers.
+  DnsCache::GetInstance()->ClearInterface(interface_name_);
+
   const IPConfig::Properties& properties = config->properties();
   allowed_uids_ = properties.allowed_uids;
   allowed_iifs_ = properties.allowed_iifs;
@@ -5,6 +5,7 @@
 #include "shill/connection_info_reader.h"
 
 #include <netinet/in.h>
+#include <sys/socket.h>
 
 #include <limits>
 
@@ -14,6 +15,8 @@
 
 #include "shill/file_reader.h"
 #include "shill/logging.h"
+#include "shill/net/netlink_conntrack.h"
+#include "shill/net/sockets.h"
 
 using base::FilePath;
 using std::string;
@@ -39,7 +42,8 @@ const char kUnrepliedTag[] = "[UNREPLIED]";
 
 }  // namespace
 
-ConnectionInfoReader::ConnectionInfoReader() = default;
+ConnectionInfoReader::ConnectionInfoReader()
+    : netlink_conntrack_created_(false) {}
 
 ConnectionInfoReader::~ConnectionInfoReader() = default;
 
@@ -47,9 +51,16 @@ FilePath ConnectionInfoReader::GetConnectionInfoFilePath() const {
   return FilePath(kConnectionInfoFilePath);
 }
 
+std::unique_ptr<NetlinkConntrack>
+ConnectionInfoReader::CreateNetlinkConntrack() {
+  return NetlinkConntrack::Create(std::make_unique<Sockets>());
+}
+
 bool ConnectionInfoReader::LoadConnectionInfo(
     vector<ConnectionInfo>* info_list) {
   info_list->clear();
+  if (LoadConnectionInfoFromNetlink(info_list))
+    return true;
 
   FilePath info_file_path = GetConnectionInfoFilePath();
   FileReader file_reader;
@@ -68,6 +79,35 @@ bool ConnectionInfoReader::LoadConnectionInfo(
   return true;
 }
 
+bool ConnectionInfoReader::LoadConnectionInfoFromNetlink(
+    vector<ConnectionInfo>* info_list) {
+  if (!netlink_conntrack_created_) {
+    netlink_conntrack_created_ = true;
+    netlink_conntrack_ = CreateNetlinkConntrack();
+  }
+  if (!netlink_conntrack_)
+    return false;
+
+  // Like /proc/net/ip_conntrack, only IPv4 connections are loaded.
+  vector<NetlinkConntrack::Connection> conns;
+  if (!netlink_conntrack_->GetConnections(AF_INET, &conns)) {
+    SLOG(this, 2) << __func__ << ": Falling back to procfs.";
+    netlink_conntrack_.reset();
+    return false;
+  }
+
+  info_list->reserve(conns.size());
+  for (const auto& conn : conns) {
+    info_list->push_back(ConnectionInfo(
+        conn.protocol, conn.timeout_seconds, !conn.seen_reply,
+        conn.original_source_ip_address, conn.original_source_port,
+        conn.original_destination_ip_address, conn.original_destination_port,
+        conn.reply_source_ip_address, conn.reply_source_port,
+        conn.reply_destination_ip_address, conn.reply_destination_port));
+  }
+  return true;
+}
+
 bool ConnectionInfoReader::ParseConnectionInfo(const string& input,
                                                ConnectionInfo* info) {
   vector<string> tokens =
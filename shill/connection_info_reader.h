@@ -5,6 +5,7 @@
 #ifndef SHILL_CONNECTION_INFO_READER_H_
 #define SHILL_CONNECTION_INFO_READER_H_
 
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -16,6 +17,8 @@
 
 namespace shill {
 
+class NetlinkConntrack;
+
 class ConnectionInfoReader {
  public:
   ConnectionInfoReader();
@@ -26,9 +29,15 @@ class ConnectionInfoReader {
   // to return a different file path.
   virtual base::FilePath GetConnectionInfoFilePath() const;
 
-  // Loads IP connection tracking information from the file path returned by
-  // GetConnectionInfoFilePath(). Existing entries in |info_list| are always
-  // discarded. Returns true on success.
+  // Returns the ctnetlink socket from which IP connection tracking
+  // information are read, or nullptr if it cannot be opened. Overloaded by
+  // unit tests to read the file path above instead.
+  virtual std::unique_ptr<NetlinkConntrack> CreateNetlinkConntrack();
+
+  // Loads IPv4 connection tracking information over ctnetlink, or if that
+  // fails, from the file path returned by GetConnectionInfoFilePath().
+  // Existing entries in |info_list| are always discarded. Returns true on
+  // success.
   virtual bool LoadConnectionInfo(std::vector<ConnectionInfo>* info_list);
 
  private:
@@ -38,6 +47,7 @@ class ConnectionInfoReader {
   FRIEND_TEST(ConnectionInfoReaderTest, ParseProtocol);
   FRIEND_TEST(ConnectionInfoReaderTest, ParseTimeToExpireSeconds);
 
+  bool LoadConnectionInfoFromNetlink(std::vector<ConnectionInfo>* info_list);
   bool ParseConnectionInfo(const std::string& input, ConnectionInfo* info);
   bool ParseProtocol(const std::string& input, int* protocol);
   bool ParseTimeToExpireSeconds(const std::string& input,
@@ -48,6 +58,11 @@ class ConnectionInfoReader {
                       bool* is_source);
   bool ParsePort(const std::string& input, uint16_t* port, bool* is_source);
 
+  // Opened on the first load; reset once it fails so that later loads go
+  // straight to procfs.
+  std::unique_ptr<NetlinkConntrack> netlink_conntrack_;
+  bool netlink_conntrack_created_;
+
   DISALLOW_COPY_AND_ASSIGN(ConnectionInfoReader);
 };
 
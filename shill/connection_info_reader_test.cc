@@ -6,12 +6,16 @@
 
 #include <netinet/in.h>
 
+#include <memory>
+
 #include <base/files/file_util.h>
 #include <base/files/scoped_temp_dir.h>
 #include <base/strings/stringprintf.h>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include "shill/net/netlink_conntrack.h"
+
 using base::FilePath;
 using base::ScopedTempDir;
 using base::StringPrintf;
@@ -42,6 +46,11 @@ class ConnectionInfoReaderUnderTest : public ConnectionInfoReader {
   // info file instead of the actual path in procfs (i.e.
   // /proc/net/ip_conntrack).
   MOCK_METHOD(FilePath, GetConnectionInfoFilePath, (), (const, override));
+
+  // Always read the file above.
+  std::unique_ptr<NetlinkConntrack> CreateNetlinkConntrack() override {
+    return nullptr;
+  }
 };
 
 class ConnectionInfoReaderTest : public testing::Test {
@@ -72,6 +72,8 @@ void DaemonTask::ApplySettings() {
   manager_->SetAcceptHostnameFrom(settings_.accept_hostname_from);
   manager_->SetDHCPv6EnabledDevices(settings_.dhcpv6_enabled_devices);
   manager_->SetJailVpnClients(settings_.jail_vpn_clients);
+  manager_->SetLinkMonitorNeighborEvents(
+      settings_.link_monitor_neighbor_events);
 }
 
 bool DaemonTask::Quit(const base::Closure& completion_callback) {
@@ -146,9 +148,14 @@ void DaemonTask::StopAndReturnToMain() {
 
 void DaemonTask::Start() {
   metrics_->Start();
-  rtnl_handler_->Start(RTMGRP_LINK | RTMGRP_IPV4_IFADDR | RTMGRP_IPV4_ROUTE |
-                       RTMGRP_IPV6_IFADDR | RTMGRP_IPV6_ROUTE |
-                       RTMGRP_ND_USEROPT);
+  uint32_t netlink_groups = RTMGRP_LINK | RTMGRP_IPV4_IFADDR |
+                            RTMGRP_IPV4_ROUTE | RTMGRP_IPV6_IFADDR |
+                            RTMGRP_IPV6_ROUTE | RTMGRP_ND_USEROPT;
+  if (settings_.link_monitor_neighbor_events) {
+    // Needed by LinkMonitor to follow the state of the gateways.
+    netlink_groups |= RTMGRP_NEIGH;
+  }
+  rtnl_handler_->Start(netlink_groups);
   routing_table_->Start();
   dhcp_provider_->Init(control_.get(), dispatcher_.get(), metrics_.get());
   process_manager_->Init(dispatcher_.get());
@@ -44,7 +44,8 @@ class DaemonTask {
         : ignore_unknown_ethernet(false),
           minimum_mtu(0),
           passive_mode(false),
-          use_portal_list(false) {}
+          use_portal_list(false),
+          link_monitor_neighbor_events(false) {}
     std::string accept_hostname_from;
     std::string default_technology_order;
     std::vector<std::string> device_blacklist;
@@ -57,6 +58,7 @@ class DaemonTask {
     std::string prepend_dns_servers;
     bool use_portal_list;
     bool jail_vpn_clients;
+    bool link_monitor_neighbor_events;
   };
 
   DaemonTask(const Settings& settings, Config* config);
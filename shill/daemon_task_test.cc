@@ -202,6 +202,7 @@ TEST_F(DaemonTaskTest, ApplySettings) {
   EXPECT_CALL(*manager_, SetPrependDNSServers(""));
   EXPECT_CALL(*manager_, SetMinimumMTU(_)).Times(0);
   EXPECT_CALL(*manager_, SetAcceptHostnameFrom(""));
+  EXPECT_CALL(*manager_, SetLinkMonitorNeighborEvents(false));
   ApplySettings(settings);
   Mock::VerifyAndClearExpectations(manager_);
 
@@ -217,6 +218,7 @@ TEST_F(DaemonTaskTest, ApplySettings) {
   settings.prepend_dns_servers = "8.8.8.8,8.8.4.4";
   settings.minimum_mtu = 256;
   settings.accept_hostname_from = "eth*";
+  settings.link_monitor_neighbor_events = true;
   EXPECT_CALL(*manager_, SetBlacklistedDevices(kBlacklistedDevices));
   EXPECT_CALL(*manager_, SetDHCPv6EnabledDevices(kDHCPv6EnabledDevices));
   EXPECT_CALL(*manager_, SetTechnologyOrder("wifi,ethernet", _));
@@ -226,6 +228,7 @@ TEST_F(DaemonTaskTest, ApplySettings) {
   EXPECT_CALL(*manager_, SetPrependDNSServers("8.8.8.8,8.8.4.4"));
   EXPECT_CALL(*manager_, SetMinimumMTU(256));
   EXPECT_CALL(*manager_, SetAcceptHostnameFrom("eth*"));
+  EXPECT_CALL(*manager_, SetLinkMonitorNeighborEvents(true));
   ApplySettings(settings);
   Mock::VerifyAndClearExpectations(manager_);
 }
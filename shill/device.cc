@@ -1481,6 +1481,8 @@ bool Device::StartLinkMonitor() {
         connection_, dispatcher(), metrics(), manager_->device_info(),
         Bind(&Device::OnLinkMonitorFailure, AsWeakPtr()),
         Bind(&Device::OnLinkMonitorGatewayChange, AsWeakPtr())));
+    link_monitor_->set_neighbor_events_enabled(
+        manager_->GetLinkMonitorNeighborEvents());
   }
 
   SLOG(this, 2) << "Device " << link_name() << ": Link Monitor starting.";
@@ -0,0 +1,189 @@
+// Copyright 2020 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "shill/dns_cache.h"
+
+#include <algorithm>
+#include <tuple>
+#include <utility>
+
+#include "shill/logging.h"
+#include "shill/metrics.h"
+#include "shill/net/shill_time.h"
+
+using std::string;
+using std::vector;
+
+namespace shill {
+
+namespace Logging {
+static auto kModuleLogScope = ScopeLogger::kDNS;
+static string ObjectID(DnsCache* d) {
+  return "(dns_cache)";
+}
+}  // namespace Logging
+
+// static
+const uint32_t DnsCache::kMaxTtlSeconds = 300;
+
+DnsCache::Key::Key(IPAddress::Family family_in,
+                   const string& interface_name_in,
+                   const vector<string>& dns_servers_in,
+                   const string& hostname_in)
+    : family(family_in),
+      interface_name(interface_name_in),
+      dns_servers(dns_servers_in),
+      hostname(hostname_in) {}
+
+bool DnsCache::Key::operator<(const Key& b) const {
+  return std::tie(family, interface_name, dns_servers, hostname) <
+         std::tie(b.family, b.interface_name, b.dns_servers, b.hostname);
+}
+
+DnsCache::Stats::Stats()
+    : hits(0),
+      coalesced(0),
+      misses(0),
+      completed(0),
+      total_latency_milliseconds(0) {}
+
+double DnsCache::Stats::HitRate() const {
+  const uint64_t lookups = hits + coalesced + misses;
+  return lookups ? static_cast<double>(hits + coalesced) / lookups : 0.0;
+}
+
+int64_t DnsCache::Stats::AverageLatencyMilliseconds() const {
+  return completed ? total_latency_milliseconds / completed : 0;
+}
+
+DnsCache::DnsCache() : metrics_(nullptr), time_(Time::GetInstance()) {}
+
+DnsCache::~DnsCache() = default;
+
+DnsCache* DnsCache::GetInstance() {
+  static base::NoDestructor<DnsCache> instance;
+  return instance.get();
+}
+
+bool DnsCache::Lookup(const Key& key, IPAddress* address) {
+  auto it = entries_.find(key);
+  if (it == entries_.end()) {
+    return false;
+  }
+  if (it->second.expiry <= Now()) {
+    entries_.erase(it);
+    return false;
+  }
+  SLOG(this, 3) << "Cached address of " << key.hostname << ": "
+                << it->second.address.ToString();
+  stats_.hits++;
+  SendLookupResult(Metrics::kDnsCacheLookupResultHit);
+  *address = it->second.address;
+  return true;
+}
+
+bool DnsCache::JoinLookup(const Key& key, const ResultCallback& callback) {
+  auto it = lookups_.find(key);
+  if (it == lookups_.end()) {
+    lookups_[key];
+    stats_.misses++;
+    SendLookupResult(Metrics::kDnsCacheLookupResultMiss);
+    return false;
+  }
+  SLOG(this, 3) << "Joining the lookup of " << key.hostname;
+  it->second.push_back(callback);
+  stats_.coalesced++;
+  SendLookupResult(Metrics::kDnsCacheLookupResultCoalesced);
+  return true;
+}
+
+void DnsCache::CompleteLookup(const Key& key,
+                              const Error& error,
+                              const IPAddress& address,
+                              uint32_t ttl_seconds,
+                              int64_t latency_milliseconds) {
+  stats_.completed++;
+  stats_.total_latency_milliseconds += latency_milliseconds;
+  SLOG(this, 2) << "Lookup of " << key.hostname << " took "
+                << latency_milliseconds << " ms; hit rate "
+                << stats_.HitRate() << ", average latency "
+                << stats_.AverageLatencyMilliseconds() << " ms";
+  if (metrics_) {
+    metrics_->SendToUMA(Metrics::kMetricDnsCacheMissLatency,
+                        latency_milliseconds,
+                        Metrics::kMetricDnsCacheMissLatencyMin,
+                        Metrics::kMetricDnsCacheMissLatencyMax,
+                        Metrics::kMetricDnsCacheMissLatencyNumBuckets);
+  }
+
+  if (error.IsSuccess() && ttl_seconds > 0) {
+    const time_t now = Now();
+    // Drop what has expired, so that names which are not looked up anymore do
+    // not accumulate.
+    for (auto it = entries_.begin(); it != entries_.end();) {
+      if (it->second.expiry <= now) {
+        it = entries_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+    const time_t expiry = now + std::min(ttl_seconds, kMaxTtlSeconds);
+    auto it = entries_.find(key);
+    if (it != entries_.end()) {
+      it->second = Entry(address, expiry);
+    } else {
+      entries_.emplace(key, Entry(address, expiry));
+    }
+  }
+  EndLookup(key, error, address);
+}
+
+void DnsCache::AbandonLookup(const Key& key) {
+  EndLookup(key, Error(Error::kOperationAborted, "DNS lookup abandoned"),
+            IPAddress(key.family));
+}
+
+void DnsCache::Clear() {
+  entries_.clear();
+}
+
+void DnsCache::ClearInterface(const string& interface_name) {
+  for (auto it = entries_.begin(); it != entries_.end();) {
+    if (it->first.interface_name == interface_name) {
+      it = entries_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+time_t DnsCache::Now() {
+  time_t now = 0;
+  time_->GetSecondsBoottime(&now);
+  return now;
+}
+
+void DnsCache::EndLookup(const Key& key,
+                         const Error& error,
+                         const IPAddress& address) {
+  auto it = lookups_.find(key);
+  if (it == lookups_.end()) {
+    return;
+  }
+  // The callbacks may start a new lookup of |key|.
+  vector<ResultCallback> callbacks = std::move(it->second);
+  lookups_.erase(it);
+  for (const auto& callback : callbacks) {
+    callback.Run(error, address);
+  }
+}
+
+void DnsCache::SendLookupResult(int result) {
+  if (metrics_) {
+    metrics_->SendEnumToUMA(Metrics::kMetricDnsCacheLookupResult, result,
+                            Metrics::kDnsCacheLookupResultMax);
+  }
+}
+
+}  // namespace shill
@@ -0,0 +1,145 @@
+// Copyright 2020 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef SHILL_DNS_CACHE_H_
+#define SHILL_DNS_CACHE_H_
+
+#include <stdint.h>
+#include <time.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <base/callback.h>
+#include <base/macros.h>
+#include <base/no_destructor.h>
+
+#include "shill/error.h"
+#include "shill/net/ip_address.h"
+
+namespace shill {
+
+class Metrics;
+class Time;
+
+// Keeps the addresses resolved by the DnsClients which use it for as long as
+// the TTL of their records, and lets concurrent lookups of the same name share
+// a single query.
+class DnsCache {
+ public:
+  using ResultCallback = base::Callback<void(const Error&, const IPAddress&)>;
+
+  // Identifies a lookup. The same name may resolve differently through
+  // another interface or other servers.
+  struct Key {
+    Key(IPAddress::Family family,
+        const std::string& interface_name,
+        const std::vector<std::string>& dns_servers,
+        const std::string& hostname);
+
+    bool operator<(const Key& b) const;
+
+    IPAddress::Family family;
+    std::string interface_name;
+    std::vector<std::string> dns_servers;
+    std::string hostname;
+  };
+
+  struct Stats {
+    Stats();
+
+    // Share of the lookups which did not go to the network.
+    double HitRate() const;
+    // Average duration of the lookups which went to the network.
+    int64_t AverageLatencyMilliseconds() const;
+
+    // Lookups answered from the cache.
+    uint64_t hits;
+    // Lookups which shared a query already in progress.
+    uint64_t coalesced;
+    // Lookups which went to the network.
+    uint64_t misses;
+    // Lookups which went to the network and completed, and their total
+    // duration.
+    uint64_t completed;
+    int64_t total_latency_milliseconds;
+  };
+
+  // Addresses are kept at most this long, whatever the TTL of their record,
+  // so that a change of network is noticed in time.
+  static const uint32_t kMaxTtlSeconds;
+
+  virtual ~DnsCache();
+
+  // This is a singleton. Use DnsCache::GetInstance()->Foo().
+  static DnsCache* GetInstance();
+
+  // Returns true and sets |address| if the address of |key| is cached.
+  bool Lookup(const Key& key, IPAddress* address);
+
+  // Registers |callback| to be run with the result of the lookup of |key|
+  // which is in progress, and returns true. Returns false if there is none, in
+  // which case the caller becomes responsible for the lookup and must end it
+  // with CompleteLookup() or AbandonLookup().
+  bool JoinLookup(const Key& key, const ResultCallback& callback);
+
+  // Caches the result of the lookup of |key| for |ttl_seconds| if it
+  // succeeded, and passes it to the lookups which joined it.
+  void CompleteLookup(const Key& key,
+                      const Error& error,
+                      const IPAddress& address,
+                      uint32_t ttl_seconds,
+                      int64_t latency_milliseconds);
+
+  // Ends the lookup of |key| without a result. The lookups which joined it
+  // are passed a kOperationAborted error, so that they can retry on their own.
+  void AbandonLookup(const Key& key);
+
+  // Forgets every cached address.
+  void Clear();
+
+  // Forgets the addresses resolved through |interface_name|, whose network
+  // may have changed.
+  void ClearInterface(const std::string& interface_name);
+
+  // Reports the lookups to UMA through |metrics| unless it is nullptr.
+  void set_metrics(Metrics* metrics) { metrics_ = metrics; }
+
+  const Stats& stats() const { return stats_; }
+
+ protected:
+  DnsCache();
+
+ private:
+  friend class base::NoDestructor<DnsCache>;
+  friend class DnsCacheTest;
+  friend class DnsClientTest;
+
+  struct Entry {
+    Entry(const IPAddress& address_in, time_t expiry_in)
+        : address(address_in), expiry(expiry_in) {}
+
+    IPAddress address;
+    // Time, in seconds since boot, at which the entry expires.
+    time_t expiry;
+  };
+
+  time_t Now();
+  void EndLookup(const Key& key, const Error& error, const IPAddress& address);
+  void SendLookupResult(int result);
+
+  std::map<Key, Entry> entries_;
+  // The callbacks waiting for each lookup in progress.
+  std::map<Key, std::vector<ResultCallback>> lookups_;
+  Stats stats_;
+  Metrics* metrics_;
+  Time* time_;
+
+  DISALLOW_COPY_AND_ASSIGN(DnsCache);
+};
+
+}  // namespace shill
+
+#endif  // SHILL_DNS_CACHE_H_
@@ -0,0 +1,200 @@
+// Copyright 2020 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "shill/dns_cache.h"
+
+#include <string>
+#include <vector>
+
+#include <base/bind.h>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "shill/mock_metrics.h"
+#include "shill/net/mock_time.h"
+#include "shill/testing.h"
+
+using base::Bind;
+using base::Unretained;
+using testing::_;
+using testing::DoAll;
+using testing::Eq;
+using testing::Return;
+using testing::SetArgPointee;
+using testing::StrictMock;
+using testing::Test;
+
+namespace shill {
+
+namespace {
+const char kHostname[] = "www.gstatic.com";
+const char kInterfaceName[] = "wlan0";
+const char kDnsServer[] = "8.8.8.8";
+const char kAddress[] = "172.217.0.3";
+}  // namespace
+
+class DnsCacheTest : public Test {
+ public:
+  DnsCacheTest()
+      : key_(IPAddress::kFamilyIPv4, kInterfaceName, {kDnsServer}, kHostname),
+        address_(IPAddress::kFamilyIPv4) {}
+
+  void SetUp() override {
+    cache_.time_ = &time_;
+    SetTime(100);
+    ASSERT_TRUE(address_.SetAddressFromString(kAddress));
+  }
+
+  void SetTime(time_t seconds) {
+    EXPECT_CALL(time_, GetSecondsBoottime(_))
+        .WillRepeatedly(DoAll(SetArgPointee<0>(seconds), Return(true)));
+  }
+
+  // Looks |key_| up on the network and caches the answer for |ttl_seconds|.
+  void Resolve(uint32_t ttl_seconds) {
+    ASSERT_FALSE(cache_.JoinLookup(key_, DnsCache::ResultCallback()));
+    cache_.CompleteLookup(key_, Error(), address_, ttl_seconds, 20);
+  }
+
+  MOCK_METHOD(void, OnResult, (const Error&, const IPAddress&));
+
+  DnsCache::ResultCallback result_callback() {
+    return Bind(&DnsCacheTest::OnResult, Unretained(this));
+  }
+
+ protected:
+  DnsCache cache_;
+  MockTime time_;
+  const DnsCache::Key key_;
+  IPAddress address_;
+};
+
+TEST_F(DnsCacheTest, LookupRespectsTtl) {
+  IPAddress address(IPAddress::kFamilyIPv4);
+  EXPECT_FALSE(cache_.Lookup(key_, &address));
+
+  Resolve(60);
+  EXPECT_TRUE(cache_.Lookup(key_, &address));
+  EXPECT_TRUE(address.Equals(address_));
+
+  // The same name through another interface is another lookup.
+  const DnsCache::Key other_key(IPAddress::kFamilyIPv4, "eth0", {kDnsServer},
+                                kHostname);
+  EXPECT_FALSE(cache_.Lookup(other_key, &address));
+
+  SetTime(159);
+  EXPECT_TRUE(cache_.Lookup(key_, &address));
+  SetTime(160);
+  EXPECT_FALSE(cache_.Lookup(key_, &address));
+}
+
+TEST_F(DnsCacheTest, TtlIsCapped) {
+  Resolve(86400);
+  IPAddress address(IPAddress::kFamilyIPv4);
+  SetTime(100 + DnsCache::kMaxTtlSeconds - 1);
+  EXPECT_TRUE(cache_.Lookup(key_, &address));
+  SetTime(100 + DnsCache::kMaxTtlSeconds);
+  EXPECT_FALSE(cache_.Lookup(key_, &address));
+}
+
+TEST_F(DnsCacheTest, FailuresAreNotCached) {
+  ASSERT_FALSE(cache_.JoinLookup(key_, DnsCache::ResultCallback()));
+  cache_.CompleteLookup(key_, Error(Error::kOperationTimeout), address_, 60,
+                        8000);
+  IPAddress address(IPAddress::kFamilyIPv4);
+  EXPECT_FALSE(cache_.Lookup(key_, &address));
+
+  // Nor are answers without a TTL.
+  Resolve(0);
+  EXPECT_FALSE(cache_.Lookup(key_, &address));
+}
+
+TEST_F(DnsCacheTest, ConcurrentLookupsShareOneQuery) {
+  EXPECT_FALSE(cache_.JoinLookup(key_, result_callback()));
+  EXPECT_TRUE(cache_.JoinLookup(key_, result_callback()));
+  EXPECT_TRUE(cache_.JoinLookup(key_, result_callback()));
+
+  EXPECT_CALL(*this, OnResult(IsSuccess(), Eq(address_))).Times(2);
+  cache_.CompleteLookup(key_, Error(), address_, 60, 30);
+
+  // The next lookup starts a new query.
+  EXPECT_FALSE(cache_.JoinLookup(key_, result_callback()));
+}
+
+TEST_F(DnsCacheTest, AbandonedLookup) {
+  EXPECT_FALSE(cache_.JoinLookup(key_, result_callback()));
+  EXPECT_TRUE(cache_.JoinLookup(key_, result_callback()));
+  EXPECT_CALL(*this, OnResult(ErrorTypeIs(Error::kOperationAborted), _));
+  cache_.AbandonLookup(key_);
+
+  IPAddress address(IPAddress::kFamilyIPv4);
+  EXPECT_FALSE(cache_.Lookup(key_, &address));
+  EXPECT_FALSE(cache_.JoinLookup(key_, result_callback()));
+}
+
+TEST_F(DnsCacheTest, Stats) {
+  IPAddress address(IPAddress::kFamilyIPv4);
+  EXPECT_FALSE(cache_.Lookup(key_, &address));
+  ASSERT_FALSE(cache_.JoinLookup(key_, DnsCache::ResultCallback()));
+  EXPECT_TRUE(cache_.JoinLookup(key_, result_callback()));
+  EXPECT_CALL(*this, OnResult(_, _));
+  cache_.CompleteLookup(key_, Error(), address_, 60, 40);
+  EXPECT_TRUE(cache_.Lookup(key_, &address));
+  EXPECT_TRUE(cache_.Lookup(key_, &address));
+  Resolve(60);
+
+  const DnsCache::Stats& stats = cache_.stats();
+  EXPECT_EQ(2, stats.hits);
+  EXPECT_EQ(1, stats.coalesced);
+  EXPECT_EQ(2, stats.misses);
+  EXPECT_EQ(2, stats.completed);
+  EXPECT_DOUBLE_EQ(0.6, stats.HitRate());
+  EXPECT_EQ(30, stats.AverageLatencyMilliseconds());
+
+  cache_.Clear();
+  EXPECT_FALSE(cache_.Lookup(key_, &address));
+}
+
+TEST_F(DnsCacheTest, ClearInterface) {
+  const DnsCache::Key other_key(IPAddress::kFamilyIPv4, "eth0", {kDnsServer},
+                                kHostname);
+  Resolve(60);
+  ASSERT_FALSE(cache_.JoinLookup(other_key, DnsCache::ResultCallback()));
+  cache_.CompleteLookup(other_key, Error(), address_, 60, 20);
+
+  cache_.ClearInterface(kInterfaceName);
+  IPAddress address(IPAddress::kFamilyIPv4);
+  EXPECT_FALSE(cache_.Lookup(key_, &address));
+  EXPECT_TRUE(cache_.Lookup(other_key, &address));
+}
+
+TEST_F(DnsCacheTest, Metrics) {
+  StrictMock<MockMetrics> metrics;
+  cache_.set_metrics(&metrics);
+
+  EXPECT_CALL(metrics, SendEnumToUMA(Metrics::kMetricDnsCacheLookupResult,
+                                     Metrics::kDnsCacheLookupResultMiss,
+                                     Metrics::kDnsCacheLookupResultMax));
+  ASSERT_FALSE(cache_.JoinLookup(key_, DnsCache::ResultCallback()));
+  EXPECT_CALL(metrics, SendEnumToUMA(Metrics::kMetricDnsCacheLookupResult,
+                                     Metrics::kDnsCacheLookupResultCoalesced,
+                                     Metrics::kDnsCacheLookupResultMax));
+  EXPECT_TRUE(cache_.JoinLookup(key_, result_callback()));
+
+  EXPECT_CALL(metrics,
+              SendToUMA(Metrics::kMetricDnsCacheMissLatency, 40,
+                        Metrics::kMetricDnsCacheMissLatencyMin,
+                        Metrics::kMetricDnsCacheMissLatencyMax,
+                        Metrics::kMetricDnsCacheMissLatencyNumBuckets));
+  EXPECT_CALL(*this, OnResult(_, _));
+  cache_.CompleteLookup(key_, Error(), address_, 60, 40);
+
+  EXPECT_CALL(metrics, SendEnumToUMA(Metrics::kMetricDnsCacheLookupResult,
+                                     Metrics::kDnsCacheLookupResultHit,
+                                     Metrics::kDnsCacheLookupResultMax));
+  IPAddress address(IPAddress::kFamilyIPv4);
+  EXPECT_TRUE(cache_.Lookup(key_, &address));
+}
+
+}  // namespace shill
@@ -5,6 +5,7 @@
 #include "shill/dns_client.h"
 
 #include <arpa/inet.h>
+#include <arpa/nameser.h>
 #include <netdb.h>
 #include <netinet/in.h>
 #include <sys/socket.h>
@@ -56,6 +57,36 @@ vector<string> FilterEmptyIPs(const vector<string>& dns_servers) {
   return results;
 }
 
+// Decodes the A or AAAA records of the DNS answer in |abuf| into |hostent|,
+// and sets |ttl_seconds| to the smallest of their TTLs.
+int ParseAnswer(int family,
+                const unsigned char* abuf,
+                int alen,
+                struct hostent** hostent,
+                uint32_t* ttl_seconds) {
+  constexpr int kMaxRecords = 8;
+  int count = kMaxRecords;
+  int status;
+  int ttl = -1;
+  if (family == AF_INET) {
+    struct ares_addrttl ttls[kMaxRecords];
+    status = ares_parse_a_reply(abuf, alen, hostent, ttls, &count);
+    for (int i = 0; status == ARES_SUCCESS && i < count; i++) {
+      if (ttl < 0 || ttls[i].ttl < ttl)
+        ttl = ttls[i].ttl;
+    }
+  } else {
+    struct ares_addr6ttl ttls[kMaxRecords];
+    status = ares_parse_aaaa_reply(abuf, alen, hostent, ttls, &count);
+    for (int i = 0; status == ARES_SUCCESS && i < count; i++) {
+      if (ttl < 0 || ttls[i].ttl < ttl)
+        ttl = ttls[i].ttl;
+    }
+  }
+  *ttl_seconds = ttl > 0 ? ttl : 0;
+  return status;
+}
+
 }  // namespace
 
 const char DnsClient::kErrorNoData[] = "The query response contains no answers";
@@ -95,12 +126,19 @@ DnsClient::DnsClient(IPAddress::Family family,
       running_(false),
       weak_ptr_factory_(this),
       ares_(Ares::GetInstance()),
-      time_(Time::GetInstance()) {}
+      time_(Time::GetInstance()),
+      cache_(nullptr),
+      ttl_seconds_(0) {}
 
 DnsClient::~DnsClient() {
   Stop();
 }
 
+DnsCache::Key DnsClient::GetCacheKey(const string& hostname) const {
+  return DnsCache::Key(address_.family(), interface_name_, dns_servers_,
+                       hostname);
+}
+
 bool DnsClient::Start(const string& hostname, Error* error) {
   if (running_) {
     Error::PopulateAndLog(FROM_HERE, error, Error::kInProgress,
@@ -108,6 +146,35 @@ bool DnsClient::Start(const string& hostname, Error* error) {
     return false;
   }
 
+  if (cache_) {
+    const DnsCache::Key key = GetCacheKey(hostname);
+    IPAddress address(address_.family());
+    if (cache_->Lookup(key, &address)) {
+      running_ = true;
+      address_ = address;
+      dispatcher_->PostTask(FROM_HERE, Bind(&DnsClient::HandleCompletion,
+                                            weak_ptr_factory_.GetWeakPtr()));
+      return true;
+    }
+    if (cache_->JoinLookup(key, Bind(&DnsClient::ReceiveSharedReply,
+                                     weak_ptr_factory_.GetWeakPtr(),
+                                     hostname))) {
+      running_ = true;
+      return true;
+    }
+    // Until it ends, the other clients looking up |hostname| wait for this
+    // lookup rather than sending queries of their own.
+    cache_lookup_ = key;
+  }
+
+  if (!StartQuery(hostname, error)) {
+    Stop();
+    return false;
+  }
+  return true;
+}
+
+bool DnsClient::StartQuery(const string& hostname, Error* error) {
   if (!resolver_state_) {
     struct ares_options options;
     memset(&options, 0, sizeof(options));
@@ -151,9 +218,18 @@ bool DnsClient::Start(const string& hostname, Error* error) {
   }
 
   running_ = true;
+  ttl_seconds_ = 0;
   time_->GetTimeMonotonic(&resolver_state_->start_time);
-  ares_->GetHostByName(resolver_state_->channel, hostname.c_str(),
-                       address_.family(), ReceiveDnsReplyCB, this);
+  if (cache_) {
+    // Unlike ares_gethostbyname(), a query reports the TTL of the records.
+    ares_->Search(resolver_state_->channel, hostname.c_str(), ns_c_in,
+                  address_.family() == IPAddress::kFamilyIPv4 ? ns_t_a
+                                                              : ns_t_aaaa,
+                  ReceiveDnsAnswerCB, this);
+  } else {
+    ares_->GetHostByName(resolver_state_->channel, hostname.c_str(),
+                         address_.family(), ReceiveDnsReplyCB, this);
+  }
 
   if (!RefreshHandles()) {
     LOG(ERROR) << interface_name_ << ": Impossibly short timeout.";
@@ -167,7 +243,20 @@ bool DnsClient::Start(const string& hostname, Error* error) {
 
 void DnsClient::Stop() {
   SLOG(this, 3) << "In " << __func__;
+  if (cache_lookup_) {
+    const DnsCache::Key key = *cache_lookup_;
+    cache_lookup_.reset();
+    cache_->AbandonLookup(key);
+  }
   if (!resolver_state_) {
+    // Requests answered by the cache or by the lookup of another client hold
+    // no resolver state.
+    if (running_) {
+      running_ = false;
+      weak_ptr_factory_.InvalidateWeakPtrs();
+      address_.SetAddressToDefault();
+    }
+    error_.Reset();
     return;
   }
 
@@ -189,9 +278,20 @@ bool DnsClient::IsActive() const {
 // call our destructor safely).
 void DnsClient::HandleCompletion() {
   SLOG(this, 3) << "In " << __func__;
+  running_ = false;
   Error error;
   error.CopyFrom(error_);
   IPAddress address(address_);
+  if (cache_lookup_) {
+    struct timeval now, elapsed_time;
+    time_->GetTimeMonotonic(&now);
+    timersub(&now, &resolver_state_->start_time, &elapsed_time);
+    const DnsCache::Key key = *cache_lookup_;
+    cache_lookup_.reset();
+    cache_->CompleteLookup(
+        key, error, address, ttl_seconds_,
+        elapsed_time.tv_sec * 1000 + elapsed_time.tv_usec / 1000);
+  }
   if (!error.IsSuccess()) {
     // If the DNS request did not succeed, do not trust it for future
     // attempts.
@@ -294,6 +394,43 @@ void DnsClient::ReceiveDnsReplyCB(void* arg,
   res->ReceiveDnsReply(status, hostent);
 }
 
+void DnsClient::ReceiveDnsAnswerCB(void* arg,
+                                   int status,
+                                   int /*timeouts*/,
+                                   unsigned char* abuf,
+                                   int alen) {
+  DnsClient* res = static_cast<DnsClient*>(arg);
+  struct hostent* hostent = nullptr;
+  if (status == ARES_SUCCESS) {
+    status = ParseAnswer(res->address_.family(), abuf, alen, &hostent,
+                         &res->ttl_seconds_);
+  }
+  res->ReceiveDnsReply(status, hostent);
+  if (hostent) {
+    ares_free_hostent(hostent);
+  }
+}
+
+void DnsClient::ReceiveSharedReply(const string& hostname,
+                                   const Error& error,
+                                   const IPAddress& address) {
+  SLOG(this, 3) << "In " << __func__;
+  running_ = false;
+  if (error.type() == Error::kOperationAborted) {
+    // The client which performed the lookup was stopped; try on our own.
+    Error start_error;
+    if (Start(hostname, &start_error)) {
+      return;
+    }
+    error_.CopyFrom(start_error);
+  } else {
+    error_.CopyFrom(error);
+    address_ = address;
+  }
+  dispatcher_->PostTask(FROM_HERE, Bind(&DnsClient::HandleCompletion,
+                                        weak_ptr_factory_.GetWeakPtr()));
+}
+
 bool DnsClient::RefreshHandles() {
   IOHandlerMap old_read(std::move(resolver_state_->read_handlers));
   IOHandlerMap old_write(std::move(resolver_state_->write_handlers));
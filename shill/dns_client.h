@@ -12,8 +12,10 @@
 #include <base/callback.h>
 #include <base/cancelable_callback.h>
 #include <base/memory/weak_ptr.h>
+#include <base/optional.h>
 #include <gtest/gtest_prod.h>  // for FRIEND_TEST
 
+#include "shill/dns_cache.h"
 #include "shill/error.h"
 #include "shill/event_dispatcher.h"
 #include "shill/net/ip_address.h"
@@ -69,9 +71,16 @@ class DnsClient {
 
   std::string interface_name() const { return interface_name_; }
 
+  // Makes the requests of this client look up |cache| first, and share their
+  // queries with those of the other clients using it. Unset by default.
+  void set_cache(DnsCache* cache) { cache_ = cache; }
+
  private:
   friend class DnsClientTest;
 
+  // Sends the query for |hostname| to the DNS servers.
+  bool StartQuery(const std::string& hostname, Error* error);
+  DnsCache::Key GetCacheKey(const std::string& hostname) const;
   void HandleCompletion();
   void HandleDnsRead(int fd);
   void HandleDnsWrite(int fd);
@@ -81,6 +90,16 @@ class DnsClient {
                                 int status,
                                 int timeouts,
                                 struct hostent* hostent);
+  static void ReceiveDnsAnswerCB(void* arg,
+                                 int status,
+                                 int timeouts,
+                                 unsigned char* abuf,
+                                 int alen);
+  // Receives the result of the lookup of |hostname| by another client, which
+  // this one joined.
+  void ReceiveSharedReply(const std::string& hostname,
+                          const Error& error,
+                          const IPAddress& address);
   bool RefreshHandles();
 
   Error error_;
@@ -97,6 +116,11 @@ class DnsClient {
   base::WeakPtrFactory<DnsClient> weak_ptr_factory_;
   Ares* ares_;
   Time* time_;
+  DnsCache* cache_;
+  // The lookup this client performs on behalf of |cache_|, if any, and the
+  // TTL of its answer.
+  base::Optional<DnsCache::Key> cache_lookup_;
+  uint32_t ttl_seconds_;
 
   DISALLOW_COPY_AND_ASSIGN(DnsClient);
 };
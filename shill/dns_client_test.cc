@@ -4,7 +4,9 @@
 
 #include "shill/dns_client.h"
 
+#include <arpa/nameser.h>
 #include <netdb.h>
+#include <string.h>
 
 #include <memory>
 #include <string>
@@ -13,6 +15,7 @@
 #include <base/bind.h>
 #include <base/strings/stringprintf.h>
 
+#include "shill/dns_cache.h"
 #include "shill/error.h"
 #include "shill/event_dispatcher.h"
 #include "shill/mock_ares.h"
@@ -54,6 +57,19 @@ const ares_channel kAresChannel =
 const int kAresFd = 10203;
 const int kAresTimeoutMS = 2000;  // ARES transaction timeout
 const int kAresWaitMS = 1000;     // Time period ARES asks caller to wait
+// The answer of a DNS server to a query for the A record of kGoodName: a
+// single record for kResult, with a TTL of 120 seconds.
+const unsigned char kAnswer[] = {
+    // Header: response, recursion available, 1 question, 1 answer.
+    0x12, 0x34, 0x81, 0x80, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00,
+    // Question: all-systems.mcast.net, type A, class IN.
+    0x0b, 'a', 'l', 'l', '-', 's', 'y', 's', 't', 'e', 'm', 's', 0x05, 'm',
+    'c', 'a', 's', 't', 0x03, 'n', 'e', 't', 0x00, 0x00, 0x01, 0x00, 0x01,
+    // Answer: the name of the question, type A, class IN, TTL, address.
+    0xc0, 0x0c, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x78, 0x00, 0x04,
+    224, 0, 0, 1,
+};
+const uint32_t kAnswerTtlSeconds = 120;
 }  // namespace
 
 class DnsClientTest : public Test {
@@ -95,6 +111,13 @@ class DnsClientTest : public Test {
                                    &hostent_);
   }
 
+  void CallAnswerCB() {
+    unsigned char answer[sizeof(kAnswer)];
+    memcpy(answer, kAnswer, sizeof(answer));
+    dns_client_->ReceiveDnsAnswerCB(dns_client_.get(), ARES_SUCCESS, 0, answer,
+                                    sizeof(answer));
+  }
+
   void CallDnsRead() { dns_client_->HandleDnsRead(kAresFd); }
 
   void CallDnsWrite() { dns_client_->HandleDnsWrite(kAresFd); }
@@ -104,14 +127,28 @@ class DnsClientTest : public Test {
   void CallCompletion() { dns_client_->HandleCompletion(); }
 
   void CreateClient(const vector<string>& dns_servers, int timeout_ms) {
-    dns_client_.reset(new DnsClient(IPAddress::kFamilyIPv4, kNetworkInterface,
-                                    dns_servers, timeout_ms, &dispatcher_,
-                                    callback_target_.callback()));
-    dns_client_->ares_ = &ares_;
-    dns_client_->time_ = &time_;
-    dns_client_->io_handler_factory_ = &io_handler_factory_;
+    dns_client_ = CreateClientWithCallback(dns_servers, timeout_ms,
+                                           callback_target_.callback());
   }
 
+  std::unique_ptr<DnsClient> CreateClientWithCallback(
+      const vector<string>& dns_servers,
+      int timeout_ms,
+      const DnsClient::ClientCallback& callback) {
+    auto client = std::make_unique<DnsClient>(IPAddress::kFamilyIPv4,
+                                              kNetworkInterface, dns_servers,
+                                              timeout_ms, &dispatcher_,
+                                              callback);
+    client->ares_ = &ares_;
+    client->time_ = &time_;
+    client->io_handler_factory_ = &io_handler_factory_;
+    return client;
+  }
+
+  void CallCompletion(DnsClient* client) { client->HandleCompletion(); }
+
+  uint32_t GetTtlSeconds() { return dns_client_->ttl_seconds_; }
+
   void SetActive() {
     // Returns that socket kAresFd is readable.
     EXPECT_CALL(ares_, GetSock(_, _, _))
@@ -125,7 +162,7 @@ class DnsClientTest : public Test {
     EXPECT_CALL(ares_, Timeout(_, _, _)).WillRepeatedly(ReturnArg<1>());
   }
 
-  void SetupRequest(const string& name, const string& server) {
+  void SetupResolver(const string& server) {
     vector<string> dns_servers = {server};
     CreateClient(dns_servers, kAresTimeoutMS);
     // These expectations are fulfilled when dns_client_->Start() is called.
@@ -135,9 +172,33 @@ class DnsClientTest : public Test {
         .WillOnce(Return(ARES_SUCCESS));
     EXPECT_CALL(ares_, SetLocalDev(kAresChannel, StrEq(kNetworkInterface)))
         .Times(1);
+  }
+
+  void SetupRequest(const string& name, const string& server) {
+    SetupResolver(server);
     EXPECT_CALL(ares_, GetHostByName(kAresChannel, StrEq(name), _, _, _));
   }
 
+  // Starts a request of kGoodName which goes through |cache_|.
+  void StartCachedRequest() {
+    SetupResolver(kGoodServer);
+    cache_.time_ = &time_;
+    EXPECT_CALL(time_, GetSecondsBoottime(_))
+        .WillRepeatedly(DoAll(SetArgPointee<0>(0), Return(true)));
+    dns_client_->set_cache(&cache_);
+    EXPECT_CALL(ares_,
+                Search(kAresChannel, StrEq(kGoodName), ns_c_in, ns_t_a, _, _));
+    EXPECT_CALL(io_handler_factory_,
+                CreateIOReadyHandler(kAresFd, IOHandler::kModeInput, _))
+        .WillOnce(ReturnNew<IOHandler>());
+    SetActive();
+    EXPECT_CALL(dispatcher_, PostDelayedTask(_, _, kAresWaitMS));
+    Error error;
+    ASSERT_TRUE(dns_client_->Start(kGoodName, &error));
+    EXPECT_TRUE(error.IsSuccess());
+    EXPECT_CALL(ares_, Destroy(kAresChannel));
+  }
+
   void StartValidRequest() {
     SetupRequest(kGoodName, kGoodServer);
     EXPECT_CALL(io_handler_factory_,
@@ -208,6 +269,7 @@ class DnsClientTest : public Test {
   StrictMock<DnsCallbackTarget> callback_target_;
   StrictMock<MockAres> ares_;
   StrictMock<MockTime> time_;
+  DnsCache cache_;
   struct timeval time_val_;
   struct timeval ares_timeout_;
   struct hostent hostent_;
@@ -429,4 +491,63 @@ TEST_F(DnsClientTest, IOHandleDeallocStop) {
   dns_client_->Stop();
 }
 
+// A request through the cache gets the TTL of the answer, which the cache
+// then respects.
+TEST_F(DnsClientTest, CachedRequest) {
+  StartCachedRequest();
+  AdvanceTime(300);
+  EXPECT_CALL(ares_, ProcessFd(kAresChannel, kAresFd, ARES_SOCKET_BAD))
+      .WillOnce(InvokeWithoutArgs(this, &DnsClientTest::CallAnswerCB));
+  ExpectPostCompletionTask();
+  CallDnsRead();
+  EXPECT_EQ(kAnswerTtlSeconds, GetTtlSeconds());
+
+  IPAddress result(IPAddress::kFamilyIPv4);
+  ASSERT_TRUE(result.SetAddressFromString(kResult));
+  EXPECT_CALL(callback_target_, CallTarget(IsSuccess(), result));
+  CallCompletion();
+  EXPECT_EQ(1, cache_.stats().completed);
+  EXPECT_EQ(300, cache_.stats().total_latency_milliseconds);
+
+  // The next request is answered from the cache, without a query.
+  ExpectPostCompletionTask();
+  Error error;
+  ASSERT_TRUE(dns_client_->Start(kGoodName, &error));
+  EXPECT_TRUE(dns_client_->IsActive());
+  EXPECT_CALL(callback_target_, CallTarget(IsSuccess(), result));
+  CallCompletion();
+  EXPECT_FALSE(dns_client_->IsActive());
+  EXPECT_EQ(1, cache_.stats().hits);
+}
+
+// A request for a name another client is looking up waits for its answer.
+TEST_F(DnsClientTest, SharedRequest) {
+  StartCachedRequest();
+
+  StrictMock<DnsCallbackTarget> other_target;
+  std::unique_ptr<DnsClient> other_client = CreateClientWithCallback(
+      {kGoodServer}, kAresTimeoutMS, other_target.callback());
+  other_client->set_cache(&cache_);
+  Error error;
+  ASSERT_TRUE(other_client->Start(kGoodName, &error));
+  EXPECT_TRUE(other_client->IsActive());
+  EXPECT_EQ(1, cache_.stats().coalesced);
+
+  EXPECT_CALL(ares_, ProcessFd(kAresChannel, kAresFd, ARES_SOCKET_BAD))
+      .WillOnce(InvokeWithoutArgs(this, &DnsClientTest::CallAnswerCB));
+  ExpectPostCompletionTask();
+  CallDnsRead();
+
+  IPAddress result(IPAddress::kFamilyIPv4);
+  ASSERT_TRUE(result.SetAddressFromString(kResult));
+  EXPECT_CALL(callback_target_, CallTarget(IsSuccess(), result));
+  // The completion of the other client is posted in turn.
+  ExpectPostCompletionTask();
+  CallCompletion();
+
+  EXPECT_CALL(other_target, CallTarget(IsSuccess(), result));
+  CallCompletion(other_client.get());
+  EXPECT_FALSE(other_client->IsActive());
+}
+
 }  // namespace shill
@@ -63,6 +63,10 @@ bool FakeStore::Flush() {
   return true;
 }
 
+bool FakeStore::FlushPending() {
+  return true;
+}
+
 bool FakeStore::MarkAsCorrupted() {
   return true;
 }
@@ -30,6 +30,7 @@ class FakeStore : public StoreInterface {
   bool Open() override;
   bool Close() override;
   bool Flush() override;
+  bool FlushPending() override;
   bool MarkAsCorrupted() override;
   std::set<std::string> GetGroups() const override;
   std::set<std::string> GetGroupsWithKey(const std::string& key) const override;
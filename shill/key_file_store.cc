@@ -9,6 +9,7 @@
 #include <memory>
 #include <utility>
 
+#include <base/bind.h>
 #include <base/files/file_util.h>
 #include <base/files/important_file_writer.h>
 #include <base/optional.h>
@@ -24,6 +25,7 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include "shill/event_dispatcher.h"
 #include "shill/key_value_store.h"
 #include "shill/logging.h"
 
@@ -160,14 +162,19 @@ class Group {
  public:
   explicit Group(const string& name) : name_(name) {}
 
-  void Set(const string& key, const string& value) {
+  // Returns false if |key| already had |value|.
+  bool Set(const string& key, const string& value) {
     if (index_.count(key) > 0) {
+      if (index_[key]->second == value) {
+        return false;
+      }
       index_[key]->second = value;
-      return;
+      return true;
     }
 
     entries_.push_back({key, value});
     index_[key] = &entries_.back();
+    return true;
   }
 
   base::Optional<string> Get(const string& key) const {
@@ -300,9 +307,12 @@ class KeyFileStore::KeyFile {
     if (index_.count(group) == 0) {
       groups_.emplace_back(group);
       index_[group] = &groups_.back();
+      dirty_ = true;
     }
 
-    index_[group]->Set(key, value);
+    if (index_[group]->Set(key, value)) {
+      dirty_ = true;
+    }
   }
 
   base::Optional<string> Get(const string& group, const string& key) const {
@@ -322,7 +332,9 @@ class KeyFileStore::KeyFile {
 
     // Older behavior here was that deleting a nonexistent key from an
     // existing group did not return an error, so replicate that here.
-    it->second->Delete(key);
+    if (it->second->Delete(key)) {
+      dirty_ = true;
+    }
     return true;
   }
 
@@ -337,6 +349,7 @@ class KeyFileStore::KeyFile {
     Group* grp = it->second;
     index_.erase(it);
     base::EraseIf(groups_, [grp](const Group& g) { return &g == grp; });
+    dirty_ = true;
   }
 
   set<string> GetGroups() const {
@@ -355,9 +368,13 @@ class KeyFileStore::KeyFile {
     for (const string& line : lines) {
       pre_group_comments_.push_back("#" + line);
     }
+    dirty_ = true;
   }
 
-  bool Flush() const {
+  // Whether the contents changed since they were loaded or last written.
+  bool IsDirty() const { return dirty_; }
+
+  bool Flush() {
     string to_write;
     for (const string& line : pre_group_comments_) {
       to_write += line + '\n';
@@ -371,6 +388,7 @@ class KeyFileStore::KeyFile {
       LOG(ERROR) << "Failed to store key file: " << path_.value();
       return false;
     }
+    dirty_ = false;
     return true;
   }
 
@@ -382,12 +400,14 @@ class KeyFileStore::KeyFile {
       : path_(path),
         pre_group_comments_(pre_group_comments),
         groups_(std::move(groups)),
-        index_(std::move(index)) {}
+        index_(std::move(index)),
+        dirty_(false) {}
 
   base::FilePath path_;
   std::list<string> pre_group_comments_;
   std::list<Group> groups_;
   std::map<string, Group*> index_;
+  bool dirty_;
 
   DISALLOW_COPY_AND_ASSIGN(KeyFile);
 };
@@ -395,11 +415,25 @@ class KeyFileStore::KeyFile {
 const char KeyFileStore::kCorruptSuffix[] = ".corrupted";
 
 KeyFileStore::KeyFileStore(const base::FilePath& path)
-    : crypto_(), key_file_(nullptr), path_(path) {
+    : KeyFileStore(path, nullptr, 0) {}
+
+KeyFileStore::KeyFileStore(const base::FilePath& path,
+                           EventDispatcher* dispatcher,
+                           int64_t flush_delay_milliseconds)
+    : crypto_(),
+      key_file_(nullptr),
+      path_(path),
+      dispatcher_(dispatcher),
+      flush_delay_milliseconds_(flush_delay_milliseconds),
+      flush_scheduled_(false) {
   CHECK(!path_.empty());
 }
 
-KeyFileStore::~KeyFileStore() = default;
+KeyFileStore::~KeyFileStore() {
+  if (key_file_) {
+    FlushPending();
+  }
+}
 
 bool KeyFileStore::IsEmpty() const {
   int64_t file_size = 0;
@@ -425,15 +459,48 @@ bool KeyFileStore::Open() {
 }
 
 bool KeyFileStore::Close() {
-  bool success = Flush();
+  flush_task_.Cancel();
+  flush_scheduled_ = false;
+  bool success = key_file_->Flush();
   key_file_.reset();
   return success;
 }
 
 bool KeyFileStore::Flush() {
+  if (!key_file_->IsDirty()) {
+    SLOG(this, 5) << "Nothing to flush to " << path_.value();
+    return true;
+  }
+  if (!dispatcher_) {
+    return key_file_->Flush();
+  }
+
+  // The changes of the flushes until the delayed one runs are written at
+  // once.
+  if (!flush_scheduled_) {
+    flush_scheduled_ = true;
+    flush_task_.Reset(
+        base::Bind(&KeyFileStore::WriteDelayedFlush, base::Unretained(this)));
+    dispatcher_->PostDelayedTask(FROM_HERE, flush_task_.callback(),
+                                 flush_delay_milliseconds_);
+  }
+  return true;
+}
+
+bool KeyFileStore::FlushPending() {
+  if (!flush_scheduled_) {
+    return true;
+  }
+  flush_task_.Cancel();
+  flush_scheduled_ = false;
   return key_file_->Flush();
 }
 
+void KeyFileStore::WriteDelayedFlush() {
+  flush_scheduled_ = false;
+  key_file_->Flush();
+}
+
 bool KeyFileStore::MarkAsCorrupted() {
   LOG(INFO) << "In " << __func__ << " for " << path_.value();
   string corrupted_path = path_.value() + kCorruptSuffix;
@@ -707,4 +774,12 @@ std::unique_ptr<StoreInterface> CreateStore(const base::FilePath& path) {
   return std::make_unique<KeyFileStore>(path);
 }
 
+std::unique_ptr<StoreInterface> CreateCoalescingStore(
+    const base::FilePath& path,
+    EventDispatcher* dispatcher,
+    int64_t flush_delay_milliseconds) {
+  return std::make_unique<KeyFileStore>(path, dispatcher,
+                                        flush_delay_milliseconds);
+}
+
 }  // namespace shill
@@ -10,6 +10,7 @@
 #include <string>
 #include <vector>
 
+#include <base/cancelable_callback.h>
 #include <base/files/file_path.h>
 #include <gtest/gtest_prod.h>  // for FRIEND_TEST
 
@@ -18,6 +19,8 @@
 
 namespace shill {
 
+class EventDispatcher;
+
 // A key file store implementation of the store interface. See
 // https://specifications.freedesktop.org/desktop-entry-spec/latest/ar01s03.html
 // for details of the key file format, and
@@ -25,9 +28,16 @@ namespace shill {
 // for details of the GLib API that is being reimplemented here.
 // This implementation does not support locales because we do not use locale
 // strings and never have.
+// Flush() only rewrites the file if its contents changed. When created with
+// a dispatcher, it also delays the write so that the changes of the flushes
+// in the meantime are written at once; FlushPending(), Close() and the
+// destructor write out a delayed flush right away.
 class KeyFileStore : public StoreInterface {
  public:
   explicit KeyFileStore(const base::FilePath& path);
+  KeyFileStore(const base::FilePath& path,
+               EventDispatcher* dispatcher,
+               int64_t flush_delay_milliseconds);
   ~KeyFileStore() override;
 
   // Inherited from StoreInterface.
@@ -35,6 +45,7 @@ class KeyFileStore : public StoreInterface {
   bool Open() override;
   bool Close() override;
   bool Flush() override;
+  bool FlushPending() override;
   bool MarkAsCorrupted() override;
   std::set<std::string> GetGroups() const override;
   std::set<std::string> GetGroupsWithKey(const std::string& key) const override;
@@ -84,6 +95,7 @@ class KeyFileStore : public StoreInterface {
  private:
   FRIEND_TEST(KeyFileStoreTest, OpenClose);
   FRIEND_TEST(KeyFileStoreTest, OpenFail);
+  FRIEND_TEST(KeyFileStoreTest, CoalescedFlush);
 
   class KeyFile;
 
@@ -92,10 +104,20 @@ class KeyFileStore : public StoreInterface {
   bool DoesGroupMatchProperties(const std::string& group,
                                 const KeyValueStore& properties) const;
 
+  // Writes out the changes of the flushes since the delayed one was
+  // scheduled.
+  void WriteDelayedFlush();
+
   CryptoProvider crypto_;
   std::unique_ptr<KeyFile> key_file_;
   const base::FilePath path_;
 
+  // Set if flushes are delayed.
+  EventDispatcher* dispatcher_;
+  const int64_t flush_delay_milliseconds_;
+  base::CancelableClosure flush_task_;
+  bool flush_scheduled_;
+
   DISALLOW_COPY_AND_ASSIGN(KeyFileStore);
 };
 
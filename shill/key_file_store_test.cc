@@ -20,6 +20,7 @@
 #include <gtest/gtest.h>
 
 #include "shill/key_value_store.h"
+#include "shill/test_event_dispatcher.h"
 
 using base::FileEnumerator;
 using base::FilePath;
@@ -814,22 +815,15 @@ TEST_F(KeyFileStoreTest, PersistAcrossClose) {
 }
 
 namespace {
-class ReadOnlyKeyFileStore : public KeyFileStore {
- public:
-  explicit ReadOnlyKeyFileStore(const base::FilePath& path)
-      : KeyFileStore(path) {}
-  bool Flush() override { return true; }
-};
-
 bool OpenCheckClose(const FilePath& path,
                     const string& group,
                     const string& key,
                     const string& expected_value) {
-  ReadOnlyKeyFileStore store(path);  // Don't modify file owned by caller.
+  KeyFileStore store(path);
   EXPECT_TRUE(store.Open());
   string value;
   bool could_get = store.GetString(group, key, &value);
-  store.Close();
+  // Not closed, since Close() rewrites the file owned by the caller.
   return could_get && expected_value == value;
 }
 
@@ -851,9 +845,57 @@ TEST_F(KeyFileStoreTest, Flush) {
   EXPECT_TRUE(store_->DeleteKey(kGroup, kKey1));
   ASSERT_TRUE(store_->Flush());
   ASSERT_FALSE(OpenCheckClose(test_file_, kGroup, kKey1, kValue1));
+
+  // Setting a key to the value it has does not make the file be rewritten.
+  WriteKeyFile("");
+  ASSERT_TRUE(store_->SetString(kGroup, kKey2, kValue2));
+  ASSERT_TRUE(store_->Flush());
+  EXPECT_TRUE(store_->IsEmpty());
 }
 }  // namespace
 
+TEST_F(KeyFileStoreTest, CoalescedFlush) {
+  static const char kGroup[] = "string-group";
+  static const char kKey1[] = "test-string";
+  static const char kValue1[] = "foo";
+  static const char kKey2[] = "other-string";
+  static const char kValue2[] = "bar";
+  EventDispatcherForTest dispatcher;
+  store_.reset(new KeyFileStore(test_file_, &dispatcher, 0));
+  ASSERT_TRUE(store_->Open());
+
+  // Both changes are written by the delayed flush.
+  ASSERT_TRUE(store_->SetString(kGroup, kKey1, kValue1));
+  ASSERT_TRUE(store_->Flush());
+  ASSERT_TRUE(store_->SetString(kGroup, kKey2, kValue2));
+  ASSERT_TRUE(store_->Flush());
+  EXPECT_TRUE(store_->flush_scheduled_);
+  EXPECT_TRUE(store_->IsEmpty());
+  dispatcher.DispatchPendingEvents();
+  EXPECT_FALSE(store_->flush_scheduled_);
+  EXPECT_TRUE(OpenCheckClose(test_file_, kGroup, kKey1, kValue1));
+  EXPECT_TRUE(OpenCheckClose(test_file_, kGroup, kKey2, kValue2));
+
+  // Nothing changed, so there is nothing to write.
+  ASSERT_TRUE(store_->Flush());
+  EXPECT_FALSE(store_->flush_scheduled_);
+
+  // FlushPending() writes a delayed flush right away.
+  EXPECT_TRUE(store_->DeleteKey(kGroup, kKey1));
+  ASSERT_TRUE(store_->Flush());
+  EXPECT_TRUE(OpenCheckClose(test_file_, kGroup, kKey1, kValue1));
+  ASSERT_TRUE(store_->FlushPending());
+  EXPECT_FALSE(store_->flush_scheduled_);
+  EXPECT_FALSE(OpenCheckClose(test_file_, kGroup, kKey1, kValue1));
+  dispatcher.DispatchPendingEvents();
+
+  // So does Close().
+  ASSERT_TRUE(store_->SetString(kGroup, kKey1, kValue1));
+  ASSERT_TRUE(store_->Flush());
+  ASSERT_TRUE(store_->Close());
+  EXPECT_TRUE(OpenCheckClose(test_file_, kGroup, kKey1, kValue1));
+}
+
 TEST_F(KeyFileStoreTest, EmptyFile) {
   ASSERT_TRUE(store_->Open());
   ASSERT_TRUE(store_->Close());
@@ -4,6 +4,10 @@
 
 #include "shill/link_monitor.h"
 
+#include <linux/if.h>
+#include <linux/neighbour.h>
+#include <linux/rtnetlink.h>
+
 #include <string>
 
 #include <base/bind.h>
@@ -13,6 +17,9 @@
 #include "shill/device_info.h"
 #include "shill/event_dispatcher.h"
 #include "shill/logging.h"
+#include "shill/net/rtnl_handler.h"
+#include "shill/net/rtnl_listener.h"
+#include "shill/net/rtnl_message.h"
 #include "shill/net/shill_time.h"
 #include "shill/passive_link_monitor.h"
 
@@ -53,7 +60,13 @@ LinkMonitor::LinkMonitor(const ConnectionRefPtr& connection,
           dispatcher,
           Bind(&LinkMonitor::OnPassiveLinkMonitorResultCallback,
                Unretained(this)))),
-      time_(Time::GetInstance()) {}
+      time_(Time::GetInstance()),
+      neighbor_events_enabled_(false),
+      rtnl_handler_(RTNLHandler::GetInstance()),
+      neighbor_wakeups_(0),
+      arp_escalations_(0) {
+  timerclear(&escalated_at_);
+}
 
 LinkMonitor::~LinkMonitor() {
   Stop();
@@ -70,6 +83,7 @@ bool LinkMonitor::Start() {
 void LinkMonitor::Stop() {
   SLOG(connection_.get(), 2) << "In " << __func__ << ".";
   timerclear(&started_monitoring_at_);
+  StopNeighborMonitor();
   active_link_monitor_->Stop();
   passive_link_monitor_->Stop();
   gateway_mac_address_.Clear();
@@ -111,6 +125,14 @@ void LinkMonitor::OnActiveLinkMonitorFailure(
       connection_->technology(), failure, elapsed_time.tv_sec,
       broadcast_failure_count, unicast_failure_count);
 
+  if (timerisset(&escalated_at_)) {
+    struct timeval latency;
+    timersub(&now, &escalated_at_, &latency);
+    metrics_->NotifyLinkMonitorDetectionLatency(
+        connection_->technology(),
+        latency.tv_sec * 1000 + latency.tv_usec / 1000);
+  }
+
   Stop();
 }
 
@@ -122,6 +144,14 @@ void LinkMonitor::OnActiveLinkMonitorSuccess() {
     gateway_change_callback_.Run();
   }
 
+  if (neighbor_events_enabled_) {
+    // Leave it to the kernel to tell when the gateway needs to be probed
+    // again.
+    timerclear(&escalated_at_);
+    StartNeighborMonitor();
+    return;
+  }
+
   // Start passive link monitoring.
   passive_link_monitor_->Start(PassiveLinkMonitor::kDefaultMonitorCycles);
 }
@@ -134,4 +164,85 @@ void LinkMonitor::OnPassiveLinkMonitorResultCallback(bool status) {
       ActiveLinkMonitor::kDefaultTestPeriodMilliseconds);
 }
 
+void LinkMonitor::StartNeighborMonitor() {
+  if (neighbor_listener_) {
+    return;
+  }
+  SLOG(connection_.get(), 2) << "Watching neighbor state of gateway "
+                             << connection_->gateway().ToString();
+  neighbor_listener_.reset(new RTNLListener(
+      RTNLHandler::kRequestNeighbor,
+      Bind(&LinkMonitor::OnNeighborMsgReceived, Unretained(this)),
+      rtnl_handler_));
+  link_listener_.reset(new RTNLListener(
+      RTNLHandler::kRequestLink,
+      Bind(&LinkMonitor::OnLinkMsgReceived, Unretained(this)), rtnl_handler_));
+}
+
+void LinkMonitor::StopNeighborMonitor() {
+  if (!neighbor_listener_) {
+    return;
+  }
+  neighbor_listener_.reset();
+  link_listener_.reset();
+  timerclear(&escalated_at_);
+  metrics_->NotifyLinkMonitorNeighborWakeups(
+      connection_->technology(), neighbor_wakeups_, arp_escalations_);
+  neighbor_wakeups_ = 0;
+  arp_escalations_ = 0;
+}
+
+void LinkMonitor::OnNeighborMsgReceived(const RTNLMessage& msg) {
+  DCHECK(msg.type() == RTNLMessage::kTypeNeighbor);
+  if (msg.mode() != RTNLMessage::kModeAdd ||
+      msg.interface_index() != connection_->interface_index() ||
+      !msg.HasAttribute(NDA_DST)) {
+    return;
+  }
+  IPAddress address(msg.family(), msg.GetAttribute(NDA_DST));
+  if (!address.Equals(connection_->gateway())) {
+    return;
+  }
+
+  neighbor_wakeups_++;
+  const uint16_t state = msg.neighbor_status().state;
+  SLOG(connection_.get(), 3) << "Gateway neighbor state is 0x" << std::hex
+                             << state;
+  if (state & NUD_FAILED) {
+    EscalateToActiveLinkMonitor(
+        ActiveLinkMonitor::kFastTestPeriodMilliseconds);
+  } else if (state & NUD_STALE) {
+    EscalateToActiveLinkMonitor(
+        ActiveLinkMonitor::kDefaultTestPeriodMilliseconds);
+  }
+}
+
+void LinkMonitor::OnLinkMsgReceived(const RTNLMessage& msg) {
+  DCHECK(msg.type() == RTNLMessage::kTypeLink);
+  if (msg.mode() != RTNLMessage::kModeAdd ||
+      msg.interface_index() != connection_->interface_index()) {
+    return;
+  }
+
+  neighbor_wakeups_++;
+  if (!(msg.link_status().flags & IFF_LOWER_UP)) {
+    SLOG(connection_.get(), 2) << "Carrier lost";
+    EscalateToActiveLinkMonitor(
+        ActiveLinkMonitor::kFastTestPeriodMilliseconds);
+  }
+}
+
+void LinkMonitor::EscalateToActiveLinkMonitor(int probe_period_milliseconds) {
+  if (timerisset(&escalated_at_)) {
+    // Already probing the gateway.
+    return;
+  }
+  arp_escalations_++;
+  time_->GetTimeMonotonic(&escalated_at_);
+  if (!active_link_monitor_->Start(probe_period_milliseconds)) {
+    // Let the next event try again.
+    timerclear(&escalated_at_);
+  }
+}
+
 }  // namespace shill
@@ -22,6 +22,9 @@ class ActiveLinkMonitor;
 class DeviceInfo;
 class EventDispatcher;
 class PassiveLinkMonitor;
+class RTNLHandler;
+class RTNLListener;
+class RTNLMessage;
 class Time;
 
 class LinkMonitor {
@@ -68,6 +71,14 @@ class LinkMonitor {
 
   const ByteString& gateway_mac_address() const { return gateway_mac_address_; }
 
+  // Once the gateway is found, watch the kernel neighbor entry of the gateway
+  // and the carrier of the link instead of sniffing ARP requests, and only
+  // probe the gateway when the kernel reports the entry as stale or failed,
+  // or the carrier as lost.  Takes effect on the next Start().
+  void set_neighbor_events_enabled(bool enabled) {
+    neighbor_events_enabled_ = enabled;
+  }
+
  private:
   friend class LinkMonitorTest;
 
@@ -77,6 +88,16 @@ class LinkMonitor {
   void OnActiveLinkMonitorSuccess();
   void OnPassiveLinkMonitorResultCallback(bool status);
 
+  // Starts listening to neighbor and link events, unless already listening.
+  void StartNeighborMonitor();
+  // Stops listening, and reports how often the events woke us up.
+  void StopNeighborMonitor();
+  void OnNeighborMsgReceived(const RTNLMessage& msg);
+  void OnLinkMsgReceived(const RTNLMessage& msg);
+  // Starts the ActiveLinkMonitor to confirm that the gateway is still
+  // reachable, unless it is already running.
+  void EscalateToActiveLinkMonitor(int probe_period_milliseconds);
+
   // The connection on which to perform link monitoring.
   ConnectionRefPtr connection_;
   // Dispatcher on which to create delayed tasks.
@@ -96,6 +117,20 @@ class LinkMonitor {
   // Time instance for performing GetTimeMonotonic().
   Time* time_;
 
+  // Whether to watch kernel neighbor events once the gateway is found, see
+  // set_neighbor_events_enabled().
+  bool neighbor_events_enabled_;
+  RTNLHandler* rtnl_handler_;
+  std::unique_ptr<RTNLListener> neighbor_listener_;
+  std::unique_ptr<RTNLListener> link_listener_;
+  // The time at which a kernel event made us probe the gateway, cleared when
+  // the probe completes.
+  struct timeval escalated_at_;
+  // Number of kernel events about the gateway or the link which were handled,
+  // and number of those which made us probe the gateway.
+  int neighbor_wakeups_;
+  int arp_escalations_;
+
   DISALLOW_COPY_AND_ASSIGN(LinkMonitor);
 };
 
@@ -4,6 +4,9 @@
 
 #include "shill/link_monitor.h"
 
+#include <linux/if.h>
+#include <linux/neighbour.h>
+
 #include <base/bind.h>
 #include <gtest/gtest.h>
 
@@ -17,7 +20,9 @@
 #include "shill/mock_metrics.h"
 #include "shill/mock_passive_link_monitor.h"
 #include "shill/net/byte_string.h"
+#include "shill/net/mock_rtnl_handler.h"
 #include "shill/net/mock_time.h"
+#include "shill/net/rtnl_message.h"
 #include "shill/test_event_dispatcher.h"
 
 using base::Bind;
@@ -36,6 +41,8 @@ namespace shill {
 
 namespace {
 const uint8_t kGatewayMacAddress[] = {0, 1, 2, 3, 4, 5};
+const char kGatewayIPAddress[] = "192.168.1.1";
+const char kOtherIPAddress[] = "192.168.1.2";
 }  // namespace
 
 class LinkMonitorObserver {
@@ -71,6 +78,7 @@ class LinkMonitorTest : public Test {
       : manager_(&control_, &dispatcher_, &metrics_),
         device_info_(&manager_),
         connection_(new StrictMock<MockConnection>(&device_info_)),
+        gateway_(IPAddress::kFamilyIPv4),
         active_link_monitor_(new MockActiveLinkMonitor()),
         passive_link_monitor_(new MockPassiveLinkMonitor()),
         monitor_(connection_,
@@ -85,6 +93,7 @@ class LinkMonitorTest : public Test {
     monitor_.active_link_monitor_.reset(active_link_monitor_);
     monitor_.passive_link_monitor_.reset(passive_link_monitor_);
     monitor_.time_ = &time_;
+    monitor_.rtnl_handler_ = &rtnl_handler_;
 
     time_val_.tv_sec = 0;
     time_val_.tv_usec = 0;
@@ -92,6 +101,8 @@ class LinkMonitorTest : public Test {
         .WillRepeatedly(DoAll(SetArgPointee<0>(time_val_), Return(0)));
     EXPECT_CALL(*connection_, technology())
         .WillRepeatedly(Return(Technology::kEthernet));
+    ASSERT_TRUE(gateway_.SetAddressFromString(kGatewayIPAddress));
+    EXPECT_CALL(*connection_, gateway()).WillRepeatedly(ReturnRef(gateway_));
   }
 
   void AdvanceTime(int time_ms) {
@@ -125,6 +136,25 @@ class LinkMonitorTest : public Test {
     monitor_.OnPassiveLinkMonitorResultCallback(status);
   }
 
+  void EnableNeighborEvents() { monitor_.set_neighbor_events_enabled(true); }
+
+  void TriggerNeighborMsg(const char* address, uint16_t state) {
+    IPAddress destination(IPAddress::kFamilyIPv4);
+    ASSERT_TRUE(destination.SetAddressFromString(address));
+    RTNLMessage msg(RTNLMessage::kTypeNeighbor, RTNLMessage::kModeAdd, 0, 0, 0,
+                    connection_->interface_index(), IPAddress::kFamilyIPv4);
+    msg.set_neighbor_status(RTNLMessage::NeighborStatus(state, 0, NDA_DST));
+    msg.SetAttribute(NDA_DST, destination.address());
+    monitor_.OnNeighborMsgReceived(msg);
+  }
+
+  void TriggerLinkMsg(unsigned int flags) {
+    RTNLMessage msg(RTNLMessage::kTypeLink, RTNLMessage::kModeAdd, 0, 0, 0,
+                    connection_->interface_index(), IPAddress::kFamilyIPv4);
+    msg.set_link_status(RTNLMessage::LinkStatus(0, flags, 0));
+    monitor_.OnLinkMsgReceived(msg);
+  }
+
  protected:
   EventDispatcherForTest dispatcher_;
   StrictMock<MockMetrics> metrics_;
@@ -132,8 +162,10 @@ class LinkMonitorTest : public Test {
   MockManager manager_;
   NiceMock<MockDeviceInfo> device_info_;
   scoped_refptr<MockConnection> connection_;
+  IPAddress gateway_;
   MockTime time_;
   struct timeval time_val_;
+  NiceMock<MockRTNLHandler> rtnl_handler_;
   MockActiveLinkMonitor* active_link_monitor_;
   MockPassiveLinkMonitor* passive_link_monitor_;
   LinkMonitorObserver observer_;
@@ -250,4 +282,93 @@ TEST_F(LinkMonitorTest, OnPassiveLinkMonitorResultCallback) {
   Mock::VerifyAndClearExpectations(active_link_monitor_);
 }
 
+TEST_F(LinkMonitorTest, NeighborEventsReplacePassiveLinkMonitor) {
+  EnableNeighborEvents();
+  ByteString gateway_mac(kGatewayMacAddress, arraysize(kGatewayMacAddress));
+  EXPECT_CALL(*active_link_monitor_, gateway_mac_address())
+      .WillRepeatedly(ReturnRef(gateway_mac));
+  EXPECT_CALL(observer_, OnGatewayChangeCallback());
+
+  // Once the gateway is found, the kernel tells when to probe it again.
+  EXPECT_CALL(*passive_link_monitor_, Start(_)).Times(0);
+  EXPECT_CALL(rtnl_handler_, AddListener(_)).Times(2);
+  TriggerActiveLinkMonitorSuccess();
+  Mock::VerifyAndClearExpectations(&rtnl_handler_);
+
+  // Neither other neighbors nor a reachable gateway are probed.
+  EXPECT_CALL(*active_link_monitor_, Start(_)).Times(0);
+  TriggerNeighborMsg(kOtherIPAddress, NUD_FAILED);
+  TriggerNeighborMsg(kGatewayIPAddress, NUD_REACHABLE);
+  TriggerLinkMsg(IFF_UP | IFF_LOWER_UP);
+  Mock::VerifyAndClearExpectations(active_link_monitor_);
+
+  // A stale gateway is probed, once.
+  AdvanceTime(1000);
+  EXPECT_CALL(*active_link_monitor_,
+              Start(ActiveLinkMonitor::kDefaultTestPeriodMilliseconds))
+      .WillOnce(Return(true));
+  TriggerNeighborMsg(kGatewayIPAddress, NUD_STALE);
+  TriggerNeighborMsg(kGatewayIPAddress, NUD_FAILED);
+  Mock::VerifyAndClearExpectations(active_link_monitor_);
+
+  // Until it answers.
+  EXPECT_CALL(*active_link_monitor_, gateway_mac_address())
+      .WillRepeatedly(ReturnRef(gateway_mac));
+  EXPECT_CALL(rtnl_handler_, AddListener(_)).Times(0);
+  TriggerActiveLinkMonitorSuccess();
+  EXPECT_CALL(*active_link_monitor_,
+              Start(ActiveLinkMonitor::kFastTestPeriodMilliseconds))
+      .WillOnce(Return(true));
+  TriggerNeighborMsg(kGatewayIPAddress, NUD_FAILED);
+  Mock::VerifyAndClearExpectations(active_link_monitor_);
+
+  // The time from the kernel event to the failure is reported, as are the
+  // events we were woken up by.
+  EXPECT_CALL(observer_, OnFailureCallback());
+  EXPECT_CALL(metrics_, SendEnumToUMA(HasSubstr("LinkMonitorFailure"), _, _));
+  EXPECT_CALL(metrics_, SendToUMA(HasSubstr("LinkMonitorSecondsToFailure"),
+                                  _, _, _, _));
+  EXPECT_CALL(metrics_, SendToUMA(HasSubstr("ErrorsAtFailure"), _, _, _, _))
+      .Times(2);
+  EXPECT_CALL(metrics_,
+              SendToUMA(HasSubstr("LinkMonitorDetectionLatency"), 2500, _, _,
+                        _));
+  EXPECT_CALL(metrics_,
+              SendToUMA(HasSubstr("LinkMonitorNeighborWakeups"), 5, _, _, _));
+  EXPECT_CALL(metrics_,
+              SendToUMA(HasSubstr("LinkMonitorArpEscalations"), 2, _, _, _));
+  AdvanceTime(2500);
+  TriggerActiveLinkMonitorFailure(Metrics::kLinkMonitorFailureThresholdReached,
+                                  5, 0);
+}
+
+TEST_F(LinkMonitorTest, NeighborEventsCarrierLoss) {
+  EnableNeighborEvents();
+  ByteString gateway_mac(kGatewayMacAddress, arraysize(kGatewayMacAddress));
+  EXPECT_CALL(*active_link_monitor_, gateway_mac_address())
+      .WillRepeatedly(ReturnRef(gateway_mac));
+  EXPECT_CALL(observer_, OnGatewayChangeCallback());
+  TriggerActiveLinkMonitorSuccess();
+
+  // A failure to start probing is retried on the next event.
+  AdvanceTime(1000);
+  EXPECT_CALL(*active_link_monitor_,
+              Start(ActiveLinkMonitor::kFastTestPeriodMilliseconds))
+      .WillOnce(Return(false))
+      .WillOnce(Return(true));
+  TriggerLinkMsg(IFF_UP);
+  TriggerLinkMsg(IFF_UP);
+  Mock::VerifyAndClearExpectations(active_link_monitor_);
+
+  EXPECT_CALL(metrics_,
+              SendToUMA(HasSubstr("LinkMonitorNeighborWakeups"), 2, _, _, _));
+  EXPECT_CALL(metrics_,
+              SendToUMA(HasSubstr("LinkMonitorArpEscalations"), 2, _, _, _));
+  monitor_.Stop();
+  Mock::VerifyAndClearExpectations(&metrics_);
+
+  // Nothing is reported when the monitor did not watch kernel events.
+  monitor_.Stop();
+}
+
 }  // namespace shill
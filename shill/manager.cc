@@ -12,6 +12,7 @@
 #include <iterator>
 #include <set>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include <base/bind.h>
@@ -34,6 +35,7 @@
 #include "shill/device.h"
 #include "shill/device_claimer.h"
 #include "shill/device_info.h"
+#include "shill/dns_cache.h"
 #include "shill/ephemeral_profile.h"
 #include "shill/error.h"
 #include "shill/ethernet/ethernet_provider.h"
@@ -47,6 +49,7 @@
 #include "shill/resolver.h"
 #include "shill/result_aggregator.h"
 #include "shill/service.h"
+#include "shill/store_interface.h"
 #include "shill/technology.h"
 #include "shill/throttler.h"
 #include "shill/vpn/vpn_provider.h"
@@ -177,6 +180,7 @@ Manager::Manager(ControlInterface* control_interface,
       last_default_physical_service_connected_(false),
       ephemeral_profile_(new EphemeralProfile(this)),
       use_startup_portal_list_(false),
+      sort_all_services_(false),
       device_status_check_task_(
           Bind(&Manager::DeviceStatusCheckTask, base::Unretained(this))),
       termination_actions_(dispatcher),
@@ -261,7 +265,10 @@ Manager::Manager(ControlInterface* control_interface,
   SLOG(this, 2) << "Manager initialized.";
 }
 
-Manager::~Manager() = default;
+Manager::~Manager() {
+  // The cache outlives |metrics_|.
+  DnsCache::GetInstance()->set_metrics(nullptr);
+}
 
 void Manager::RegisterAsync(const Callback<void(bool)>& completion_callback) {
   adaptor_->RegisterAsync(completion_callback);
@@ -315,6 +322,7 @@ void Manager::Start() {
   if (metrics_) {
     AddDefaultServiceObserver(metrics_);
   }
+  DnsCache::GetInstance()->set_metrics(metrics_);
 
   InitializeProfiles();
   running_ = true;
@@ -373,6 +381,7 @@ void Manager::Stop() {
   if (metrics_) {
     RemoveDefaultServiceObserver(metrics_);
   }
+  DnsCache::GetInstance()->set_metrics(nullptr);
   power_manager_->Stop();
   power_manager_.reset();
 }
@@ -1364,7 +1373,7 @@ void Manager::RegisterService(const ServiceRefPtr& to_manage) {
     CHECK(to_manage->unique_name() != service->unique_name());
   }
   services_.push_back(to_manage);
-  SortServices();
+  RepositionService(to_manage);
 }
 
 void Manager::DeregisterService(const ServiceRefPtr& to_forget) {
@@ -1381,8 +1390,9 @@ void Manager::DeregisterService(const ServiceRefPtr& to_forget) {
         last_default_physical_service_ = nullptr;
         last_default_physical_service_connected_ = false;
       }
+      // Removing a service leaves the others in order.
       services_.erase(it);
-      SortServices();
+      PostSortServicesTask();
       return;
     }
   }
@@ -1432,7 +1442,7 @@ void Manager::UpdateService(const ServiceRefPtr& to_update) {
     // persist its settings).
     PersistService(to_update);
   }
-  SortServices();
+  RepositionService(to_update);
 }
 
 void Manager::NotifyServiceStateChanged(const ServiceRefPtr& to_update) {
@@ -1579,6 +1589,10 @@ void Manager::UpdateDefaultServices(const ServiceRefPtr& logical_service,
     return;
   }
 
+  // Names may resolve differently on the new default network, and are looked
+  // up again rather than served from before the change.
+  DnsCache::GetInstance()->Clear();
+
   for (auto& observer : default_service_observers_) {
     observer.OnDefaultServiceChanged(logical_service, logical_service_changed,
                                      physical_service,
@@ -1599,6 +1613,14 @@ bool Manager::EmitDefaultService() {
 
 void Manager::OnSuspendImminent() {
   metrics_->NotifySuspendActionsStarted();
+  // Write out the profile changes whose flush was delayed, in case the system
+  // does not resume.
+  for (const auto& profile : profiles_) {
+    StoreInterface* storage = profile->GetStorage();
+    if (storage) {
+      storage->FlushPending();
+    }
+  }
   if (devices_.empty()) {
     // If there are no devices, then suspend actions succeeded synchronously.
     // Make a call to the Manager::OnSuspendActionsComplete directly, since
@@ -1722,6 +1744,16 @@ void Manager::HelpRegisterDerivedBool(const string& name,
 }
 
 void Manager::SortServices() {
+  sort_all_services_ = true;
+  PostSortServicesTask();
+}
+
+void Manager::RepositionService(const ServiceRefPtr& service) {
+  services_to_reposition_.insert(service.get());
+  PostSortServicesTask();
+}
+
+void Manager::PostSortServicesTask() {
   // We might be called in the middle of a series of events that
   // may result in multiple calls to Manager::SortServices, or within
   // an outer loop that may also be traversing the services_ list.
@@ -1736,11 +1768,36 @@ void Manager::SortServicesTask() {
   SLOG(this, 4) << "In " << __func__;
   sort_services_task_.Cancel();
 
-  sort(services_.begin(), services_.end(),
-       [& order = technology_order_](ServiceRefPtr a, ServiceRefPtr b) {
-         return Service::Compare(a, b, true /* compare connectivity */, order)
-             .first;
-       });
+  const auto compare = [& order = technology_order_](const ServiceRefPtr& a,
+                                                     const ServiceRefPtr& b) {
+    return Service::Compare(a, b, true /* compare connectivity */, order).first;
+  };
+  // Usually only a few services changed since the last sort. Take them out
+  // and insert each back in place, unless the others are no longer in order,
+  // e.g. because a service changed without being reported to UpdateService().
+  bool sorted = false;
+  if (!sort_all_services_) {
+    auto updated_begin = std::stable_partition(
+        services_.begin(), services_.end(), [this](const ServiceRefPtr& s) {
+          return !base::ContainsKey(services_to_reposition_, s.get());
+        });
+    vector<ServiceRefPtr> updated(std::make_move_iterator(updated_begin),
+                                  std::make_move_iterator(services_.end()));
+    services_.erase(updated_begin, services_.end());
+    sorted = std::is_sorted(services_.begin(), services_.end(), compare);
+    for (auto& service : updated) {
+      auto position = sorted ? std::upper_bound(services_.begin(),
+                                                services_.end(), service,
+                                                compare)
+                             : services_.end();
+      services_.insert(position, std::move(service));
+    }
+  }
+  if (!sorted) {
+    sort(services_.begin(), services_.end(), compare);
+  }
+  sort_all_services_ = false;
+  services_to_reposition_.clear();
 
   std::vector<IPAddress> vpn_addresses;
   for (const auto& service : services_) {
@@ -1798,12 +1855,15 @@ void Manager::SortServicesTask() {
   }
 
   Error error;
-  adaptor_->EmitRpcIdentifierArrayChanged(kServiceCompleteListProperty,
-                                          EnumerateCompleteServices(nullptr));
-  adaptor_->EmitRpcIdentifierArrayChanged(kServicesProperty,
-                                          EnumerateAvailableServices(nullptr));
-  adaptor_->EmitRpcIdentifierArrayChanged(kServiceWatchListProperty,
-                                          EnumerateWatchedServices(nullptr));
+  EmitServiceListIfChanged(kServiceCompleteListProperty,
+                           EnumerateCompleteServices(nullptr),
+                           &last_complete_service_rpc_ids_);
+  EmitServiceListIfChanged(kServicesProperty,
+                           EnumerateAvailableServices(nullptr),
+                           &last_available_service_rpc_ids_);
+  EmitServiceListIfChanged(kServiceWatchListProperty,
+                           EnumerateWatchedServices(nullptr),
+                           &last_watched_service_rpc_ids_);
   adaptor_->EmitStringsChanged(kConnectedTechnologiesProperty,
                                ConnectedTechnologies(&error));
   adaptor_->EmitStringChanged(kDefaultTechnologyProperty,
@@ -1818,6 +1878,16 @@ void Manager::SortServicesTask() {
   AutoConnect();
 }
 
+void Manager::EmitServiceListIfChanged(const string& property,
+                                       RpcIdentifiers rpc_ids,
+                                       RpcIdentifiers* last_rpc_ids) {
+  if (rpc_ids == *last_rpc_ids) {
+    return;
+  }
+  adaptor_->EmitRpcIdentifierArrayChanged(property, rpc_ids);
+  *last_rpc_ids = std::move(rpc_ids);
+}
+
 void Manager::DeviceStatusCheckTask() {
   SLOG(this, 4) << "In " << __func__;
 
@@ -7,6 +7,7 @@
 
 #include <map>
 #include <memory>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -72,7 +73,8 @@ class Manager : public base::SupportsWeakPtr<Manager> {
           arp_gateway(true),
           connection_id_salt(0),
           minimum_mtu(IPConfig::kUndefinedMTU),
-          jail_vpn_clients(false) {}
+          jail_vpn_clients(false),
+          link_monitor_neighbor_events(false) {}
     bool offline_mode;
     std::string check_portal_list;
     std::string portal_http_url;
@@ -99,6 +101,9 @@ class Manager : public base::SupportsWeakPtr<Manager> {
     int minimum_mtu;
     // Whether to run third party VPN client programs in a minijail.
     bool jail_vpn_clients;
+    // Whether link monitoring watches kernel neighbor events instead of
+    // sniffing ARP requests once the gateway is found.
+    bool link_monitor_neighbor_events;
     // Name of Android VPN package that should be enforced for user traffic.
     // Empty string if the lockdown feature is not enabled.
     std::string always_on_vpn_package;
@@ -403,6 +408,13 @@ class Manager : public base::SupportsWeakPtr<Manager> {
     props_.jail_vpn_clients = jail_vpn_clients;
   }
 
+  bool GetLinkMonitorNeighborEvents() const {
+    return props_.link_monitor_neighbor_events;
+  }
+  virtual void SetLinkMonitorNeighborEvents(bool enabled) {
+    props_.link_monitor_neighbor_events = enabled;
+  }
+
   virtual void UpdateEnabledTechnologies();
   virtual void UpdateUninitializedTechnologies();
 
@@ -585,6 +597,7 @@ class Manager : public base::SupportsWeakPtr<Manager> {
   FRIEND_TEST(ManagerTest, ServiceRegistration);
   FRIEND_TEST(ManagerTest, SetAlwaysOnVpnPackage);
   FRIEND_TEST(ManagerTest, ShouldBlackholeUserTraffic);
+  FRIEND_TEST(ManagerTest, SortServicesIncrementalMatchesFullSort);
   FRIEND_TEST(ManagerTest, SortServicesWithConnection);
   FRIEND_TEST(ManagerTest, StartupPortalList);
   FRIEND_TEST(ServiceTest, IsAutoConnectable);
@@ -664,8 +677,18 @@ class Manager : public base::SupportsWeakPtr<Manager> {
   void PopProfileInternal();
   void OnProfilesChanged();
 
+  // Re-sorts all services.
   void SortServices();
+  // Moves |service|, whose sorting criteria may have changed, to its place
+  // among the other services.
+  void RepositionService(const ServiceRefPtr& service);
+  void PostSortServicesTask();
   void SortServicesTask();
+  // Emits |property| with |rpc_ids| unless it is the same as |*last_rpc_ids|,
+  // which is updated.
+  void EmitServiceListIfChanged(const std::string& property,
+                                RpcIdentifiers rpc_ids,
+                                RpcIdentifiers* last_rpc_ids);
   void DeviceStatusCheckTask();
   void ConnectionStatusCheck();
   void DevicePresenceStatusCheck();
@@ -811,6 +834,17 @@ class Manager : public base::SupportsWeakPtr<Manager> {
   std::string accept_hostname_from_;
 
   base::CancelableClosure sort_services_task_;
+  // Whether the next SortServicesTask() should re-sort all services, rather
+  // than only reposition those in |services_to_reposition_|. The pointers
+  // are only compared, never dereferenced.
+  bool sort_all_services_;
+  std::set<const Service*> services_to_reposition_;
+
+  // Service lists last emitted, so that they are only emitted again when
+  // they change.
+  RpcIdentifiers last_complete_service_rpc_ids_;
+  RpcIdentifiers last_available_service_rpc_ids_;
+  RpcIdentifiers last_watched_service_rpc_ids_;
 
   // Task for periodically checking various device status.
   base::CancelableClosure device_status_check_task_;
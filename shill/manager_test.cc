@@ -3298,12 +3298,13 @@ TEST_F(ManagerTest, PortalFallbackUrls) {
 }
 
 TEST_F(ManagerTest, ServiceStateChangeEmitsServices) {
-  // Test to make sure that every service state-change causes the
-  // Manager to emit a new service list.
+  // Test to make sure that service state-changes cause the Manager to
+  // emit the service lists which changed.
   MockServiceRefPtr mock_service(new NiceMock<MockService>(manager()));
   EXPECT_CALL(*mock_service, state())
       .WillRepeatedly(Return(Service::kStateIdle));
 
+  // An idle Service is not watched.
   manager()->RegisterService(mock_service);
   EXPECT_CALL(*manager_adaptor_,
               EmitRpcIdentifierArrayChanged(kServiceCompleteListProperty, _))
@@ -3311,9 +3312,30 @@ TEST_F(ManagerTest, ServiceStateChangeEmitsServices) {
   EXPECT_CALL(*manager_adaptor_,
               EmitRpcIdentifierArrayChanged(kServicesProperty, _))
       .Times(1);
+  EXPECT_CALL(*manager_adaptor_,
+              EmitRpcIdentifierArrayChanged(kServiceWatchListProperty, _))
+      .Times(0);
+  CompleteServiceSort();
+
+  // Lists which did not change are not emitted again.
+  Mock::VerifyAndClearExpectations(manager_adaptor_);
+  EXPECT_CALL(*manager_adaptor_, EmitRpcIdentifierArrayChanged(_, _)).Times(0);
+  manager()->UpdateService(mock_service.get());
+  CompleteServiceSort();
+
+  Mock::VerifyAndClearExpectations(manager_adaptor_);
+  EXPECT_CALL(*manager_adaptor_,
+              EmitRpcIdentifierArrayChanged(kServiceCompleteListProperty, _))
+      .Times(0);
+  EXPECT_CALL(*manager_adaptor_,
+              EmitRpcIdentifierArrayChanged(kServicesProperty, _))
+      .Times(0);
   EXPECT_CALL(*manager_adaptor_,
               EmitRpcIdentifierArrayChanged(kServiceWatchListProperty, _))
       .Times(1);
+  EXPECT_CALL(*mock_service, state())
+      .WillRepeatedly(Return(Service::kStateConnected));
+  manager()->UpdateService(mock_service.get());
   CompleteServiceSort();
 
   Mock::VerifyAndClearExpectations(manager_adaptor_);
@@ -3326,10 +3348,95 @@ TEST_F(ManagerTest, ServiceStateChangeEmitsServices) {
   EXPECT_CALL(*manager_adaptor_,
               EmitRpcIdentifierArrayChanged(kServiceWatchListProperty, _))
       .Times(1);
-  manager()->UpdateService(mock_service.get());
+  manager()->DeregisterService(mock_service);
   CompleteServiceSort();
+}
 
-  manager()->DeregisterService(mock_service);
+TEST_F(ManagerTest, ServiceReorderEmitsServiceCompleteList) {
+  MockServiceRefPtr mock_service0(new NiceMock<MockService>(manager()));
+  MockServiceRefPtr mock_service1(new NiceMock<MockService>(manager()));
+  manager()->RegisterService(mock_service0);
+  manager()->RegisterService(mock_service1);
+  CompleteServiceSort();
+  EXPECT_TRUE(ServiceOrderIs(mock_service0, mock_service1));
+
+  EXPECT_CALL(
+      *manager_adaptor_,
+      EmitRpcIdentifierArrayChanged(
+          kServiceCompleteListProperty,
+          ElementsAre(mock_service1->GetRpcIdentifier(),
+                      mock_service0->GetRpcIdentifier())));
+  mock_service1->SetPriority(1, nullptr);
+  manager()->UpdateService(mock_service1);
+  CompleteServiceSort();
+  EXPECT_TRUE(ServiceOrderIs(mock_service1, mock_service0));
+
+  // Changing the priority back moves the Service back.
+  Mock::VerifyAndClearExpectations(manager_adaptor_);
+  EXPECT_CALL(
+      *manager_adaptor_,
+      EmitRpcIdentifierArrayChanged(
+          kServiceCompleteListProperty,
+          ElementsAre(mock_service0->GetRpcIdentifier(),
+                      mock_service1->GetRpcIdentifier())));
+  mock_service1->SetPriority(0, nullptr);
+  manager()->UpdateService(mock_service1);
+  CompleteServiceSort();
+  EXPECT_TRUE(ServiceOrderIs(mock_service0, mock_service1));
+}
+
+TEST_F(ManagerTest, SortServicesNotUpdatedService) {
+  MockServiceRefPtr mock_service0(new NiceMock<MockService>(manager()));
+  MockServiceRefPtr mock_service1(new NiceMock<MockService>(manager()));
+  MockServiceRefPtr mock_service2(new NiceMock<MockService>(manager()));
+  manager()->RegisterService(mock_service0);
+  manager()->RegisterService(mock_service1);
+  manager()->RegisterService(mock_service2);
+  CompleteServiceSort();
+
+  // A Service whose criteria changed without it being updated is still put
+  // in order when another Service is.
+  mock_service2->SetPriority(1, nullptr);
+  manager()->UpdateService(mock_service1);
+  CompleteServiceSort();
+  EXPECT_EQ(mock_service2.get(), GetServices()[0].get());
+  EXPECT_EQ(mock_service0.get(), GetServices()[1].get());
+  EXPECT_EQ(mock_service1.get(), GetServices()[2].get());
+}
+
+TEST_F(ManagerTest, SortServicesIncrementalMatchesFullSort) {
+  // Updates one Service at a time, some of them several times between sorts,
+  // and checks that repositioning them gives the same order as sorting all
+  // Services.
+  constexpr size_t kNumServices = 200;
+  constexpr size_t kNumUpdates = 100;
+  vector<MockServiceRefPtr> services;
+  for (size_t i = 0; i < kNumServices; ++i) {
+    MockServiceRefPtr service(new NiceMock<MockService>(manager()));
+    service->SetPriority(i % 10, nullptr);
+    manager()->RegisterService(service);
+    services.push_back(service);
+  }
+  CompleteServiceSort();
+
+  for (size_t i = 0; i < kNumUpdates; ++i) {
+    for (size_t j = 0; j < i % 3 + 1; ++j) {
+      const MockServiceRefPtr& service =
+          services[(i * 37 + j * 11) % kNumServices];
+      service->SetPriority((i + j) % 20, nullptr);
+      manager()->UpdateService(service);
+    }
+    CompleteServiceSort();
+    const vector<ServiceRefPtr> repositioned = GetServices();
+
+    manager()->SortServices();
+    CompleteServiceSort();
+    ASSERT_EQ(repositioned, GetServices()) << "After update " << i;
+  }
+
+  for (const auto& service : services) {
+    manager()->DeregisterService(service);
+  }
 }
 
 TEST_F(ManagerTest, EnumerateServices) {
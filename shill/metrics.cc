@@ -306,6 +306,18 @@ const int Metrics::kMetricLinkMonitorErrorCountMax =
     LinkMonitor::kFailureThreshold;
 const int Metrics::kMetricLinkMonitorErrorCountNumBuckets =
     LinkMonitor::kFailureThreshold + 1;
+const char Metrics::kMetricLinkMonitorDetectionLatencySuffix[] =
+    "LinkMonitorDetectionLatency";
+const int Metrics::kMetricLinkMonitorDetectionLatencyMin = 1;
+const int Metrics::kMetricLinkMonitorDetectionLatencyMax = 60000;
+const int Metrics::kMetricLinkMonitorDetectionLatencyNumBuckets = 50;
+const char Metrics::kMetricLinkMonitorNeighborWakeupsSuffix[] =
+    "LinkMonitorNeighborWakeups";
+const char Metrics::kMetricLinkMonitorArpEscalationsSuffix[] =
+    "LinkMonitorArpEscalations";
+const int Metrics::kMetricLinkMonitorWakeupsMin = 1;
+const int Metrics::kMetricLinkMonitorWakeupsMax = 10000;
+const int Metrics::kMetricLinkMonitorWakeupsNumBuckets = 50;
 
 // static
 const char Metrics::kMetricApChannelSwitch[] =
@@ -480,6 +492,15 @@ const int Metrics::kMetricWifiSupplicantAttemptsNumBuckets = 11;
 const char Metrics::kMetricFallbackDNSTestResultSuffix[] =
     "FallbackDNSTestResult";
 
+// static
+const char Metrics::kMetricDnsCacheLookupResult[] =
+    "Network.Shill.DnsCache.LookupResult";
+const char Metrics::kMetricDnsCacheMissLatency[] =
+    "Network.Shill.DnsCache.MissLatency";
+const int Metrics::kMetricDnsCacheMissLatencyMax = 20000;  // 20 seconds
+const int Metrics::kMetricDnsCacheMissLatencyMin = 1;
+const int Metrics::kMetricDnsCacheMissLatencyNumBuckets = 50;
+
 // static
 const char Metrics::kMetricNetworkProblemDetectedSuffix[] =
     "NetworkProblemDetected";
@@ -1219,6 +1240,29 @@ void Metrics::NotifyLinkMonitorResponseTimeSampleAdded(
             kMetricLinkMonitorResponseTimeSampleNumBuckets);
 }
 
+void Metrics::NotifyLinkMonitorDetectionLatency(Technology technology,
+                                                int latency_milliseconds) {
+  string histogram =
+      GetFullMetricName(kMetricLinkMonitorDetectionLatencySuffix, technology);
+  SendToUMA(histogram, latency_milliseconds,
+            kMetricLinkMonitorDetectionLatencyMin,
+            kMetricLinkMonitorDetectionLatencyMax,
+            kMetricLinkMonitorDetectionLatencyNumBuckets);
+}
+
+void Metrics::NotifyLinkMonitorNeighborWakeups(Technology technology,
+                                               int wakeups,
+                                               int arp_escalations) {
+  string histogram =
+      GetFullMetricName(kMetricLinkMonitorNeighborWakeupsSuffix, technology);
+  SendToUMA(histogram, wakeups, kMetricLinkMonitorWakeupsMin,
+            kMetricLinkMonitorWakeupsMax, kMetricLinkMonitorWakeupsNumBuckets);
+  histogram =
+      GetFullMetricName(kMetricLinkMonitorArpEscalationsSuffix, technology);
+  SendToUMA(histogram, arp_escalations, kMetricLinkMonitorWakeupsMin,
+            kMetricLinkMonitorWakeupsMax, kMetricLinkMonitorWakeupsNumBuckets);
+}
+
 void Metrics::NotifyApChannelSwitch(uint16_t frequency,
                                     uint16_t new_frequency) {
   WiFiChannel channel = WiFiFrequencyToChannel(frequency);
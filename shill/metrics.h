@@ -406,6 +406,14 @@ class Metrics : public DefaultServiceObserver {
     kFallbackDNSTestResultMax
   };
 
+  // How a DNS lookup through the DnsCache was answered.
+  enum DnsCacheLookupResult {
+    kDnsCacheLookupResultHit = 0,
+    kDnsCacheLookupResultCoalesced = 1,
+    kDnsCacheLookupResultMiss = 2,
+    kDnsCacheLookupResultMax
+  };
+
   // Network problem detected by traffic monitor.
   enum NetworkProblem {
     kNetworkProblemCongestedTCPTxQueue = 0,
@@ -701,6 +709,15 @@ class Metrics : public DefaultServiceObserver {
   static const int kMetricLinkMonitorErrorCountMin;
   static const int kMetricLinkMonitorErrorCountMax;
   static const int kMetricLinkMonitorErrorCountNumBuckets;
+  static const char kMetricLinkMonitorDetectionLatencySuffix[];
+  static const int kMetricLinkMonitorDetectionLatencyMin;
+  static const int kMetricLinkMonitorDetectionLatencyMax;
+  static const int kMetricLinkMonitorDetectionLatencyNumBuckets;
+  static const char kMetricLinkMonitorNeighborWakeupsSuffix[];
+  static const char kMetricLinkMonitorArpEscalationsSuffix[];
+  static const int kMetricLinkMonitorWakeupsMin;
+  static const int kMetricLinkMonitorWakeupsMax;
+  static const int kMetricLinkMonitorWakeupsNumBuckets;
 
   // Signal strength when link becomes unreliable (multiple link monitor
   // failures in short period of time).
@@ -883,6 +900,13 @@ class Metrics : public DefaultServiceObserver {
   // DNS test result.
   static const char kMetricFallbackDNSTestResultSuffix[];
 
+  // DnsCache lookups, and the duration of those which went to the network.
+  static const char kMetricDnsCacheLookupResult[];
+  static const char kMetricDnsCacheMissLatency[];
+  static const int kMetricDnsCacheMissLatencyMax;
+  static const int kMetricDnsCacheMissLatencyMin;
+  static const int kMetricDnsCacheMissLatencyNumBuckets;
+
   // Network problem detected by traffic monitor
   static const char kMetricNetworkProblemDetectedSuffix[];
 
@@ -1063,6 +1087,19 @@ class Metrics : public DefaultServiceObserver {
   void NotifyLinkMonitorResponseTimeSampleAdded(Technology technology,
                                                 int response_time_milliseconds);
 
+  // Notifies this object that LinkMonitor detected a failure
+  // |latency_milliseconds| after the kernel reported the gateway neighbor
+  // entry as stale or failed, or the loss of carrier.
+  void NotifyLinkMonitorDetectionLatency(Technology technology,
+                                         int latency_milliseconds);
+
+  // Notifies this object that LinkMonitor stopped monitoring kernel neighbor
+  // events, after being woken up |wakeups| times by them and escalating to
+  // ARP probing |arp_escalations| times.
+  void NotifyLinkMonitorNeighborWakeups(Technology technology,
+                                        int wakeups,
+                                        int arp_escalations);
+
   // Notifies this object that an AP was discovered and of that AP's 802.11k
   // support.
   void NotifyAp80211kSupport(bool neighbor_list_supported);
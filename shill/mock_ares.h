@@ -37,6 +37,10 @@ class MockAres : public Ares {
               (ares_channel, struct timeval*, struct timeval*),
               (override));
   MOCK_METHOD(int, SetServersCsv, (ares_channel, const char*), (override));
+  MOCK_METHOD(void,
+              Search,
+              (ares_channel, const char*, int, int, ares_callback, void*),
+              (override));
 
  private:
   DISALLOW_COPY_AND_ASSIGN(MockAres);
@@ -144,6 +144,7 @@ class MockManager : public Manager {
   MOCK_METHOD(void, SetPrependDNSServers, (const std::string&), (override));
   MOCK_METHOD(void, SetMinimumMTU, (const int), (override));
   MOCK_METHOD(void, SetAcceptHostnameFrom, (const std::string&), (override));
+  MOCK_METHOD(void, SetLinkMonitorNeighborEvents, (bool), (override));
   MOCK_METHOD(bool, ignore_unknown_ethernet, (), (const, override));
   MOCK_METHOD(std::vector<std::string>,
               FilterPrependDNSServersByFamily,
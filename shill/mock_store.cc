@@ -6,7 +6,10 @@
 
 namespace shill {
 
-MockStore::MockStore() = default;
+MockStore::MockStore() {
+  // Flushes are not delayed unless a test says so.
+  ON_CALL(*this, FlushPending()).WillByDefault(testing::Return(true));
+}
 
 MockStore::~MockStore() = default;
 
@@ -26,6 +26,7 @@ class MockStore : public StoreInterface {
   MOCK_METHOD(bool, Open, (), (override));
   MOCK_METHOD(bool, Close, (), (override));
   MOCK_METHOD(bool, Flush, (), (override));
+  MOCK_METHOD(bool, FlushPending, (), (override));
   MOCK_METHOD(bool, MarkAsCorrupted, (), (override));
   MOCK_METHOD(std::set<std::string>, GetGroups, (), (const, override));
   MOCK_METHOD(std::set<std::string>,
@@ -7,12 +7,13 @@
 #include <ctype.h>
 #include <linux/nl80211.h>
 
+#include <algorithm>
 #include <iomanip>
 #include <memory>
 #include <string>
+#include <utility>
 
 #include <base/logging.h>
-#include <base/stl_util.h>
 
 #include "shill/logging.h"
 #include "shill/net/netlink_attribute.h"
@@ -29,17 +30,27 @@ static std::string ObjectID(const AttributeList* obj) {
 }
 }  // namespace Logging
 
+namespace {
+
+bool CompareAttributeId(
+    const std::pair<int, std::unique_ptr<NetlinkAttribute>>& attribute,
+    int id) {
+  return attribute.first < id;
+}
+
+}  // namespace
+
 AttributeList::AttributeList() = default;
 
 AttributeList::~AttributeList() = default;
 
 bool AttributeList::CreateAttribute(int id,
                                     AttributeList::NewFromIdMethod factory) {
-  if (base::ContainsKey(attributes_, id)) {
+  if (GetAttribute(id)) {
     SLOG(this, 7) << "Trying to re-add attribute " << id << ", not overwriting";
     return true;
   }
-  attributes_[id] = factory.Run(id);
+  AddAttribute(id, factory.Run(id));
   return true;
 }
 
@@ -84,6 +95,7 @@ bool AttributeList::IterateAttributes(
     const AttributeList::AttributeMethod& method) {
   const unsigned char* ptr = payload.GetConstData() + NLA_ALIGN(offset);
   const unsigned char* end = payload.GetConstData() + payload.GetLength();
+  ByteString value;
   while (ptr + sizeof(nlattr) <= end) {
     const nlattr* attribute = reinterpret_cast<const nlattr*>(ptr);
     if (attribute->nla_len < sizeof(*attribute) ||
@@ -95,10 +107,9 @@ bool AttributeList::IterateAttributes(
                  << (ptr - payload.GetConstData()) << ".";
       return false;
     }
-    ByteString value;
-    if (attribute->nla_len > NLA_HDRLEN) {
-      value = ByteString(ptr + NLA_HDRLEN, attribute->nla_len - NLA_HDRLEN);
-    }
+    // |value| is reused for each attribute so that its storage is only
+    // allocated once per list.
+    value.Assign(ptr + NLA_HDRLEN, attribute->nla_len - NLA_HDRLEN);
     if (!method.Run(attribute->nla_type, value)) {
       return false;
     }
@@ -136,11 +147,11 @@ bool AttributeList::GetU8AttributeValue(int id, uint8_t* value) const {
 }
 
 bool AttributeList::CreateU8Attribute(int id, const char* id_string) {
-  if (base::ContainsKey(attributes_, id)) {
+  if (GetAttribute(id)) {
     LOG(ERROR) << "Trying to re-add attribute: " << id;
     return false;
   }
-  attributes_[id] = std::make_unique<NetlinkU8Attribute>(id, id_string);
+  AddAttribute(id, std::make_unique<NetlinkU8Attribute>(id, id_string));
   return true;
 }
 
@@ -161,11 +172,11 @@ bool AttributeList::GetU16AttributeValue(int id, uint16_t* value) const {
 }
 
 bool AttributeList::CreateU16Attribute(int id, const char* id_string) {
-  if (base::ContainsKey(attributes_, id)) {
+  if (GetAttribute(id)) {
     LOG(ERROR) << "Trying to re-add attribute: " << id;
     return false;
   }
-  attributes_[id] = std::make_unique<NetlinkU16Attribute>(id, id_string);
+  AddAttribute(id, std::make_unique<NetlinkU16Attribute>(id, id_string));
   return true;
 }
 
@@ -186,11 +197,11 @@ bool AttributeList::GetU32AttributeValue(int id, uint32_t* value) const {
 }
 
 bool AttributeList::CreateU32Attribute(int id, const char* id_string) {
-  if (base::ContainsKey(attributes_, id)) {
+  if (GetAttribute(id)) {
     LOG(ERROR) << "Trying to re-add attribute: " << id;
     return false;
   }
-  attributes_[id] = std::make_unique<NetlinkU32Attribute>(id, id_string);
+  AddAttribute(id, std::make_unique<NetlinkU32Attribute>(id, id_string));
   return true;
 }
 
@@ -211,11 +222,11 @@ bool AttributeList::GetU64AttributeValue(int id, uint64_t* value) const {
 }
 
 bool AttributeList::CreateU64Attribute(int id, const char* id_string) {
-  if (base::ContainsKey(attributes_, id)) {
+  if (GetAttribute(id)) {
     LOG(ERROR) << "Trying to re-add attribute: " << id;
     return false;
   }
-  attributes_[id] = std::make_unique<NetlinkU64Attribute>(id, id_string);
+  AddAttribute(id, std::make_unique<NetlinkU64Attribute>(id, id_string));
   return true;
 }
 
@@ -236,11 +247,11 @@ bool AttributeList::GetFlagAttributeValue(int id, bool* value) const {
 }
 
 bool AttributeList::CreateFlagAttribute(int id, const char* id_string) {
-  if (base::ContainsKey(attributes_, id)) {
+  if (GetAttribute(id)) {
     LOG(ERROR) << "Trying to re-add attribute: " << id;
     return false;
   }
-  attributes_[id] = std::make_unique<NetlinkFlagAttribute>(id, id_string);
+  AddAttribute(id, std::make_unique<NetlinkFlagAttribute>(id, id_string));
   return true;
 }
 
@@ -269,20 +280,20 @@ bool AttributeList::GetStringAttributeValue(int id, string* value) const {
 }
 
 bool AttributeList::CreateStringAttribute(int id, const char* id_string) {
-  if (base::ContainsKey(attributes_, id)) {
+  if (GetAttribute(id)) {
     LOG(ERROR) << "Trying to re-add attribute: " << id;
     return false;
   }
-  attributes_[id] = std::make_unique<NetlinkStringAttribute>(id, id_string);
+  AddAttribute(id, std::make_unique<NetlinkStringAttribute>(id, id_string));
   return true;
 }
 
 bool AttributeList::CreateSsidAttribute(int id, const char* id_string) {
-  if (base::ContainsKey(attributes_, id)) {
+  if (GetAttribute(id)) {
     LOG(ERROR) << "Trying to re-add attribute: " << id;
     return false;
   }
-  attributes_[id] = std::make_unique<NetlinkSsidAttribute>(id, id_string);
+  AddAttribute(id, std::make_unique<NetlinkSsidAttribute>(id, id_string));
   return true;
 }
 
@@ -318,11 +329,11 @@ bool AttributeList::SetNestedAttributeHasAValue(int id) {
 }
 
 bool AttributeList::CreateNestedAttribute(int id, const char* id_string) {
-  if (base::ContainsKey(attributes_, id)) {
+  if (GetAttribute(id)) {
     LOG(ERROR) << "Trying to re-add attribute: " << id;
     return false;
   }
-  attributes_[id] = std::make_unique<NetlinkNestedAttribute>(id, id_string);
+  AddAttribute(id, std::make_unique<NetlinkNestedAttribute>(id, id_string));
   return true;
 }
 
@@ -352,11 +363,11 @@ bool AttributeList::SetRawAttributeValue(int id, ByteString value) {
 }
 
 bool AttributeList::CreateRawAttribute(int id, const char* id_string) {
-  if (base::ContainsKey(attributes_, id)) {
+  if (GetAttribute(id)) {
     LOG(ERROR) << "Trying to re-add attribute: " << id;
     return false;
   }
-  attributes_[id] = std::make_unique<NetlinkRawAttribute>(id, id_string);
+  AddAttribute(id, std::make_unique<NetlinkRawAttribute>(id, id_string));
   return true;
 }
 
@@ -368,9 +379,23 @@ bool AttributeList::GetAttributeAsString(int id, std::string* value) const {
   return attribute->ToString(value);
 }
 
+void AttributeList::AddAttribute(int id,
+                                 std::unique_ptr<NetlinkAttribute> attribute) {
+  // Decoded attributes mostly come in increasing order of id.
+  if (attributes_.empty() || attributes_.back().first < id) {
+    attributes_.emplace_back(id, std::move(attribute));
+    return;
+  }
+  AttributeArray::iterator i = std::lower_bound(
+      attributes_.begin(), attributes_.end(), id, &CompareAttributeId);
+  DCHECK(i == attributes_.end() || i->first != id);
+  attributes_.emplace(i, id, std::move(attribute));
+}
+
 NetlinkAttribute* AttributeList::GetAttribute(int id) const {
-  AttributeMap::const_iterator i = attributes_.find(id);
-  if (i == attributes_.end()) {
+  AttributeArray::const_iterator i = std::lower_bound(
+      attributes_.begin(), attributes_.end(), id, &CompareAttributeId);
+  if (i == attributes_.end() || i->first != id) {
     return nullptr;
   }
   return i->second.get();
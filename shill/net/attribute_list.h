@@ -7,9 +7,10 @@
 
 #include <linux/nl80211.h>
 
-#include <map>
 #include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include <base/bind.h>
 #include <base/callback.h>
@@ -134,12 +135,20 @@ class SHILL_EXPORT AttributeList : public base::RefCounted<AttributeList> {
   friend class AttributeIdIterator;
   friend class NetlinkNestedAttribute;
 
-  using AttributeMap = std::map<int, std::unique_ptr<NetlinkAttribute>>;
+  // Attributes paired with their id, sorted by id.  Messages hold a few
+  // dozen attributes at most, so a sorted array is both smaller and faster
+  // to search than a map.
+  using AttributeArray =
+      std::vector<std::pair<int, std::unique_ptr<NetlinkAttribute>>>;
 
-  // Using this to get around issues with const and operator[].
+  // Adds |attribute| with |id|, which must not be in the list yet.
+  SHILL_PRIVATE void AddAttribute(int id,
+                                  std::unique_ptr<NetlinkAttribute> attribute);
+
+  // Returns the attribute with |id|, or nullptr if there is none.
   SHILL_PRIVATE NetlinkAttribute* GetAttribute(int id) const;
 
-  AttributeMap attributes_;
+  AttributeArray attributes_;
 
   DISALLOW_COPY_AND_ASSIGN(AttributeList);
 };
@@ -156,8 +165,8 @@ class AttributeIdIterator {
   int GetId() const { return iter_->first; }
 
  private:
-  AttributeList::AttributeMap::const_iterator iter_;
-  const AttributeList::AttributeMap::const_iterator end_;
+  AttributeList::AttributeArray::const_iterator iter_;
+  const AttributeList::AttributeArray::const_iterator end_;
 
   DISALLOW_COPY_AND_ASSIGN(AttributeIdIterator);
 };
@@ -204,4 +204,27 @@ TEST_F(AttributeListTest, TrailingGarbage) {
   Mock::VerifyAndClearExpectations(this);
 }
 
+TEST_F(AttributeListTest, AttributesAreSortedById) {
+  AttributeListRefPtr list(new AttributeList());
+  EXPECT_TRUE(list->CreateU32Attribute(kType3, "type3"));
+  EXPECT_TRUE(list->CreateU32Attribute(kType1, "type1"));
+  EXPECT_TRUE(list->CreateU32Attribute(kType2, "type2"));
+  EXPECT_FALSE(list->CreateU32Attribute(kType2, "type2"));
+  EXPECT_TRUE(list->SetU32AttributeValue(kType1, 1));
+  EXPECT_TRUE(list->SetU32AttributeValue(kType2, 2));
+  EXPECT_TRUE(list->SetU32AttributeValue(kType3, 3));
+
+  AttributeIdIterator iter(*list);
+  for (uint16_t id : {kType1, kType2, kType3}) {
+    ASSERT_FALSE(iter.AtEnd());
+    EXPECT_EQ(id, iter.GetId());
+    uint32_t value = 0;
+    EXPECT_TRUE(list->GetU32AttributeValue(id, &value));
+    EXPECT_EQ(id, value);
+    iter.Advance();
+  }
+  EXPECT_TRUE(iter.AtEnd());
+  EXPECT_FALSE(list->GetU32AttributeValue(kType3 + 1, nullptr));
+}
+
 }  // namespace shill
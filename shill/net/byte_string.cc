@@ -161,6 +161,10 @@ void ByteString::Resize(int size) {
   data_.resize(size, 0);
 }
 
+void ByteString::Assign(const unsigned char* data, size_t length) {
+  data_.assign(data, data + length);
+}
+
 string ByteString::HexEncode() const {
   return base::HexEncode(GetConstData(), GetLength());
 }
@@ -102,6 +102,9 @@ class SHILL_EXPORT ByteString {
   void Append(const ByteString& b);
   void Clear();
   void Resize(int size);
+  // Replaces the contents with the |length| bytes at |data|, reusing the
+  // current storage if it is large enough.
+  void Assign(const unsigned char* data, size_t length);
 
   std::string HexEncode() const;
 
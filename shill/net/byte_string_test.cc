@@ -163,6 +163,16 @@ TEST_F(ByteStringTest, Resize) {
   EXPECT_EQ(0, memcmp(bs.GetData(), kTest2, sizeof(kTest2) - kSizeReduction));
 }
 
+TEST_F(ByteStringTest, Assign) {
+  ByteString bs(kTest1, sizeof(kTest1));
+  bs.Assign(kTest2, sizeof(kTest2));
+  EXPECT_TRUE(bs.Equals(ByteString(kTest2, sizeof(kTest2))));
+  bs.Assign(kTest6, sizeof(kTest6));
+  EXPECT_TRUE(bs.Equals(ByteString(kTest6, sizeof(kTest6))));
+  bs.Assign(kTest6, 0);
+  EXPECT_TRUE(bs.IsEmpty());
+}
+
 TEST_F(ByteStringTest, HexEncode) {
   ByteString bs(kTest2, sizeof(kTest2));
   EXPECT_EQ(kTest2HexString, bs.HexEncode());
@@ -7,6 +7,7 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include <base/macros.h>
 #include <gmock/gmock.h>
@@ -48,6 +49,14 @@ class MockRTNLHandler : public RTNLHandler {
                    uint32_t* seq) override {
     return DoSendMessage(message.get(), seq);
   }
+  MOCK_METHOD(bool,
+              DoSendMessagesAndWait,
+              (const std::vector<std::unique_ptr<RTNLMessage>>&,
+               std::vector<int32_t>*));
+  bool SendMessagesAndWait(std::vector<std::unique_ptr<RTNLMessage>> messages,
+                           std::vector<int32_t>* errors) override {
+    return DoSendMessagesAndWait(messages, errors);
+  }
 
  private:
   DISALLOW_COPY_AND_ASSIGN(MockRTNLHandler);
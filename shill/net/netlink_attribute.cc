@@ -216,7 +216,6 @@ std::unique_ptr<NetlinkAttribute> NetlinkAttribute::NewControlAttributeFromId(
   }
 }
 
-// Duplicate attribute data, store in map indexed on |id|.
 bool NetlinkAttribute::InitFromValue(const ByteString& input) {
   data_ = input;
   return true;
@@ -375,7 +374,7 @@ bool NetlinkU8Attribute::InitFromValue(const ByteString& input) {
     return false;
   }
   SetU8Value(data);
-  return NetlinkAttribute::InitFromValue(input);
+  return true;
 }
 
 bool NetlinkU8Attribute::GetU8Value(uint8_t* output) const {
@@ -429,7 +428,7 @@ bool NetlinkU16Attribute::InitFromValue(const ByteString& input) {
   }
 
   SetU16Value(data);
-  return NetlinkAttribute::InitFromValue(input);
+  return true;
 }
 
 bool NetlinkU16Attribute::GetU16Value(uint16_t* output) const {
@@ -483,7 +482,7 @@ bool NetlinkU32Attribute::InitFromValue(const ByteString& input) {
   }
 
   SetU32Value(data);
-  return NetlinkAttribute::InitFromValue(input);
+  return true;
 }
 
 bool NetlinkU32Attribute::GetU32Value(uint32_t* output) const {
@@ -536,7 +535,7 @@ bool NetlinkU64Attribute::InitFromValue(const ByteString& input) {
     return false;
   }
   SetU64Value(data);
-  return NetlinkAttribute::InitFromValue(input);
+  return true;
 }
 
 bool NetlinkU64Attribute::GetU64Value(uint64_t* output) const {
@@ -583,7 +582,7 @@ const NetlinkAttribute::Type NetlinkFlagAttribute::kType =
 bool NetlinkFlagAttribute::InitFromValue(const ByteString& input) {
   // The existence of the parameter means it's true
   SetFlagValue(true);
-  return NetlinkAttribute::InitFromValue(input);
+  return true;
 }
 
 bool NetlinkFlagAttribute::GetFlagValue(bool* output) const {
@@ -647,7 +646,7 @@ bool NetlinkStringAttribute::InitFromValue(const ByteString& input) {
     }
   }
 
-  return NetlinkAttribute::InitFromValue(input);
+  return true;
 }
 
 bool NetlinkStringAttribute::GetStringValue(string* output) const {
@@ -54,6 +54,8 @@ class SHILL_EXPORT NetlinkAttribute {
   static std::unique_ptr<NetlinkAttribute> NewNl80211AttributeFromId(
       NetlinkMessage::MessageContext context, int id);
 
+  // Initializes the attribute from |input|, the attribute data.  Attributes
+  // which decode the data into a value do not keep a copy of it.
   virtual bool InitFromValue(const ByteString& input);
 
   // Accessors for the attribute's id and datatype information.
@@ -116,8 +118,8 @@ class SHILL_EXPORT NetlinkAttribute {
   // failure.
   ByteString EncodeGeneric(const unsigned char* data, size_t num_bytes) const;
 
-  // Attribute data (NOT including the nlattr header) corresponding to the
-  // value in any of the child classes.
+  // Attribute data (NOT including the nlattr header) of the child classes
+  // which do not decode it into a value of their own.
   ByteString data_;
 
   // True if a value has been assigned to the attribute; false, otherwise.
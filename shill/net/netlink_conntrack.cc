@@ -0,0 +1,296 @@
+// Copyright 2020 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "shill/net/netlink_conntrack.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <linux/netfilter/nf_conntrack_common.h>
+#include <linux/netfilter/nfnetlink.h>
+#include <linux/netfilter/nfnetlink_conntrack.h>
+#include <linux/netlink.h>
+#include <string.h>
+#include <sys/socket.h>
+
+#include <utility>
+
+#include <base/logging.h>
+#include <base/memory/ptr_util.h>
+#include <base/numerics/safe_conversions.h>
+
+#include "shill/net/byte_string.h"
+#include "shill/net/netlink_fd.h"
+#include "shill/net/sockets.h"
+
+namespace shill {
+
+namespace {
+
+struct ConntrackRequest {
+  struct nlmsghdr header;
+  struct nfgenmsg msg;
+};
+
+constexpr uint16_t kConntrackMessageType =
+    (NFNL_SUBSYS_CTNETLINK << 8) | IPCTNL_MSG_CT_NEW;
+
+ConntrackRequest CreateDumpRequest(uint8_t family, int sequence_number) {
+  CHECK(family == AF_INET || family == AF_INET6)
+      << "Unsupported conntrack family " << family;
+
+  ConntrackRequest request = {};
+  request.header.nlmsg_len = sizeof(ConntrackRequest);
+  request.header.nlmsg_type = (NFNL_SUBSYS_CTNETLINK << 8) | IPCTNL_MSG_CT_GET;
+  request.header.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+  request.header.nlmsg_seq = sequence_number;
+  request.msg.nfgen_family = family;
+  request.msg.version = NFNETLINK_V0;
+  return request;
+}
+
+const unsigned char* AttributeData(const struct nlattr* attr) {
+  return reinterpret_cast<const unsigned char*>(attr) + NLA_HDRLEN;
+}
+
+size_t AttributeLength(const struct nlattr* attr) {
+  return attr->nla_len - NLA_HDRLEN;
+}
+
+// Indexes the attributes in |data| by type into |attrs|, which holds
+// |max_type| + 1 entries. Attributes of a larger type are skipped. Returns
+// false if an attribute overruns |data|.
+bool ParseAttributes(const unsigned char* data,
+                     size_t length,
+                     int max_type,
+                     const struct nlattr** attrs) {
+  memset(attrs, 0, (max_type + 1) * sizeof(*attrs));
+  while (length >= NLA_HDRLEN) {
+    const struct nlattr* attr = reinterpret_cast<const struct nlattr*>(data);
+    if (attr->nla_len < NLA_HDRLEN || attr->nla_len > length)
+      return false;
+    const int type = attr->nla_type & NLA_TYPE_MASK;
+    if (type <= max_type)
+      attrs[type] = attr;
+    const size_t aligned_length = NLA_ALIGN(attr->nla_len);
+    if (aligned_length >= length)
+      break;
+    data += aligned_length;
+    length -= aligned_length;
+  }
+  return true;
+}
+
+bool ParseNestedAttributes(const struct nlattr* attr,
+                           int max_type,
+                           const struct nlattr** attrs) {
+  return ParseAttributes(AttributeData(attr), AttributeLength(attr), max_type,
+                         attrs);
+}
+
+bool GetU32Attribute(const struct nlattr* attr, uint32_t* value) {
+  if (!attr || AttributeLength(attr) < sizeof(*value))
+    return false;
+  memcpy(value, AttributeData(attr), sizeof(*value));
+  *value = ntohl(*value);
+  return true;
+}
+
+bool GetAddressAttribute(const struct nlattr* attr,
+                         IPAddress::Family family,
+                         IPAddress* address) {
+  if (!attr || AttributeLength(attr) != IPAddress::GetAddressLength(family))
+    return false;
+  *address =
+      IPAddress(family, ByteString(AttributeData(attr), AttributeLength(attr)));
+  return true;
+}
+
+// Ports are only part of the tuple of port-based protocols; they are left at
+// 0 for the others.
+void GetPortAttribute(const struct nlattr* attr, uint16_t* port) {
+  uint16_t value = 0;
+  if (attr && AttributeLength(attr) >= sizeof(value))
+    memcpy(&value, AttributeData(attr), sizeof(value));
+  *port = ntohs(value);
+}
+
+// Decodes a CTA_TUPLE_ORIG or CTA_TUPLE_REPLY attribute.
+bool ParseTuple(const struct nlattr* tuple_attr,
+                IPAddress::Family family,
+                uint8_t* protocol,
+                IPAddress* source_ip_address,
+                uint16_t* source_port,
+                IPAddress* destination_ip_address,
+                uint16_t* destination_port) {
+  const struct nlattr* tuple[CTA_TUPLE_MAX + 1];
+  const struct nlattr* ip[CTA_IP_MAX + 1];
+  const struct nlattr* proto[CTA_PROTO_MAX + 1];
+  if (!tuple_attr ||
+      !ParseNestedAttributes(tuple_attr, CTA_TUPLE_MAX, tuple) ||
+      !tuple[CTA_TUPLE_IP] || !tuple[CTA_TUPLE_PROTO] ||
+      !ParseNestedAttributes(tuple[CTA_TUPLE_IP], CTA_IP_MAX, ip) ||
+      !ParseNestedAttributes(tuple[CTA_TUPLE_PROTO], CTA_PROTO_MAX, proto)) {
+    return false;
+  }
+
+  const bool is_ipv4 = family == IPAddress::kFamilyIPv4;
+  if (!GetAddressAttribute(ip[is_ipv4 ? CTA_IP_V4_SRC : CTA_IP_V6_SRC], family,
+                           source_ip_address) ||
+      !GetAddressAttribute(ip[is_ipv4 ? CTA_IP_V4_DST : CTA_IP_V6_DST], family,
+                           destination_ip_address)) {
+    return false;
+  }
+
+  const struct nlattr* num = proto[CTA_PROTO_NUM];
+  if (!num || AttributeLength(num) < sizeof(*protocol))
+    return false;
+  *protocol = *AttributeData(num);
+  GetPortAttribute(proto[CTA_PROTO_SRC_PORT], source_port);
+  GetPortAttribute(proto[CTA_PROTO_DST_PORT], destination_port);
+  return true;
+}
+
+}  // namespace
+
+NetlinkConntrack::Connection::Connection()
+    : protocol(0),
+      timeout_seconds(0),
+      seen_reply(false),
+      original_source_port(0),
+      original_destination_port(0),
+      reply_source_port(0),
+      reply_destination_port(0) {}
+
+NetlinkConntrack::NetlinkConntrack(std::unique_ptr<Sockets> sockets,
+                                   int file_descriptor)
+    : sockets_(std::move(sockets)),
+      file_descriptor_(file_descriptor),
+      sequence_number_(0) {}
+
+// static
+std::unique_ptr<NetlinkConntrack> NetlinkConntrack::Create(
+    std::unique_ptr<Sockets> sockets) {
+  int file_descriptor =
+      OpenNetlinkSocketFD(sockets.get(), NETLINK_NETFILTER, 0);
+  if (file_descriptor == Sockets::kInvalidFileDescriptor)
+    return nullptr;
+
+  VLOG(2) << "Netlink conntrack socket started";
+  return base::WrapUnique(
+      new NetlinkConntrack(std::move(sockets), file_descriptor));
+}
+
+NetlinkConntrack::~NetlinkConntrack() {
+  sockets_->Close(file_descriptor_);
+}
+
+bool NetlinkConntrack::GetConnections(uint8_t family,
+                                      std::vector<Connection>* out_conns) {
+  CHECK(out_conns);
+  ConntrackRequest request = CreateDumpRequest(family, ++sequence_number_);
+  if (sockets_->Send(file_descriptor_, static_cast<void*>(&request),
+                     sizeof(request), 0) < 0) {
+    PLOG(ERROR) << "Failed to write conntrack request to netlink socket "
+                << "(family: " << family << ")";
+    return false;
+  }
+
+  return ReadDumpContents(out_conns);
+}
+
+// static
+bool NetlinkConntrack::ParseConnection(uint8_t family,
+                                       const unsigned char* data,
+                                       size_t length,
+                                       Connection* conn) {
+  IPAddress::Family address_family;
+  if (family == AF_INET) {
+    address_family = IPAddress::kFamilyIPv4;
+  } else if (family == AF_INET6) {
+    address_family = IPAddress::kFamilyIPv6;
+  } else {
+    return false;
+  }
+
+  const struct nlattr* attrs[CTA_MAX + 1];
+  uint32_t status;
+  uint8_t reply_protocol;
+  if (!ParseAttributes(data, length, CTA_MAX, attrs) ||
+      !GetU32Attribute(attrs[CTA_STATUS], &status) ||
+      !GetU32Attribute(attrs[CTA_TIMEOUT], &conn->timeout_seconds) ||
+      !ParseTuple(attrs[CTA_TUPLE_ORIG], address_family, &conn->protocol,
+                  &conn->original_source_ip_address,
+                  &conn->original_source_port,
+                  &conn->original_destination_ip_address,
+                  &conn->original_destination_port) ||
+      !ParseTuple(attrs[CTA_TUPLE_REPLY], address_family, &reply_protocol,
+                  &conn->reply_source_ip_address, &conn->reply_source_port,
+                  &conn->reply_destination_ip_address,
+                  &conn->reply_destination_port)) {
+    return false;
+  }
+  conn->seen_reply = (status & IPS_SEEN_REPLY) != 0;
+  return true;
+}
+
+bool NetlinkConntrack::ReadDumpContents(std::vector<Connection>* out_conns) {
+  char buf[8192];
+
+  out_conns->clear();
+
+  for (;;) {
+    ssize_t bytes_read = sockets_->RecvFrom(file_descriptor_, buf, sizeof(buf),
+                                            0, nullptr, nullptr);
+    if (bytes_read < 0) {
+      PLOG(ERROR) << "Failed to read from netlink socket";
+      return false;
+    }
+
+    size_t unsigned_bytes = base::checked_cast<size_t>(bytes_read);
+
+    for (nlmsghdr* nlh = reinterpret_cast<nlmsghdr*>(buf);
+         NLMSG_OK(nlh, unsigned_bytes); nlh = NLMSG_NEXT(nlh, unsigned_bytes)) {
+      switch (nlh->nlmsg_type) {
+        case NLMSG_DONE:
+          return true;
+        case NLMSG_ERROR: {
+          const nlmsgerr* err =
+              reinterpret_cast<const nlmsgerr*> NLMSG_DATA(nlh);
+          const char* err_msg = "Error reading conntrack netlink dump";
+          if (nlh->nlmsg_len < NLMSG_LENGTH(sizeof(*err))) {
+            LOG(ERROR) << err_msg;
+          } else {
+            errno = -err->error;
+            PLOG(ERROR) << err_msg;
+          }
+          return false;
+        }
+        case kConntrackMessageType: {
+          if (nlh->nlmsg_len < NLMSG_SPACE(sizeof(struct nfgenmsg))) {
+            LOG(WARNING) << "Ignoring truncated conntrack message";
+            break;
+          }
+          const struct nfgenmsg* msg =
+              reinterpret_cast<const struct nfgenmsg*>(NLMSG_DATA(nlh));
+          const unsigned char* attrs =
+              reinterpret_cast<const unsigned char*>(NLMSG_DATA(nlh)) +
+              NLMSG_ALIGN(sizeof(*msg));
+          Connection conn;
+          if (ParseConnection(
+                  msg->nfgen_family, attrs,
+                  nlh->nlmsg_len - NLMSG_SPACE(sizeof(*msg)), &conn)) {
+            out_conns->push_back(conn);
+          }
+          break;
+        }
+        default:
+          LOG(WARNING) << "Ignoring unexpected netlink message type "
+                       << nlh->nlmsg_type;
+          break;
+      }
+    }
+  }
+}
+
+}  // namespace shill
@@ -0,0 +1,84 @@
+// Copyright 2020 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef SHILL_NET_NETLINK_CONNTRACK_H_
+#define SHILL_NET_NETLINK_CONNTRACK_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+#include <vector>
+
+#include <base/macros.h>
+#include <gtest/gtest_prod.h>  // for FRIEND_TEST
+
+#include "shill/net/ip_address.h"
+#include "shill/net/shill_export.h"
+
+namespace shill {
+
+class Sockets;
+
+// NetlinkConntrack reads the connection tracking table of the kernel over
+// ctnetlink, the binary counterpart of /proc/net/nf_conntrack. Only the
+// fields of each entry that shill looks at are decoded.
+class SHILL_EXPORT NetlinkConntrack {
+ public:
+  // An entry of the connection tracking table.
+  struct Connection {
+    Connection();
+
+    uint8_t protocol;
+    // Seconds until the entry expires.
+    uint32_t timeout_seconds;
+    // Whether a packet was seen in the reply direction.
+    bool seen_reply;
+
+    IPAddress original_source_ip_address;
+    uint16_t original_source_port;
+    IPAddress original_destination_ip_address;
+    uint16_t original_destination_port;
+
+    IPAddress reply_source_ip_address;
+    uint16_t reply_source_port;
+    IPAddress reply_destination_ip_address;
+    uint16_t reply_destination_port;
+  };
+
+  static std::unique_ptr<NetlinkConntrack> Create(
+      std::unique_ptr<Sockets> sockets);
+  virtual ~NetlinkConntrack();
+
+  // Get the entries of the connection tracking table for |family|
+  // (AF_INET or AF_INET6).
+  bool GetConnections(uint8_t family, std::vector<Connection>* out_conns);
+
+ private:
+  FRIEND_TEST(NetlinkConntrackTest, ParseConnection);
+  FRIEND_TEST(NetlinkConntrackTest, ParseConnectionMissingTuple);
+
+  // Hidden; use the static Create function above.
+  NetlinkConntrack(std::unique_ptr<Sockets> sockets, int file_descriptor);
+
+  // Decodes the attributes of an IPCTNL_MSG_CT_NEW message, which follow its
+  // nfgenmsg header, into |conn|. Returns false if a field is missing.
+  static bool ParseConnection(uint8_t family,
+                              const unsigned char* data,
+                              size_t length,
+                              Connection* conn);
+
+  // Read the table dump from the netlink socket.
+  bool ReadDumpContents(std::vector<Connection>* out_conns);
+
+  std::unique_ptr<Sockets> sockets_;
+  int file_descriptor_;
+  int sequence_number_;
+
+  DISALLOW_COPY_AND_ASSIGN(NetlinkConntrack);
+};
+
+}  // namespace shill
+
+#endif  // SHILL_NET_NETLINK_CONNTRACK_H_
@@ -0,0 +1,98 @@
+// Copyright 2020 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "shill/net/netlink_conntrack.h"
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "shill/net/ip_address.h"
+
+namespace shill {
+
+namespace {
+
+// The attributes of the conntrack entry of an unanswered DNS query from
+// 192.168.1.10:40000 to 8.8.8.8:53, as dumped by the kernel after the
+// nfgenmsg header.
+const unsigned char kDnsQueryAttributes[] = {
+    // CTA_TUPLE_ORIG
+    0x34, 0x00, 0x01, 0x80,
+    // CTA_TUPLE_IP
+    0x14, 0x00, 0x01, 0x80,
+    0x08, 0x00, 0x01, 0x00, 0xc0, 0xa8, 0x01, 0x0a,  // CTA_IP_V4_SRC
+    0x08, 0x00, 0x02, 0x00, 0x08, 0x08, 0x08, 0x08,  // CTA_IP_V4_DST
+    // CTA_TUPLE_PROTO
+    0x1c, 0x00, 0x02, 0x80,
+    0x05, 0x00, 0x01, 0x00, 0x11, 0x00, 0x00, 0x00,  // CTA_PROTO_NUM
+    0x06, 0x00, 0x02, 0x00, 0x9c, 0x40, 0x00, 0x00,  // CTA_PROTO_SRC_PORT
+    0x06, 0x00, 0x03, 0x00, 0x00, 0x35, 0x00, 0x00,  // CTA_PROTO_DST_PORT
+    // CTA_TUPLE_REPLY
+    0x34, 0x00, 0x02, 0x80,
+    // CTA_TUPLE_IP
+    0x14, 0x00, 0x01, 0x80,
+    0x08, 0x00, 0x01, 0x00, 0x08, 0x08, 0x08, 0x08,  // CTA_IP_V4_SRC
+    0x08, 0x00, 0x02, 0x00, 0xc0, 0xa8, 0x01, 0x0a,  // CTA_IP_V4_DST
+    // CTA_TUPLE_PROTO
+    0x1c, 0x00, 0x02, 0x80,
+    0x05, 0x00, 0x01, 0x00, 0x11, 0x00, 0x00, 0x00,  // CTA_PROTO_NUM
+    0x06, 0x00, 0x02, 0x00, 0x00, 0x35, 0x00, 0x00,  // CTA_PROTO_SRC_PORT
+    0x06, 0x00, 0x03, 0x00, 0x9c, 0x40, 0x00, 0x00,  // CTA_PROTO_DST_PORT
+    // CTA_STATUS: IPS_CONFIRMED
+    0x08, 0x00, 0x03, 0x00, 0x00, 0x00, 0x00, 0x08,
+    // CTA_TIMEOUT: 14 seconds
+    0x08, 0x00, 0x07, 0x00, 0x00, 0x00, 0x00, 0x0e,
+};
+
+// Offset of the CTA_STATUS attribute in kDnsQueryAttributes.
+const size_t kStatusOffset = 104;
+
+}  // namespace
+
+TEST(NetlinkConntrackTest, ParseConnection) {
+  NetlinkConntrack::Connection conn;
+  ASSERT_TRUE(NetlinkConntrack::ParseConnection(
+      AF_INET, kDnsQueryAttributes, sizeof(kDnsQueryAttributes), &conn));
+  EXPECT_EQ(IPPROTO_UDP, conn.protocol);
+  EXPECT_EQ(14, conn.timeout_seconds);
+  EXPECT_FALSE(conn.seen_reply);
+  EXPECT_EQ("192.168.1.10", conn.original_source_ip_address.ToString());
+  EXPECT_EQ(40000, conn.original_source_port);
+  EXPECT_EQ("8.8.8.8", conn.original_destination_ip_address.ToString());
+  EXPECT_EQ(53, conn.original_destination_port);
+  EXPECT_EQ("8.8.8.8", conn.reply_source_ip_address.ToString());
+  EXPECT_EQ(53, conn.reply_source_port);
+  EXPECT_EQ("192.168.1.10", conn.reply_destination_ip_address.ToString());
+  EXPECT_EQ(40000, conn.reply_destination_port);
+
+  // IPS_SEEN_REPLY | IPS_CONFIRMED
+  std::vector<unsigned char> answered(
+      kDnsQueryAttributes, kDnsQueryAttributes + sizeof(kDnsQueryAttributes));
+  answered[kStatusOffset + 7] = 0x0a;
+  ASSERT_TRUE(NetlinkConntrack::ParseConnection(AF_INET, answered.data(),
+                                                answered.size(), &conn));
+  EXPECT_TRUE(conn.seen_reply);
+
+  // The addresses do not match the family.
+  EXPECT_FALSE(NetlinkConntrack::ParseConnection(
+      AF_INET6, kDnsQueryAttributes, sizeof(kDnsQueryAttributes), &conn));
+}
+
+TEST(NetlinkConntrackTest, ParseConnectionMissingTuple) {
+  NetlinkConntrack::Connection conn;
+  // Only CTA_TUPLE_ORIG.
+  EXPECT_FALSE(
+      NetlinkConntrack::ParseConnection(AF_INET, kDnsQueryAttributes, 52,
+                                        &conn));
+  // CTA_TUPLE_ORIG claims more bytes than there are.
+  EXPECT_FALSE(
+      NetlinkConntrack::ParseConnection(AF_INET, kDnsQueryAttributes, 40,
+                                        &conn));
+}
+
+}  // namespace shill
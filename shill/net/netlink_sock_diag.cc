@@ -141,6 +141,22 @@ bool NetlinkSockDiag::GetSockets(
     uint8_t protocol,
     std::vector<struct inet_diag_sockid>* out_socks) {
   CHECK(out_socks);
+  std::vector<struct inet_diag_msg> msgs;
+  if (!GetSocketInfos(family, protocol, &msgs))
+    return false;
+
+  out_socks->clear();
+  out_socks->reserve(msgs.size());
+  for (const auto& msg : msgs)
+    out_socks->push_back(msg.id);
+  return true;
+}
+
+bool NetlinkSockDiag::GetSocketInfos(
+    uint8_t family,
+    uint8_t protocol,
+    std::vector<struct inet_diag_msg>* out_msgs) {
+  CHECK(out_msgs);
   SockDiagRequest request =
       CreateDumpRequest(family, protocol, ++sequence_number_);
   if (sockets_->Send(file_descriptor_, static_cast<void*>(&request),
@@ -150,14 +166,14 @@ bool NetlinkSockDiag::GetSockets(
     return false;
   }
 
-  return ReadDumpContents(out_socks);
+  return ReadDumpContents(out_msgs);
 }
 
 bool NetlinkSockDiag::ReadDumpContents(
-    std::vector<struct inet_diag_sockid>* out_socks) {
+    std::vector<struct inet_diag_msg>* out_msgs) {
   char buf[8192];
 
-  out_socks->clear();
+  out_msgs->clear();
 
   for (;;) {
     ssize_t bytes_read = sockets_->RecvFrom(file_descriptor_, buf, sizeof(buf),
@@ -187,9 +203,12 @@ bool NetlinkSockDiag::ReadDumpContents(
           return false;
         }
         case SOCK_DIAG_BY_FAMILY:
-          struct inet_diag_msg current_msg;
-          memcpy(&current_msg, NLMSG_DATA(nlh), sizeof(current_msg));
-          out_socks->push_back(current_msg.id);
+          if (nlh->nlmsg_len < NLMSG_LENGTH(sizeof(struct inet_diag_msg))) {
+            LOG(WARNING) << "Ignoring truncated sock_diag message";
+            break;
+          }
+          out_msgs->emplace_back();
+          memcpy(&out_msgs->back(), NLMSG_DATA(nlh), sizeof(out_msgs->back()));
           break;
         default:
           LOG(WARNING) << "Ignoring unexpected netlink message type "
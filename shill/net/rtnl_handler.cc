@@ -14,10 +14,12 @@
 #include <netinet/ether.h>
 #include <string.h>
 #include <sys/ioctl.h>
+#include <sys/select.h>
 #include <sys/socket.h>
 #include <time.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <limits>
 #include <utility>
 
@@ -25,6 +27,7 @@
 #include <base/logging.h>
 #include <base/stl_util.h>
 #include <base/strings/stringprintf.h>
+#include <base/time/time.h>
 
 #include "shill/logging.h"
 #include "shill/net/io_handler.h"
@@ -65,6 +68,11 @@ base::LazyInstance<RTNLHandler>::DestructorAtExit g_rtnl_handler =
 
 // Increasing buffer size to avoid overflows on IPV6 routing events.
 constexpr int kReceiveBufferBytes = 1024 * 1024;
+
+// How long SendMessagesAndWait() waits for all of the acknowledgements. The
+// kernel replies right away, so this only bounds how long shill is blocked
+// when a reply gets lost.
+constexpr int kAckTimeoutMilliseconds = 1000;
 }  // namespace
 
 RTNLHandler::RTNLHandler()
@@ -507,6 +515,100 @@ bool RTNLHandler::SendMessageWithErrorMask(std::unique_ptr<RTNLMessage> message,
   return true;
 }
 
+bool RTNLHandler::SendMessagesAndWait(
+    std::vector<std::unique_ptr<RTNLMessage>> messages,
+    std::vector<int32_t>* errors) {
+  CHECK(errors);
+  errors->clear();
+  if (messages.empty())
+    return true;
+
+  // The sequence numbers only need to be unique on this socket; they are the
+  // index of each message plus one.
+  ByteString batch;
+  for (size_t i = 0; i < messages.size(); ++i) {
+    CHECK(messages[i]->flags() & NLM_F_ACK) << messages[i]->ToString();
+    messages[i]->set_seq(i + 1);
+    ByteString msgdata = messages[i]->Encode();
+    if (msgdata.IsEmpty()) {
+      LOG(ERROR) << "Failed to encode " << messages[i]->ToString();
+      return false;
+    }
+    msgdata.Resize(NLMSG_ALIGN(msgdata.GetLength()));
+    batch.Append(msgdata);
+  }
+
+  int socket = OpenNetlinkSocketFD(sockets_.get(), NETLINK_ROUTE, 0);
+  if (socket == Sockets::kInvalidFileDescriptor)
+    return false;
+  ScopedSocketCloser socket_closer(sockets_.get(), socket);
+  if (socket >= FD_SETSIZE) {
+    LOG(ERROR) << "Invalid RTNL socket " << socket;
+    return false;
+  }
+
+  SLOG(this, 5) << "RTNL sending " << messages.size()
+                << " messages, length " << batch.GetLength();
+  if (sockets_->Send(socket, batch.GetConstData(), batch.GetLength(), 0) < 0) {
+    PLOG(ERROR) << "RTNL send failed";
+    return false;
+  }
+
+  std::vector<int32_t> replies(messages.size(), 0);
+  std::vector<bool> acknowledged(messages.size(), false);
+  size_t pending = messages.size();
+  // Large enough for error replies, which quote the request.
+  unsigned char buf[8192];
+  const base::TimeTicks deadline =
+      base::TimeTicks::Now() +
+      base::TimeDelta::FromMilliseconds(kAckTimeoutMilliseconds);
+  while (pending > 0) {
+    fd_set read_fds;
+    FD_ZERO(&read_fds);
+    FD_SET(socket, &read_fds);
+    struct timeval wait_duration =
+        std::max(deadline - base::TimeTicks::Now(), base::TimeDelta())
+            .ToTimeVal();
+    int result = sockets_->Select(socket + 1, &read_fds, nullptr, nullptr,
+                                  &wait_duration);
+    if (result < 0) {
+      PLOG(ERROR) << "RTNL select failed";
+      return false;
+    }
+    if (result == 0) {
+      LOG(ERROR) << "Timed out waiting for " << pending << " of "
+                 << messages.size() << " RTNL acknowledgements";
+      return false;
+    }
+    ssize_t bytes_read =
+        sockets_->RecvFrom(socket, buf, sizeof(buf), 0, nullptr, nullptr);
+    if (bytes_read < 0) {
+      PLOG(ERROR) << "RTNL receive failed";
+      return false;
+    }
+    int length = bytes_read;
+    for (const struct nlmsghdr* hdr =
+             reinterpret_cast<const struct nlmsghdr*>(buf);
+         NLMSG_OK(hdr, length); hdr = NLMSG_NEXT(hdr, length)) {
+      if (hdr->nlmsg_type != NLMSG_ERROR ||
+          hdr->nlmsg_len < NLMSG_LENGTH(sizeof(struct nlmsgerr))) {
+        continue;
+      }
+      const size_t index = hdr->nlmsg_seq - 1;
+      if (index >= messages.size() || acknowledged[index])
+        continue;
+      acknowledged[index] = true;
+      replies[index] =
+          -reinterpret_cast<const struct nlmsgerr*>(NLMSG_DATA(hdr))->error;
+      --pending;
+      SLOG(this, 3) << messages[index]->ToString() << " received "
+                    << replies[index];
+    }
+  }
+  errors->swap(replies);
+  return true;
+}
+
 void RTNLHandler::OnReadError(const string& error_msg) {
   LOG(FATAL) << "RTNL Socket read returns error: " << error_msg;
 }
@@ -124,6 +124,17 @@ class SHILL_EXPORT RTNLHandler {
   // not null, then it will be set to the message's assigned sequence number.
   virtual bool SendMessage(std::unique_ptr<RTNLMessage> message, uint32_t* seq);
 
+  // Sends |messages| to the kernel in a single datagram and blocks until each
+  // of them is acknowledged, so they must all be flagged with NLM_F_ACK. A
+  // socket of its own is used, so that the acknowledgements are not mixed up
+  // with events. On success, |errors| is set to the positive errno or 0 the
+  // kernel replied to each message, in order. Returns false if the messages
+  // could not be sent, or if the acknowledgements could not be read or did not
+  // all arrive within a second.
+  virtual bool SendMessagesAndWait(
+      std::vector<std::unique_ptr<RTNLMessage>> messages,
+      std::vector<int32_t>* errors);
+
  protected:
   RTNLHandler();
 
@@ -7,6 +7,7 @@
 #include <limits>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include <gtest/gtest.h>
 #include <net/if.h>
@@ -32,7 +33,11 @@ using testing::_;
 using testing::A;
 using testing::DoAll;
 using testing::ElementsAre;
+using testing::Field;
 using testing::HasSubstr;
+using testing::Invoke;
+using testing::Le;
+using testing::Pointee;
 using testing::Return;
 using testing::ReturnArg;
 using testing::StrictMock;
@@ -553,4 +558,94 @@ TEST_F(RTNLHandlerTest, SetInterfaceMac) {
   StopRTNLHandler();
 }
 
+TEST_F(RTNLHandlerTest, SendMessagesAndWait) {
+  const int kAckSocket = 321;
+  std::vector<std::unique_ptr<RTNLMessage>> messages;
+  for (int i = 0; i < 3; ++i) {
+    messages.push_back(std::make_unique<RTNLMessage>(
+        RTNLMessage::kTypeQdisc, RTNLMessage::kModeAdd,
+        NLM_F_REQUEST | NLM_F_ACK, 0, 0, kTestDeviceIndex,
+        IPAddress::kFamilyUnknown));
+  }
+
+  EXPECT_CALL(*sockets_,
+              Socket(PF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC, NETLINK_ROUTE))
+      .WillOnce(Return(kAckSocket));
+  EXPECT_CALL(*sockets_, SetReceiveBuffer(kAckSocket, _)).WillOnce(Return(0));
+  EXPECT_CALL(*sockets_, Bind(kAckSocket, _, sizeof(sockaddr_nl)))
+      .WillOnce(Return(0));
+  // All of the messages go out in one datagram.
+  EXPECT_CALL(*sockets_, Send(kAckSocket, _, _, 0))
+      .WillOnce(Invoke([](int, const void* buf, size_t len, int) {
+        size_t count = 0;
+        int length = len;
+        for (const struct nlmsghdr* hdr =
+                 reinterpret_cast<const struct nlmsghdr*>(buf);
+             NLMSG_OK(hdr, length); hdr = NLMSG_NEXT(hdr, length)) {
+          EXPECT_EQ(RTM_NEWQDISC, hdr->nlmsg_type);
+          EXPECT_EQ(++count, hdr->nlmsg_seq);
+        }
+        EXPECT_EQ(3u, count);
+        return len;
+      }));
+  // The acknowledgements arrive out of order and over two reads.
+  auto ack = [](std::vector<std::pair<uint32_t, int>> replies) {
+    return [replies](int, void* buf, size_t len, int, struct sockaddr*,
+                     socklen_t*) {
+      struct AckMessage {
+        struct nlmsghdr hdr;
+        struct nlmsgerr err;
+      };
+      AckMessage* acks = reinterpret_cast<AckMessage*>(buf);
+      memset(acks, 0, replies.size() * sizeof(*acks));
+      for (size_t i = 0; i < replies.size(); ++i) {
+        acks[i].hdr.nlmsg_type = NLMSG_ERROR;
+        acks[i].hdr.nlmsg_len = sizeof(*acks);
+        acks[i].hdr.nlmsg_seq = replies[i].first;
+        acks[i].err.error = -replies[i].second;
+      }
+      return replies.size() * sizeof(*acks);
+    };
+  };
+  EXPECT_CALL(*sockets_, Select(kAckSocket + 1, _, nullptr, nullptr, _))
+      .Times(2)
+      .WillRepeatedly(Return(1));
+  EXPECT_CALL(*sockets_, RecvFrom(kAckSocket, _, _, 0, nullptr, nullptr))
+      .WillOnce(Invoke(ack({{2, EEXIST}})))
+      .WillOnce(Invoke(ack({{3, 0}, {1, 0}})));
+  EXPECT_CALL(*sockets_, Close(kAckSocket)).WillOnce(Return(0));
+
+  std::vector<int32_t> errors;
+  EXPECT_TRUE(RTNLHandler::GetInstance()->SendMessagesAndWait(
+      std::move(messages), &errors));
+  EXPECT_THAT(errors, ElementsAre(0, EEXIST, 0));
+}
+
+TEST_F(RTNLHandlerTest, SendMessagesAndWaitTimesOut) {
+  const int kAckSocket = 321;
+  std::vector<std::unique_ptr<RTNLMessage>> messages;
+  messages.push_back(std::make_unique<RTNLMessage>(
+      RTNLMessage::kTypeQdisc, RTNLMessage::kModeAdd, NLM_F_REQUEST | NLM_F_ACK,
+      0, 0, kTestDeviceIndex, IPAddress::kFamilyUnknown));
+
+  EXPECT_CALL(*sockets_,
+              Socket(PF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC, NETLINK_ROUTE))
+      .WillOnce(Return(kAckSocket));
+  EXPECT_CALL(*sockets_, SetReceiveBuffer(kAckSocket, _)).WillOnce(Return(0));
+  EXPECT_CALL(*sockets_, Bind(kAckSocket, _, sizeof(sockaddr_nl)))
+      .WillOnce(Return(0));
+  EXPECT_CALL(*sockets_, Send(kAckSocket, _, _, 0)).WillOnce(ReturnArg<2>());
+  // The wait is bounded, and the batch fails once nothing is left to read
+  // before the deadline.
+  EXPECT_CALL(*sockets_, Select(kAckSocket + 1, _, nullptr, nullptr,
+                                Pointee(Field(&timeval::tv_sec, Le(1)))))
+      .WillOnce(Return(0));
+  EXPECT_CALL(*sockets_, RecvFrom(_, _, _, _, _, _)).Times(0);
+  EXPECT_CALL(*sockets_, Close(kAckSocket)).WillOnce(Return(0));
+
+  std::vector<int32_t> errors;
+  EXPECT_FALSE(RTNLHandler::GetInstance()->SendMessagesAndWait(
+      std::move(messages), &errors));
+}
+
 }  // namespace shill
@@ -11,6 +11,7 @@
 #include <sys/socket.h>
 
 #include <memory>
+#include <utility>
 
 #include <base/logging.h>
 #include <base/strings/string_util.h>
@@ -38,6 +39,12 @@ const char* TypeToString(RTNLMessage::Type type) {
       return "Dnssl";
     case RTNLMessage::kTypeNeighbor:
       return "Neighbor";
+    case RTNLMessage::kTypeQdisc:
+      return "Qdisc";
+    case RTNLMessage::kTypeTrafficClass:
+      return "TrafficClass";
+    case RTNLMessage::kTypeTrafficFilter:
+      return "TrafficFilter";
     default:
       return "UnknownType";
   }
@@ -45,7 +52,8 @@ const char* TypeToString(RTNLMessage::Type type) {
 
 std::unique_ptr<RTNLAttrMap> ParseAttrs(struct rtattr* data, int len) {
   RTNLAttrMap attrs;
-  ByteString attr_bytes(reinterpret_cast<const char*>(data), len);
+  const char* attr_start = reinterpret_cast<const char*>(data);
+  const int attr_len = len;
 
   while (data && RTA_OK(data, len)) {
     attrs[data->rta_type] = ByteString(
@@ -56,12 +64,13 @@ std::unique_ptr<RTNLAttrMap> ParseAttrs(struct rtattr* data, int len) {
   }
 
   if (len) {
-    LOG(ERROR) << "Error parsing RTNL attributes <" << attr_bytes.HexEncode()
+    LOG(ERROR) << "Error parsing RTNL attributes <"
+               << ByteString(attr_start, attr_len).HexEncode()
                << ">, trailing length: " << len;
     return nullptr;
   }
 
-  return std::make_unique<RTNLAttrMap>(attrs);
+  return std::make_unique<RTNLAttrMap>(std::move(attrs));
 }
 
 ByteString PackAttrs(const RTNLAttrMap& attrs) {
@@ -99,6 +108,7 @@ struct RTNLHeader {
     struct rtmsg rtm;
     struct nduseroptmsg nd_user_opt;
     struct ndmsg ndm;
+    struct tcmsg tcm;
   };
 };
 
@@ -127,6 +137,11 @@ std::string RTNLMessage::NeighborStatus::ToString() const {
                             flags, type);
 }
 
+std::string RTNLMessage::TrafficControlStatus::ToString() const {
+  return base::StringPrintf("TrafficControlStatus handle %X parent %X info %X",
+                            handle, parent, info);
+}
+
 std::string RTNLMessage::RdnssOption::ToString() const {
   return base::StringPrintf("RdnssOption lifetime %d", lifetime);
 }
@@ -247,8 +262,8 @@ bool RTNLMessage::DecodeInternal(const ByteString& msg) {
     return false;
   }
 
-  for (const auto& pair : *attrs) {
-    SetAttribute(pair.first, pair.second);
+  for (auto& pair : *attrs) {
+    attributes_[pair.first] = std::move(pair.second);
   }
   return true;
 }
@@ -464,7 +479,8 @@ bool RTNLMessage::DecodeNeighbor(const RTNLHeader* hdr,
 
 ByteString RTNLMessage::Encode() const {
   if (type_ != kTypeLink && type_ != kTypeAddress && type_ != kTypeRoute &&
-      type_ != kTypeRule && type_ != kTypeNeighbor) {
+      type_ != kTypeRule && type_ != kTypeNeighbor && type_ != kTypeQdisc &&
+      type_ != kTypeTrafficClass && type_ != kTypeTrafficFilter) {
     return ByteString();
   }
 
@@ -518,6 +534,14 @@ ByteString RTNLMessage::Encode() const {
         }
         break;
 
+      case kTypeQdisc:
+      case kTypeTrafficClass:
+      case kTypeTrafficFilter:
+        if (!EncodeTrafficControl(&hdr)) {
+          return ByteString();
+        }
+        break;
+
       default:
         NOTREACHED();
     }
@@ -632,6 +656,42 @@ bool RTNLMessage::EncodeNeighbor(RTNLHeader* hdr) const {
   return true;
 }
 
+bool RTNLMessage::EncodeTrafficControl(RTNLHeader* hdr) const {
+  static const uint16_t kAddTypes[] = {RTM_NEWQDISC, RTM_NEWTCLASS,
+                                       RTM_NEWTFILTER};
+  static const uint16_t kDeleteTypes[] = {RTM_DELQDISC, RTM_DELTCLASS,
+                                          RTM_DELTFILTER};
+  static const uint16_t kQueryTypes[] = {RTM_GETQDISC, RTM_GETTCLASS,
+                                         RTM_GETTFILTER};
+  const int index = type_ - kTypeQdisc;
+  switch (mode_) {
+    case kModeAdd:
+      hdr->hdr.nlmsg_type = kAddTypes[index];
+      break;
+    case kModeDelete:
+      hdr->hdr.nlmsg_type = kDeleteTypes[index];
+      break;
+    case kModeQuery:
+      hdr->hdr.nlmsg_type = kQueryTypes[index];
+      break;
+    default:
+      NOTIMPLEMENTED();
+      return false;
+  }
+  hdr->hdr.nlmsg_len = NLMSG_LENGTH(sizeof(hdr->tcm));
+  hdr->tcm.tcm_family = family_;
+  hdr->tcm.tcm_ifindex = interface_index_;
+  hdr->tcm.tcm_handle = traffic_control_status_.handle;
+  hdr->tcm.tcm_parent = traffic_control_status_.parent;
+  hdr->tcm.tcm_info = traffic_control_status_.info;
+  return true;
+}
+
+// static
+ByteString RTNLMessage::EncodeAttributes(const RTNLAttrMap& attributes) {
+  return PackAttrs(attributes);
+}
+
 void RTNLMessage::Reset() {
   type_ = kTypeUnknown;
   mode_ = kModeUnknown;
@@ -644,6 +704,7 @@ void RTNLMessage::Reset() {
   address_status_ = AddressStatus();
   route_status_ = RouteStatus();
   neighbor_status_ = NeighborStatus();
+  traffic_control_status_ = TrafficControlStatus();
   rdnss_option_ = RdnssOption();
   attributes_.clear();
 }
@@ -685,6 +746,11 @@ std::string RTNLMessage::ToString() const {
     case RTNLMessage::kTypeNeighbor:
       str += neighbor_status_.ToString();
       break;
+    case RTNLMessage::kTypeQdisc:
+    case RTNLMessage::kTypeTrafficClass:
+    case RTNLMessage::kTypeTrafficFilter:
+      str += traffic_control_status_.ToString();
+      break;
     default:
       break;
   }
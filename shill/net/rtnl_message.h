@@ -36,6 +36,9 @@ class SHILL_EXPORT RTNLMessage {
     kTypeRdnss,
     kTypeDnssl,
     kTypeNeighbor,
+    kTypeQdisc,
+    kTypeTrafficClass,
+    kTypeTrafficFilter,
   };
 
   enum Mode { kModeUnknown, kModeGet, kModeAdd, kModeDelete, kModeQuery };
@@ -109,6 +112,20 @@ class SHILL_EXPORT RTNLMessage {
     uint8_t type;
   };
 
+  // Header of queueing discipline, traffic class and traffic filter messages.
+  struct TrafficControlStatus {
+    TrafficControlStatus() : handle(0), parent(0), info(0) {}
+    TrafficControlStatus(uint32_t handle_in,
+                         uint32_t parent_in,
+                         uint32_t info_in)
+        : handle(handle_in), parent(parent_in), info(info_in) {}
+    std::string ToString() const;
+    uint32_t handle;
+    uint32_t parent;
+    // For filters, the priority and protocol.
+    uint32_t info;
+  };
+
   struct RdnssOption {
     RdnssOption() : lifetime(0) {}
     RdnssOption(uint32_t lifetime_in, std::vector<IPAddress> addresses_in)
@@ -133,6 +150,8 @@ class SHILL_EXPORT RTNLMessage {
   bool Decode(const ByteString& data);
   // Encode an RTNL message.  Returns empty ByteString on failure.
   ByteString Encode() const;
+  // Encode |attributes| as the value of a nested attribute.
+  static ByteString EncodeAttributes(const RTNLAttrMap& attributes);
   // Reset all fields.
   void Reset();
 
@@ -140,6 +159,7 @@ class SHILL_EXPORT RTNLMessage {
   Type type() const { return type_; }
   Mode mode() const { return mode_; }
   uint16_t flags() const { return flags_; }
+  void set_flags(uint16_t flags) { flags_ = flags; }
   uint32_t seq() const { return seq_; }
   void set_seq(uint32_t seq) { seq_ = seq; }
   uint32_t pid() const { return pid_; }
@@ -169,6 +189,13 @@ class SHILL_EXPORT RTNLMessage {
   void set_neighbor_status(const NeighborStatus& neighbor_status) {
     neighbor_status_ = neighbor_status;
   }
+  const TrafficControlStatus& traffic_control_status() const {
+    return traffic_control_status_;
+  }
+  void set_traffic_control_status(
+      const TrafficControlStatus& traffic_control_status) {
+    traffic_control_status_ = traffic_control_status;
+  }
   // GLint hates "unsigned short", and I don't blame it, but that's the
   // type that's used in the system headers.  Use uint16_t instead and hope
   // that the conversion never ends up truncating on some strange platform.
@@ -215,6 +242,7 @@ class SHILL_EXPORT RTNLMessage {
   SHILL_PRIVATE bool EncodeAddress(RTNLHeader* hdr) const;
   SHILL_PRIVATE bool EncodeRoute(RTNLHeader* hdr) const;
   SHILL_PRIVATE bool EncodeNeighbor(RTNLHeader* hdr) const;
+  SHILL_PRIVATE bool EncodeTrafficControl(RTNLHeader* hdr) const;
 
   Type type_;
   Mode mode_;
@@ -227,6 +255,7 @@ class SHILL_EXPORT RTNLMessage {
   AddressStatus address_status_;
   RouteStatus route_status_;
   NeighborStatus neighbor_status_;
+  TrafficControlStatus traffic_control_status_;
   RdnssOption rdnss_option_;
   RTNLAttrMap attributes_;
   // NOTE: Update Reset() accordingly when adding a new member field.
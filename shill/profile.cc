@@ -32,6 +32,15 @@ using std::vector;
 
 namespace shill {
 
+namespace {
+
+// Services and devices are saved after many of their property changes, e.g.
+// on each connection. The writes of their flushes within this long are
+// coalesced.
+constexpr int64_t kStorageFlushDelayMilliseconds = 5000;
+
+}  // namespace
+
 // static
 const char Profile::kUserProfileListPathname[] = RUNDIR "/loaded_profile_list";
 
@@ -80,7 +89,8 @@ Profile::~Profile() = default;
 bool Profile::InitStorage(InitStorageOption storage_option, Error* error) {
   CHECK(!persistent_profile_path_.empty());
   std::unique_ptr<StoreInterface> storage =
-      CreateStore(persistent_profile_path_);
+      CreateCoalescingStore(persistent_profile_path_, manager_->dispatcher(),
+                            kStorageFlushDelayMilliseconds);
   bool already_exists = !storage->IsEmpty();
   if (!already_exists && storage_option != kCreateNew &&
       storage_option != kCreateOrOpenExisting) {
@@ -345,7 +355,7 @@ bool Profile::MatchesIdentifier(const Identifier& name) const {
 }
 
 bool Profile::Save() {
-  return storage_->Flush();
+  return storage_->Flush() && storage_->FlushPending();
 }
 
 RpcIdentifiers Profile::EnumerateAvailableServices(Error* error) {
@@ -5,6 +5,7 @@
 #include "shill/routing_table.h"
 
 #include <arpa/inet.h>
+#include <errno.h>
 #include <fcntl.h>
 #include <limits.h>
 #include <linux/fib_rules.h>
@@ -194,17 +195,29 @@ void RoutingTable::RegisterDevice(int interface_index,
   managed_interfaces_.insert(interface_index);
 
   uint32_t table_id = GetInterfaceTableId(interface_index);
-  // Move existing entries for this interface to the per-Device table.
-  for (auto& nent : tables_[interface_index]) {
+  // Move existing entries for this interface to the per-Device table. All of
+  // them are added there before any is removed from its old table.
+  RouteTableEntryVector& table = tables_[interface_index];
+  MessageBatch batch;
+  for (const auto& nent : table) {
     if (nent.table == table_id) {
       continue;
     }
     RoutingTableEntry new_entry = nent;
     new_entry.table = table_id;
-    AddRouteToKernelTable(interface_index, new_entry);
-    RemoveRouteFromKernelTable(interface_index, nent);
+    batch.push_back(CreateRouteMessage(interface_index, new_entry,
+                                       RTNLMessage::kModeAdd,
+                                       NLM_F_CREATE | NLM_F_EXCL));
+  }
+  for (auto& nent : table) {
+    if (nent.table == table_id) {
+      continue;
+    }
+    batch.push_back(CreateRouteMessage(interface_index, nent,
+                                       RTNLMessage::kModeDelete, 0));
     nent.table = table_id;
   }
+  SendBatch(std::move(batch), nullptr);
 
   // Set accept_ra_rt_table to -N to cause routes created by the reception of
   // RAs to be sent to the table id (interface_index + N).
@@ -369,7 +382,20 @@ bool RoutingTable::ConfigureRoutes(int interface_index,
 
   IPAddress::Family address_family = ipconfig->properties().address_family;
   const vector<IPConfig::Route>& routes = ipconfig->properties().routes;
+  if (routes.empty()) {
+    return true;
+  }
+  if (table_id != GetInterfaceTableId(interface_index)) {
+    LOG(ERROR) << "Can't add routes to table " << table_id
+               << " when the interface's per-device table is "
+               << GetInterfaceTableId(interface_index);
+    return false;
+  }
 
+  // Only the routes which are not installed yet are sent to the kernel, all
+  // in one batch.
+  RouteTableEntryVector& table = tables_[interface_index];
+  RouteTableEntryVector entries;
   for (const auto& route : routes) {
     SLOG(this, 3) << "Installing route:"
                   << " Destination: " << route.host
@@ -389,11 +415,32 @@ bool RoutingTable::ConfigureRoutes(int interface_index,
       continue;
     }
     destination_address.set_prefix(route.prefix);
-    if (!AddRoute(interface_index,
-                  RoutingTableEntry::Create(destination_address, source_address,
-                                            gateway_address)
-                      .SetMetric(metric)
-                      .SetTable(table_id))) {
+    auto entry = RoutingTableEntry::Create(destination_address, source_address,
+                                           gateway_address)
+                     .SetMetric(metric)
+                     .SetTable(table_id);
+    if (base::ContainsValue(table, entry) ||
+        base::ContainsValue(entries, entry)) {
+      SLOG(this, 3) << "Route is already installed: " << entry;
+      continue;
+    }
+    entries.push_back(entry);
+  }
+
+  MessageBatch batch;
+  for (const auto& entry : entries) {
+    batch.push_back(CreateRouteMessage(interface_index, entry,
+                                       RTNLMessage::kModeAdd,
+                                       NLM_F_CREATE | NLM_F_EXCL));
+  }
+  vector<int32_t> errors;
+  if (!SendBatch(std::move(batch), &errors)) {
+    return false;
+  }
+  for (size_t i = 0; i < entries.size(); ++i) {
+    if (errors[i] == 0) {
+      table.push_back(entries[i]);
+    } else {
       ret = false;
     }
   }
@@ -408,25 +455,31 @@ void RoutingTable::FlushRoutes(int interface_index) {
     return;
   }
 
+  MessageBatch batch;
   for (const auto& nent : table->second) {
-    RemoveRouteFromKernelTable(interface_index, nent);
+    batch.push_back(CreateRouteMessage(interface_index, nent,
+                                       RTNLMessage::kModeDelete, 0));
   }
+  SendBatch(std::move(batch), nullptr);
   table->second.clear();
 }
 
 void RoutingTable::FlushRoutesWithTag(int tag) {
   SLOG(this, 2) << __func__;
 
+  MessageBatch batch;
   for (auto& table : tables_) {
     for (auto nent = table.second.begin(); nent != table.second.end();) {
       if (nent->tag == tag) {
-        RemoveRouteFromKernelTable(table.first, *nent);
+        batch.push_back(CreateRouteMessage(table.first, *nent,
+                                           RTNLMessage::kModeDelete, 0));
         nent = table.second.erase(nent);
       } else {
         ++nent;
       }
     }
   }
+  SendBatch(std::move(batch), nullptr);
 }
 
 void RoutingTable::ResetTable(int interface_index) {
@@ -609,6 +662,15 @@ bool RoutingTable::ApplyRoute(uint32_t interface_index,
                               const RoutingTableEntry& entry,
                               RTNLMessage::Mode mode,
                               unsigned int flags) {
+  return rtnl_handler_->SendMessage(
+      CreateRouteMessage(interface_index, entry, mode, flags), nullptr);
+}
+
+std::unique_ptr<RTNLMessage> RoutingTable::CreateRouteMessage(
+    uint32_t interface_index,
+    const RoutingTableEntry& entry,
+    RTNLMessage::Mode mode,
+    unsigned int flags) {
   DCHECK(entry.table != RT_TABLE_UNSPEC && entry.table != RT_TABLE_COMPAT)
       << "Attempted to apply route: " << entry;
 
@@ -647,7 +709,7 @@ bool RoutingTable::ApplyRoute(uint32_t interface_index,
                           ByteString::CreateFromCPUUInt32(interface_index));
   }
 
-  return rtnl_handler_->SendMessage(std::move(message), nullptr);
+  return message;
 }
 
 // Somewhat surprisingly, the kernel allows you to create multiple routes
@@ -768,6 +830,15 @@ bool RoutingTable::ApplyRule(uint32_t interface_index,
                              const RoutingPolicyEntry& entry,
                              RTNLMessage::Mode mode,
                              unsigned int flags) {
+  return rtnl_handler_->SendMessage(
+      CreateRuleMessage(interface_index, entry, mode, flags), nullptr);
+}
+
+std::unique_ptr<RTNLMessage> RoutingTable::CreateRuleMessage(
+    uint32_t interface_index,
+    const RoutingPolicyEntry& entry,
+    RTNLMessage::Mode mode,
+    unsigned int flags) {
   SLOG(this, 2) << base::StringPrintf(
       "%s: index %d family %s prio %d", __func__, interface_index,
       IPAddress::GetAddressFamilyName(entry.family).c_str(), entry.priority);
@@ -811,7 +882,48 @@ bool RoutingTable::ApplyRule(uint32_t interface_index,
     message->SetAttribute(FRA_SRC, entry.src.address());
   }
 
-  return rtnl_handler_->SendMessage(std::move(message), nullptr);
+  return message;
+}
+
+bool RoutingTable::SendBatch(MessageBatch batch, vector<int32_t>* errors) {
+  if (batch.empty()) {
+    if (errors) {
+      errors->clear();
+    }
+    return true;
+  }
+  // A single change whose result nobody asks for is sent without waiting, as
+  // shill always has: it would gain nothing from the ack but a blocking round
+  // trip, and RTNLHandler still logs the kernel's error reply when it arrives.
+  if (batch.size() == 1 && !errors) {
+    return rtnl_handler_->SendMessage(std::move(batch.front()), nullptr);
+  }
+
+  vector<RTNLMessage::Mode> modes;
+  for (auto& message : batch) {
+    message->set_flags(message->flags() | NLM_F_ACK);
+    modes.push_back(message->mode());
+  }
+  vector<int32_t> results;
+  if (!rtnl_handler_->SendMessagesAndWait(std::move(batch), &results)) {
+    LOG(ERROR) << "Failed to send " << modes.size() << " routing changes";
+    return false;
+  }
+  for (size_t i = 0; i < results.size(); ++i) {
+    if ((modes[i] == RTNLMessage::kModeAdd && results[i] == EEXIST) ||
+        (modes[i] == RTNLMessage::kModeDelete &&
+         (results[i] == ESRCH || results[i] == ENODEV ||
+          results[i] == ENOENT))) {
+      results[i] = 0;
+    }
+    LOG_IF(ERROR, results[i] != 0)
+        << "Routing change " << i << " of " << results.size()
+        << " failed: " << strerror(results[i]);
+  }
+  if (errors) {
+    errors->swap(results);
+  }
+  return true;
 }
 
 bool RoutingTable::ParseRoutingPolicyMessage(const RTNLMessage& message,
@@ -948,9 +1060,12 @@ void RoutingTable::FlushRules(int interface_index) {
     return;
   }
 
+  MessageBatch batch;
   for (const auto& nent : table->second) {
-    ApplyRule(interface_index, nent, RTNLMessage::kModeDelete, 0);
+    batch.push_back(CreateRuleMessage(interface_index, nent,
+                                      RTNLMessage::kModeDelete, 0));
   }
+  SendBatch(std::move(batch), nullptr);
   table->second.clear();
 }
 
@@ -970,16 +1085,19 @@ uint32_t RoutingTable::RequestAdditionalTableId() {
 
   // Flush any entries currently in this table before letting the caller
   // use it.
+  MessageBatch batch;
   for (auto& table : tables_) {
     for (auto nent = table.second.begin(); nent != table.second.end();) {
       if (nent->table == table_id) {
-        RemoveRouteFromKernelTable(table.first, *nent);
+        batch.push_back(CreateRouteMessage(table.first, *nent,
+                                           RTNLMessage::kModeDelete, 0));
         nent = table.second.erase(nent);
       } else {
         ++nent;
       }
     }
   }
+  SendBatch(std::move(batch), nullptr);
   return table_id;
 }
 
@@ -162,6 +162,8 @@ class RoutingTable {
   using RouteTables = std::unordered_map<int, RouteTableEntryVector>;
   using PolicyTableEntryVector = std::vector<RoutingPolicyEntry>;
   using PolicyTables = std::unordered_map<int, PolicyTableEntryVector>;
+  // Route and rule changes which are sent to the kernel together.
+  using MessageBatch = std::vector<std::unique_ptr<RTNLMessage>>;
 
   struct Query {
     Query() : sequence(0), tag(0), table_id(0) {}
@@ -194,6 +196,11 @@ class RoutingTable {
                   const RoutingTableEntry& entry,
                   RTNLMessage::Mode mode,
                   unsigned int flags);
+  std::unique_ptr<RTNLMessage> CreateRouteMessage(
+      uint32_t interface_index,
+      const RoutingTableEntry& entry,
+      RTNLMessage::Mode mode,
+      unsigned int flags);
   // Get the default route associated with an interface of a given addr family.
   // A pointer to the route is placed in |*entry|.
   virtual bool GetDefaultRouteInternal(int interface_index,
@@ -208,6 +215,21 @@ class RoutingTable {
                  const RoutingPolicyEntry& entry,
                  RTNLMessage::Mode mode,
                  unsigned int flags);
+  std::unique_ptr<RTNLMessage> CreateRuleMessage(
+      uint32_t interface_index,
+      const RoutingPolicyEntry& entry,
+      RTNLMessage::Mode mode,
+      unsigned int flags);
+
+  // Sends the changes in |batch| to the kernel in a single datagram, and
+  // waits (for a bounded time) for the kernel to acknowledge them so that the
+  // result of each is known. A batch of one change is sent like any other
+  // message, without waiting, unless |errors| is given. Unless |errors| is
+  // null, it is set to the errno of each change, in order, or 0 if it was
+  // applied; adding what already exists and removing what does not (ESRCH and
+  // ENODEV for routes, ENOENT for rules) are not errors. Returns false if the
+  // batch was not sent or not acknowledged in time.
+  bool SendBatch(MessageBatch batch, std::vector<int32_t>* errors);
   bool ParseRoutingPolicyMessage(const RTNLMessage& message,
                                  RoutingPolicyEntry* entry);
   bool HandleRoutingPolicyMessage(const RTNLMessage& message);
@@ -4,6 +4,7 @@
 
 #include "shill/routing_table.h"
 
+#include <errno.h>
 #include <linux/rtnetlink.h>
 #include <sys/socket.h>
 
@@ -30,9 +31,13 @@ using base::Unretained;
 using std::deque;
 using std::vector;
 using testing::_;
+using testing::DoAll;
+using testing::ElementsAre;
 using testing::Field;
 using testing::Invoke;
 using testing::Return;
+using testing::SetArgPointee;
+using testing::SizeIs;
 using testing::StrictMock;
 using testing::Test;
 using testing::WithArg;
@@ -473,9 +478,11 @@ TEST_F(RoutingTableTest, PolicyRuleAddFlush) {
                      .SetUidRange({100, 101})));
   EXPECT_EQ(CountRoutingPolicyEntries(), 3);
 
-  EXPECT_CALL(rtnl_handler_, DoSendMessage(_, _))
-      .Times(2)
-      .WillRepeatedly(Return(true));
+  // Both rules of the interface are removed in one batch, where a rule the
+  // kernel has already dropped is not an error.
+  EXPECT_CALL(rtnl_handler_, DoSendMessagesAndWait(SizeIs(2), _))
+      .WillOnce(
+          DoAll(SetArgPointee<1>(vector<int32_t>{0, ENOENT}), Return(true)));
   routing_table_->FlushRules(iface_id0);
   EXPECT_EQ(CountRoutingPolicyEntries(), 1);
 
@@ -608,11 +615,16 @@ TEST_F(RoutingTableTest, ConfigureRoutes) {
           .SetMetric(kMetric)
           .SetTable(RoutingTable::GetInterfaceTableId(kTestDeviceIndex0));
 
+  // Even a single route waits for the kernel, so that it is only recorded
+  // once it is known to be installed.
   EXPECT_CALL(
       rtnl_handler_,
-      DoSendMessage(IsRoutingPacket(RTNLMessage::kModeAdd, kTestDeviceIndex0,
-                                    entry, NLM_F_CREATE | NLM_F_EXCL),
-                    _));
+      DoSendMessagesAndWait(
+          ElementsAre(IsRoutingPacket(RTNLMessage::kModeAdd, kTestDeviceIndex0,
+                                      entry,
+                                      NLM_F_CREATE | NLM_F_EXCL | NLM_F_ACK)),
+          _))
+      .WillOnce(DoAll(SetArgPointee<1>(vector<int32_t>{0}), Return(true)));
   EXPECT_TRUE(routing_table_->ConfigureRoutes(
       kTestDeviceIndex0, ipconfig, kMetric,
       RoutingTable::GetInterfaceTableId(kTestDeviceIndex0)));
@@ -627,15 +639,91 @@ TEST_F(RoutingTableTest, ConfigureRoutes) {
   routes.push_back(route);
   ipconfig->UpdateProperties(properties, true);
 
-  EXPECT_CALL(
-      rtnl_handler_,
-      DoSendMessage(IsRoutingPacket(RTNLMessage::kModeAdd, kTestDeviceIndex0,
-                                    entry, NLM_F_CREATE | NLM_F_EXCL),
-                    _))
-      .Times(1);
+  // The valid route is already installed, so nothing is sent.
   EXPECT_FALSE(routing_table_->ConfigureRoutes(
       kTestDeviceIndex0, ipconfig, kMetric,
       RoutingTable::GetInterfaceTableId(kTestDeviceIndex0)));
+  EXPECT_EQ(1, (*GetRoutingTables())[kTestDeviceIndex0].size());
+}
+
+TEST_F(RoutingTableTest, ConfigureRoutesInOneBatch) {
+  MockControl control;
+  IPConfigRefPtr ipconfig(new IPConfig(&control, kTestDeviceName0));
+  IPConfig::Properties properties;
+  properties.address_family = IPAddress::kFamilyIPv4;
+  IPConfig::Route route;
+  route.host = kTestRemoteNetwork4;
+  route.prefix = kTestRemotePrefix4;
+  route.gateway = kTestGatewayAddress4;
+  properties.routes.push_back(route);
+  route.host = kTestNetAddress0;
+  route.prefix = 32;
+  properties.routes.push_back(route);
+  // Listed twice, but only added once.
+  properties.routes.push_back(route);
+  ipconfig->UpdateProperties(properties, true);
+
+  IPAddress source_address(IPAddress::kFamilyIPv4);
+  IPAddress gateway_address(IPAddress::kFamilyIPv4);
+  ASSERT_TRUE(gateway_address.SetAddressFromString(kTestGatewayAddress4));
+  IPAddress destination_address0(IPAddress::kFamilyIPv4);
+  ASSERT_TRUE(destination_address0.SetAddressFromString(kTestRemoteNetwork4));
+  destination_address0.set_prefix(kTestRemotePrefix4);
+  IPAddress destination_address1(IPAddress::kFamilyIPv4);
+  ASSERT_TRUE(destination_address1.SetAddressFromString(kTestNetAddress0));
+  destination_address1.set_prefix(32);
+
+  const int kMetric = 10;
+  const uint32_t table_id =
+      RoutingTable::GetInterfaceTableId(kTestDeviceIndex0);
+  auto entry0 = RoutingTableEntry::Create(destination_address0,
+                                          source_address, gateway_address)
+                    .SetMetric(kMetric)
+                    .SetTable(table_id);
+  auto entry1 = RoutingTableEntry::Create(destination_address1,
+                                          source_address, gateway_address)
+                    .SetMetric(kMetric)
+                    .SetTable(table_id);
+
+  // The kernel rejects the second route.
+  EXPECT_CALL(
+      rtnl_handler_,
+      DoSendMessagesAndWait(
+          ElementsAre(
+              IsRoutingPacket(RTNLMessage::kModeAdd, kTestDeviceIndex0, entry0,
+                              NLM_F_CREATE | NLM_F_EXCL | NLM_F_ACK),
+              IsRoutingPacket(RTNLMessage::kModeAdd, kTestDeviceIndex0, entry1,
+                              NLM_F_CREATE | NLM_F_EXCL | NLM_F_ACK)),
+          _))
+      .WillOnce(
+          DoAll(SetArgPointee<1>(vector<int32_t>{0, EINVAL}), Return(true)));
+  EXPECT_FALSE(
+      routing_table_->ConfigureRoutes(kTestDeviceIndex0, ipconfig, kMetric,
+                                      table_id));
+  ASSERT_EQ(1, (*GetRoutingTables())[kTestDeviceIndex0].size());
+  EXPECT_EQ(entry0, (*GetRoutingTables())[kTestDeviceIndex0][0]);
+
+  // Only the route which is missing is sent again.
+  EXPECT_CALL(
+      rtnl_handler_,
+      DoSendMessagesAndWait(
+          ElementsAre(IsRoutingPacket(RTNLMessage::kModeAdd, kTestDeviceIndex0,
+                                      entry1,
+                                      NLM_F_CREATE | NLM_F_EXCL | NLM_F_ACK)),
+          _))
+      .WillOnce(DoAll(SetArgPointee<1>(vector<int32_t>{0}), Return(true)));
+  EXPECT_TRUE(
+      routing_table_->ConfigureRoutes(kTestDeviceIndex0, ipconfig, kMetric,
+                                      table_id));
+  EXPECT_EQ(2, (*GetRoutingTables())[kTestDeviceIndex0].size());
+
+  // Both are removed in one batch, where a route the kernel has already
+  // dropped is not an error.
+  EXPECT_CALL(rtnl_handler_, DoSendMessagesAndWait(SizeIs(2), _))
+      .WillOnce(
+          DoAll(SetArgPointee<1>(vector<int32_t>{0, ESRCH}), Return(true)));
+  routing_table_->FlushRoutes(kTestDeviceIndex0);
+  EXPECT_TRUE((*GetRoutingTables())[kTestDeviceIndex0].empty());
 }
 
 MATCHER_P2(IsRoutingQuery, destination, index, "") {
@@ -57,4 +57,13 @@ int Ares::SetServersCsv(ares_channel channel, const char* servers) {
   return ares_set_servers_csv(channel, servers);
 }
 
+void Ares::Search(ares_channel channel,
+                  const char* name,
+                  int dnsclass,
+                  int type,
+                  ares_callback callback,
+                  void* arg) {
+  ares_search(channel, name, dnsclass, type, callback, arg);
+}
+
 }  // namespace shill
@@ -53,6 +53,14 @@ class Ares {
   // ares_set_servers_csv
   virtual int SetServersCsv(ares_channel channel, const char* servers);
 
+  // ares_search
+  virtual void Search(ares_channel channel,
+                      const char* name,
+                      int dnsclass,
+                      int type,
+                      ares_callback callback,
+                      void* arg);
+
  protected:
   Ares();
 
@@ -56,6 +56,9 @@ const char kMinimumMTU[] = "minimum-mtu";
 const char kAcceptHostnameFrom[] = "accept-hostname-from";
 // Flag that causes shill to run third party VPN client programs in a minijail.
 const char kJailVpnClients[] = "jail-vpn-clients";
+// Flag that causes link monitoring to follow the kernel neighbor state of the
+// gateway instead of sniffing ARP requests.
+const char kLinkMonitorNeighborEvents[] = "link-monitor-neighbor-events";
 #ifndef DISABLE_DHCPV6
 // List of devices to enable DHCPv6.
 const char kDhcpv6EnabledDevices[] = "dhcpv6-enabled-devices";
@@ -98,7 +101,9 @@ const char kHelpMessage[] =
     "  --minimum-mtu=mtu\n"
     "    Set the minimum value to respect as the MTU from DHCP responses.\n"
     "  --jail-vpn-clients\n"
-    "    Spawn third party VPN client programs in a minijail.\n";
+    "    Spawn third party VPN client programs in a minijail.\n"
+    "  --link-monitor-neighbor-events\n"
+    "    Monitor links through kernel neighbor events rather than ARP.\n";
 }  // namespace switches
 
 const char kLoggerCommand[] = "/usr/bin/logger";
@@ -226,6 +231,9 @@ int main(int argc, char** argv) {
     settings.jail_vpn_clients = false;
   }
 
+  settings.link_monitor_neighbor_events =
+      cl->HasSwitch(switches::kLinkMonitorNeighborEvents);
+
 #ifndef DISABLE_DHCPV6
   if (cl->HasSwitch(switches::kDhcpv6EnabledDevices)) {
     settings.dhcpv6_enabled_devices = base::SplitString(
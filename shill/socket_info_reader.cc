@@ -4,6 +4,10 @@
 
 #include "shill/socket_info_reader.h"
 
+#include <linux/inet_diag.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
 #include <algorithm>
 #include <limits>
 
@@ -13,6 +17,8 @@
 
 #include "shill/file_reader.h"
 #include "shill/logging.h"
+#include "shill/net/netlink_sock_diag.h"
+#include "shill/net/sockets.h"
 
 using base::FilePath;
 using std::string;
@@ -34,7 +40,7 @@ const char kTcpv6SocketInfoFilePath[] = "/proc/net/tcp6";
 
 }  // namespace
 
-SocketInfoReader::SocketInfoReader() = default;
+SocketInfoReader::SocketInfoReader() : sock_diag_created_(false) {}
 
 SocketInfoReader::~SocketInfoReader() = default;
 
@@ -46,7 +52,15 @@ FilePath SocketInfoReader::GetTcpv6SocketInfoFilePath() const {
   return FilePath(kTcpv6SocketInfoFilePath);
 }
 
+std::unique_ptr<NetlinkSockDiag> SocketInfoReader::CreateSockDiag() {
+  return NetlinkSockDiag::Create(std::make_unique<Sockets>());
+}
+
 bool SocketInfoReader::LoadTcpSocketInfo(vector<SocketInfo>* info_list) {
+  info_list->clear();
+  if (LoadTcpSocketInfoFromSockDiag(info_list))
+    return true;
+
   info_list->clear();
   bool v4_loaded = AppendSocketInfo(GetTcpv4SocketInfoFilePath(), info_list);
   bool v6_loaded = AppendSocketInfo(GetTcpv6SocketInfoFilePath(), info_list);
@@ -55,6 +69,79 @@ bool SocketInfoReader::LoadTcpSocketInfo(vector<SocketInfo>* info_list) {
   return v4_loaded || v6_loaded;
 }
 
+bool SocketInfoReader::LoadTcpSocketInfoFromSockDiag(
+    vector<SocketInfo>* info_list) {
+  if (!sock_diag_created_) {
+    sock_diag_created_ = true;
+    sock_diag_ = CreateSockDiag();
+  }
+  if (!sock_diag_)
+    return false;
+
+  for (uint8_t family : {AF_INET, AF_INET6}) {
+    vector<struct inet_diag_msg> msgs;
+    if (!sock_diag_->GetSocketInfos(family, IPPROTO_TCP, &msgs)) {
+      SLOG(this, 2) << __func__ << ": Falling back to procfs.";
+      sock_diag_.reset();
+      return false;
+    }
+    info_list->reserve(info_list->size() + msgs.size());
+    for (const auto& msg : msgs) {
+      SocketInfo socket_info;
+      if (ParseSockDiagMessage(msg, &socket_info))
+        info_list->push_back(socket_info);
+    }
+  }
+  return true;
+}
+
+bool SocketInfoReader::ParseSockDiagMessage(const struct inet_diag_msg& msg,
+                                            SocketInfo* socket_info) {
+  IPAddress::Family family;
+  if (msg.idiag_family == AF_INET) {
+    family = IPAddress::kFamilyIPv4;
+  } else if (msg.idiag_family == AF_INET6) {
+    family = IPAddress::kFamilyIPv6;
+  } else {
+    return false;
+  }
+
+  // Unlike /proc/net/tcp{,6}, sock_diag gives addresses and ports in network
+  // order.
+  const size_t address_length = IPAddress::GetAddressLength(family);
+  SocketInfo info;
+  info.local_ip_address = IPAddress(
+      family, ByteString(reinterpret_cast<const unsigned char*>(
+                             msg.id.idiag_src),
+                         address_length));
+  info.local_port = ntohs(msg.id.idiag_sport);
+  info.remote_ip_address = IPAddress(
+      family, ByteString(reinterpret_cast<const unsigned char*>(
+                             msg.id.idiag_dst),
+                         address_length));
+  info.remote_port = ntohs(msg.id.idiag_dport);
+
+  // For TCP, the queue values and the state and timer codes are the same as
+  // the ones shown by /proc/net/tcp{,6}.
+  info.transmit_queue_value = msg.idiag_wqueue;
+  info.receive_queue_value = msg.idiag_rqueue;
+  if (msg.idiag_state > 0 &&
+      msg.idiag_state < SocketInfo::kConnectionStateMax) {
+    info.connection_state =
+        static_cast<SocketInfo::ConnectionState>(msg.idiag_state);
+  } else {
+    info.connection_state = SocketInfo::kConnectionStateUnknown;
+  }
+  if (msg.idiag_timer < SocketInfo::kTimerStateMax) {
+    info.timer_state = static_cast<SocketInfo::TimerState>(msg.idiag_timer);
+  } else {
+    info.timer_state = SocketInfo::kTimerStateUnknown;
+  }
+
+  *socket_info = info;
+  return true;
+}
+
 bool SocketInfoReader::AppendSocketInfo(const FilePath& info_file_path,
                                         vector<SocketInfo>* info_list) {
   FileReader file_reader;
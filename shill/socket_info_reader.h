@@ -5,6 +5,7 @@
 #ifndef SHILL_SOCKET_INFO_READER_H_
 #define SHILL_SOCKET_INFO_READER_H_
 
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -14,8 +15,12 @@
 
 #include "shill/socket_info.h"
 
+struct inet_diag_msg;
+
 namespace shill {
 
+class NetlinkSockDiag;
+
 class SocketInfoReader {
  public:
   SocketInfoReader();
@@ -31,9 +36,15 @@ class SocketInfoReader {
   // different file path.
   virtual base::FilePath GetTcpv6SocketInfoFilePath() const;
 
-  // Loads TCP socket information from /proc/net/tcp and /proc/net/tcp6.
-  // Existing entries in |info_list| are always discarded. Returns false
-  // if when neither /proc/net/tcp nor /proc/net/tcp6 can be read.
+  // Returns the sock_diag netlink socket from which TCP socket information is
+  // read, or nullptr if it cannot be opened. Overloaded by unit tests to read
+  // the file paths above instead.
+  virtual std::unique_ptr<NetlinkSockDiag> CreateSockDiag();
+
+  // Loads TCP socket information over sock_diag netlink, or if that fails,
+  // from /proc/net/tcp and /proc/net/tcp6. Existing entries in |info_list|
+  // are always discarded. Returns false if neither sock_diag nor
+  // /proc/net/tcp nor /proc/net/tcp6 can be read.
   virtual bool LoadTcpSocketInfo(std::vector<SocketInfo>* info_list);
 
  private:
@@ -42,10 +53,14 @@ class SocketInfoReader {
   FRIEND_TEST(SocketInfoReaderTest, ParseIPAddress);
   FRIEND_TEST(SocketInfoReaderTest, ParseIPAddressAndPort);
   FRIEND_TEST(SocketInfoReaderTest, ParsePort);
+  FRIEND_TEST(SocketInfoReaderTest, ParseSockDiagMessage);
   FRIEND_TEST(SocketInfoReaderTest, ParseSocketInfo);
   FRIEND_TEST(SocketInfoReaderTest, ParseTimerState);
   FRIEND_TEST(SocketInfoReaderTest, ParseTransimitAndReceiveQueueValues);
 
+  bool LoadTcpSocketInfoFromSockDiag(std::vector<SocketInfo>* info_list);
+  bool ParseSockDiagMessage(const struct inet_diag_msg& msg,
+                            SocketInfo* socket_info);
   bool AppendSocketInfo(const base::FilePath& info_file_path,
                         std::vector<SocketInfo>* info_list);
   bool ParseSocketInfo(const std::string& input, SocketInfo* socket_info);
@@ -62,6 +77,11 @@ class SocketInfoReader {
   bool ParseTimerState(const std::string& input,
                        SocketInfo::TimerState* timer_state);
 
+  // Opened on the first load; reset once it fails so that later loads go
+  // straight to procfs.
+  std::unique_ptr<NetlinkSockDiag> sock_diag_;
+  bool sock_diag_created_;
+
   DISALLOW_COPY_AND_ASSIGN(SocketInfoReader);
 };
 
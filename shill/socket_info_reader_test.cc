@@ -4,12 +4,21 @@
 
 #include "shill/socket_info_reader.h"
 
+#include <arpa/inet.h>
+#include <linux/inet_diag.h>
+#include <string.h>
+#include <sys/socket.h>
+
+#include <memory>
+
 #include <base/files/file_util.h>
 #include <base/files/scoped_temp_dir.h>
 #include <base/strings/stringprintf.h>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include "shill/net/netlink_sock_diag.h"
+
 using base::FilePath;
 using base::ScopedTempDir;
 using std::string;
@@ -57,6 +66,11 @@ class SocketInfoReaderUnderTest : public SocketInfoReader {
   // in procfs (i.e. /proc/net/tcp and /proc/net/tcp6).
   MOCK_METHOD(FilePath, GetTcpv4SocketInfoFilePath, (), (const, override));
   MOCK_METHOD(FilePath, GetTcpv6SocketInfoFilePath, (), (const, override));
+
+  // Always read the files above.
+  std::unique_ptr<NetlinkSockDiag> CreateSockDiag() override {
+    return nullptr;
+  }
 };
 
 class SocketInfoReaderTest : public testing::Test {
@@ -209,6 +223,46 @@ TEST_F(SocketInfoReaderTest, ParseSocketInfo) {
       info);
 }
 
+TEST_F(SocketInfoReaderTest, ParseSockDiagMessage) {
+  struct inet_diag_msg msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.idiag_family = AF_INET;
+  msg.idiag_state = SocketInfo::kConnectionStateEstablished;
+  msg.idiag_timer = SocketInfo::kTimerStateRetransmitTimerPending;
+  msg.idiag_wqueue = 10;
+  msg.idiag_rqueue = 5;
+  msg.id.idiag_sport = htons(80);
+  msg.id.idiag_dport = htons(1020);
+  ASSERT_EQ(1, inet_pton(AF_INET, kIPv4Address_192_168_1_10, msg.id.idiag_src));
+  ASSERT_EQ(1, inet_pton(AF_INET, kIPv4Address_127_0_0_1, msg.id.idiag_dst));
+
+  SocketInfo info;
+  EXPECT_TRUE(reader_.ParseSockDiagMessage(msg, &info));
+  ExpectSocketInfoEqual(
+      SocketInfo(SocketInfo::kConnectionStateEstablished,
+                 StringToIPv4Address(kIPv4Address_192_168_1_10), 80,
+                 StringToIPv4Address(kIPv4Address_127_0_0_1), 1020, 10, 5,
+                 SocketInfo::kTimerStateRetransmitTimerPending),
+      info);
+
+  msg.idiag_family = AF_INET6;
+  msg.idiag_state = SocketInfo::kConnectionStateMax;
+  msg.idiag_timer = SocketInfo::kTimerStateMax;
+  ASSERT_EQ(1, inet_pton(AF_INET6, "123:4567:89ab:cdef:ffee:ddcc:bbaa:9988",
+                         msg.id.idiag_src));
+  memset(msg.id.idiag_dst, 0, sizeof(msg.id.idiag_dst));
+  EXPECT_TRUE(reader_.ParseSockDiagMessage(msg, &info));
+  ExpectSocketInfoEqual(
+      SocketInfo(SocketInfo::kConnectionStateUnknown,
+                 StringToIPv6Address(kIPv6AddressPattern1), 80,
+                 StringToIPv6Address(kIPv6AddressAllZeros), 1020, 10, 5,
+                 SocketInfo::kTimerStateUnknown),
+      info);
+
+  msg.idiag_family = AF_UNIX;
+  EXPECT_FALSE(reader_.ParseSockDiagMessage(msg, &info));
+}
+
 TEST_F(SocketInfoReaderTest, ParseIPAddressAndPort) {
   IPAddress ip_address(IPAddress::kFamilyUnknown);
   uint16_t port = 0;
@@ -5,6 +5,8 @@
 #ifndef SHILL_STORE_INTERFACE_H_
 #define SHILL_STORE_INTERFACE_H_
 
+#include <stdint.h>
+
 #include <memory>
 #include <set>
 #include <string>
@@ -14,6 +16,7 @@
 
 namespace shill {
 
+class EventDispatcher;
 class KeyValueStore;
 
 // An interface to a persistent store implementation.
@@ -35,9 +38,14 @@ class StoreInterface {
   // store are undefined.
   virtual bool Close() = 0;
 
-  // Flush current in-memory data to disk.
+  // Flush current in-memory data to disk. Stores which coalesce their writes
+  // may delay this for a while; see FlushPending().
   virtual bool Flush() = 0;
 
+  // Writes out right away the data of the previous calls to Flush() which
+  // the store delayed, if any. Returns false if that write failed.
+  virtual bool FlushPending() = 0;
+
   // Mark the underlying file store as corrupted, moving the data file
   // to a new filename.  This will prevent the file from being re-opened
   // the next time Open() is called.
@@ -161,6 +169,14 @@ class StoreInterface {
 // Currently, the implementation is provided by key_file_store.cc.
 std::unique_ptr<StoreInterface> CreateStore(const base::FilePath& path);
 
+// Creates a store like CreateStore(), whose flushes are delayed by
+// |flush_delay_milliseconds| on |dispatcher| so that the data of those in
+// the meantime is written at once.
+std::unique_ptr<StoreInterface> CreateCoalescingStore(
+    const base::FilePath& path,
+    EventDispatcher* dispatcher,
+    int64_t flush_delay_milliseconds);
+
 }  // namespace shill
 
 #endif  // SHILL_STORE_INTERFACE_H_
@@ -22,6 +22,7 @@ class StubStorage : public StoreInterface {
   bool Open() override { return false; }
   bool Close() override { return false; }
   bool Flush() override { return false; }
+  bool FlushPending() override { return false; }
   bool MarkAsCorrupted() override { return false; }
   std::set<std::string> GetGroups() const override { return {}; }
   std::set<std::string> GetGroupsWithKey(
@@ -1,15 +1,26 @@
 // Copyright 2018 The Chromium OS Authors. All rights reserved.
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
+#include <arpa/inet.h>
+#include <linux/if_ether.h>
+#include <linux/netlink.h>
+#include <linux/pkt_cls.h>
+#include <linux/pkt_sched.h>
 #include <stdlib.h>
+#include <string.h>
 
+#include <base/numerics/safe_conversions.h>
 #include <base/strings/string_number_conversions.h>
 
 #include <algorithm>
+#include <limits>
+#include <utility>
 #include <vector>
 
 #include "shill/logging.h"
 #include "shill/net/io_handler_factory.h"
+#include "shill/net/rtnl_handler.h"
+#include "shill/net/rtnl_message.h"
 #include "shill/process_manager.h"
 #include "shill/throttler.h"
 
@@ -51,13 +62,196 @@ const char kTemplateBurst[] = "${BURST}";
 const char Throttler::kTCUser[] = "nobody";
 const char Throttler::kTCGroup[] = "nobody";
 
+namespace {
+
+// The handles of the qdiscs and classes set up by the tc commands above.
+constexpr uint32_t kRootQdiscHandle = TC_H_MAKE(1 << 16, 0);          // 1:
+constexpr uint32_t kRootClassHandle = TC_H_MAKE(1 << 16, 1);          // 1:1
+constexpr uint32_t kDefaultClassHandle = TC_H_MAKE(1 << 16, 0x11);    // 1:11
+constexpr uint32_t kIngressQdiscHandle = TC_H_MAKE(TC_H_INGRESS, 0);  // ffff:
+
+constexpr uint32_t kDownlinkFilterPriority = 50;
+constexpr uint32_t kDownlinkFlowId = 1;
+// Largest packet the downlink policer accounts for, as with 'mtu 66000'.
+constexpr uint32_t kDownlinkPoliceMtu = 66000;
+// Largest packet tc assumes when sizing the HTB buffers.
+constexpr uint32_t kUplinkMtu = 1600;
+constexpr uint32_t kUplinkDefaultClassQuantum = 300;
+constexpr int kRateTableSize = 256;
+
+// The packet scheduler clock counts 64ns ticks, as reported by
+// /proc/net/psched on every kernel shill runs on.
+constexpr double kPschedTicksPerSecond = 1e9 / 64;
+
+const uint16_t kAddFlags =
+    NLM_F_REQUEST | NLM_F_ACK | NLM_F_CREATE | NLM_F_EXCL;
+const uint16_t kDeleteFlags = NLM_F_REQUEST | NLM_F_ACK;
+
+uint32_t RateBytesPerSecond(uint32_t rate_kbits) {
+  return base::saturated_cast<uint32_t>(uint64_t{rate_kbits} * 1000 / 8);
+}
+
+// Returns the number of scheduler ticks it takes to send |size| bytes at
+// |rate| bytes per second, like tc_calc_xmittime() of iproute2.
+uint32_t TransmitTime(uint32_t rate, uint32_t size) {
+  return base::saturated_cast<uint32_t>(kPschedTicksPerSecond * size / rate);
+}
+
+template <typename T>
+ByteString StructToByteString(const T& value) {
+  return ByteString(reinterpret_cast<const unsigned char*>(&value),
+                    sizeof(value));
+}
+
+ByteString U32ToByteString(uint32_t value) {
+  return StructToByteString(value);
+}
+
+std::unique_ptr<RTNLMessage> CreateTrafficControlMessage(
+    RTNLMessage::Type type,
+    RTNLMessage::Mode mode,
+    int interface_index,
+    uint32_t handle,
+    uint32_t parent,
+    uint32_t info,
+    const std::string& kind,
+    const RTNLAttrMap& options) {
+  auto message = std::make_unique<RTNLMessage>(
+      type, mode, mode == RTNLMessage::kModeAdd ? kAddFlags : kDeleteFlags, 0,
+      0, interface_index, IPAddress::kFamilyUnknown);
+  message->set_traffic_control_status(
+      RTNLMessage::TrafficControlStatus(handle, parent, info));
+  if (!kind.empty())
+    message->SetAttribute(TCA_KIND, ByteString(kind, true));
+  if (!options.empty())
+    message->SetAttribute(TCA_OPTIONS, RTNLMessage::EncodeAttributes(options));
+  return message;
+}
+
+// Returns the options of an HTB class like
+// 'htb rate ${ULRATE} [prio 0 quantum 300]'.
+RTNLAttrMap CreateHtbClassOptions(uint32_t upload_rate_kbits,
+                                  uint32_t quantum) {
+  struct tc_htb_opt opt = {};
+  opt.rate.rate = RateBytesPerSecond(upload_rate_kbits);
+  // The kernel computes the transmit times itself for a known link layer,
+  // which saves sending rate tables.
+  opt.rate.linklayer = TC_LINKLAYER_ETHERNET;
+  opt.ceil = opt.rate;
+  opt.buffer = TransmitTime(opt.rate.rate, kUplinkMtu);
+  opt.cbuffer = opt.buffer;
+  opt.quantum = quantum;
+  return {{TCA_HTB_PARMS, StructToByteString(opt)}};
+}
+
+// Returns the rate table of a policer, as computed by tc_calc_rtable() of
+// iproute2.
+ByteString CreatePoliceRateTable(struct tc_ratespec* rate) {
+  rate->cell_log = 0;
+  while ((kDownlinkPoliceMtu >> rate->cell_log) > kRateTableSize - 1)
+    rate->cell_log++;
+  rate->cell_align = -1;
+  rate->linklayer = TC_LINKLAYER_ETHERNET;
+  ByteString table;
+  for (int i = 0; i < kRateTableSize; ++i) {
+    table.Append(U32ToByteString(
+        TransmitTime(rate->rate, (i + 1) << rate->cell_log)));
+  }
+  return table;
+}
+
+// Returns the options of the filter dropping the inbound traffic above
+// |download_rate_kbits|, like 'u32 match ip src 0.0.0.0/0 police ...'.
+RTNLAttrMap CreateDownlinkFilterOptions(uint32_t download_rate_kbits) {
+  struct tc_police police = {};
+  police.action = TC_POLICE_SHOT;
+  police.mtu = kDownlinkPoliceMtu;
+  police.rate.rate = RateBytesPerSecond(download_rate_kbits);
+  ByteString rate_table = CreatePoliceRateTable(&police.rate);
+  police.burst = TransmitTime(
+      police.rate.rate,
+      base::saturated_cast<uint32_t>(uint64_t{download_rate_kbits} * 2 * 1024));
+  RTNLAttrMap police_options = {
+      {TCA_POLICE_TBF, StructToByteString(police)},
+      {TCA_POLICE_RATE, rate_table},
+  };
+
+  // 'match ip src 0.0.0.0/0' matches the source address with an empty mask.
+  struct tc_u32_sel selector = {};
+  selector.flags = TC_U32_TERMINAL;
+  selector.nkeys = 1;
+  struct tc_u32_key key = {};
+  key.off = 12;
+  ByteString selector_bytes = StructToByteString(selector);
+  selector_bytes.Append(StructToByteString(key));
+
+  return {
+      {TCA_U32_CLASSID, U32ToByteString(kDownlinkFlowId)},
+      {TCA_U32_SEL, selector_bytes},
+      {TCA_U32_POLICE, RTNLMessage::EncodeAttributes(police_options)},
+  };
+}
+
+// Appends to |messages| the messages which remove the qdiscs of
+// |interface_index|, like kTCCleanUpCmds.
+void AppendCleanUpMessages(
+    int interface_index, std::vector<std::unique_ptr<RTNLMessage>>* messages) {
+  messages->push_back(CreateTrafficControlMessage(
+      RTNLMessage::kTypeQdisc, RTNLMessage::kModeDelete, interface_index, 0,
+      TC_H_ROOT, 0, "", {}));
+  messages->push_back(CreateTrafficControlMessage(
+      RTNLMessage::kTypeQdisc, RTNLMessage::kModeDelete, interface_index, 0,
+      TC_H_INGRESS, 0, "", {}));
+}
+
+// Appends to |messages| the messages which set up throttling on
+// |interface_index|, like kTCThrottleUplinkCmds and kTCThrottleDownlinkCmds.
+void AppendThrottleMessages(
+    int interface_index,
+    uint32_t upload_rate_kbits,
+    uint32_t download_rate_kbits,
+    std::vector<std::unique_ptr<RTNLMessage>>* messages) {
+  if (upload_rate_kbits) {
+    struct tc_htb_glob glob = {};
+    glob.version = TC_HTB_PROTOVER;
+    glob.rate2quantum = 10;
+    glob.defcls = TC_H_MIN(kDefaultClassHandle);
+    messages->push_back(CreateTrafficControlMessage(
+        RTNLMessage::kTypeQdisc, RTNLMessage::kModeAdd, interface_index,
+        kRootQdiscHandle, TC_H_ROOT, 0, "htb",
+        {{TCA_HTB_INIT, StructToByteString(glob)}}));
+    messages->push_back(CreateTrafficControlMessage(
+        RTNLMessage::kTypeTrafficClass, RTNLMessage::kModeAdd, interface_index,
+        kRootClassHandle, kRootQdiscHandle, 0, "htb",
+        CreateHtbClassOptions(upload_rate_kbits, 0)));
+    messages->push_back(CreateTrafficControlMessage(
+        RTNLMessage::kTypeTrafficClass, RTNLMessage::kModeAdd, interface_index,
+        kDefaultClassHandle, kRootClassHandle, 0, "htb",
+        CreateHtbClassOptions(upload_rate_kbits, kUplinkDefaultClassQuantum)));
+  }
+
+  if (download_rate_kbits) {
+    messages->push_back(CreateTrafficControlMessage(
+        RTNLMessage::kTypeQdisc, RTNLMessage::kModeAdd, interface_index,
+        kIngressQdiscHandle, TC_H_INGRESS, 0, "ingress", {}));
+    messages->push_back(CreateTrafficControlMessage(
+        RTNLMessage::kTypeTrafficFilter, RTNLMessage::kModeAdd,
+        interface_index, 0, kIngressQdiscHandle,
+        TC_H_MAKE(kDownlinkFilterPriority << 16, htons(ETH_P_ALL)), "u32",
+        CreateDownlinkFilterOptions(download_rate_kbits)));
+  }
+}
+
+}  // namespace
+
 Throttler::Throttler(EventDispatcher* dispatcher, Manager* manager)
     : file_io_(FileIO::GetInstance()),
       tc_stdin_(-1),
       tc_pid_(0),
       manager_(manager),
       io_handler_factory_(IOHandlerFactory::GetInstance()),
-      process_manager_(ProcessManager::GetInstance()) {
+      process_manager_(ProcessManager::GetInstance()),
+      rtnl_handler_(RTNLHandler::GetInstance()) {
   SLOG(this, 2) << __func__;
 }
 
@@ -94,6 +288,15 @@ bool Throttler::DisableThrottlingOnAllInterfaces(
     return true;
   }
 
+  Error::Type error_type;
+  std::string message;
+  if (tc_pid_ == 0 &&
+      ProgramQdiscs(interfaces, 0, 0, &error_type, &message)) {
+    Done(callback, error_type, message);
+    ClearThrottleStatus();
+    return error_type == Error::kSuccess;
+  }
+
   callback_ = callback;
   result = StartTCForCommands(commands);
   if (result) {
@@ -143,6 +346,20 @@ bool Throttler::ThrottleInterfaces(const ResultCallback& callback,
   desired_upload_rate_kbits_ = upload_rate_kbits;
   desired_download_rate_kbits_ = download_rate_kbits;
 
+  if (tc_pid_ == 0) {
+    std::vector<std::string> interfaces = tc_interfaces_to_throttle_;
+    interfaces.push_back(interface_name);
+    Error::Type error_type;
+    std::string message;
+    if (ProgramQdiscs(interfaces, upload_rate_kbits, download_rate_kbits,
+                      &error_type, &message)) {
+      // The batch covered every interface, so none is left for tc.
+      tc_interfaces_to_throttle_.clear();
+      Done(callback, error_type, message);
+      return error_type == Error::kSuccess;
+    }
+  }
+
   return Throttle(callback, interface_name, upload_rate_kbits,
                   download_rate_kbits);
 }
@@ -209,12 +426,71 @@ bool Throttler::ApplyThrottleToNewInterface(const std::string& interface_name) {
     tc_interfaces_to_throttle_.push_back(interface_name);
     return true;
   }
-  // No operation currently in progress, start a new tc process
+  // No operation currently in progress
+  Error::Type error_type;
+  std::string message;
+  if (ProgramQdiscs({interface_name}, desired_upload_rate_kbits_,
+                    desired_download_rate_kbits_, &error_type, &message)) {
+    // The failed messages were logged already.
+    return error_type == Error::kSuccess;
+  }
+  // Start a new tc process instead
   ResultCallback dummy;
   return Throttle(dummy, interface_name, desired_upload_rate_kbits_,
                   desired_download_rate_kbits_);
 }
 
+bool Throttler::ProgramQdiscs(const std::vector<std::string>& interface_names,
+                              uint32_t upload_rate_kbits,
+                              uint32_t download_rate_kbits,
+                              Error::Type* error_type,
+                              std::string* message) {
+  const bool throttle = upload_rate_kbits || download_rate_kbits;
+  std::vector<std::unique_ptr<RTNLMessage>> messages;
+  // Whether the failure of each message is ignored, as 'tc -f' does for the
+  // clean up commands of interfaces which are not throttled.
+  std::vector<bool> may_fail;
+  for (const auto& interface_name : interface_names) {
+    int interface_index = rtnl_handler_->GetInterfaceIndex(interface_name);
+    if (interface_index < 0) {
+      LOG(WARNING) << "Cannot program the qdiscs of " << interface_name
+                   << " over rtnetlink";
+      return false;
+    }
+    AppendCleanUpMessages(interface_index, &messages);
+    may_fail.resize(messages.size(), true);
+    if (throttle) {
+      AppendThrottleMessages(interface_index, upload_rate_kbits,
+                             download_rate_kbits, &messages);
+      may_fail.resize(messages.size(), false);
+    }
+  }
+
+  SLOG(this, 2) << "Sending " << messages.size() << " tc messages for "
+                << interface_names.size() << " interfaces";
+  std::vector<int32_t> errors;
+  if (!rtnl_handler_->SendMessagesAndWait(std::move(messages), &errors)) {
+    LOG(WARNING) << "Failed to program qdiscs over rtnetlink, using tc";
+    return false;
+  }
+
+  int failures = 0;
+  for (size_t i = 0; i < errors.size(); ++i) {
+    if (errors[i] && !may_fail[i]) {
+      LOG(ERROR) << "tc message " << i << " failed: " << strerror(errors[i]);
+      failures++;
+    }
+  }
+  *error_type = failures ? Error::kOperationFailed : Error::kSuccess;
+  message->clear();
+  if (failures) {
+    *message = (throttle ? "throttling" : "disabling throttle") +
+               std::string(" failed: ") + base::NumberToString(failures) +
+               " tc messages failed";
+  }
+  return true;
+}
+
 bool Throttler::StartTCForCommands(const std::vector<std::string>& commands) {
   CHECK_EQ(tc_pid_, 0);
   CHECK(!commands.empty());
@@ -20,6 +20,7 @@
 namespace shill {
 
 class IOHandlerFactory;
+class RTNLHandler;
 
 // The Throttler class implements bandwidth throttling for inbound/outbound
 // traffic, using Linux's 'traffic control'(tc) tool from the iproute2 code.
@@ -32,8 +33,11 @@ class IOHandlerFactory;
 // Any inbound traffic above a rate of ${DLRATE} kbits/s is dropped on the
 // floor. For egress (upload) traffic, a qdisc using the Hierarchical Token
 // Bucket algorithm is used.
-// The implementation spawns the 'tc' process in a minijail and writes
-// commands to its stdin.
+// The implementation programs the same qdiscs, classes and filters as the
+// tc commands would over rtnetlink, for all interfaces in a single batch of
+// messages, and reports the result synchronously. Should that fail, it falls
+// back to spawning the 'tc' process in a minijail and writing commands to
+// its stdin, one interface at a time.
 
 class Throttler : public base::SupportsWeakPtr<Throttler> {
  public:
@@ -61,6 +65,9 @@ class Throttler : public base::SupportsWeakPtr<Throttler> {
   FRIEND_TEST(ThrottlerTest, ThrottleCallsTCExpectedTimesAndSetsState);
   FRIEND_TEST(ThrottlerTest, NewlyAddedInterfaceIsThrottled);
   FRIEND_TEST(ThrottlerTest, DisablingThrottleClearsState);
+  FRIEND_TEST(ThrottlerTest, DisablingThrottleOverRTNL);
+  FRIEND_TEST(ThrottlerTest, ThrottleOverRTNLFailure);
+  FRIEND_TEST(ThrottlerTest, ThrottleOverRTNLSendsOneBatch);
 
   // Required for spawning the 'tc' process
   // and communicating with it.
@@ -84,6 +91,17 @@ class Throttler : public base::SupportsWeakPtr<Throttler> {
   uint32_t desired_upload_rate_kbits_;
   uint32_t desired_download_rate_kbits_;
 
+  // Replaces the qdiscs of |interface_names| by those throttling traffic to
+  // the given rates, or only removes them if both rates are 0, in one batch
+  // of rtnetlink messages. Returns false if the batch could not be sent, in
+  // which case tc should be used instead; otherwise |error_type| and
+  // |message| describe its outcome.
+  virtual bool ProgramQdiscs(const std::vector<std::string>& interface_names,
+                             uint32_t upload_rate_kbits,
+                             uint32_t download_rate_kbits,
+                             Error::Type* error_type,
+                             std::string* message);
+
   virtual bool StartTCForCommands(const std::vector<std::string>& commands);
 
   virtual bool Throttle(const ResultCallback& callback,
@@ -113,6 +131,8 @@ class Throttler : public base::SupportsWeakPtr<Throttler> {
   IOHandlerFactory* io_handler_factory_;
   // For spawning 'tc'
   ProcessManager* process_manager_;
+  // For programming qdiscs without 'tc'
+  RTNLHandler* rtnl_handler_;
 
   DISALLOW_COPY_AND_ASSIGN(Throttler);
 };
@@ -4,16 +4,26 @@
 
 #include "shill/throttler.h"
 
+#include <errno.h>
+#include <linux/rtnetlink.h>
+
+#include <memory>
+
+#include <base/bind.h>
+#include <base/stl_util.h>
+
 #include "shill/mock_control.h"
 #include "shill/mock_file_io.h"
 #include "shill/mock_log.h"
 #include "shill/mock_manager.h"
 #include "shill/mock_process_manager.h"
 #include "shill/net/mock_io_handler_factory.h"
+#include "shill/net/mock_rtnl_handler.h"
 #include "shill/test_event_dispatcher.h"
 #include "shill/testing.h"
 
 using testing::_;
+using testing::Invoke;
 using testing::NiceMock;
 using testing::Return;
 using testing::StrictMock;
@@ -29,6 +39,22 @@ class ThrottlerTest : public Test {
     throttler_.process_manager_ = &mock_process_manager_;
     throttler_.io_handler_factory_ = &mock_io_factory_handler_;
     throttler_.file_io_ = &mock_file_io_;
+    throttler_.rtnl_handler_ = &mock_rtnl_handler_;
+    ON_CALL(mock_rtnl_handler_, GetInterfaceIndex(_))
+        .WillByDefault(Return(kInterfaceIndex));
+  }
+
+  MOCK_METHOD(void, ResultCallbackTarget, (const Error&));
+
+  ResultCallback GetResultCallback() {
+    return base::Bind(&ThrottlerTest::ResultCallbackTarget,
+                      base::Unretained(this));
+  }
+
+  // Makes the batch of rtnetlink messages fail to be sent, so that tc is used.
+  void FailRTNL() {
+    EXPECT_CALL(mock_rtnl_handler_, DoSendMessagesAndWait(_, _))
+        .WillOnce(Return(false));
   }
 
  protected:
@@ -39,6 +65,7 @@ class ThrottlerTest : public Test {
   static const pid_t kPID2;
   static const pid_t kPID3;
   static const uint32_t kThrottleRate;
+  static const int kInterfaceIndex;
 
   MockControl control_interface_;
   EventDispatcherForTest dispatcher_;
@@ -46,6 +73,7 @@ class ThrottlerTest : public Test {
   NiceMock<MockProcessManager> mock_process_manager_;
   NiceMock<MockIOHandlerFactory> mock_io_factory_handler_;
   NiceMock<MockFileIO> mock_file_io_;
+  NiceMock<MockRTNLHandler> mock_rtnl_handler_;
   Throttler throttler_;
 };
 
@@ -56,11 +84,13 @@ const pid_t ThrottlerTest::kPID1 = 9900;
 const pid_t ThrottlerTest::kPID2 = 9901;
 const pid_t ThrottlerTest::kPID3 = 9902;
 const uint32_t ThrottlerTest::kThrottleRate = 100;
+const int ThrottlerTest::kInterfaceIndex = 3;
 
 TEST_F(ThrottlerTest, ThrottleCallsTCExpectedTimesAndSetsState) {
   std::vector<std::string> interfaces = {kIfaceName0, kIfaceName1};
   EXPECT_CALL(mock_manager_, GetDeviceInterfaceNames())
       .WillOnce(Return(interfaces));
+  FailRTNL();
   EXPECT_CALL(mock_process_manager_,
               StartProcessInMinijailWithPipes(
                   _, base::FilePath(Throttler::kTCPath), _, Throttler::kTCUser,
@@ -84,6 +114,7 @@ TEST_F(ThrottlerTest, NewlyAddedInterfaceIsThrottled) {
   throttler_.desired_throttling_enabled_ = true;
   throttler_.desired_upload_rate_kbits_ = kThrottleRate;
   throttler_.desired_download_rate_kbits_ = kThrottleRate;
+  FailRTNL();
   EXPECT_CALL(mock_process_manager_,
               StartProcessInMinijailWithPipes(
                   _, base::FilePath(Throttler::kTCPath), _, Throttler::kTCUser,
@@ -101,6 +132,7 @@ TEST_F(ThrottlerTest, DisablingThrottleClearsState) {
   std::vector<std::string> interfaces = {kIfaceName0};
   EXPECT_CALL(mock_manager_, GetDeviceInterfaceNames())
       .WillOnce(Return(interfaces));
+  FailRTNL();
   EXPECT_CALL(mock_process_manager_,
               StartProcessInMinijailWithPipes(
                   _, base::FilePath(Throttler::kTCPath), _, Throttler::kTCUser,
@@ -118,4 +150,95 @@ TEST_F(ThrottlerTest, DisablingThrottleClearsState) {
   EXPECT_EQ(throttler_.desired_download_rate_kbits_, 0);
 }
 
+TEST_F(ThrottlerTest, ThrottleOverRTNLSendsOneBatch) {
+  std::vector<std::string> interfaces = {kIfaceName0, kIfaceName1};
+  EXPECT_CALL(mock_manager_, GetDeviceInterfaceNames())
+      .WillOnce(Return(interfaces));
+  EXPECT_CALL(mock_rtnl_handler_, DoSendMessagesAndWait(_, _))
+      .WillOnce(Invoke(
+          [](const std::vector<std::unique_ptr<RTNLMessage>>& messages,
+             std::vector<int32_t>* errors) {
+            const RTNLMessage::Type kInterfaceTypes[] = {
+                RTNLMessage::kTypeQdisc,        RTNLMessage::kTypeQdisc,
+                RTNLMessage::kTypeQdisc,        RTNLMessage::kTypeTrafficClass,
+                RTNLMessage::kTypeTrafficClass, RTNLMessage::kTypeQdisc,
+                RTNLMessage::kTypeTrafficFilter};
+            const size_t kInterfaceMessages = base::size(kInterfaceTypes);
+            EXPECT_EQ(2 * kInterfaceMessages, messages.size());
+            for (size_t i = 0; i < messages.size(); ++i) {
+              EXPECT_EQ(kInterfaceTypes[i % kInterfaceMessages],
+                        messages[i]->type());
+              EXPECT_EQ(kInterfaceIndex, messages[i]->interface_index());
+              EXPECT_FALSE(messages[i]->Encode().IsEmpty());
+            }
+            // There was nothing to clean up.
+            errors->assign(messages.size(), 0);
+            (*errors)[0] = ENOENT;
+            (*errors)[kInterfaceMessages + 1] = EINVAL;
+            return true;
+          }));
+  EXPECT_CALL(mock_process_manager_,
+              StartProcessInMinijailWithPipes(_, _, _, _, _, _, _, _, _, _))
+      .Times(0);
+  EXPECT_CALL(*this, ResultCallbackTarget(IsSuccess()));
+  EXPECT_TRUE(throttler_.ThrottleInterfaces(GetResultCallback(), kThrottleRate,
+                                            kThrottleRate));
+  EXPECT_TRUE(throttler_.desired_throttling_enabled_);
+  EXPECT_EQ(0, throttler_.tc_pid_);
+  EXPECT_TRUE(throttler_.tc_interfaces_to_throttle_.empty());
+}
+
+TEST_F(ThrottlerTest, ThrottleOverRTNLFailure) {
+  std::vector<std::string> interfaces = {kIfaceName0};
+  EXPECT_CALL(mock_manager_, GetDeviceInterfaceNames())
+      .WillOnce(Return(interfaces));
+  EXPECT_CALL(mock_rtnl_handler_, DoSendMessagesAndWait(_, _))
+      .WillOnce(Invoke(
+          [](const std::vector<std::unique_ptr<RTNLMessage>>& messages,
+             std::vector<int32_t>* errors) {
+            // Only the clean up and the downlink throttling.
+            EXPECT_EQ(4u, messages.size());
+            errors->assign(messages.size(), 0);
+            errors->back() = EINVAL;
+            return true;
+          }));
+  EXPECT_CALL(mock_process_manager_,
+              StartProcessInMinijailWithPipes(_, _, _, _, _, _, _, _, _, _))
+      .Times(0);
+  EXPECT_CALL(*this,
+              ResultCallbackTarget(ErrorTypeIs(Error::kOperationFailed)));
+  EXPECT_FALSE(
+      throttler_.ThrottleInterfaces(GetResultCallback(), 0, kThrottleRate));
+  // Failures in the batch are not retried with tc.
+  EXPECT_EQ(0, throttler_.tc_pid_);
+  EXPECT_TRUE(throttler_.tc_interfaces_to_throttle_.empty());
+}
+
+TEST_F(ThrottlerTest, DisablingThrottleOverRTNL) {
+  throttler_.desired_throttling_enabled_ = true;
+  throttler_.desired_upload_rate_kbits_ = kThrottleRate;
+  throttler_.desired_download_rate_kbits_ = kThrottleRate;
+  std::vector<std::string> interfaces = {kIfaceName0, kIfaceName1};
+  EXPECT_CALL(mock_manager_, GetDeviceInterfaceNames())
+      .WillOnce(Return(interfaces));
+  EXPECT_CALL(mock_rtnl_handler_, DoSendMessagesAndWait(_, _))
+      .WillOnce(Invoke(
+          [](const std::vector<std::unique_ptr<RTNLMessage>>& messages,
+             std::vector<int32_t>* errors) {
+            EXPECT_EQ(4u, messages.size());
+            for (const auto& message : messages) {
+              EXPECT_EQ(RTNLMessage::kTypeQdisc, message->type());
+              EXPECT_EQ(RTNLMessage::kModeDelete, message->mode());
+            }
+            // Failing to remove qdiscs which do not exist is not an error.
+            errors->assign(messages.size(), ENOENT);
+            return true;
+          }));
+  EXPECT_CALL(*this, ResultCallbackTarget(IsSuccess()));
+  EXPECT_TRUE(throttler_.DisableThrottlingOnAllInterfaces(GetResultCallback()));
+  EXPECT_FALSE(throttler_.desired_throttling_enabled_);
+  EXPECT_EQ(throttler_.desired_upload_rate_kbits_, 0);
+  EXPECT_EQ(throttler_.desired_download_rate_kbits_, 0);
+}
+
 }  // namespace shill
@@ -4,6 +4,7 @@
 
 #include "shill/traffic_monitor.h"
 
+#include <algorithm>
 #include <utility>
 
 #include <base/bind.h>
@@ -34,6 +35,8 @@ const uint16_t TrafficMonitor::kDnsPort = 53;
 const int64_t TrafficMonitor::kDnsTimedOutThresholdSeconds = 15;
 const int TrafficMonitor::kMinimumFailedSamplesToTrigger = 2;
 const int64_t TrafficMonitor::kSamplingIntervalMilliseconds = 5000;
+const int64_t TrafficMonitor::kMaxSamplingIntervalMilliseconds =
+    kDnsTimedOutThresholdSeconds * 1000;
 
 TrafficMonitor::TrafficMonitor(
     const DeviceRefPtr& device,
@@ -41,6 +44,7 @@ TrafficMonitor::TrafficMonitor(
     NetworkProblemDetectedCallback network_problem_detected_callback)
     : device_(device),
       dispatcher_(dispatcher),
+      sampling_interval_milliseconds_(kSamplingIntervalMilliseconds),
       network_problem_detected_callback_(
           std::move(network_problem_detected_callback)),
       socket_info_reader_(new SocketInfoReader),
@@ -65,6 +69,7 @@ void TrafficMonitor::Start() {
 void TrafficMonitor::Stop() {
   SLOG(device_.get(), 2) << __func__;
   sample_traffic_callback_.Cancel();
+  sampling_interval_milliseconds_ = kSamplingIntervalMilliseconds;
   ResetCongestedTxQueuesStats();
   ResetDnsFailingStats();
 }
@@ -178,9 +183,10 @@ bool TrafficMonitor::IsDnsFailing() {
     // multiple times once its time-to-expire is less than
     // |kDnsTimedOutThresholdSeconds|.  To ensure that we only count an
     // entry once, we look for entries in this time window between
-    // |kDnsTimedOutThresholdSeconds| and |kDnsTimedOutLowerThresholdSeconds|.
+    // |kDnsTimedOutThresholdSeconds| and |kDnsTimedOutLowerThresholdSeconds|,
+    // which spans the interval since the previous sample.
     const int64_t kDnsTimedOutLowerThresholdSeconds =
-        kDnsTimedOutThresholdSeconds - kSamplingIntervalMilliseconds / 1000;
+        kDnsTimedOutThresholdSeconds - sampling_interval_milliseconds_ / 1000;
     string device_ip_address = device_->ipconfig()->properties().address;
     for (const auto& info : connection_infos) {
       if (info.protocol != IPPROTO_UDP ||
@@ -201,20 +207,40 @@ bool TrafficMonitor::IsDnsFailing() {
   return false;
 }
 
+void TrafficMonitor::UpdateSamplingInterval() {
+  if (!old_tx_queue_lengths_.empty() ||
+      accummulated_dns_failures_samples_ > 0) {
+    sampling_interval_milliseconds_ = kSamplingIntervalMilliseconds;
+    return;
+  }
+  sampling_interval_milliseconds_ = std::min(
+      2 * sampling_interval_milliseconds_, kMaxSamplingIntervalMilliseconds);
+  SLOG(device_.get(), 4) << __func__ << ": Nothing to watch, next sample in "
+                         << sampling_interval_milliseconds_ << " ms";
+}
+
 void TrafficMonitor::SampleTraffic() {
   SLOG(device_.get(), 3) << __func__;
 
-  // Schedule the sample callback first, so it is possible for the network
-  // problem callback to stop the traffic monitor.
-  dispatcher_->PostDelayedTask(FROM_HERE, sample_traffic_callback_.callback(),
-                               kSamplingIntervalMilliseconds);
-
+  NetworkProblem problem = kNetworkProblemMax;
   if (IsCongestedTxQueues() && accummulated_congested_tx_queues_samples_ ==
                                    kMinimumFailedSamplesToTrigger) {
-    LOG(WARNING) << "Congested tx queues detected, out-of-credits?";
-    network_problem_detected_callback_.Run(kNetworkProblemCongestedTxQueue);
+    problem = kNetworkProblemCongestedTxQueue;
   } else if (IsDnsFailing() && accummulated_dns_failures_samples_ ==
                                    kMinimumFailedSamplesToTrigger) {
+    problem = kNetworkProblemDNSFailure;
+  }
+
+  // Schedule the sample callback before running the network problem
+  // callback, so it is possible for the latter to stop the traffic monitor.
+  UpdateSamplingInterval();
+  dispatcher_->PostDelayedTask(FROM_HERE, sample_traffic_callback_.callback(),
+                               sampling_interval_milliseconds_);
+
+  if (problem == kNetworkProblemCongestedTxQueue) {
+    LOG(WARNING) << "Congested tx queues detected, out-of-credits?";
+    network_problem_detected_callback_.Run(kNetworkProblemCongestedTxQueue);
+  } else if (problem == kNetworkProblemDNSFailure) {
     LOG(WARNING) << "DNS queries failing, out-of-credits?";
     network_problem_detected_callback_.Run(kNetworkProblemDNSFailure);
   }
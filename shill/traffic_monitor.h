@@ -58,11 +58,13 @@ class TrafficMonitor {
   FRIEND_TEST(TrafficMonitorTest, BuildIPPortToTxQueueLengthMultipleEntries);
   FRIEND_TEST(TrafficMonitorTest, BuildIPPortToTxQueueLengthValid);
   FRIEND_TEST(TrafficMonitorTest, BuildIPPortToTxQueueLengthZero);
+  FRIEND_TEST(TrafficMonitorTest, SampleTrafficBacksOffWhenIdle);
   FRIEND_TEST(TrafficMonitorTest, SampleTrafficDnsFailureThenSuccess);
   FRIEND_TEST(TrafficMonitorTest, SampleTrafficDnsOutstanding);
   FRIEND_TEST(TrafficMonitorTest, SampleTrafficDnsStatsReset);
   FRIEND_TEST(TrafficMonitorTest, SampleTrafficDnsSuccessful);
   FRIEND_TEST(TrafficMonitorTest, SampleTrafficDnsTimedOut);
+  FRIEND_TEST(TrafficMonitorTest, SampleTrafficDnsTimedOutAfterBackOff);
   FRIEND_TEST(TrafficMonitorTest, SampleTrafficDnsTimedOutInvalidProtocol);
   FRIEND_TEST(TrafficMonitorTest, SampleTrafficDnsTimedOutInvalidSourceIp);
   FRIEND_TEST(TrafficMonitorTest, SampleTrafficDnsTimedOutOutsideTimeWindow);
@@ -83,6 +85,10 @@ class TrafficMonitor {
   static const int kMinimumFailedSamplesToTrigger;
   // The frequency at which to sample the TCP connections.
   static const int64_t kSamplingIntervalMilliseconds;
+  // The sampling interval doubles up to this value while no tx-queue is
+  // being watched and no DNS query failed. It must not exceed the DNS time
+  // out threshold, so that timed out DNS queries are still seen once.
+  static const int64_t kMaxSamplingIntervalMilliseconds;
   // DNS port.
   static const uint16_t kDnsPort;
   // If a DNS "connection" time-to-expire falls below this threshold, then
@@ -110,6 +116,10 @@ class TrafficMonitor {
   // Checks to see for failed DNS queries.
   bool IsDnsFailing();
 
+  // Backs off the sampling interval while there is nothing to watch, and
+  // restores it as soon as there is.
+  void UpdateSamplingInterval();
+
   // Samples traffic (e.g. receive and transmit byte counts) on the
   // selected device and invokes appropriate callbacks when certain
   // abnormal scenarios are detected.
@@ -125,6 +135,9 @@ class TrafficMonitor {
   // of the network interface.
   base::CancelableClosure sample_traffic_callback_;
 
+  // Delay until the next sample.
+  int64_t sampling_interval_milliseconds_;
+
   // Callback to invoke when we detect a network problem. Possible network
   // problems that can be detected are congested TCP TX queue and DNS failure.
   // Refer to enum NetworkProblem for all possible network problems that can be
@@ -579,6 +579,73 @@ TEST_F(TrafficMonitorTest, SampleTrafficNonDnsTimedOut) {
   }
 }
 
+TEST_F(TrafficMonitorTest, SampleTrafficBacksOffWhenIdle) {
+  SetupMockSocketInfos(vector<SocketInfo>());
+  SetupMockConnectionInfos(vector<ConnectionInfo>());
+  EXPECT_CALL(dispatcher_,
+              PostDelayedTask(
+                  _, _, 2 * TrafficMonitor::kSamplingIntervalMilliseconds));
+  monitor_.SampleTraffic();
+  Mock::VerifyAndClearExpectations(&dispatcher_);
+
+  EXPECT_CALL(dispatcher_,
+              PostDelayedTask(
+                  _, _, TrafficMonitor::kMaxSamplingIntervalMilliseconds))
+      .Times(2);
+  monitor_.SampleTraffic();
+  monitor_.SampleTraffic();
+  Mock::VerifyAndClearExpectations(&dispatcher_);
+
+  // A connection with a pending tx-queue is sampled at the base rate.
+  vector<SocketInfo> socket_infos = {
+      SocketInfo(SocketInfo::kConnectionStateEstablished, local_addr_,
+                 TrafficMonitorTest::kLocalPort1, remote_addr_,
+                 TrafficMonitorTest::kRemotePort,
+                 TrafficMonitorTest::kTxQueueLength1, 0,
+                 SocketInfo::kTimerStateRetransmitTimerPending),
+  };
+  SetupMockSocketInfos(socket_infos);
+  EXPECT_CALL(dispatcher_,
+              PostDelayedTask(_, _,
+                              TrafficMonitor::kSamplingIntervalMilliseconds));
+  monitor_.SampleTraffic();
+  Mock::VerifyAndClearExpectations(&dispatcher_);
+
+  SetupMockSocketInfos(vector<SocketInfo>());
+  monitor_.SampleTraffic();
+  monitor_.Stop();
+  EXPECT_EQ(TrafficMonitor::kSamplingIntervalMilliseconds,
+            monitor_.sampling_interval_milliseconds_);
+}
+
+TEST_F(TrafficMonitorTest, SampleTrafficDnsTimedOutAfterBackOff) {
+  SetupMockSocketInfos(vector<SocketInfo>());
+  SetupMockConnectionInfos(vector<ConnectionInfo>());
+  monitor_.SampleTraffic();
+  monitor_.SampleTraffic();
+  ASSERT_EQ(TrafficMonitor::kMaxSamplingIntervalMilliseconds,
+            monitor_.sampling_interval_milliseconds_);
+
+  // The query timed out since the previous sample, although not within the
+  // base sampling interval.
+  vector<ConnectionInfo> connection_infos = {
+      ConnectionInfo(IPPROTO_UDP,
+                     TrafficMonitor::kDnsTimedOutThresholdSeconds -
+                         TrafficMonitor::kSamplingIntervalMilliseconds / 1000 -
+                         1,
+                     true, local_addr_, TrafficMonitorTest::kLocalPort1,
+                     remote_addr_, TrafficMonitor::kDnsPort, remote_addr_,
+                     TrafficMonitor::kDnsPort, local_addr_,
+                     TrafficMonitorTest::kLocalPort1),
+  };
+  SetupMockConnectionInfos(connection_infos);
+  EXPECT_CALL(dispatcher_,
+              PostDelayedTask(_, _,
+                              TrafficMonitor::kSamplingIntervalMilliseconds));
+  monitor_.SampleTraffic();
+  EXPECT_EQ(1, monitor_.accummulated_dns_failures_samples_);
+}
+
 TEST_F(TrafficMonitorTest, SampleTrafficDnsStatsReset) {
   vector<ConnectionInfo> connection_infos;
   SetupMockConnectionInfos(connection_infos);
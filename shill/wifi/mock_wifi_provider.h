@@ -51,6 +51,8 @@ class MockWiFiProvider : public WiFiProvider {
               OnEndpointUpdated,
               (const WiFiEndpointConstRefPtr&),
               (override));
+  MOCK_METHOD(void, BeginEndpointUpdates, (), (override));
+  MOCK_METHOD(void, EndEndpointUpdates, (), (override));
   MOCK_METHOD(bool, OnServiceUnloaded, (const WiFiServiceRefPtr&), (override));
   MOCK_METHOD(ByteArrays, GetHiddenSSIDList, (), (override));
   MOCK_METHOD(void, LoadAndFixupServiceEntries, (Profile*), (override));
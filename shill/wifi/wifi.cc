@@ -16,6 +16,7 @@
 #include <memory>
 #include <set>
 #include <string>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
@@ -1235,13 +1236,33 @@ void WiFi::PendingScanResultsHandler() {
   SLOG(this, 2) << __func__ << " with " << pending_scan_results_->results.size()
                 << " results and is_complete set to "
                 << pending_scan_results_->is_complete;
-  for (const auto result : pending_scan_results_->results) {
-    if (result.is_removal) {
-      BSSRemovedTask(result.path);
+  const vector<ScanResult>& results = pending_scan_results_->results;
+
+  // A BSS which is added and then removed before the results are processed
+  // is skipped. Find these additions from the last result back.
+  vector<bool> skip_result(results.size(), false);
+  std::unordered_set<RpcIdentifier> removed_later;
+  for (size_t i = results.size(); i-- > 0;) {
+    if (results[i].is_removal) {
+      removed_later.insert(results[i].path);
     } else {
-      BSSAddedTask(result.path, result.properties);
+      skip_result[i] = removed_later.erase(results[i].path) > 0;
     }
   }
+
+  provider_->BeginEndpointUpdates();
+  for (size_t i = 0; i < results.size(); ++i) {
+    if (skip_result[i]) {
+      continue;
+    }
+    if (results[i].is_removal) {
+      BSSRemovedTask(results[i].path);
+    } else {
+      BSSAddedTask(results[i].path, results[i].properties);
+    }
+  }
+  provider_->EndEndpointUpdates();
+
   if (pending_scan_results_->is_complete) {
     ScanDoneTask();
   }
@@ -20,7 +20,9 @@
 // WPA Supplicant, which identifies them by a "path".  The WiFi object maintains
 // an EndpointMap in |endpoint_by_rpcid_|, in which the key is the "path" and
 // the value is a pointer to a WiFiEndpoint object.  When a WiFiEndpoint is
-// added, it is associated with a WiFiService.
+// added, it is associated with a WiFiService.  BSSAdded and BSSRemoved signals
+// are queued and applied together, so that the services of a scan are updated
+// once.
 //
 // The WiFi device connects to a WiFiService, not a WiFiEndpoint, through WPA
 // Supplicant. It is the job of WPA Supplicant to select a BSS (aka
@@ -79,6 +81,7 @@
 #include <memory>
 #include <set>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include <base/callback_forward.h>
@@ -316,7 +319,7 @@ class WiFi : public Device, public SupplicantEventDelegateInterface {
   // kMaxPassiveScanRetries, kMaxFreqsForPassiveScanRetries
   FRIEND_TEST(WiFiMainTest, InitiateScanInDarkResume_Idle);
 
-  using EndpointMap = std::map<const RpcIdentifier, WiFiEndpointRefPtr>;
+  using EndpointMap = std::unordered_map<RpcIdentifier, WiFiEndpointRefPtr>;
   using ReverseServiceMap = std::map<const WiFiService*, RpcIdentifier>;
 
   static const char* const kDefaultBgscanMethod;
@@ -272,6 +272,7 @@ const time_t WiFiProvider::kWeeksToKeepFrequencyCounts = 3;
 WiFiProvider::WiFiProvider(Manager* manager)
     : manager_(manager),
       running_(false),
+      updating_endpoints_(false),
       total_frequency_connections_(-1L),
       time_(Time::GetInstance()),
       disable_vht_(false) {}
@@ -453,7 +454,7 @@ void WiFiProvider::OnEndpointAdded(const WiFiEndpointConstRefPtr& endpoint) {
   SLOG(this, 1) << "Assigned endpoint " << endpoint->bssid_string()
                 << " to service " << service->unique_name() << ".";
 
-  manager_->UpdateService(service);
+  UpdateServiceForEndpoints(service);
 }
 
 WiFiServiceRefPtr WiFiProvider::OnEndpointRemoved(
@@ -474,7 +475,7 @@ WiFiServiceRefPtr WiFiProvider::OnEndpointRemoved(
   if (service->HasEndpoints() || service->IsRemembered()) {
     // Keep services around if they are in a profile or have remaining
     // endpoints.
-    manager_->UpdateService(service);
+    UpdateServiceForEndpoints(service);
     return nullptr;
   }
 
@@ -508,6 +509,19 @@ void WiFiProvider::OnEndpointUpdated(const WiFiEndpointConstRefPtr& endpoint) {
   OnEndpointAdded(endpoint);
 }
 
+void WiFiProvider::BeginEndpointUpdates() {
+  updating_endpoints_ = true;
+}
+
+void WiFiProvider::EndEndpointUpdates() {
+  updating_endpoints_ = false;
+  std::set<WiFiServiceRefPtr> services;
+  services.swap(services_with_updated_endpoints_);
+  for (const auto& service : services) {
+    manager_->UpdateService(service);
+  }
+}
+
 bool WiFiProvider::OnServiceUnloaded(const WiFiServiceRefPtr& service) {
   // If the service still has endpoints, it should remain in the service list.
   if (service->HasEndpoints()) {
@@ -640,9 +654,18 @@ void WiFiProvider::ForgetService(const WiFiServiceRefPtr& service) {
     return;
   }
   (*it)->ResetWiFi();
+  services_with_updated_endpoints_.erase(*it);
   services_.erase(it);
 }
 
+void WiFiProvider::UpdateServiceForEndpoints(const WiFiServiceRefPtr& service) {
+  if (updating_endpoints_) {
+    services_with_updated_endpoints_.insert(service);
+    return;
+  }
+  manager_->UpdateService(service);
+}
+
 void WiFiProvider::ReportRememberedNetworkCount() {
   metrics()->SendToUMA(
       Metrics::kMetricRememberedWiFiNetworkCount,
@@ -9,7 +9,9 @@
 
 #include <deque>
 #include <map>
+#include <set>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include <gtest/gtest_prod.h>  // for FRIEND_TEST
@@ -90,6 +92,15 @@ class WiFiProvider : public ProviderInterface {
   // the endpoint.
   virtual void OnEndpointUpdated(const WiFiEndpointConstRefPtr& endpoint);
 
+  // Called by a Device before it adds or removes the Endpoints of a scan.
+  // Until EndEndpointUpdates() is called, the Manager is not notified of
+  // the Services whose Endpoints change.
+  virtual void BeginEndpointUpdates();
+
+  // Called by a Device once it is done adding or removing Endpoints.
+  // Notifies the Manager once of each Service whose Endpoints changed.
+  virtual void EndEndpointUpdates();
+
   // Called by a WiFiService when it is unloaded and no longer visible.
   virtual bool OnServiceUnloaded(const WiFiServiceRefPtr& service);
 
@@ -137,7 +148,8 @@ class WiFiProvider : public ProviderInterface {
   FRIEND_TEST(WiFiProviderTest, StringListToFrequencyMap);
   FRIEND_TEST(WiFiProviderTest, StringListToFrequencyMapEmpty);
 
-  using EndpointServiceMap = std::map<const WiFiEndpoint*, WiFiServiceRefPtr>;
+  using EndpointServiceMap =
+      std::unordered_map<const WiFiEndpoint*, WiFiServiceRefPtr>;
 
   static const char kStorageId[];
   static const time_t kWeeksToKeepFrequencyCounts;
@@ -161,6 +173,10 @@ class WiFiProvider : public ProviderInterface {
   // services_ vector.
   void ForgetService(const WiFiServiceRefPtr& service);
 
+  // Notifies the Manager that the Endpoints of |service| changed, or defers
+  // it until EndEndpointUpdates().
+  void UpdateServiceForEndpoints(const WiFiServiceRefPtr& service);
+
   void ReportRememberedNetworkCount();
   void ReportServiceSourceMetrics();
 
@@ -190,6 +206,12 @@ class WiFiProvider : public ProviderInterface {
 
   bool running_;
 
+  // Whether Endpoints are being added or removed between calls to
+  // BeginEndpointUpdates() and EndEndpointUpdates(), and the Services whose
+  // Endpoints changed meanwhile.
+  bool updating_endpoints_;
+  std::set<WiFiServiceRefPtr> services_with_updated_endpoints_;
+
   // Map of frequencies at which we've connected and the number of times a
   // successful connection has been made at that frequency.  Absent frequencies
   // have not had a successful connection.
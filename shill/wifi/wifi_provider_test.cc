@@ -1195,6 +1195,131 @@ TEST_F(WiFiProviderTest, OnEndpointAdded) {
   EXPECT_TRUE(service1 != service0);
 }
 
+TEST_F(WiFiProviderTest, EndpointUpdatesNotifyManagerOnce) {
+  provider_.Start();
+  const string ssid0("an_ssid");
+  const vector<uint8_t> ssid0_bytes(ssid0.begin(), ssid0.end());
+  const string ssid1("another_ssid");
+  const vector<uint8_t> ssid1_bytes(ssid1.begin(), ssid1.end());
+  WiFiEndpointRefPtr endpoint0 = MakeEndpoint(ssid0, "00:00:00:00:00:00", 0, 0);
+  WiFiEndpointRefPtr endpoint1 = MakeEndpoint(ssid0, "00:00:00:00:00:01", 0, 0);
+  WiFiEndpointRefPtr endpoint2 = MakeEndpoint(ssid1, "00:00:00:00:00:02", 0, 0);
+
+  provider_.BeginEndpointUpdates();
+  EXPECT_CALL(manager_, RegisterService(_)).Times(2);
+  EXPECT_CALL(manager_, UpdateService(_)).Times(0);
+  EXPECT_CALL(manager_, DeregisterService(_)).Times(1);
+  provider_.OnEndpointAdded(endpoint0);
+  provider_.OnEndpointAdded(endpoint1);
+  provider_.OnEndpointAdded(endpoint2);
+  provider_.OnEndpointRemoved(endpoint2);
+  Mock::VerifyAndClearExpectations(&manager_);
+
+  // The Manager is only notified of the Service which is still registered.
+  WiFiServiceRefPtr service0(
+      FindService(ssid0_bytes, kModeManaged, kSecurityNone));
+  ASSERT_NE(nullptr, service0);
+  EXPECT_FALSE(FindService(ssid1_bytes, kModeManaged, kSecurityNone));
+  EXPECT_CALL(manager_, UpdateService(RefPtrMatch(service0))).Times(1);
+  provider_.EndEndpointUpdates();
+  Mock::VerifyAndClearExpectations(&manager_);
+
+  // Once done, each change is notified again.
+  EXPECT_CALL(manager_, UpdateService(RefPtrMatch(service0))).Times(1);
+  provider_.OnEndpointRemoved(endpoint1);
+}
+
+TEST_F(WiFiProviderTest, EndpointChurnUpdatesEachServiceOncePerScan) {
+  // Replays BSS churn modeled on consecutive scans in a dense deployment:
+  // several BSSes per SSID, of which each scan loses and finds a fraction.
+  // Applied as a single update, each scan must notify the Manager once per
+  // Service that it touched and that is still around, instead of once per
+  // BSS change.
+  constexpr size_t kNumBsses = 60;
+  constexpr size_t kBssesPerSsid = 6;
+  constexpr size_t kNumScans = 10;
+  vector<WiFiEndpointRefPtr> endpoints;
+  for (size_t i = 0; i < kNumBsses; ++i) {
+    endpoints.push_back(MakeEndpoint(
+        StringPrintf("ssid%" PRIuS, i / kBssesPerSsid),
+        StringPrintf("00:00:00:00:00:%02x", static_cast<unsigned>(i)), 2412,
+        -50));
+  }
+  // Each scan toggles the BSSes picked by a fixed pseudo-random sequence, so
+  // that every replay sees the same churn.
+  vector<vector<size_t>> scans(kNumScans);
+  uint32_t seed = 1;
+  for (auto& scan : scans) {
+    for (size_t i = 0; i < kNumBsses / 10; ++i) {
+      seed = seed * 1103515245 + 12345;
+      scan.push_back((seed >> 8) % kNumBsses);
+    }
+  }
+
+  auto replay = [&](bool batched, int* updates, int* expected_updates) {
+    EXPECT_CALL(manager_, RegisterService(_)).Times(AnyNumber());
+    EXPECT_CALL(manager_, DeregisterService(_)).Times(AnyNumber());
+    EXPECT_CALL(manager_, UpdateService(_))
+        .WillRepeatedly(Invoke([updates](const ServiceRefPtr&) {
+          ++*updates;
+        }));
+    provider_.Start();
+    set<size_t> present;
+    // The first scan finds all the BSSes.
+    provider_.BeginEndpointUpdates();
+    for (size_t i = 0; i < kNumBsses; ++i) {
+      provider_.OnEndpointAdded(endpoints[i]);
+      present.insert(i);
+    }
+    provider_.EndEndpointUpdates();
+    *updates = 0;
+    *expected_updates = 0;
+
+    for (const auto& scan : scans) {
+      if (batched) {
+        provider_.BeginEndpointUpdates();
+      }
+      set<size_t> touched_ssids;
+      for (size_t index : scan) {
+        if (base::ContainsKey(present, index)) {
+          provider_.OnEndpointRemoved(endpoints[index]);
+          present.erase(index);
+        } else {
+          provider_.OnEndpointAdded(endpoints[index]);
+          present.insert(index);
+        }
+        touched_ssids.insert(index / kBssesPerSsid);
+      }
+      if (batched) {
+        provider_.EndEndpointUpdates();
+      }
+      for (size_t ssid : touched_ssids) {
+        for (size_t i = 0; i < kBssesPerSsid; ++i) {
+          if (base::ContainsKey(present, ssid * kBssesPerSsid + i)) {
+            ++*expected_updates;
+            break;
+          }
+        }
+      }
+    }
+
+    for (size_t index : present) {
+      EXPECT_NE(nullptr, provider_.FindServiceForEndpoint(endpoints[index]));
+      provider_.OnEndpointRemoved(endpoints[index]);
+    }
+    provider_.Stop();
+    Mock::VerifyAndClearExpectations(&manager_);
+  };
+
+  int unbatched_updates = 0;
+  int expected_updates = 0;
+  replay(false, &unbatched_updates, &expected_updates);
+  int batched_updates = 0;
+  replay(true, &batched_updates, &expected_updates);
+  EXPECT_EQ(expected_updates, batched_updates);
+  EXPECT_LT(batched_updates, unbatched_updates);
+}
+
 TEST_F(WiFiProviderTest, OnEndpointAddedWithSecurity) {
   provider_.Start();
   const string ssid0("an_ssid");
@@ -82,6 +82,7 @@ using ::testing::_;
 using ::testing::AnyNumber;
 using ::testing::AtLeast;
 using ::testing::ByMove;
+using ::testing::Contains;
 using ::testing::ContainsRegex;
 using ::testing::DoAll;
 using ::testing::EndsWith;
@@ -3492,7 +3493,7 @@ TEST_F(WiFiMainTest, GetGeolocationObjects) {
         StringPrintf("%d", bsses[i].signal_strength);
     expected_info[kGeoChannelProperty] =
         StringPrintf("%d", Metrics::WiFiFrequencyToChannel(bsses[i].frequency));
-    EXPECT_EQ(expected_info, objects[i]);
+    EXPECT_THAT(objects, Contains(expected_info));
   }
 }
 
@@ -4070,13 +4071,15 @@ TEST_F(WiFiMainTest, PendingScanEvents) {
   WiFiEndpointRefPtr ap1 = MakeEndpoint("ssid1", "00:00:00:00:00:01");
   WiFiEndpointRefPtr ap2 = MakeEndpoint("ssid2", "00:00:00:00:00:02");
 
+  // The events are applied as a single update, in which bss0, which is
+  // added and removed, does not appear.
   InSequence seq;
-  EXPECT_CALL(*wifi_provider(), OnEndpointAdded(EndpointMatch(ap0)));
+  EXPECT_CALL(*wifi_provider(), BeginEndpointUpdates());
+  EXPECT_CALL(*wifi_provider(), OnEndpointAdded(EndpointMatch(ap0))).Times(0);
   EXPECT_CALL(*wifi_provider(), OnEndpointAdded(EndpointMatch(ap1)));
-  WiFiServiceRefPtr null_service;
-  EXPECT_CALL(*wifi_provider(), OnEndpointRemoved(EndpointMatch(ap0)))
-      .WillOnce(Return(null_service));
+  EXPECT_CALL(*wifi_provider(), OnEndpointRemoved(_)).Times(0);
   EXPECT_CALL(*wifi_provider(), OnEndpointAdded(EndpointMatch(ap2)));
+  EXPECT_CALL(*wifi_provider(), EndEndpointUpdates());
   event_dispatcher_->DispatchPendingEvents();
   Mock::VerifyAndClearExpectations(wifi_provider());
 
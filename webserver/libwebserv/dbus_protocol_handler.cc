@@ -4,12 +4,21 @@
 
 #include "libwebserv/dbus_protocol_handler.h"
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
 #include <tuple>
 #include <utility>
+#include <vector>
 
+#include <base/files/file_util.h>
+#include <base/files/scoped_file.h>
 #include <base/logging.h>
+#include <brillo/http/http_request.h>
 #include <brillo/map_utils.h>
 #include <brillo/streams/file_stream.h>
+#include <brillo/streams/memory_stream.h>
 #include <brillo/streams/stream_utils.h>
 
 #include "dbus_bindings/org.chromium.WebServer.RequestHandler.h"
@@ -24,9 +33,33 @@ namespace libwebserv {
 
 namespace {
 
+// Responses up to this size are handed over to the web server at once in a
+// memory file instead of being streamed through a pipe.
+const int64_t kMaxSharedResponseSize = 64 * 1024;
+
 // Dummy callback for async D-Bus errors.
 void IgnoreDBusError(brillo::Error* /* error */) {}
 
+// Writes |data| to a memory file, sealed as CompleteRequestWithData()
+// requires. Returns an invalid file descriptor on error.
+base::ScopedFD WriteResponseDataToMemoryFile(const std::vector<char>& data) {
+  base::ScopedFD fd{memfd_create("libwebserv-response",
+                                 MFD_CLOEXEC | MFD_ALLOW_SEALING)};
+  if (!fd.is_valid()) {
+    PLOG(ERROR) << "Failed to create a memory file for response data";
+    return fd;
+  }
+  if (!base::WriteFileDescriptor(fd.get(), data.data(),
+                                 static_cast<int>(data.size())) ||
+      lseek(fd.get(), 0, SEEK_SET) != 0 ||
+      fcntl(fd.get(), F_ADD_SEALS,
+            F_SEAL_WRITE | F_SEAL_GROW | F_SEAL_SHRINK | F_SEAL_SEAL) != 0) {
+    PLOG(ERROR) << "Failed to write response data to a memory file";
+    return base::ScopedFD{};
+  }
+  return fd;
+}
+
 // Copies the data from |src_stream| to the destination stream represented
 // by a file descriptor |fd|.
 void WriteResponseData(brillo::StreamPtr src_stream,
@@ -237,6 +270,28 @@ void DBusProtocolHandler::CompleteRequest(
   int64_t data_size = -1;
   if (data_stream->CanGetSize())
     data_size = data_stream->GetRemainingSize();
+  if (data_size >= 0 && data_size <= kMaxSharedResponseSize) {
+    std::vector<char> data(data_size);
+    if (!data_stream->ReadAllBlocking(data.data(), data.size(), nullptr)) {
+      // Part of the data may be gone from the stream, so the response can't
+      // be sent anymore.
+      LOG(ERROR) << "Failed to read response data";
+      status_code = brillo::http::status_code::InternalServerError;
+      header_list.clear();
+      data.clear();
+    }
+    base::ScopedFD data_file = WriteResponseDataToMemoryFile(data);
+    if (data_file.is_valid()) {
+      proxy->CompleteRequestWithDataAsync(
+          request_id, status_code, header_list, data_file.get(),
+          // TODO(crbug.com/909719): replace with base::DoNothing;
+          base::Bind([]() {}), base::Bind(&IgnoreDBusError));
+      return;
+    }
+    // Send what was read through the pipe instead.
+    data_size = data.size();
+    data_stream = brillo::MemoryStream::OpenCopyOf(std::move(data), nullptr);
+  }
   proxy->CompleteRequestAsync(
       request_id, status_code, header_list, data_size,
       base::Bind(&WriteResponseData, base::Passed(&data_stream)),
@@ -2,12 +2,27 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
 #include <base/bind.h>
 #include <base/macros.h>
+#include <base/memory/weak_ptr.h>
+#include <base/strings/string_number_conversions.h>
+#include <base/threading/thread_task_runner_handle.h>
+#include <base/time/time.h>
+#include <brillo/flag_helper.h>
+#include <brillo/http/curl_api.h>
+#include <brillo/http/http_transport_curl.h>
+#include <brillo/http/http_utils.h>
 #include <brillo/mime_utils.h>
+#include <brillo/streams/memory_stream.h>
 #include <brillo/syslog_logging.h>
 #include <libwebserv/protocol_handler.h>
 #include <libwebserv/request_handler_interface.h>
+#include <libwebserv/request_utils.h>
 #include <libwebserv/server.h>
 #include <sysexits.h>
 
@@ -50,9 +65,145 @@ const char PingRequestHandler::kMethods[] = "";  // all methods
 const char PingRequestHandler::kResponse[] = "Still alive, still alive!\n";
 const char PingRequestHandler::kUrl[] = "/webservd-test-client/ping";
 
+// Replies with the body of the request.
+class EchoRequestHandler : public RequestHandlerInterface {
+ public:
+  static const char kMethods[];
+  static const char kUrl[];
+
+  ~EchoRequestHandler() override = default;
+  void HandleRequest(std::unique_ptr<Request> request,
+                     std::unique_ptr<Response> response) override {
+    libwebserv::GetRequestData(std::move(request), std::move(response),
+                               base::Bind(&EchoRequestHandler::OnData),
+                               base::Bind(&EchoRequestHandler::OnError));
+  }
+
+ private:
+  static void OnData(std::unique_ptr<Request> /* request */,
+                     std::unique_ptr<Response> response,
+                     std::vector<uint8_t> data) {
+    response->Reply(200, brillo::MemoryStream::OpenCopyOf(data, nullptr),
+                    brillo::mime::application::kOctet_stream);
+  }
+
+  static void OnError(std::unique_ptr<Request> /* request */,
+                      std::unique_ptr<Response> response,
+                      const brillo::Error* error) {
+    response->ReplyWithError(500, error->GetMessage());
+  }
+};  // class EchoRequestHandler
+
+const char EchoRequestHandler::kMethods[] = "POST";
+const char EchoRequestHandler::kUrl[] = "/webservd-test-client/echo";
+
+// The echo handler is registered with the web server asynchronously, so it
+// may take a few tries before the first request of the benchmark reaches it.
+const int kMaxWarmUpTries = 50;
+const int kWarmUpRetryDelayMs = 100;
+
+// Measures how many requests per second the web server relays to the echo
+// handler. The requests are sent one after the other over a kept-alive
+// connection, so that the time is spent in the web server and the handler
+// rather than in connecting. Compare body sizes below and above the size
+// handed over in memory files (64 KiB) to see the cost of the pipes.
+class Benchmark {
+ public:
+  Benchmark(int requests,
+            int body_size,
+            const base::Callback<void(bool)>& done_callback)
+      : requests_{requests},
+        body_(body_size, 'x'),
+        done_callback_{done_callback} {}
+
+  void Start(uint16_t port) {
+    url_ = "http://localhost:" + base::UintToString(port) +
+           EchoRequestHandler::kUrl;
+    transport_ = std::make_shared<brillo::http::curl::Transport>(
+        std::make_shared<brillo::http::curl::CurlApi>());
+    brillo::ErrorPtr error;
+    if (!transport_->EnableConnectionPooling(
+            brillo::http::curl::Transport::PoolOptions{}, &error)) {
+      LOG(WARNING) << "Not reusing connections: " << error->GetMessage();
+    }
+    SendRequest();
+  }
+
+ private:
+  void SendRequest() {
+    brillo::http::SendRequest(
+        brillo::http::request_type::kPost, url_, body_.data(), body_.size(),
+        brillo::mime::application::kOctet_stream, {}, transport_,
+        base::Bind(&Benchmark::OnResponse, weak_ptr_factory_.GetWeakPtr()),
+        base::Bind(&Benchmark::OnError, weak_ptr_factory_.GetWeakPtr()));
+  }
+
+  void OnResponse(brillo::http::RequestID /* request_id */,
+                  std::unique_ptr<brillo::http::Response> response) {
+    const bool echoed = response->GetStatusCode() == 200 &&
+                        response->ExtractDataAsString() == body_;
+    if (start_time_.is_null()) {
+      // Still warming up. The timing starts once the handler is reached.
+      if (echoed) {
+        start_time_ = base::TimeTicks::Now();
+        SendRequest();
+        return;
+      }
+      if (++warm_up_tries_ < kMaxWarmUpTries) {
+        base::ThreadTaskRunnerHandle::Get()->PostDelayedTask(
+            FROM_HERE,
+            base::Bind(&Benchmark::SendRequest,
+                       weak_ptr_factory_.GetWeakPtr()),
+            base::TimeDelta::FromMilliseconds(kWarmUpRetryDelayMs));
+        return;
+      }
+    }
+    if (!echoed) {
+      LOG(ERROR) << "Unexpected response with status "
+                 << response->GetStatusCode();
+      done_callback_.Run(false);
+      return;
+    }
+    if (++completed_ < requests_) {
+      SendRequest();
+      return;
+    }
+
+    const base::TimeDelta elapsed = base::TimeTicks::Now() - start_time_;
+    LOG(INFO) << completed_ << " requests with " << body_.size()
+              << " byte bodies in " << elapsed.InMillisecondsF() << " ms: "
+              << completed_ / elapsed.InSecondsF() << " requests/s, "
+              << transport_->pool_stats().ReuseRate() * 100
+              << "% on reused connections";
+    done_callback_.Run(true);
+  }
+
+  void OnError(brillo::http::RequestID /* request_id */,
+               const brillo::Error* error) {
+    LOG(ERROR) << "Request failed: " << error->GetMessage();
+    done_callback_.Run(false);
+  }
+
+  const int requests_;
+  const std::string body_;
+  base::Callback<void(bool)> done_callback_;
+  std::string url_;
+  std::shared_ptr<brillo::http::curl::Transport> transport_;
+  int warm_up_tries_{0};
+  int completed_{0};
+  // Time at which the first request reached the handler. That request is
+  // not counted.
+  base::TimeTicks start_time_;
+
+  base::WeakPtrFactory<Benchmark> weak_ptr_factory_{this};
+  DISALLOW_COPY_AND_ASSIGN(Benchmark);
+};  // class Benchmark
+
 class WebservTestClient : public WebservTestClientBaseClass {
  public:
-  WebservTestClient() = default;
+  WebservTestClient(int benchmark_requests, int benchmark_body_size)
+      : benchmark_requests_{benchmark_requests},
+        benchmark_body_size_{benchmark_body_size} {}
   ~WebservTestClient() override = default;
 
  protected:
@@ -74,20 +225,56 @@ class WebservTestClient : public WebservTestClientBaseClass {
         PingRequestHandler::kUrl,
         PingRequestHandler::kMethods,
         std::unique_ptr<RequestHandlerInterface>(new PingRequestHandler()));
+    http_handler->AddHandler(
+        EchoRequestHandler::kUrl,
+        EchoRequestHandler::kMethods,
+        std::unique_ptr<RequestHandlerInterface>(new EchoRequestHandler()));
+
+    if (benchmark_requests_ > 0) {
+      benchmark_.reset(new Benchmark{
+          benchmark_requests_, benchmark_body_size_,
+          base::Bind(&WebservTestClient::OnBenchmarkDone,
+                     base::Unretained(this))});
+      webserver_->OnProtocolHandlerConnected(
+          base::Bind(&WebservTestClient::OnProtocolHandlerConnected,
+                     base::Unretained(this)));
+    }
 
     return exit_code;
   }
 
  private:
+  void OnProtocolHandlerConnected(ProtocolHandler* handler) {
+    if (handler != webserver_->GetDefaultHttpHandler() || benchmark_started_)
+      return;
+    benchmark_started_ = true;
+    benchmark_->Start(*handler->GetPorts().begin());
+  }
+
+  void OnBenchmarkDone(bool success) {
+    QuitWithExitCode(success ? EX_OK : EX_SOFTWARE);
+  }
+
+  const int benchmark_requests_;
+  const int benchmark_body_size_;
   std::unique_ptr<Server> webserver_;
+  std::unique_ptr<Benchmark> benchmark_;
+  bool benchmark_started_{false};
 
   DISALLOW_COPY_AND_ASSIGN(WebservTestClient);
 };  // class WebservTestClient
 
 }  // namespace
 
-int main(int /* argc */, char* /* argv */[]) {
+int main(int argc, char* argv[]) {
+  DEFINE_int32(benchmark_requests, 0,
+               "Number of requests to send to the echo handler to measure the "
+               "request rate of the web server. The client exits once done.");
+  DEFINE_int32(benchmark_body_size, 1024,
+               "Size in bytes of the request bodies sent by the benchmark.");
+  brillo::FlagHelper::Init(argc, argv, "Web server test client");
   brillo::InitLog(brillo::kLogToSyslog | brillo::kLogHeader);
-  WebservTestClient client;
+  WebservTestClient client{FLAGS_benchmark_requests,
+                           FLAGS_benchmark_body_size};
   return client.Run();
 }
@@ -14,6 +14,7 @@
 #include "webservd/protocol_handler.h"
 #include "webservd/request.h"
 #include "webservd/server.h"
+#include "webservd/utils.h"
 
 using brillo::dbus_utils::AsyncEventSequencer;
 using brillo::dbus_utils::DBusObject;
@@ -188,6 +189,35 @@ bool DBusProtocolHandler::CompleteRequest(
   return false;
 }
 
+bool DBusProtocolHandler::CompleteRequestWithData(
+    brillo::ErrorPtr* error,
+    const std::string& in_request_id,
+    int32_t in_status_code,
+    const std::vector<std::tuple<std::string, std::string>>& in_headers,
+    const base::ScopedFD& in_data) {
+  // The data is sent lazily, so it must not change in the meantime.
+  int64_t data_size = GetSealedMemoryFileSize(in_data.get());
+  if (data_size < 0) {
+    brillo::Error::AddTo(error, FROM_HERE, brillo::errors::dbus::kDomain,
+                         DBUS_ERROR_INVALID_ARGS,
+                         "Response data is not a sealed memory file");
+    return false;
+  }
+
+  auto request = GetRequest(in_request_id, error);
+  if (!request)
+    return false;
+
+  base::ScopedFD data_file{dup(in_data.get())};
+  if (request->Complete(in_status_code, in_headers, std::move(data_file),
+                        data_size)) {
+    return true;
+  }
+  brillo::Error::AddTo(error, FROM_HERE, brillo::errors::dbus::kDomain,
+                       DBUS_ERROR_FAILED, "Response already received");
+  return false;
+}
+
 Request* DBusProtocolHandler::GetRequest(const std::string& request_id,
                                          brillo::ErrorPtr* error) {
   Request* request = protocol_handler_->GetRequest(request_id);
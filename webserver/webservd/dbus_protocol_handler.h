@@ -12,6 +12,7 @@
 #include <tuple>
 #include <vector>
 
+#include <base/files/scoped_file.h>
 #include <base/macros.h>
 #include <base/memory/weak_ptr.h>
 #include <brillo/dbus/dbus_object.h>
@@ -75,6 +76,13 @@ class DBusProtocolHandler final
       int64_t in_data_size,
       brillo::dbus_utils::FileDescriptor* out_response_stream) override;
 
+  bool CompleteRequestWithData(
+      brillo::ErrorPtr* error,
+      const std::string& in_request_id,
+      int32_t in_status_code,
+      const std::vector<std::tuple<std::string, std::string>>& in_headers,
+      const base::ScopedFD& in_data) override;
+
  private:
   using RequestHandlerProxy = org::chromium::WebServer::RequestHandlerProxy;
 
@@ -0,0 +1,96 @@
+// Copyright 2020 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "webservd/dbus_protocol_handler.h"
+
+#include <unistd.h>
+
+#include <string>
+
+#include <base/files/file_util.h>
+#include <base/files/scoped_file.h>
+#include <brillo/dbus/exported_object_manager.h>
+#include <brillo/errors/error_codes.h>
+#include <dbus/dbus-protocol.h>
+#include <dbus/mock_bus.h>
+#include <dbus/object_path.h>
+#include <gtest/gtest.h>
+
+#include "webservd/protocol_handler.h"
+#include "webservd/utils.h"
+
+namespace webservd {
+
+namespace {
+
+const char kResponseData[] = "response data";
+
+// Returns a memory file holding |kResponseData|, sealed if |seal| is true.
+base::ScopedFD CreateResponseDataFile(bool seal) {
+  base::ScopedFD fd = CreateMemoryFile("test");
+  if (!fd.is_valid() ||
+      !base::WriteFileDescriptor(fd.get(), kResponseData,
+                                 sizeof(kResponseData) - 1) ||
+      (seal && !SealMemoryFile(fd.get()))) {
+    return base::ScopedFD{};
+  }
+  return fd;
+}
+
+}  // namespace
+
+class DBusProtocolHandlerTest : public testing::Test {
+ protected:
+  DBusProtocolHandlerTest()
+      : bus_{new dbus::MockBus{dbus::Bus::Options{}}},
+        object_manager_{bus_, dbus::ObjectPath{"/org/chromium/WebServer"}},
+        protocol_handler_{"http", nullptr},
+        dbus_protocol_handler_{
+            &object_manager_,
+            dbus::ObjectPath{"/org/chromium/WebServer/ProtocolHandlers/1"},
+            &protocol_handler_, nullptr} {}
+
+  // Completes a request that does not exist with |data| as response.
+  brillo::ErrorPtr CompleteRequestWithData(const base::ScopedFD& data) {
+    brillo::ErrorPtr error;
+    EXPECT_FALSE(dbus_protocol_handler_.CompleteRequestWithData(
+        &error, "unknown-request", 200, {}, data));
+    return error;
+  }
+
+  scoped_refptr<dbus::MockBus> bus_;
+  brillo::dbus_utils::ExportedObjectManager object_manager_;
+  ProtocolHandler protocol_handler_;
+  DBusProtocolHandler dbus_protocol_handler_;
+};
+
+TEST_F(DBusProtocolHandlerTest, CompleteRequestWithUnsealedData) {
+  base::ScopedFD data = CreateResponseDataFile(false);
+  ASSERT_TRUE(data.is_valid());
+  brillo::ErrorPtr error = CompleteRequestWithData(data);
+  ASSERT_NE(nullptr, error);
+  EXPECT_EQ(brillo::errors::dbus::kDomain, error->GetDomain());
+  EXPECT_EQ(DBUS_ERROR_INVALID_ARGS, error->GetCode());
+}
+
+TEST_F(DBusProtocolHandlerTest, CompleteRequestWithPipe) {
+  int pipe_fds[2];
+  ASSERT_EQ(0, pipe(pipe_fds));
+  base::ScopedFD read_fd{pipe_fds[0]};
+  base::ScopedFD write_fd{pipe_fds[1]};
+  brillo::ErrorPtr error = CompleteRequestWithData(read_fd);
+  ASSERT_NE(nullptr, error);
+  EXPECT_EQ(DBUS_ERROR_INVALID_ARGS, error->GetCode());
+}
+
+TEST_F(DBusProtocolHandlerTest, CompleteUnknownRequestWithSealedData) {
+  // Sealed data is accepted, and then the request is looked up.
+  base::ScopedFD data = CreateResponseDataFile(true);
+  ASSERT_TRUE(data.is_valid());
+  brillo::ErrorPtr error = CompleteRequestWithData(data);
+  ASSERT_NE(nullptr, error);
+  EXPECT_EQ(DBUS_ERROR_FAILED, error->GetCode());
+}
+
+}  // namespace webservd
@@ -8,9 +8,13 @@
 #include <microhttpd.h>
 #include <netinet/in.h>
 
+#include <utility>
+
 #include <base/bind.h>
 #include <base/files/file.h>
+#include <base/files/file_util.h>
 #include <base/guid.h>
+#include <base/strings/string_number_conversions.h>
 #include <brillo/http/http_request.h>
 #include <brillo/http/http_utils.h>
 #include <brillo/mime_utils.h>
@@ -21,9 +25,36 @@
 #include "webservd/request_handler_interface.h"
 #include "webservd/server_interface.h"
 #include "webservd/temp_file_manager.h"
+#include "webservd/utils.h"
 
 namespace webservd {
 
+namespace {
+
+// Request bodies up to this size are buffered and handed over to the request
+// handler at once instead of being streamed.
+const int64_t kMaxBufferedBodySize = 64 * 1024;
+
+// Returns the size of the request body announced by the request headers, or
+// -1 if it is not known in advance.
+int64_t GetRequestBodySize(MHD_Connection* connection) {
+  if (MHD_lookup_connection_value(connection, MHD_HEADER_KIND,
+                                  MHD_HTTP_HEADER_TRANSFER_ENCODING)) {
+    return -1;
+  }
+  const char* content_length = MHD_lookup_connection_value(
+      connection, MHD_HEADER_KIND, MHD_HTTP_HEADER_CONTENT_LENGTH);
+  // A request with neither header has no body.
+  if (!content_length)
+    return 0;
+  int64_t size = 0;
+  if (!base::StringToInt64(content_length, &size) || size < 0)
+    return -1;
+  return size;
+}
+
+}  // anonymous namespace
+
 // Helper class to provide static callback methods to microhttpd library,
 // with the ability to access private methods of Request class.
 class RequestHelper {
@@ -88,16 +119,6 @@ Request::Request(
       version_{version},
       connection_{connection},
       protocol_handler_{protocol_handler} {
-  // Here we create the data pipe used to transfer the request body from the
-  // web server to the remote request handler.
-  int pipe_fds[2] = {-1, -1};
-  CHECK_EQ(0, pipe(pipe_fds));
-  request_data_pipe_out_ = base::File{pipe_fds[0]};
-  CHECK(request_data_pipe_out_.IsValid());
-  request_data_stream_ = brillo::FileStream::FromFileDescriptor(
-      pipe_fds[1], true, nullptr);
-  CHECK(request_data_stream_);
-
   // POST request processor.
   post_processor_ = MHD_create_post_processor(
       connection, 1024, &RequestHelper::PostDataIterator, this);
@@ -124,15 +145,9 @@ base::File Request::Complete(
     const std::vector<std::tuple<std::string, std::string>>& headers,
     int64_t in_data_size) {
   base::File file;
-  if (response_data_started_)
+  if (!StartResponse(status_code, headers, in_data_size))
     return file;
 
-  response_status_code_ = status_code;
-  response_headers_.reserve(headers.size());
-  for (const auto& tuple : headers) {
-    response_headers_.emplace_back(std::get<0>(tuple), std::get<1>(tuple));
-  }
-
   // Create the pipe for response data.
   int pipe_fds[2] = {-1, -1};
   CHECK_EQ(0, pipe(pipe_fds));
@@ -142,14 +157,6 @@ base::File Request::Complete(
       pipe_fds[0], true, nullptr);
   CHECK(response_data_stream_);
 
-  response_data_size_ = in_data_size;
-  response_data_started_ = true;
-  const MHD_ConnectionInfo* info =
-      MHD_get_connection_info(connection_, MHD_CONNECTION_INFO_CLIENT_ADDRESS);
-
-  const sockaddr* client_addr = (info ? info->client_addr : nullptr);
-  LogManager::OnRequestCompleted(base::Time::Now(), client_addr, method_, url_,
-                                 version_, status_code, in_data_size);
   protocol_handler_->ScheduleWork();
   return file;
 }
@@ -162,6 +169,17 @@ bool Request::Complete(
   std::vector<std::tuple<std::string, std::string>> headers_copy;
   headers_copy.emplace_back(brillo::http::response_header::kContentType,
                             mime_type);
+  // The data is all there, so hand it over at once in a memory file rather
+  // than through a pipe.
+  base::ScopedFD data_file = CreateMemoryFile("webservd-response");
+  if (data_file.is_valid() &&
+      base::WriteFileDescriptor(data_file.get(), data.data(),
+                                static_cast<int>(data.size())) &&
+      SealMemoryFile(data_file.get())) {
+    return Complete(status_code, headers_copy, std::move(data_file),
+                    data.size());
+  }
+
   base::File file = Complete(status_code, headers_copy, data.size());
   bool success = false;
   if (file.IsValid()) {
@@ -171,12 +189,25 @@ bool Request::Complete(
   return success;
 }
 
+bool Request::Complete(
+    int32_t status_code,
+    const std::vector<std::tuple<std::string, std::string>>& headers,
+    base::ScopedFD data_file,
+    int64_t data_size) {
+  if (!StartResponse(status_code, headers, data_size))
+    return false;
+
+  response_data_file_ = std::move(data_file);
+  protocol_handler_->ScheduleWork();
+  return true;
+}
+
 const std::string& Request::GetProtocolHandlerID() const {
   return protocol_handler_->GetID();
 }
 
 int Request::GetBodyDataFileDescriptor() const {
-  int fd = dup(request_data_pipe_out_.GetPlatformFile());
+  int fd = dup(request_data_file_.GetPlatformFile());
   CHECK_GE(fd, 0);
   return fd;
 }
@@ -190,11 +221,28 @@ bool Request::BeginRequestData() {
                             &RequestHelper::ValueCallback, this);
   MHD_get_connection_values(connection_, MHD_GET_ARGUMENT_KIND,
                             &RequestHelper::ValueCallback, this);
+
+  // Small bodies are buffered in a memory file, which spares the handler
+  // reading them from a pipe chunk by chunk. The handler gets an empty one
+  // when we parse the POST data ourselves.
+  const int64_t body_size =
+      post_processor_ ? 0 : GetRequestBodySize(connection_);
+  if (body_size >= 0 && body_size <= kMaxBufferedBodySize) {
+    base::ScopedFD memory_file = CreateMemoryFile("webservd-request");
+    if (memory_file.is_valid()) {
+      request_data_file_ = base::File{memory_file.release()};
+      request_data_buffered_ = true;
+    }
+  }
+  if (!request_data_buffered_)
+    CreateRequestDataPipe();
+
   // If we have POST processor, then we are parsing the request ourselves and
   // we need to dispatch it to the handler only after all the data is parsed.
+  // Likewise, a buffered body is handed over once it has been received.
   // Otherwise forward the request immediately and let the handler read the
   // request data as needed.
-  if (!post_processor_)
+  if (!post_processor_ && (!request_data_buffered_ || body_size == 0))
     ForwardRequestToHandler();
   return true;
 }
@@ -218,9 +266,17 @@ void Request::EndRequestData() {
   }
 
   if (response_data_started_ && !response_data_finished_) {
-    MHD_Response* resp = MHD_create_response_from_callback(
-        response_data_size_, 4096, &Request::ResponseDataCallback, this,
-        nullptr);
+    MHD_Response* resp = nullptr;
+    if (response_data_file_.is_valid()) {
+      // libmicrohttpd takes ownership of the file and sends the data straight
+      // from it.
+      resp = MHD_create_response_from_fd(response_data_size_,
+                                         response_data_file_.release());
+    } else {
+      resp = MHD_create_response_from_callback(
+          response_data_size_, 4096, &Request::ResponseDataCallback, this,
+          nullptr);
+    }
     CHECK(resp);
     for (const auto& pair : response_headers_) {
       MHD_add_response_header(resp, pair.first.c_str(), pair.second.c_str());
@@ -235,6 +291,8 @@ void Request::EndRequestData() {
 
 void Request::ForwardRequestToHandler() {
   request_forwarded_ = true;
+  if (request_data_buffered_)
+    SealMemoryFile(request_data_file_.GetPlatformFile());
   if (!request_handler_id_.empty()) {
     // Close all temporary file streams, if any.
     for (auto& file : file_info_)
@@ -277,6 +335,17 @@ bool Request::ProcessPostData(const char* key,
 
 bool Request::AddRawRequestData(const void* data, size_t* size) {
   CHECK(*size);
+  if (request_data_buffered_) {
+    // Writing to the memory file never blocks. libmicrohttpd does not pass
+    // more data than the announced body size, which is small.
+    const int length = static_cast<int>(*size);
+    if (request_data_file_.WriteAtCurrentPos(static_cast<const char*>(data),
+                                             length) != length) {
+      return false;
+    }
+    *size = 0;
+    return true;
+  }
   CHECK(request_data_stream_) << "Data pipe hasn't been created.";
 
   size_t written = 0;
@@ -399,6 +468,42 @@ bool Request::AppendPostFieldData(const char* key,
   return true;
 }
 
+void Request::CreateRequestDataPipe() {
+  // Here we create the data pipe used to transfer the request body from the
+  // web server to the remote request handler.
+  int pipe_fds[2] = {-1, -1};
+  CHECK_EQ(0, pipe(pipe_fds));
+  request_data_file_ = base::File{pipe_fds[0]};
+  CHECK(request_data_file_.IsValid());
+  request_data_stream_ = brillo::FileStream::FromFileDescriptor(
+      pipe_fds[1], true, nullptr);
+  CHECK(request_data_stream_);
+}
+
+bool Request::StartResponse(
+    int32_t status_code,
+    const std::vector<std::tuple<std::string, std::string>>& headers,
+    int64_t data_size) {
+  if (response_data_started_)
+    return false;
+
+  response_status_code_ = status_code;
+  response_headers_.reserve(headers.size());
+  for (const auto& tuple : headers) {
+    response_headers_.emplace_back(std::get<0>(tuple), std::get<1>(tuple));
+  }
+
+  response_data_size_ = data_size;
+  response_data_started_ = true;
+  const MHD_ConnectionInfo* info =
+      MHD_get_connection_info(connection_, MHD_CONNECTION_INFO_CLIENT_ADDRESS);
+
+  const sockaddr* client_addr = (info ? info->client_addr : nullptr);
+  LogManager::OnRequestCompleted(base::Time::Now(), client_addr, method_, url_,
+                                 version_, status_code, data_size);
+  return true;
+}
+
 TempFileManager* Request::GetTempFileManager() {
   return protocol_handler_->GetServer()->GetTempFileManager();
 }
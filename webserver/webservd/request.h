@@ -13,6 +13,7 @@
 
 #include <base/files/file.h>
 #include <base/files/file_path.h>
+#include <base/files/scoped_file.h>
 #include <base/macros.h>
 #include <base/memory/weak_ptr.h>
 #include <brillo/streams/stream.h>
@@ -82,6 +83,14 @@ class Request final {
       const std::string& mime_type,
       const std::string& data);
 
+  // Finishes the request with the reply data in |data_file|, a sealed memory
+  // file of |data_size| bytes which is sent as is.
+  bool Complete(
+      int32_t status_code,
+      const std::vector<std::tuple<std::string, std::string>>& headers,
+      base::ScopedFD data_file,
+      int64_t data_size);
+
   // Returns the unique ID of this request (GUID).
   const std::string& GetID() const { return id_; }
 
@@ -99,12 +108,13 @@ class Request final {
   // Returns the request method (e.g. "GET", "POST", ...).
   const std::string& GetMethod() const { return method_; }
 
-  // Returns the output end of the body data stream pipe. The file descriptor
-  // is owned by the caller and must be closed when no longer needed.
-  // The pipe will contain the request body data, or no data if the request
-  // had no body or a POST request has been parsed into form data.
-  // In case there is no data, the file descriptor will represent a closed pipe,
-  // so reading from it will just indicate end-of-file (no data to read).
+  // Returns a file descriptor to read the request body data from. The file
+  // descriptor is owned by the caller and must be closed when no longer
+  // needed. It will provide no data if the request had no body or a POST
+  // request has been parsed into form data.
+  // Small bodies of a size known in advance are handed over complete, in a
+  // sealed memory file. Other bodies are streamed through a pipe, and this is
+  // the output end of it.
   int GetBodyDataFileDescriptor() const;
 
   // Returns the POST form field data.
@@ -156,6 +166,16 @@ class Request final {
                         size_t size);
   bool AppendPostFieldData(const char* key, const char* data, size_t size);
 
+  // Creates the pipe the request body data is streamed through.
+  void CreateRequestDataPipe();
+
+  // Records the response status and headers. Returns false if the request has
+  // already been completed.
+  bool StartResponse(
+      int32_t status_code,
+      const std::vector<std::tuple<std::string, std::string>>& headers,
+      int64_t data_size);
+
   // Callback to be called when data can be written to the output pipe again.
   void OnPipeAvailable(brillo::Stream::AccessMode mode);
 
@@ -175,10 +195,14 @@ class Request final {
   std::string version_;
   MHD_Connection* connection_{nullptr};
   MHD_PostProcessor* post_processor_{nullptr};
-  // Data pipe for request body data (output/read end of the pipe).
-  base::File request_data_pipe_out_;
-  // Data stream for the input/write end of the request data pipe.
+  // Request body data: either the output/read end of the data pipe, or the
+  // memory file the body is buffered in.
+  base::File request_data_file_;
+  // Data stream for the input/write end of the request data pipe. Not used
+  // when the body is buffered.
   brillo::StreamPtr request_data_stream_;
+  // Whether the request body is buffered in a memory file.
+  bool request_data_buffered_{false};
 
   bool last_posted_data_was_file_{false};
   bool request_forwarded_{false};
@@ -197,6 +221,9 @@ class Request final {
   int64_t response_data_size_{-1};
   // Data stream for the output/read end of the response data pipe.
   brillo::StreamPtr response_data_stream_;
+  // Memory file containing the whole response data, used instead of the
+  // response data pipe.
+  base::ScopedFD response_data_file_;
   std::vector<PairOfStrings> response_headers_;
   ProtocolHandler* protocol_handler_;
 
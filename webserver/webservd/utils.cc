@@ -4,7 +4,11 @@
 
 #include "webservd/utils.h"
 
+#include <fcntl.h>
+#include <sys/mman.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include <openssl/bio.h>
 #include <openssl/evp.h>
@@ -20,6 +24,9 @@ namespace webservd {
 
 namespace {
 
+// Seals which guarantee that the data of a memory file stays the same.
+constexpr int kMemoryFileSeals = F_SEAL_WRITE | F_SEAL_GROW | F_SEAL_SHRINK;
+
 // Returns the current date/time. This is used for TLS certificate validation
 // very early in process start when the system clock might not be adjusted
 // yet on devices that don't have a real-time clock. So, try to get the system
@@ -176,4 +183,30 @@ int CreateNetworkInterfaceSocket(const std::string& if_name) {
   return socket_fd;
 }
 
+base::ScopedFD CreateMemoryFile(const char* name) {
+  base::ScopedFD fd{memfd_create(name, MFD_CLOEXEC | MFD_ALLOW_SEALING)};
+  if (!fd.is_valid())
+    PLOG(ERROR) << "Failed to create memory file " << name;
+  return fd;
+}
+
+bool SealMemoryFile(int fd) {
+  if (lseek(fd, 0, SEEK_SET) != 0 ||
+      fcntl(fd, F_ADD_SEALS, kMemoryFileSeals | F_SEAL_SEAL) != 0) {
+    PLOG(ERROR) << "Failed to seal memory file";
+    return false;
+  }
+  return true;
+}
+
+int64_t GetSealedMemoryFileSize(int fd) {
+  int seals = fcntl(fd, F_GET_SEALS);
+  struct stat info;
+  if (seals < 0 || (seals & kMemoryFileSeals) != kMemoryFileSeals ||
+      fstat(fd, &info) != 0) {
+    return -1;
+  }
+  return info.st_size;
+}
+
 }  // namespace webservd
@@ -11,6 +11,7 @@
 #include <openssl/ossl_typ.h>
 
 #include <base/files/file_path.h>
+#include <base/files/scoped_file.h>
 #include <base/time/time.h>
 #include <brillo/secure_blob.h>
 
@@ -47,6 +48,18 @@ brillo::Blob GetSha256Fingerprint(X509* cert);
 // Returns a socket file descriptor or -1 on error.
 int CreateNetworkInterfaceSocket(const std::string& if_name);
 
+// Creates an anonymous file in memory (see memfd_create(2)) that can be
+// sealed with SealMemoryFile(). Returns an invalid descriptor on error.
+base::ScopedFD CreateMemoryFile(const char* name);
+
+// Rewinds the memory file |fd| and seals it, so that neither its contents nor
+// its size can change anymore. Returns false on error.
+bool SealMemoryFile(int fd);
+
+// Returns the size of |fd| if it is a memory file sealed against writes and
+// size changes, or -1 otherwise.
+int64_t GetSealedMemoryFileSize(int fd);
+
 }  // namespace webservd
 
 #endif  // WEBSERVER_WEBSERVD_UTILS_H_
@@ -0,0 +1,45 @@
+// Copyright 2020 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "webservd/utils.h"
+
+#include <unistd.h>
+
+#include <string>
+
+#include <base/files/file_util.h>
+#include <gtest/gtest.h>
+
+namespace webservd {
+
+TEST(Utils, SealedMemoryFile) {
+  const std::string data = "response data";
+  base::ScopedFD fd = CreateMemoryFile("test");
+  ASSERT_TRUE(fd.is_valid());
+  ASSERT_TRUE(base::WriteFileDescriptor(fd.get(), data.data(), data.size()));
+  // The file can still change.
+  EXPECT_EQ(-1, GetSealedMemoryFileSize(fd.get()));
+
+  ASSERT_TRUE(SealMemoryFile(fd.get()));
+  EXPECT_EQ(static_cast<int64_t>(data.size()),
+            GetSealedMemoryFileSize(fd.get()));
+  EXPECT_EQ(-1, write(fd.get(), "x", 1));
+  EXPECT_NE(0, ftruncate(fd.get(), 0));
+
+  // The data is read from the start.
+  char buffer[32] = {};
+  ASSERT_EQ(static_cast<ssize_t>(data.size()),
+            read(fd.get(), buffer, sizeof(buffer)));
+  EXPECT_EQ(data, std::string(buffer, data.size()));
+}
+
+TEST(Utils, PipeIsNotSealedMemoryFile) {
+  int pipe_fds[2];
+  ASSERT_EQ(0, pipe(pipe_fds));
+  base::ScopedFD read_fd{pipe_fds[0]};
+  base::ScopedFD write_fd{pipe_fds[1]};
+  EXPECT_EQ(-1, GetSealedMemoryFileSize(read_fd.get()));
+}
+
+}  // namespace webservd